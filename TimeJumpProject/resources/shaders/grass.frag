@@ -0,0 +1,21 @@
+#version 330 core
+in vec3 vWorldPos;
+in vec3 vNormal;
+in float vLevel;
+in float vTint;
+out vec4 FragColor;
+
+uniform vec3 lightPos;
+uniform vec3 lightColor;
+uniform vec3 ambientColor;
+uniform vec3 baseColor;
+uniform vec3 tipColor;
+
+void main() {
+    vec3 albedo = mix(baseColor, tipColor, vLevel) * mix(0.8, 1.15, vTint);
+    // two-sided blades: light whichever face points at the sun
+    vec3 N = normalize(vNormal);
+    vec3 L = normalize(lightPos - vWorldPos);
+    float diff = abs(dot(N, L)) * 0.7 + 0.3 * vLevel;
+    FragColor = vec4(ambientColor * albedo + diff * lightColor * albedo, 1.0);
+}
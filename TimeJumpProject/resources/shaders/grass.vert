@@ -0,0 +1,92 @@
+#version 330 core
+// Procedural grass: no vertex buffers. gl_InstanceID picks a blade inside the
+// current tile, gl_VertexID picks a corner of that blade.
+
+uniform mat4 uView;
+uniform mat4 uProj;
+
+uniform sampler2D uHeightMap;   // terrain heights, R32F, 0..1
+uniform vec2 uHeightMapSize;    // texels
+uniform float uHeightScale;     // world Y of height 1.0
+uniform float uTerrainSize;     // world width/depth of the terrain
+
+uniform vec2 uTileOrigin;       // world XZ of the tile's min corner
+uniform float uTileSize;
+uniform int uTileSeed;
+uniform float uBladeCount;      // blades drawn in this tile (fractional -> last blades shrink in)
+uniform float uWidthScale;      // widens blades when the tile is thinned out
+
+uniform float uTime;
+uniform vec2 uWindDir;
+uniform float uWindStrength;
+
+out vec3 vWorldPos;
+out vec3 vNormal;
+out float vLevel;
+out float vTint;
+
+// 15 corners: two tapered quads and a tip triangle. x = side, y = level.
+const vec2 kBlade[15] = vec2[15](
+    vec2(-1.0, 0.0),  vec2(1.0, 0.0),  vec2(1.0, 0.35),
+    vec2(-1.0, 0.0),  vec2(1.0, 0.35), vec2(-1.0, 0.35),
+    vec2(-1.0, 0.35), vec2(1.0, 0.35), vec2(1.0, 0.7),
+    vec2(-1.0, 0.35), vec2(1.0, 0.7),  vec2(-1.0, 0.7),
+    vec2(-1.0, 0.7),  vec2(1.0, 0.7),  vec2(0.0, 1.0));
+
+uint Hash(uint x) {
+    x ^= x >> 16; x *= 0x7feb352du;
+    x ^= x >> 15; x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+float Rand(inout uint s) {
+    s = Hash(s);
+    return float(s & 0xFFFFFFu) / 16777216.0;
+}
+
+float TerrainHeight(vec2 xz) {
+    vec2 uv = clamp((xz + 0.5 * uTerrainSize) / uTerrainSize, 0.0, 1.0);
+    // match Terrain::GetHeightAt: heightmap samples sit on texel centres
+    uv = (uv * (uHeightMapSize - 1.0) + 0.5) / uHeightMapSize;
+    return texture(uHeightMap, uv).r * uHeightScale;
+}
+
+void main() {
+    int id = gl_InstanceID;
+    uint seed = Hash(uint(uTileSeed) ^ Hash(uint(id)));
+
+    // R2 low-discrepancy sequence: every prefix is evenly spread, so drawing
+    // fewer blades at distance thins the same field instead of reshuffling it
+    uint tileHash = Hash(uint(uTileSeed));
+    vec2 offset = vec2(float(tileHash & 0xFFFFu), float(tileHash >> 16)) / 65536.0;
+    vec2 r2 = fract(offset + float(id) * vec2(0.7548776662, 0.5698402910));
+    vec2 xz = uTileOrigin + r2 * uTileSize;
+
+    float facing = Rand(seed) * 6.2831853;
+    float height = mix(0.35, 0.9, Rand(seed));
+    float width = mix(0.025, 0.045, Rand(seed)) * uWidthScale;
+    float lean = Rand(seed) * 0.3;
+    vTint = Rand(seed);
+
+    // blades past the drawn count grow in smoothly instead of popping
+    height *= clamp(uBladeCount - float(id), 0.0, 1.0);
+
+    vec2 corner = kBlade[gl_VertexID];
+    float level = corner.y;
+    vec3 side = vec3(cos(facing), 0.0, sin(facing));
+    vec3 front = vec3(-side.z, 0.0, side.x);
+
+    vec3 base = vec3(xz.x, TerrainHeight(xz), xz.y);
+    vec3 p = base + side * (corner.x * width * (1.0 - level)) + vec3(0.0, level * height, 0.0);
+
+    // bend grows with level^2; gusts travel across the field along the wind direction
+    float phase = dot(xz, uWindDir) * 0.15 - uTime * 1.7 + vTint * 1.3;
+    float sway = (sin(phase) * 0.6 + sin(phase * 2.3 + 1.1) * 0.25 + 0.45) * uWindStrength;
+    vec2 bend = uWindDir * sway + front.xz * lean;
+    p.xz += bend * (level * level) * height;
+
+    vNormal = normalize(front + vec3(0.0, 0.4, 0.0));
+    vLevel = level;
+    vWorldPos = p;
+    gl_Position = uProj * uView * vec4(p, 1.0);
+}
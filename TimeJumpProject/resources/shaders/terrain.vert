@@ -6,14 +6,20 @@ layout(location=2) in vec2 aTex;
 uniform mat4 uModel;
 uniform mat4 uView;
 uniform mat4 uProj;
+// quantized vertices: value = stored * scale + offset (Terrain::GetDequant)
+uniform vec3 uPosScale = vec3(1.0);
+uniform vec3 uPosOffset = vec3(0.0);
+uniform vec2 uUvScale = vec2(1.0);
+uniform vec2 uUvOffset = vec2(0.0);
 
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoord;
 
 void main(){
-    FragPos = vec3(uModel * vec4(aPos,1.0));
+    vec3 pos = aPos * uPosScale + uPosOffset;
+    FragPos = vec3(uModel * vec4(pos,1.0));
     Normal = mat3(transpose(inverse(uModel))) * aNormal;
-    TexCoord = aTex;
+    TexCoord = aTex * uUvScale + uUvOffset;
     gl_Position = uProj * uView * vec4(FragPos, 1.0);
 }
@@ -2,6 +2,7 @@
 in vec2 vUV;
 in vec3 vNormal;
 in vec3 vWorldPos;
+in float vAge;
 out vec4 FragColor;
 
 uniform sampler2D uTex;        // diffuse atlas / texture
@@ -9,16 +10,29 @@ uniform vec3 lightPos;
 uniform vec3 lightColor;
 uniform vec3 ambientColor;
 uniform vec3 viewPos;
+uniform float uFade = 1.0;     // era cross-fade weight (1 = solid)
+uniform bool uFadeInvert = false; // odd eras keep the other end of the noise
+uniform bool uBlend = false;   // sorted, alpha-blended foliage pass
+uniform float uAlphaCutoff = 0.5;
 
 void main(){
+    // screen-door fade: dithered discard keeps the pass opaque, so no sorting needed
+    if (uFade < 1.0) {
+        float n = fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+        // neighbouring eras' fades sum to 1, so their patterns tile the pixels between them
+        if (uFadeInvert ? n < 1.0 - uFade : n >= uFade) discard;
+    }
     vec3 N = normalize(vNormal);
     vec3 L = normalize(lightPos - vWorldPos);
     float diff = max(dot(N,L), 0.0);
     vec3 col = texture(uTex, vUV).rgb;
+    // old trees fade towards grey
+    float grey = dot(col, vec3(0.299, 0.587, 0.114));
+    col = mix(col, vec3(grey), clamp((vAge - 90.0) / 120.0, 0.0, 0.35));
     // if texture has alpha and we want to discard fully transparent pixels:
     float a = texture(uTex, vUV).a;
-    if (a < 0.5) discard;
+    if (a < uAlphaCutoff) discard;
     vec3 ambient = ambientColor * col;
     vec3 diffuse = diff * lightColor * col;
-    FragColor = vec4(ambient + diffuse, 1.0);
+    FragColor = vec4(ambient + diffuse, uBlend ? a : 1.0);
 }
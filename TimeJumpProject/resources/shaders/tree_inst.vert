@@ -7,19 +7,32 @@ layout(location=3) in vec4 iMat0;
 layout(location=4) in vec4 iMat1;
 layout(location=5) in vec4 iMat2;
 layout(location=6) in vec4 iMat3;
+// forest growth: scale from/to, age from/to (years)
+layout(location=7) in vec4 iGrowth;
 
 uniform mat4 uView;
 uniform mat4 uProj;
+uniform float uGrowthBlend = 1.0; // 0 = state before the last jump, 1 = after
+// quantized mesh attributes: value = stored * scale + offset (VertexDequant)
+uniform vec3 uPosScale = vec3(1.0);
+uniform vec3 uPosOffset = vec3(0.0);
+uniform vec2 uUvScale = vec2(1.0);
+uniform vec2 uUvOffset = vec2(0.0);
 
 out vec2 vUV;
 out vec3 vNormal;
 out vec3 vWorldPos;
+out float vAge;
 
 void main() {
     mat4 inst = mat4(iMat0, iMat1, iMat2, iMat3);
-    vec4 worldPos = inst * vec4(aPos, 1.0);
+    // grow around the root; the matrix keeps the tree's base scale and rotation
+    float growth = mix(iGrowth.x, iGrowth.y, uGrowthBlend);
+    vAge = mix(iGrowth.z, iGrowth.w, uGrowthBlend);
+    vec3 pos = aPos * uPosScale + uPosOffset;
+    vec4 worldPos = inst * vec4(pos * growth, 1.0);
     vWorldPos = worldPos.xyz;
     vNormal = mat3(inst) * aNormal; // simple normal transform
-    vUV = aUV;
+    vUV = aUV * uUvScale + uUvOffset;
     gl_Position = uProj * uView * worldPos;
 }
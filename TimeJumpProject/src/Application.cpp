@@ -22,8 +22,14 @@
 #include "TextRenderer.h"
 #include "EnvSphere.h"
 
+#include "AssetLoader.h"
+#include "AssetPack.h"
+#include "SharedCache.h"
 #include "ModelLoader.h"
+#include "TextureManager.h"
 #include "TreeInstancer.h"
+#include "GrassRenderer.h"
+#include "ForestSim.h"
 
 // ---------- Globals ----------
 int WIN_W = 1280;
@@ -43,6 +49,12 @@ Shader postShader;
 float jumpAnim = 0.0f;   
 float jumpTarget = 0.0f; 
 bool timeJumpOn = false; 
+bool forestJumpRequested = false; // T: age the forest by forestYearsPerJump
+const float forestYearsPerJump = 25.0f;
+size_t textureBudgetMB = 256;     // VRAM for textures; least recently drawn lose mips beyond it (0 = no limit)
+bool sharedAssetCache = false;    // several instances on one host: decode assets once for all (SharedCache.h)
+float growthBlend = 1.0f;         // uGrowthBlend, animates each forest jump
+bool blendFoliage = false;        // B: sorted alpha blending (for a leaf-card species; skips LOD/MDI culling)
 // alt sky & textures
 
 Skybox skyDead;  // new alternative sky
@@ -55,17 +67,23 @@ Skybox sky;
 bool okTerrain = false, okTerrainShader = false, okSkyShader = false;
 unsigned int blackTex = 0;
 
+// static meshes share one VAO/VBO/EBO per vertex format
+GeometryArena sphereArena(SphereVertexLayout::stride, &SphereVertexLayout::Apply);
+GeometryArena modelArena(ModelVertexLayout::stride, &ModelVertexLayout::Apply);
+
 MeshGL sunSphere;
 Shader sunShader;
 
 MeshGL reflectiveSphere;
 Shader envShader;
 
-MeshGL_Model treeMesh;
-GLuint treeDiffuse = 0;
-TreeInstancer treeInstancer;
 GLsizei treeInstanceCount = 0;
 Shader treeShader;
+bool okTreeShader = false;
+
+GrassRenderer grass;
+Shader grassShader;
+bool okGrass = false;
 
 // HUD
 TextRenderer ui;
@@ -92,34 +110,70 @@ struct SpotState {
 // single global spotlight you can toggle / move
 static SpotState gSpot;
 
-static void UploadSpotToShader(Shader& shader, const std::string& name, const SpotState& st) {
+// the members of a SpotLight uniform, looked up once per program
+struct SpotUniforms {
+    unsigned int program = 0;
+    UniformHandle<glm::vec3> position, direction, color;
+    UniformHandle<float> cutOff, outerCutOff, intensity, constant, linear, quadratic;
+    UniformHandle<bool> enabled;
+
+    void Resolve(const Shader& shader, const std::string& name) {
+        program = shader.ID;
+        position = shader.Uniform<glm::vec3>((name + ".position").c_str());
+        direction = shader.Uniform<glm::vec3>((name + ".direction").c_str());
+        cutOff = shader.Uniform<float>((name + ".cutOff").c_str());
+        outerCutOff = shader.Uniform<float>((name + ".outerCutOff").c_str());
+        color = shader.Uniform<glm::vec3>((name + ".color").c_str());
+        intensity = shader.Uniform<float>((name + ".intensity").c_str());
+        constant = shader.Uniform<float>((name + ".constant").c_str());
+        linear = shader.Uniform<float>((name + ".linear").c_str());
+        quadratic = shader.Uniform<float>((name + ".quadratic").c_str());
+        enabled = shader.Uniform<bool>((name + ".enabled").c_str());
+    }
+};
+
+static SpotUniforms gSpotUniforms;
+
+static void UploadSpotToShader(const Shader& shader, const std::string& name, SpotUniforms& u, const SpotState& st) {
     // assume shader.Use() already called
-    shader.SetVec3(name + ".position", st.position);
-    shader.SetVec3(name + ".direction", glm::normalize(st.direction));
-    shader.SetFloat(name + ".cutOff", cos(glm::radians(st.innerAngleDeg)));
-    shader.SetFloat(name + ".outerCutOff", cos(glm::radians(st.outerAngleDeg)));
-    shader.SetVec3(name + ".color", st.color);
-    shader.SetFloat(name + ".intensity", st.intensity);
-    shader.SetFloat(name + ".constant", st.constant);
-    shader.SetFloat(name + ".linear", st.linear);
-    shader.SetFloat(name + ".quadratic", st.quadratic);
-    shader.SetInt(name + ".enabled", st.enabled ? 1 : 0);
+    if (u.program != shader.ID) u.Resolve(shader, name);
+    shader.Set(u.position, st.position);
+    shader.Set(u.direction, glm::normalize(st.direction));
+    shader.Set(u.cutOff, cos(glm::radians(st.innerAngleDeg)));
+    shader.Set(u.outerCutOff, cos(glm::radians(st.outerAngleDeg)));
+    shader.Set(u.color, st.color);
+    shader.Set(u.intensity, st.intensity);
+    shader.Set(u.constant, st.constant);
+    shader.Set(u.linear, st.linear);
+    shader.Set(u.quadratic, st.quadratic);
+    shader.Set(u.enabled, st.enabled);
 }
 
 // ----------------- Helper: find resources folder -----------------
-static std::string GetResourcePath(const std::string& relativePath) {
-    namespace fs = std::filesystem;
-    fs::path dir = fs::current_path();
-    for (int i = 0; i < 6; ++i) {
-        fs::path candidate = dir / "resources";
-        if (fs::exists(candidate) && fs::is_directory(candidate)) {
-            return (dir / relativePath).lexically_normal().string();
+// the folder holding resources/ or resources.pack, looked up once
+static const std::filesystem::path& ResourceRoot() {
+    static const std::filesystem::path root = [] {
+        namespace fs = std::filesystem;
+        fs::path dir = fs::current_path();
+        for (int i = 0; i < 6; ++i) {
+            if (fs::is_directory(dir / "resources") || fs::exists(dir / kAssetPackName)) return dir;
+            if (dir.has_parent_path()) dir = dir.parent_path();
+            else break;
         }
-        if (dir.has_parent_path()) dir = dir.parent_path();
-        else break;
-    }
-    fs::path fallback = fs::current_path() / relativePath;
-    return fs::absolute(fallback).lexically_normal().string();
+        return fs::absolute(fs::current_path());
+    }();
+    return root;
+}
+
+static std::string GetResourcePath(const std::string& relativePath) {
+    return (ResourceRoot() / relativePath).lexically_normal().string();
+}
+
+// a .glb exported next to the .obj wins: its binary accessors decode without a text
+// parse, then get the same passes (LODs) as the OBJ
+static std::string ModelPath(const std::string& objPath) {
+    std::string glbPath = std::filesystem::path(objPath).replace_extension(".glb").string();
+    return ResourceExists(glbPath) ? glbPath : objPath;
 }
 static void CreatePostResources(int width, int height) {
     // delete old if present
@@ -198,11 +252,18 @@ int main() {
         std::cerr << "ERROR: GLFW init failed\n";
         return -1;
     }
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    // 4.3 for multi-draw indirect (GeometryArena.h); 3.3 runs the same frame with
+    // one draw per command
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
     gWindow = glfwCreateWindow(WIN_W, WIN_H, "TimeJump - Terrain Demo", nullptr, nullptr);
+    if (!gWindow) {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        gWindow = glfwCreateWindow(WIN_W, WIN_H, "TimeJump - Terrain Demo", nullptr, nullptr);
+    }
     if (!gWindow) {
         std::cerr << "ERROR: Window creation failed\n";
         glfwTerminate();
@@ -214,6 +275,11 @@ int main() {
         std::cerr << "ERROR: Failed to initialize GLAD\n";
         return -1;
     }
+    bool multiDraw = IndirectDrawList::LoadMultiDraw((GLADloadproc)glfwGetProcAddress);
+    TextureManager::LoadTextureStorage((GLADloadproc)glfwGetProcAddress);
+    TextureManager::Instance().SetBudget(textureBudgetMB << 20);
+    std::cout << "OpenGL " << GLVersion.major << "." << GLVersion.minor
+        << (multiDraw ? " (multi-draw indirect)" : "") << "\n";
 
     // callbacks
     glfwSetFramebufferSizeCallback(gWindow, framebuffer_size_callback);
@@ -230,121 +296,194 @@ int main() {
     std::cout << "Renderer: " << glGetString(GL_RENDERER) << "\n";
     std::cout << "OpenGL: " << glGetString(GL_VERSION) << "\n";
 
-    // ---------- Load / compile shaders ----------
-    okTerrainShader = terrainShader.LoadFromFiles(
-        GetResourcePath("resources/shaders/terrain.vert"),
-        GetResourcePath("resources/shaders/terrain.frag")
-    );
-    if (!okTerrainShader) std::cerr << "ERROR: terrain shader failed\n";
-
-    okSkyShader = skyShader.LoadFromFiles(
-        GetResourcePath("resources/shaders/skybox.vert"),
-        GetResourcePath("resources/shaders/skybox.frag")
-    );
-    if (!okSkyShader) std::cerr << "ERROR: sky shader failed\n";
-
-    bool okEnvShader = envShader.LoadFromFiles(
-        GetResourcePath("resources/shaders/env_vert.glsl"),
-        GetResourcePath("resources/shaders/env_frag.glsl")
-    );
-    if (!okEnvShader) std::cerr << "ERROR: env shader failed\n";
-
-    // ---------- Load terrain ----------
-    okTerrain = terrain.Load(
-        GetResourcePath("resources/textures/heightmap.png"),
-        GetResourcePath("resources/textures/grass.jpg"),
-        25.0f, 400.0f
-    );
-    if (!okTerrain) std::cerr << "ERROR: terrain failed to load\n";
-
-
-    MeshGL_Model treeMesh;
-    if (!LoadOBJWithMaterials(GetResourcePath("resources/models/Tree1.obj"), treeMesh)) {
-        std::cerr << "Failed to load Tree1.obj\n";
-    }
-    else {
-        std::cout << "Tree loaded. submeshes: " << treeMesh.submeshes.size()
-            << " materials: " << treeMesh.materials.size() << "\n";
+    // ---------- Small black texture: fallback, and placeholder until textures arrive ----------
+    {
+        unsigned char px[3] = { 0, 0, 0 };
+        TextureOptions options;
+        options.mipmaps = false;
+        blackTex = TextureManager::Instance().Create(GL_RGB8, 1, 1, GL_RGB, GL_UNSIGNED_BYTE, px, options);
     }
 
-
-    treeShader.LoadFromFiles(GetResourcePath("resources/shaders/tree_inst.vert"), GetResourcePath("resources/shaders/tree_inst.frag"));
-    GLuint treeShaderID = treeShader.ID;
-
-
+    // ---------- Assets ----------
+    // packed (see pack_assets.cpp) when resources.pack is there; loose files otherwise,
+    // and for whatever the pack lacks
+    std::string packPath = GetResourcePath(kAssetPackName);
+    if (std::filesystem::exists(packPath) && AssetPack::Mount(packPath))
+        std::cout << "Assets: " << packPath << ", " << AssetPack::Mounted()->EntryCount() << " files\n";
+    if (sharedAssetCache && EnableSharedCache())
+        std::cout << "Assets: sharing decoded data in " << SharedCacheFolder() << "\n";
+
+    // Nothing below waits for a file: the loader reads and decodes on its own threads
+    // and assets.Update (main loop) uploads a few ms' worth per frame, so the first
+    // frame is up at once and the scene fills in as its parts arrive.
+    bool okEnvShader = false, okSunShader = false;
     TreeInstancer inst;
-    TreeInstancer instancer;
-    inst.GenerateInstances(100, -90.0f, 90.0f, -90.0f, 90.0f, terrain, 0.4f, 1.0f);
-    inst.UploadInstancesToGPU(treeMesh);
-
- 
-
-
-    // ---------- Load skybox ----------
-    std::vector<std::string> faces = {
+    ForestSim forest;
+    int liveTrees = -1, deadTrees = -1;
+    AssetLoader assets; // after everything its jobs write to, so it stops first
+    auto loadStart = std::chrono::high_resolution_clock::now();
+
+    // shaders compile on the GL thread, one per finish step
+    auto compileShader = [&assets](Shader& shader, bool& ok, const char* vs, const char* fs, const char* name) {
+        return assets.Run(nullptr, [&shader, &ok, vs, fs, name] {
+            ok = shader.LoadFromFiles(GetResourcePath(vs), GetResourcePath(fs));
+            if (!ok) std::cerr << "ERROR: " << name << " shader failed\n";
+            return ok;
+        });
+    };
+    compileShader(terrainShader, okTerrainShader, "resources/shaders/terrain.vert", "resources/shaders/terrain.frag", "terrain");
+    compileShader(skyShader, okSkyShader, "resources/shaders/skybox.vert", "resources/shaders/skybox.frag", "sky");
+    compileShader(envShader, okEnvShader, "resources/shaders/env_vert.glsl", "resources/shaders/env_frag.glsl", "env");
+    compileShader(sunShader, okSunShader, "resources/shaders/sun.vert", "resources/shaders/sun.frag", "sun");
+    compileShader(treeShader, okTreeShader, "resources/shaders/tree_inst.vert", "resources/shaders/tree_inst.frag", "tree");
+
+    // ---------- Terrain: mesh built on a worker, drawn black until its texture is in ----------
+    JobHandle terrainJob = assets.Run(
+        [] {
+            if (terrain.LoadHeightmap(GetResourcePath("resources/textures/heightmap.png"), 25.0f, 400.0f)) return true;
+            std::cerr << "ERROR: terrain failed to load\n";
+            return false;
+        },
+        [] {
+            okTerrain = terrain.Upload();
+            if (okTerrain) terrain.SetTexture(blackTex);
+            return okTerrain;
+        });
+    TextureOptions albedoOptions;
+    albedoOptions.flipVertically = false;
+    TextureHandle grassTexture = assets.LoadTexture(GetResourcePath("resources/textures/grass.jpg"), albedoOptions);
+    assets.Run(nullptr, [&assets, grassTexture] {
+        terrainDefaultTex = assets.Texture(grassTexture); // the handle's reference, kept while the terrain shows sand
+        if (!terrainDefaultTex) {
+            std::cerr << "Terrain: failed to load texture\n";
+            return false;
+        }
+        if (terrain.GetTexture() == blackTex) terrain.SetTexture(terrainDefaultTex);
+        return true;
+    }, { grassTexture.id, terrainJob.id });
+
+    TextureHandle sand = assets.LoadTexture(GetResourcePath("resources/textures/sand.jpg"));
+    assets.Run(nullptr, [&assets, sand] {
+        sandTexture = assets.Texture(sand);
+        if (!sandTexture) std::cerr << "Warning: failed to load sand texture\n";
+        return sandTexture != 0;
+    }, { sand.id });
+
+    // ---------- Grass (generated on the GPU from the terrain height texture) ----------
+    assets.Run(nullptr, [] {
+        okGrass = okTerrain && grassShader.LoadFromFiles(
+            GetResourcePath("resources/shaders/grass.vert"),
+            GetResourcePath("resources/shaders/grass.frag")
+        ) && grass.Init(terrain, 16.0f);
+        if (!okGrass) std::cerr << "Warning: grass disabled\n";
+        return okGrass;
+    }, { terrainJob.id });
+
+    // ---------- Skyboxes: the clear colour shows until the cubemaps are in ----------
+    auto loadSky = [&assets](Skybox& box, const std::vector<std::string>& faces, const char* warning) {
+        TextureHandle cubemap = assets.LoadCubemap(faces, Skybox::CubemapOptions());
+        assets.Run(nullptr, [&assets, &box, cubemap, warning] {
+            GLuint tex = assets.Texture(cubemap);
+            bool ok = tex && box.SetCubemap(tex);
+            TextureManager::Instance().Release(tex); // SetCubemap holds its own reference
+            if (!ok) std::cerr << warning << "\n";
+            return ok;
+        }, { cubemap.id });
+    };
+    loadSky(sky, {
         GetResourcePath("resources/skybox/right.png"),
         GetResourcePath("resources/skybox/left.png"),
         GetResourcePath("resources/skybox/top.png"),
         GetResourcePath("resources/skybox/bottom.png"),
         GetResourcePath("resources/skybox/front.png"),
         GetResourcePath("resources/skybox/back.png")
-    };
-    if (!sky.Load(faces)) {
-        std::cerr << "Warning: Skybox failed to load faces\n";
-    }
-
-    terrainDefaultTex = terrain.GetTexture();
-    bool dummyAlpha = false;
-    sandTexture = LoadTexture2D(GetResourcePath("resources/textures/sand.jpg"), dummyAlpha);
-    if (!sandTexture) {
-        std::cerr << "Warning: failed to load sand texture\n";
-        
-    }
-
-     std::vector<std::string> deadFaces = {
-GetResourcePath("resources/skybox_dry/right.png"),
-GetResourcePath("resources/skybox_dry/left.png"),
-GetResourcePath("resources/skybox_dry/top.png"),
-GetResourcePath("resources/skybox_dry/bottom.png"),
-GetResourcePath("resources/skybox_dry/front.png"),
-GetResourcePath("resources/skybox_dry/back.png")
- };
-    if (!skyDead.Load(deadFaces)) {
-        std::cerr << "Warning: failed to load alternate skybox (skybox_dry)";
-        
-    }
-
-    bool okSunShader = sunShader.LoadFromFiles(
-        GetResourcePath("resources/shaders/sun.vert"),
-        GetResourcePath("resources/shaders/sun.frag")
-    );
-    if (!okSunShader) std::cerr << "ERROR: sun shader failed\n";
+    }, "Warning: Skybox failed to load faces");
+    loadSky(skyDead, {
+        GetResourcePath("resources/skybox_dry/right.png"),
+        GetResourcePath("resources/skybox_dry/left.png"),
+        GetResourcePath("resources/skybox_dry/top.png"),
+        GetResourcePath("resources/skybox_dry/bottom.png"),
+        GetResourcePath("resources/skybox_dry/front.png"),
+        GetResourcePath("resources/skybox_dry/back.png")
+    }, "Warning: failed to load alternate skybox (skybox_dry)");
+
+    // ---------- Trees ----------
+    // all species of every era are loaded and uploaded up front; the time jump
+    // only changes which batches draw (TreeInstancer::SetEra), never loads anything
+    ModelHandle treeModel = assets.LoadModel(ModelPath(GetResourcePath("resources/models/Tree1.obj")), &modelArena);
+    ModelHandle deadTreeModel = assets.LoadModel(ModelPath(GetResourcePath("resources/models/DeadTree.obj")), &modelArena);
+    static const MeshGL_Model noMesh; // a species whose model failed draws nothing
+    JobHandle speciesJob = assets.Run(nullptr, [&] {
+        const MeshGL_Model* treeMesh = assets.Model(treeModel);
+        const MeshGL_Model* deadTreeMesh = assets.Model(deadTreeModel);
+        if (!treeMesh) {
+            std::cerr << "Failed to load Tree1.obj\n";
+        }
+        else {
+            std::cout << "Tree loaded. submeshes: " << treeMesh->submeshes.size()
+                << " materials: " << treeMesh->materials.size()
+                << " vertices: " << treeMesh->vertexCount << " indices: " << treeMesh->indexCount << "\n";
+            for (size_t l = 0; l < treeMesh->lods.size(); ++l) {
+                size_t lodIndices = 0;
+                for (const SubMeshRange& r : treeMesh->lods[l].submeshes) lodIndices += r.indexCount;
+                std::cout << "  LOD " << (l + 1) << ": " << lodIndices / 3 << " triangles, error "
+                    << treeMesh->lods[l].error << "\n";
+            }
+        }
+        if (!deadTreeMesh) std::cerr << "Failed to load DeadTree.obj\n";
+        liveTrees = inst.AddSpecies(treeMesh ? *treeMesh : noMesh, 0);
+        deadTrees = inst.AddSpecies(deadTreeMesh ? *deadTreeMesh : noMesh, 1);
+        return true;
+    }, { treeModel.id, deadTreeModel.id });
+
+    // placement samples the terrain: on a worker once the species and heights are in;
+    // nothing touches inst before treeInstanceCount is set
+    assets.Run([&] {
+        if (!okTerrain) return false;
+        ScatterRules treeRules;
+        treeRules.seed = 1337;
+        treeRules.minX = -90.0f; treeRules.maxX = 90.0f;
+        treeRules.minZ = -90.0f; treeRules.maxZ = 90.0f;
+        treeRules.minSpacing = 12.0f;
+        treeRules.maxSlopeDeg = 30.0f;
+        treeRules.minScale = 0.4f; treeRules.maxScale = 1.0f;
+        ScatterStats treeStats = inst.ScatterInstances(liveTrees, terrain, treeRules);
+        std::cout << "Scattered " << inst.InstanceCount(liveTrees) << " trees (" << treeStats.candidates
+            << " candidates) in " << treeStats.milliseconds << " ms\n";
+
+        // the dry era keeps fewer, sparser survivors
+        ScatterRules deadRules = treeRules;
+        deadRules.seed = 7331;
+        deadRules.minSpacing = 20.0f;
+        inst.ScatterInstances(deadTrees, terrain, deadRules);
+
+        // scattering already sorted both species into 32 m cells
+        // the living forest ages with every time jump (growth, die-off, seedlings)
+        ForestParams forestParams;
+        forestParams.placement = treeRules;
+        forest.Init(inst, liveTrees, terrain, forestParams);
+        return true;
+    }, [&] {
+        for (int s = 0; s < inst.SpeciesCount(); ++s) inst.UploadInstancesToGPU(s);
+        treeInstanceCount = (GLsizei)inst.TotalInstanceCount();
+        return true;
+    }, { speciesJob.id, terrainJob.id });
 
     CreatePostResources(WIN_W, WIN_H);
     postShader.LoadFromFiles(GetResourcePath("resources/shaders/post.vs"),
         GetResourcePath("resources/shaders/post.fs"));
 
     // ---------- Create env-mapped sphere ----------
-    reflectiveSphere = CreateUVSphere(48, 48, 6.0f);
+    reflectiveSphere = CreateUVSphere(48, 48, 6.0f, &sphereArena);
     // initial placement: above terrain so it's visible (adjust later to sample terrain height)
     reflectiveSphere.model = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 40.0f, 0.0f));
     reflectiveSphere.model = glm::scale(reflectiveSphere.model, glm::vec3(2.0f));
-    sunSphere = CreateUVSphere(24, 24, 15.0f);
+    sunSphere = CreateUVSphere(24, 24, 15.0f, &sphereArena);
 
     // ---------- Camera ----------
     gCamera.mode = CamMode::AUTO;
     gCamera.pos = glm::vec3(0.0f, 30.0f, 80.0f);
 
-    // ---------- Small black texture fallback ----------
-    {
-        unsigned char px[3] = { 0, 0, 0 };
-        glGenTextures(1, &blackTex);
-        glBindTexture(GL_TEXTURE_2D, blackTex);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, px);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    }
-
     // Example: attach spot to camera: place this after gCamera has been set up
     gSpot.position = gCamera.pos + glm::vec3(0.0f, 0.5f, 0.0f);   // just above camera
     gSpot.direction = gCamera.front; // if your camera has a 'front' vector
@@ -365,6 +504,7 @@ GetResourcePath("resources/skybox_dry/back.png")
     double fpsTimer = 0.0;
     int fpsFrames = 0;
     double fpsValue = 0.0;
+    int framesLoading = 0;
 
     // ---------- Main loop ----------
     while (!glfwWindowShouldClose(gWindow)) {
@@ -375,6 +515,11 @@ GetResourcePath("resources/skybox_dry/back.png")
         lastFrameTime = t;
         globalTime = t;
 
+        // finish what the loader threads prepared, a few ms' worth
+        assets.Update();
+        // texture budget, then larger mips of streamed textures, a few MB per frame
+        TextureManager::Instance().BeginFrame();
+
         // input + camera update
         process_free_camera_input(delta);
         if (gCamera.mode == CamMode::AUTO) gCamera.UpdateAuto(globalTime);
@@ -421,12 +566,13 @@ GetResourcePath("resources/skybox_dry/back.png")
             terrainShader.SetMat4("uView", view);
             terrainShader.SetMat4("uProj", proj);
             terrainShader.SetMat4("uModel", terrain.model);
+            SetDequantUniforms(terrainShader, terrain.GetDequant());
 
             bool attachSpotToCamera = true;
             if (attachSpotToCamera) {
                 gSpot.position = gCamera.pos + glm::vec3(0.0f, 0.5f, 0.0f);
                 gSpot.direction = gCamera.front; // adapt to your camera API
-                UploadSpotToShader(terrainShader, "spot", gSpot);
+                UploadSpotToShader(terrainShader, "spot", gSpotUniforms, gSpot);
             }
             
             terrainShader.SetVec3("lightPos", sunPos);
@@ -441,6 +587,58 @@ GetResourcePath("resources/skybox_dry/back.png")
             
         }
 
+        // Trees (alpha-tested leaves, so they stay in the opaque pass)
+        if (okTreeShader && treeInstanceCount > 0) {
+            treeShader.Use();
+            treeShader.SetMat4("uView", view);
+            treeShader.SetMat4("uProj", proj);
+            treeShader.SetVec3("lightPos", sunPos);
+            treeShader.SetVec3("lightColor", sunColor);
+            treeShader.SetVec3("ambientColor", ambient);
+            treeShader.SetVec3("viewPos", gCamera.pos);
+            treeShader.SetInt("uTex", 0);
+
+            // forest jump: simulate in the background, then blend old -> new sizes
+            if (forestJumpRequested && !forest.Busy() && growthBlend >= 1.0f) {
+                forest.StartAdvance(forestYearsPerJump);
+                forestJumpRequested = false;
+            }
+            if (forest.Ready()) {
+                forest.Apply(inst);
+                growthBlend = 0.0f;
+                const ForestStats& fs = forest.LastStats();
+                std::cout << "Forest +" << forestYearsPerJump << "y: " << fs.alive << " trees, "
+                    << fs.births << " born, " << fs.deaths << " died (" << fs.milliseconds << " ms)\n";
+            }
+            if (growthBlend < 1.0f) {
+                growthBlend = std::min(growthBlend + delta / 2.0f, 1.0f);
+                if (growthBlend >= 1.0f) forest.Commit(inst); // drop the trees that shrank away
+            }
+            treeShader.SetFloat("uGrowthBlend", growthBlend);
+            treeShader.SetBool("uBlend", false);
+            treeShader.SetFloat("uAlphaCutoff", 0.5f);
+
+            // era follows the time-jump animation, cross-fading live and dead species
+            inst.SetEra(jumpAnim);
+            inst.SetBlended(liveTrees, blendFoliage);
+            inst.FlushUpdates(); // dynamic add/remove/update since last frame
+            glDisable(GL_CULL_FACE); // leaf cards are single-sided
+            inst.SetLodTolerance((float)WIN_H);
+            inst.DrawCulled(view, proj, treeShader);
+            glEnable(GL_CULL_FACE);
+        }
+
+        // Grass
+        if (okGrass) {
+            grassShader.Use();
+            grassShader.SetVec3("lightPos", sunPos);
+            grassShader.SetVec3("lightColor", sunColor);
+            grassShader.SetVec3("ambientColor", ambient);
+            grassShader.SetVec3("baseColor", glm::vec3(0.12f, 0.25f, 0.06f));
+            grassShader.SetVec3("tipColor", glm::vec3(0.45f, 0.62f, 0.2f));
+            grass.Draw(grassShader, view, proj, gCamera.pos, globalTime);
+        }
+
         // Environment-mapped reflective sphere
         if (okEnvShader) {
             envShader.Use();
@@ -456,18 +654,17 @@ GetResourcePath("resources/skybox_dry/back.png")
 
             glActiveTexture(GL_TEXTURE1);
             glBindTexture(GL_TEXTURE_CUBE_MAP, sky.getCubemapID());
+            TextureManager::Instance().Touch(sky.getCubemapID());
             envShader.SetInt("skybox", 1);
 
-            glBindVertexArray(reflectiveSphere.VAO);
-            glDrawElements(GL_TRIANGLES, reflectiveSphere.indexCount, GL_UNSIGNED_INT, 0);
-            glBindVertexArray(0);
+            DrawMesh(reflectiveSphere);
         }
 
 
          //---------- Skybox (draw last) ----------
         GLuint cubemapToUse = (timeJumpOn ? skyDead.getCubemapID() : sky.getCubemapID());
 
-        if (okSkyShader) {
+        if (okSkyShader && cubemapToUse) {
             glDepthFunc(GL_LEQUAL);
             glDepthMask(GL_FALSE);
 
@@ -484,13 +681,27 @@ GetResourcePath("resources/skybox_dry/back.png")
             glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapToUse);
 
             // now call Draw with overrideCubemap
-            sky.Draw(skyShader.ID, cubemapToUse);
+            sky.Draw(skyShader, cubemapToUse);
             glActiveTexture(GL_TEXTURE1);
             glBindTexture(GL_TEXTURE_2D, blackTex);
             glDepthMask(GL_TRUE);
             glDepthFunc(GL_LESS);
         }
 
+        // ---------- Blended foliage (after the sky so soft leaf edges blend with it) ----------
+        if (okTreeShader && blendFoliage && treeInstanceCount > 0) {
+            treeShader.Use();
+            treeShader.SetBool("uBlend", true);
+            treeShader.SetFloat("uAlphaCutoff", 0.05f);
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            glDisable(GL_CULL_FACE);
+            // instances arrive sorted back to front; the sort overlaps this frame's rendering
+            inst.DrawSortedBlended(liveTrees, view, proj, treeShader);
+            glEnable(GL_CULL_FACE);
+            glDisable(GL_BLEND);
+        }
+
         if (okSunShader && dayFactor > 0.0f) {
             glDisable(GL_DEPTH_TEST);
             glEnable(GL_BLEND);
@@ -503,9 +714,7 @@ GetResourcePath("resources/skybox_dry/back.png")
             sunShader.SetMat4("uProj", proj);
             sunShader.SetVec3("uSunColor", sunObjectColor);
 
-            glBindVertexArray(sunSphere.VAO);
-            glDrawElements(GL_TRIANGLES, sunSphere.indexCount, GL_UNSIGNED_INT, 0);
-            glBindVertexArray(0);
+            DrawMesh(sunSphere);
 
             // Reset GL state
             glDisable(GL_BLEND);
@@ -528,12 +737,12 @@ GetResourcePath("resources/skybox_dry/back.png")
         static bool swappedAlready = false;
         if (jumpAnim > 0.5f && !swappedAlready && jumpTarget == 1.0f) {
             // perform swap ONCE mid-transition
-            terrain.SetTexture(sandTexture);
+            terrain.SetTexture(sandTexture ? sandTexture : blackTex);
             swappedAlready = true;
         }
         if (jumpAnim < 0.5f && swappedAlready && jumpTarget == 0.0f) {
             // revert when returning to normal
-            terrain.SetTexture(terrainDefaultTex);
+            terrain.SetTexture(terrainDefaultTex ? terrainDefaultTex : blackTex);
             swappedAlready = false;
         }
 
@@ -580,36 +789,31 @@ GetResourcePath("resources/skybox_dry/back.png")
         //    }
         //}
 
-        //if (treeInstanceCount > 0) {
-
-        //    glActiveTexture(GL_TEXTURE0);
-        //    glBindTexture(GL_TEXTURE_2D, treeDiffuse);
-
-        //    treeShader.Use();
-        //    treeShader.SetMat4("uView", view);
-        //    treeShader.SetMat4("uProj", proj);
-        //    treeShader.SetVec3("lightPos", sunPos);
-        //    treeShader.SetVec3("lightColor", sunColor);
-        //    treeShader.SetVec3("ambientColor", ambient);
-        //    treeShader.SetVec3("viewPos", gCamera.pos);
-        //    treeShader.SetInt("uTex", 0);
-
-        //    glEnable(GL_BLEND);
-        //    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        //    inst.DrawInstanced(treeMesh,1);
-        //    glDisable(GL_BLEND);
-        //}
-
         // swap/poll
         glfwSwapBuffers(gWindow);
         glfwPollEvents();
+
+        if (framesLoading >= 0) {
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - loadStart).count();
+            if (framesLoading++ == 0) std::cout << "First frame after " << ms << " ms\n";
+            if (assets.Idle()) {
+                std::cout << "Scene loaded after " << ms << " ms (" << framesLoading << " frames)\n";
+                std::cout << "Textures: " << TextureManager::Instance().TextureCount() << ", "
+                    << TextureManager::Instance().ResidentBytes() / (1024.0 * 1024.0) << " MB resident (budget "
+                    << textureBudgetMB << " MB)\n";
+                framesLoading = -1;
+            }
+        }
     }
 
     // ---------- Cleanup ----------
     DestroyMesh(reflectiveSphere);
     DestroyMesh(sunSphere);
+    sphereArena.Release();
+    modelArena.Release();
 
-    if (blackTex) { glDeleteTextures(1, &blackTex); blackTex = 0; }
+    TextureManager::Instance().Release(blackTex);
+    blackTex = 0;
 
      if (sceneColorTex) { glDeleteTextures(1, &sceneColorTex); sceneColorTex = 0; }
      if (sceneDepthRBO) { glDeleteRenderbuffers(1, &sceneDepthRBO); sceneDepthRBO = 0; }
@@ -617,7 +821,11 @@ GetResourcePath("resources/skybox_dry/back.png")
      if (quadVBO) { glDeleteBuffers(1, &quadVBO); quadVBO = 0; }
      if (quadVAO) { glDeleteVertexArrays(1, &quadVAO); quadVAO = 0; }
         // delete alternate textures
-        if (sandTexture) { glDeleteTextures(1, &sandTexture); sandTexture = 0; }
+        TextureManager::Instance().Release(sandTexture);
+        TextureManager::Instance().Release(terrainDefaultTex);
+        sandTexture = terrainDefaultTex = 0;
+        // whatever is still referenced (models, terrain, sky, font) goes with the context
+        TextureManager::Instance().Clear();
     
         glfwTerminate();
     return 0;
@@ -660,6 +868,12 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
         // example: fast-forward dayTime by half a cycle (instant swap)
         // You can replace with a proper transition effect later
         globalTime += 30.0f;
+        forestJumpRequested = true;
+    }
+
+    // B: toggle sorted alpha-blended foliage
+    if (key == GLFW_KEY_B && action == GLFW_PRESS) {
+        blendFoliage = !blendFoliage;
     }
 
     // record keys for free camera movement
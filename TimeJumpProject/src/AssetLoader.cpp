@@ -0,0 +1,243 @@
+// AssetLoader.cpp
+#include "AssetLoader.h"
+#include "GltfLoader.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+
+AssetLoader::AssetLoader(unsigned workerCount) : states(1, AssetState::Failed) {
+    if (workerCount == 0) workerCount = std::max(1u, WorkerThreadCount() - 1);
+    for (unsigned i = 0; i < workerCount; ++i) workers.emplace_back([this] { WorkerLoop(); });
+}
+
+AssetLoader::~AssetLoader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& t : workers) t.join();
+}
+
+void AssetLoader::WorkerLoop() {
+    for (;;) {
+        std::unique_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || !queue.empty(); });
+            if (stopping) return;
+            job = std::move(queue.front());
+            queue.pop_front();
+        }
+        job->ok = job->work();
+        std::lock_guard<std::mutex> lock(mutex);
+        done.push_back(std::move(job));
+    }
+}
+
+uint32_t AssetLoader::NewId() {
+    states.push_back(AssetState::Loading);
+    ++loading;
+    return (uint32_t)states.size() - 1;
+}
+
+void AssetLoader::Complete(uint32_t id, bool ok) {
+    if (states[id] != AssetState::Loading) return;
+    states[id] = ok ? AssetState::Ready : AssetState::Failed;
+    --loading;
+}
+
+AssetState AssetLoader::State(uint32_t id) const {
+    return id < states.size() ? states[id] : AssetState::Failed;
+}
+
+void AssetLoader::Enqueue(uint32_t id, std::function<bool()> work, std::function<bool()> finish,
+    std::vector<uint32_t> after, bool completes)
+{
+    auto job = std::make_unique<Job>();
+    job->id = id;
+    job->work = std::move(work);
+    job->finish = std::move(finish);
+    job->after = std::move(after);
+    job->completes = completes;
+    waiting.push_back(std::move(job));
+    StartWaiting();
+}
+
+void AssetLoader::Dispatch(std::unique_ptr<Job> job) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (job->work) {
+        queue.push_back(std::move(job));
+        wake.notify_one();
+    }
+    else done.push_back(std::move(job)); // GL thread only: straight to Update
+}
+
+void AssetLoader::StartWaiting() {
+    for (size_t i = 0; i < waiting.size();) {
+        const std::vector<uint32_t>& after = waiting[i]->after;
+        if (std::any_of(after.begin(), after.end(), [&](uint32_t d) { return State(d) == AssetState::Loading; })) {
+            ++i;
+            continue;
+        }
+        std::unique_ptr<Job> job = std::move(waiting[i]);
+        waiting.erase(waiting.begin() + i);
+        Dispatch(std::move(job));
+    }
+}
+
+int AssetLoader::Update(double budgetMs) {
+    auto t0 = std::chrono::high_resolution_clock::now();
+    int ran = 0;
+    for (;;) {
+        std::unique_ptr<Job> job;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (done.empty()) break;
+            job = std::move(done.front());
+            done.pop_front();
+        }
+        bool ok = job->ok && (!job->finish || job->finish());
+        if (!ok || job->completes) Complete(job->id, ok);
+        job.reset(); // frees what the steps held (decoded pixels, mappings) here, not at the next frame
+        ++ran;
+        StartWaiting();
+        if (std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count() >= budgetMs)
+            break;
+    }
+    return ran;
+}
+
+JobHandle AssetLoader::Run(std::function<bool()> work, std::function<bool()> finish, const std::vector<uint32_t>& after) {
+    JobHandle h{ NewId() };
+    Enqueue(h.id, std::move(work), std::move(finish), after);
+    return h;
+}
+
+GLuint AssetLoader::Texture(TextureHandle h, GLuint placeholder) const {
+    if (State(h.id) != AssetState::Ready) return placeholder;
+    auto it = textures.find(h.id);
+    return it == textures.end() ? placeholder : it->second;
+}
+
+const MeshGL_Model* AssetLoader::Model(ModelHandle h) const {
+    if (State(h.id) != AssetState::Ready) return nullptr;
+    auto it = models.find(h.id);
+    return it == models.end() ? nullptr : it->second.get();
+}
+
+TextureHandle AssetLoader::LoadTexture(const std::string& path, const TextureOptions& options) {
+    return LoadTextures({ path }, options);
+}
+
+TextureHandle AssetLoader::LoadCubemap(const std::vector<std::string>& faces, const TextureOptions& options) {
+    return LoadTextures(faces, options);
+}
+
+TextureHandle AssetLoader::LoadTextures(const std::vector<std::string>& paths, const TextureOptions& options) {
+    TextureHandle h{ NewId() };
+    if (GLuint tex = TextureManager::Instance().Find(paths, options)) {
+        textures[h.id] = tex;
+        Complete(h.id, true);
+        return h;
+    }
+    // the same image already on its way: share it once it lands rather than decode
+    // it twice (or build its compressed cache twice at the same time)
+    std::string key = TextureManager::PathKey(paths, options);
+    auto it = texturesByKey.find(key);
+    if (it != texturesByKey.end() && State(it->second) == AssetState::Loading) {
+        Enqueue(h.id, nullptr, [this, id = h.id, paths, options] {
+            GLuint tex = TextureManager::Instance().Find(paths, options);
+            textures[id] = tex;
+            return tex != 0;
+        }, { it->second });
+        return h;
+    }
+    texturesByKey[key] = h.id;
+
+    auto prepared = std::make_shared<PreparedTexture>();
+    Enqueue(h.id,
+        [paths, options, prepared] { return TextureManager::Prepare(paths, options, *prepared); },
+        [this, id = h.id, prepared] {
+            GLuint tex = TextureManager::Instance().Finish(*prepared);
+            textures[id] = tex;
+            return tex != 0;
+        }, {});
+    return h;
+}
+
+TextureHandle AssetLoader::LoadTextureFromMemory(const unsigned char* data, size_t size, const TextureOptions& options,
+    std::shared_ptr<void> keepAlive)
+{
+    TextureHandle h{ NewId() };
+    auto prepared = std::make_shared<PreparedTexture>();
+    Enqueue(h.id,
+        [data, size, options, prepared, keepAlive] { return TextureManager::PrepareFromMemory(data, size, options, *prepared); },
+        [this, id = h.id, prepared] {
+            GLuint tex = TextureManager::Instance().Finish(*prepared);
+            textures[id] = tex;
+            return tex != 0;
+        }, {});
+    return h;
+}
+
+ModelHandle AssetLoader::LoadModel(const std::string& path, GeometryArena* arena) {
+    ModelHandle h{ NewId() };
+    models[h.id] = std::make_unique<MeshGL_Model>();
+
+    // what the worker reads, kept until the last material texture has decoded
+    // (embedded GLB images point into the mapping)
+    struct Source {
+        bool glb = false;
+        PreparedMesh obj;
+        MappedFile glbFile;
+        GlbAsset glbAsset;
+    };
+    auto src = std::make_shared<Source>();
+    src->glb = std::filesystem::path(path).extension() == ".glb";
+
+    auto work = [path, src] {
+        if (!src->glb) return PrepareOBJ(path, src->obj);
+        if (!ImportGLB(path, src->glbFile, src->glbAsset)) return false;
+        ProcessGLB(src->glbAsset);
+        return true;
+    };
+    auto finish = [this, id = h.id, path, arena, src] {
+        MeshGL_Model& model = *models[id];
+        // the geometry now, the material textures as requests of their own
+        std::vector<uint32_t> textureIds;
+        if (src->glb) {
+            UploadGLB(src->glbAsset, model, arena, false);
+            TextureOptions options;
+            options.flipVertically = false; // glTF UVs start at the top
+            for (const GlbMaterial& g : src->glbAsset.materials) {
+                if (g.imageData) textureIds.push_back(LoadTextureFromMemory(g.imageData, g.imageSize, options, src).id);
+                else textureIds.push_back(g.imagePath.empty() ? 0 : LoadTexture(g.imagePath, options).id);
+            }
+        }
+        else {
+            UploadPreparedMesh(src->obj, model, arena, false);
+            for (const MaterialSource& m : src->obj.materials)
+                textureIds.push_back(m.diffusePath.empty() ? 0 : LoadTexture(m.diffusePath).id);
+        }
+        std::vector<uint32_t> after;
+        for (uint32_t t : textureIds) if (t) after.push_back(t);
+        Enqueue(id, nullptr, [this, id, path, textureIds, src] {
+            MeshGL_Model& model = *models[id];
+            for (size_t i = 0; i < textureIds.size() && i < model.materials.size(); ++i) {
+                if (!textureIds[i]) continue;
+                MaterialGL& m = model.materials[i];
+                m.diffuseTex = Texture(TextureHandle{ textureIds[i] });
+                if (!m.diffuseTex) std::cerr << "Warning: failed to load texture for " << m.name << " in " << path << "\n";
+                else if (!src->glb) m.usesAlpha = TextureManager::Instance().Info(m.diffuseTex)->hasAlpha;
+            }
+            return true;
+        }, std::move(after));
+        return true;
+    };
+    Enqueue(h.id, std::move(work), std::move(finish), {}, false);
+    return h;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+// AssetLoader.h - asynchronous loading: typed handles at once, file reading and
+// decoding on worker threads, GL uploads on the render thread within a frame budget
+#include <glad/glad.h>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "ModelLoader.h"
+#include "TextureManager.h"
+
+// default time AssetLoader::Update spends on finish steps per frame
+const double kAssetFrameBudgetMs = 4.0;
+
+enum class AssetState { Loading, Ready, Failed };
+
+// One request; 0 is none. The type only keeps textures, models and plain jobs
+// apart at compile time; any handle's id can be waited on.
+template <typename T>
+struct AssetHandle {
+    uint32_t id = 0;
+    explicit operator bool() const { return id != 0; }
+};
+using TextureHandle = AssetHandle<GLuint>;
+using ModelHandle = AssetHandle<MeshGL_Model>;
+using JobHandle = AssetHandle<void>;
+
+// Every request runs in two steps: 'work' on a worker thread (file I/O, decoding,
+// mesh processing; no GL), then 'finish' on the GL thread inside Update, which stops
+// taking finish steps once the frame's budget is spent. A request can wait for
+// others ('after'); it starts once they are Ready or Failed, and checks which itself.
+// Everything but the work steps runs on the GL thread.
+class AssetLoader {
+public:
+    // 0 = one worker per hardware thread, less the render thread's
+    explicit AssetLoader(unsigned workers = 0);
+    // waits for the work steps running, drops the rest
+    ~AssetLoader();
+    AssetLoader(const AssetLoader&) = delete;
+    AssetLoader& operator=(const AssetLoader&) = delete;
+
+    // TextureManager::Prepare on a worker, Finish on the GL thread; a Ready handle
+    // holds one texture reference, released by the caller as after TextureManager::Load
+    TextureHandle LoadTexture(const std::string& path, const TextureOptions& options = TextureOptions());
+    TextureHandle LoadCubemap(const std::vector<std::string>& faces, const TextureOptions& options);
+    // .glb (ImportGLB + ProcessGLB) or .obj (PrepareOBJ) on a worker, uploaded (into
+    // 'arena' if given) on the GL thread; Ready once every material texture is in too
+    ModelHandle LoadModel(const std::string& path, GeometryArena* arena = nullptr);
+    // either step may be empty; false from one marks the handle Failed
+    JobHandle Run(std::function<bool()> work, std::function<bool()> finish, const std::vector<uint32_t>& after = {});
+
+    // once per frame: starts the requests whose dependencies are done and runs finish
+    // steps until budgetMs is spent (at least one); returns how many ran
+    int Update(double budgetMs = kAssetFrameBudgetMs);
+
+    AssetState State(uint32_t id) const;
+    template <typename T>
+    bool Ready(AssetHandle<T> h) const { return State(h.id) == AssetState::Ready; }
+    // the texture, or placeholder until it is Ready
+    GLuint Texture(TextureHandle h, GLuint placeholder = 0) const;
+    // null until Ready; the model lives as long as the loader
+    const MeshGL_Model* Model(ModelHandle h) const;
+    bool Idle() const { return loading == 0; }
+    size_t Loading() const { return loading; }
+
+private:
+    struct Job {
+        uint32_t id = 0;
+        std::function<bool()> work, finish;
+        std::vector<uint32_t> after;
+        bool completes = true;     // a successful finish makes the handle Ready
+        bool ok = true;            // work's result
+    };
+
+    uint32_t NewId();
+    void Enqueue(uint32_t id, std::function<bool()> work, std::function<bool()> finish, std::vector<uint32_t> after,
+        bool completes = true);
+    void Dispatch(std::unique_ptr<Job> job);
+    void StartWaiting();
+    void Complete(uint32_t id, bool ok);
+    void WorkerLoop();
+    TextureHandle LoadTextures(const std::vector<std::string>& paths, const TextureOptions& options);
+    // keepAlive owns the bytes until they are decoded
+    TextureHandle LoadTextureFromMemory(const unsigned char* data, size_t size, const TextureOptions& options,
+        std::shared_ptr<void> keepAlive);
+
+    std::vector<AssetState> states;                     // by id; 0 is no request
+    size_t loading = 0;
+    std::unordered_map<uint32_t, GLuint> textures;
+    std::unordered_map<uint32_t, std::unique_ptr<MeshGL_Model>> models;
+    std::unordered_map<std::string, uint32_t> texturesByKey; // TextureManager::PathKey -> request
+    std::vector<std::unique_ptr<Job>> waiting;          // on unfinished dependencies
+
+    std::mutex mutex;                                   // guards queue, done, stopping
+    std::condition_variable wake;
+    std::deque<std::unique_ptr<Job>> queue;             // work steps for the workers
+    std::deque<std::unique_ptr<Job>> done;              // finish steps for Update
+    bool stopping = false;
+    std::vector<std::thread> workers;
+};
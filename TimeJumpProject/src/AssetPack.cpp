@@ -0,0 +1,255 @@
+// AssetPack.cpp
+#include "AssetPack.h"
+#include "Lz4.h"
+#include "Parallel.h"
+#include "SourceFile.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+
+// packed paths: relative to the folder, '/'-separated, no "." or ".."
+static std::string PackName(const std::filesystem::path& path, const std::filesystem::path& folder) {
+    namespace fs = std::filesystem;
+    fs::path p = path.is_absolute() ? path : folder / path;
+    fs::path rel = p.lexically_normal().lexically_relative(folder);
+    std::string name = rel.generic_string();
+    if (name.empty() || name == "." || name.compare(0, 2, "..") == 0) return {};
+    return name;
+}
+
+static uint32_t ChunkEnd(const unsigned char* table, uint32_t i) {
+    uint32_t v;
+    std::memcpy(&v, table + i * sizeof(uint32_t), sizeof(v));
+    return v;
+}
+
+bool AssetPack::Open(const std::string& path) {
+    namespace fs = std::filesystem;
+    Close();
+    if (!file.Open(path)) return false;
+    const unsigned char* base = file.Data();
+    const size_t size = file.Size();
+    const AssetPackHeader* h = (const AssetPackHeader*)base;
+    if (size < sizeof(AssetPackHeader) || std::memcmp(h->magic, kAssetPackMagic, sizeof(h->magic)) != 0 ||
+        h->version != kAssetPackVersion || h->fileSize != size ||
+        h->tocOffset + (uint64_t)h->entryCount * sizeof(AssetPackEntry) > h->namesOffset || h->namesOffset > size) {
+        std::cerr << "AssetPack: " << path << " is not a version " << kAssetPackVersion << " pack\n";
+        Close();
+        return false;
+    }
+    const AssetPackEntry* entries = (const AssetPackEntry*)(base + h->tocOffset);
+    const uint64_t namesSize = size - h->namesOffset;
+    for (uint32_t i = 0; i < h->entryCount; ++i) {
+        const AssetPackEntry& e = entries[i];
+        bool ok = (uint64_t)e.nameOffset + e.nameLength <= namesSize && e.offset + e.storedSize <= h->tocOffset &&
+            (e.chunkCount ? e.chunkCount == (e.size + kAssetPackChunkBytes - 1) / kAssetPackChunkBytes &&
+                (uint64_t)e.chunkCount * sizeof(uint32_t) <= e.storedSize : e.storedSize == e.size);
+        if (!ok) {
+            std::cerr << "AssetPack: " << path << " has a broken entry " << i << "\n";
+            Close();
+            return false;
+        }
+    }
+    header = h;
+    toc = entries;
+    names = (const char*)base + h->namesOffset;
+    folder = fs::absolute(fs::path(path)).lexically_normal().parent_path().string();
+    return true;
+}
+
+void AssetPack::Close() {
+    file.Close();
+    folder.clear();
+    header = nullptr;
+    toc = nullptr;
+    names = nullptr;
+}
+
+const AssetPackEntry* AssetPack::Find(const std::string& path) const {
+    if (!header) return nullptr;
+    std::string name = PackName(path, folder);
+    if (name.empty()) return nullptr;
+    const uint64_t hash = Fnv1a(name.data(), name.size());
+    const AssetPackEntry* end = toc + header->entryCount;
+    const AssetPackEntry* it = std::lower_bound(toc, end, hash,
+        [](const AssetPackEntry& e, uint64_t h) { return e.nameHash < h; });
+    for (; it != end && it->nameHash == hash; ++it) {
+        if (it->nameLength == name.size() && std::memcmp(names + it->nameOffset, name.data(), name.size()) == 0)
+            return it;
+    }
+    return nullptr;
+}
+
+const unsigned char* AssetPack::Stored(const AssetPackEntry& e) const {
+    return e.chunkCount ? nullptr : file.Data() + e.offset;
+}
+
+bool AssetPack::Decompress(const AssetPackEntry& e, unsigned char* out) const {
+    const unsigned char* data = file.Data() + e.offset;
+    if (!e.chunkCount) {
+        if (e.size) std::memcpy(out, data, (size_t)e.size);
+        return true;
+    }
+    const uint32_t tableBytes = e.chunkCount * (uint32_t)sizeof(uint32_t);
+    std::atomic<bool> ok{ true };
+    ParallelFor(e.chunkCount, [&](size_t c) {
+        uint32_t begin = c ? ChunkEnd(data, (uint32_t)c - 1) : tableBytes, end = ChunkEnd(data, (uint32_t)c);
+        size_t first = c * kAssetPackChunkBytes, bytes = std::min<size_t>(kAssetPackChunkBytes, (size_t)e.size - first);
+        if (begin > end || end > e.storedSize || !Lz4Decompress(data + begin, end - begin, out + first, bytes))
+            ok = false;
+    });
+    if (!ok) std::cerr << "AssetPack: corrupt entry " << std::string(names + e.nameOffset, e.nameLength) << "\n";
+    return ok;
+}
+
+static std::unique_ptr<AssetPack> mountedPack;
+
+bool AssetPack::Mount(const std::string& path) {
+    auto pack = std::make_unique<AssetPack>();
+    if (!pack->Open(path)) return false;
+    mountedPack = std::move(pack);
+    return true;
+}
+
+const AssetPack* AssetPack::Mounted() {
+    return mountedPack.get();
+}
+
+const AssetPackEntry* AssetPack::Lookup(const std::string& path) {
+    if (!mountedPack) return nullptr;
+    // relative paths mean the working directory here, as for a loose file
+    std::filesystem::path p(path);
+    std::error_code ec;
+    return mountedPack->Find(p.is_absolute() ? path : std::filesystem::absolute(p, ec).string());
+}
+
+bool ResourceExists(const std::string& path) {
+    std::error_code ec;
+    return AssetPack::Lookup(path) || std::filesystem::exists(path, ec);
+}
+
+bool WriteAssetPack(const std::string& folder, const std::vector<std::string>& paths, const std::string& outPath,
+    bool compress)
+{
+    namespace fs = std::filesystem;
+    const fs::path root = fs::absolute(fs::path(folder)).lexically_normal();
+    std::vector<AssetPackEntry> entries;
+    std::string names;
+
+    // write to a temp name and rename, so a crash never leaves a torn pack; a name of
+    // its own per writer, so two packers of one path never write into the same file
+    std::random_device rd;
+    std::string tmpPath = outPath + "." + std::to_string(((uint64_t)rd() << 32) | rd()) + ".tmp";
+    std::ofstream f(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!f) {
+        std::cerr << "WriteAssetPack: cannot write " << tmpPath << "\n";
+        return false;
+    }
+    auto fail = [&] {
+        f.close();
+        std::error_code ec;
+        fs::remove(tmpPath, ec);
+        return false;
+    };
+    AssetPackHeader h{};
+    f.write((const char*)&h, sizeof(h)); // patched at the end
+    uint64_t at = sizeof(h);
+    auto pad = [&] {
+        static const char zeros[kAssetPackAlignment] = {};
+        uint64_t aligned = (at + kAssetPackAlignment - 1) / kAssetPackAlignment * kAssetPackAlignment;
+        f.write(zeros, (std::streamsize)(aligned - at));
+        at = aligned;
+    };
+
+    for (const std::string& p : paths) {
+        std::string name = PackName(fs::path(p), root);
+        if (name.empty()) {
+            std::cerr << "WriteAssetPack: " << p << " is outside " << folder << "\n";
+            return fail();
+        }
+        std::string full = (root / name).string();
+        std::error_code ec;
+        auto mtime = fs::last_write_time(full, ec);
+        MappedFile src;
+        if (ec || !src.Open(full)) {
+            std::cerr << "WriteAssetPack: cannot read " << full << "\n";
+            return fail();
+        }
+
+        AssetPackEntry e{};
+        e.nameHash = Fnv1a(name.data(), name.size());
+        e.size = src.Size();
+        e.sourceMTime = (uint64_t)mtime.time_since_epoch().count();
+        e.nameOffset = (uint32_t)names.size();
+        e.nameLength = (uint32_t)name.size();
+        names += name;
+
+        // chunks compress independently, so they can be decompressed in parallel too
+        std::vector<std::vector<unsigned char>> chunks;
+        size_t packedBytes = 0;
+        if (compress && e.size > 0) {
+            chunks.resize((src.Size() + kAssetPackChunkBytes - 1) / kAssetPackChunkBytes);
+            ParallelFor(chunks.size(), [&](size_t c) {
+                size_t first = c * kAssetPackChunkBytes, bytes = std::min(kAssetPackChunkBytes, src.Size() - first);
+                chunks[c].resize(Lz4CompressBound(bytes));
+                chunks[c].resize(Lz4Compress(src.Data() + first, bytes, chunks[c].data(), chunks[c].size()));
+            });
+            packedBytes = chunks.size() * sizeof(uint32_t);
+            for (const auto& c : chunks) packedBytes += c.size();
+        }
+
+        pad();
+        e.offset = at;
+        if (!chunks.empty() && packedBytes <= src.Size() / 10 * 9) {
+            e.chunkCount = (uint32_t)chunks.size();
+            uint32_t end = e.chunkCount * (uint32_t)sizeof(uint32_t);
+            for (const auto& c : chunks) {
+                end += (uint32_t)c.size();
+                f.write((const char*)&end, sizeof(end));
+            }
+            for (const auto& c : chunks) f.write((const char*)c.data(), (std::streamsize)c.size());
+            e.storedSize = packedBytes;
+        }
+        else {
+            f.write((const char*)src.Data(), (std::streamsize)src.Size());
+            e.storedSize = e.size;
+        }
+        at += e.storedSize;
+        entries.push_back(e);
+    }
+
+    std::sort(entries.begin(), entries.end(), [&](const AssetPackEntry& a, const AssetPackEntry& b) {
+        if (a.nameHash != b.nameHash) return a.nameHash < b.nameHash;
+        return names.compare(a.nameOffset, a.nameLength, names, b.nameOffset, b.nameLength) < 0;
+    });
+    pad();
+    std::memcpy(h.magic, kAssetPackMagic, sizeof(h.magic));
+    h.version = kAssetPackVersion;
+    h.entryCount = (uint32_t)entries.size();
+    h.tocOffset = at;
+    h.namesOffset = at + entries.size() * sizeof(AssetPackEntry);
+    h.fileSize = h.namesOffset + names.size();
+    f.write((const char*)entries.data(), (std::streamsize)(entries.size() * sizeof(AssetPackEntry)));
+    f.write(names.data(), (std::streamsize)names.size());
+    f.seekp(0);
+    f.write((const char*)&h, sizeof(h));
+    f.close();
+    if (!f) {
+        std::cerr << "WriteAssetPack: write failed for " << tmpPath << "\n";
+        return fail();
+    }
+    std::error_code ec;
+    fs::rename(tmpPath, outPath, ec);
+    if (ec) {
+        std::cerr << "WriteAssetPack: cannot replace " << outPath << ": " << ec.message() << "\n";
+        fs::remove(tmpPath, ec);
+        return false;
+    }
+    return true;
+}
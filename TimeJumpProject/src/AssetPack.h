@@ -0,0 +1,82 @@
+#pragma once
+
+// AssetPack.h - many asset files in one memory-mapped pack: a table of contents sorted
+// by path hash, then every entry at a 64-byte aligned offset, stored as is or
+// LZ4-compressed in independent chunks that decompress in parallel. While a pack is
+// mounted, MappedFile::Open serves the paths it holds straight from the mapping;
+// anything it lacks still comes from the loose file.
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+
+const char kAssetPackMagic[8] = { 'T', 'J', 'P', 'A', 'C', 'K', 0, 0 };
+const uint32_t kAssetPackVersion = 1;
+const size_t kAssetPackAlignment = 64;
+const size_t kAssetPackChunkBytes = 256 * 1024;   // uncompressed bytes per LZ4 chunk
+const char kAssetPackName[] = "resources.pack";  // next to resources/
+
+struct AssetPackHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t entryCount;
+    uint64_t tocOffset;     // AssetPackEntry[entryCount], sorted by (nameHash, name)
+    uint64_t namesOffset;   // the entries' paths, back to back
+    uint64_t fileSize;
+};
+
+struct AssetPackEntry {
+    uint64_t nameHash;      // FNV-1a of the path
+    uint64_t offset;        // of the entry's bytes, kAssetPackAlignment aligned
+    uint64_t storedSize;    // bytes at offset
+    uint64_t size;          // bytes of the file
+    uint64_t sourceMTime;   // of the packed file, as StatSource reads it, so caches validate as loose
+    uint32_t nameOffset;    // into the names
+    uint32_t nameLength;
+    uint32_t chunkCount;    // 0: stored; else uint32_t end offsets of the chunks, then the chunks
+    uint32_t reserved;
+};
+
+class AssetPack {
+public:
+    AssetPack() = default;
+    AssetPack(const AssetPack&) = delete;
+    AssetPack& operator=(const AssetPack&) = delete;
+
+    // maps the pack and checks its table of contents; messages on std::cerr
+    bool Open(const std::string& path);
+    void Close();
+    bool IsOpen() const { return header != nullptr; }
+    size_t EntryCount() const { return header ? header->entryCount : 0; }
+
+    // the entry for a path relative to the pack's folder ("resources/textures/sand.jpg"),
+    // or for a full path inside that folder; null if not packed
+    const AssetPackEntry* Find(const std::string& path) const;
+    // a stored entry's bytes in the mapping; null for compressed ones
+    const unsigned char* Stored(const AssetPackEntry& e) const;
+    // e.size bytes into out; chunks spread over worker threads
+    bool Decompress(const AssetPackEntry& e, unsigned char* out) const;
+
+    // The pack MappedFile::Open looks in first. Mount before loading starts; it stays
+    // mapped until exit, and lookups only read, so any thread may open files.
+    static bool Mount(const std::string& path);
+    static const AssetPack* Mounted();
+    // the mounted pack's entry for path, or null
+    static const AssetPackEntry* Lookup(const std::string& path);
+
+private:
+    MappedFile file;
+    std::string folder;     // absolute; packed paths are relative to it
+    const AssetPackHeader* header = nullptr;
+    const AssetPackEntry* toc = nullptr;
+    const char* names = nullptr;
+};
+
+// Packs the loose files 'paths' (relative to folder) into outPath. With compress,
+// entries LZ4 shrinks by at least 10% are stored compressed, the rest as they are.
+bool WriteAssetPack(const std::string& folder, const std::vector<std::string>& paths, const std::string& outPath,
+    bool compress);
+
+// path opens with MappedFile: packed, or a loose file
+bool ResourceExists(const std::string& path);
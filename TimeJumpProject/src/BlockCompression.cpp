@@ -0,0 +1,454 @@
+// BlockCompression.cpp
+#include "BlockCompression.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// EXT_texture_compression_s3tc (not in the generated glad header)
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+// BC7 index interpolation weights (out of 64)
+static const int kWeights2[4] = { 0, 21, 43, 64 };
+static const int kWeights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+size_t BlockBytes(BlockFormat format) {
+    return format == BlockFormat::BC1 || format == BlockFormat::BC4 ? 8 : format == BlockFormat::None ? 0 : 16;
+}
+
+size_t CompressedLevelSize(BlockFormat format, int width, int height) {
+    return (size_t)((width + 3) / 4) * (size_t)((height + 3) / 4) * BlockBytes(format);
+}
+
+GLenum BlockGLFormat(BlockFormat format) {
+    switch (format) {
+    case BlockFormat::BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case BlockFormat::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case BlockFormat::BC4: return GL_COMPRESSED_RED_RGTC1;
+    case BlockFormat::BC5: return GL_COMPRESSED_RG_RGTC2;
+    case BlockFormat::BC7: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+    default: return 0;
+    }
+}
+
+// 4x4 texels as RGBA (missing channels: 0, alpha 255), edges clamped
+static void FetchBlock(const unsigned char* pixels, int w, int h, int channels, int bx, int by, unsigned char block[16][4]) {
+    for (int y = 0; y < 4; ++y) {
+        const unsigned char* row = pixels + (size_t)std::min(by * 4 + y, h - 1) * w * channels;
+        for (int x = 0; x < 4; ++x) {
+            const unsigned char* p = row + (size_t)std::min(bx * 4 + x, w - 1) * channels;
+            unsigned char* t = block[y * 4 + x];
+            t[0] = p[0];
+            t[1] = channels > 1 ? p[1] : 0;
+            t[2] = channels > 2 ? p[2] : 0;
+            t[3] = channels > 3 ? p[3] : 255;
+        }
+    }
+}
+
+// Mean and dominant direction of the texels' first 'dims' channels (power
+// iteration on the covariance); the axis falls back to the diagonal for flat blocks.
+static void PrincipalAxis(const unsigned char block[16][4], int dims, float mean[4], float axis[4]) {
+    for (int c = 0; c < 4; ++c) {
+        mean[c] = 0.0f;
+        for (int i = 0; i < 16; ++i) mean[c] += block[i][c];
+        mean[c] /= 16.0f;
+    }
+    float cov[4][4] = {};
+    for (int i = 0; i < 16; ++i) {
+        float d[4];
+        for (int c = 0; c < dims; ++c) d[c] = block[i][c] - mean[c];
+        for (int a = 0; a < dims; ++a)
+            for (int b = 0; b < dims; ++b) cov[a][b] += d[a] * d[b];
+    }
+    float v[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    for (int it = 0; it < 8; ++it) {
+        float n[4] = {}, len = 0.0f;
+        for (int a = 0; a < dims; ++a) {
+            for (int b = 0; b < dims; ++b) n[a] += cov[a][b] * v[b];
+            len = std::max(len, std::fabs(n[a]));
+        }
+        if (len < 1e-6f) break;
+        for (int a = 0; a < dims; ++a) v[a] = n[a] / len;
+    }
+    float len = 0.0f;
+    for (int a = 0; a < dims; ++a) len += v[a] * v[a];
+    len = std::sqrt(len);
+    for (int a = 0; a < 4; ++a) axis[a] = a < dims && len > 0.0f ? v[a] / len : 0.0f;
+}
+
+// the texels' extremes along the principal axis, pulled in by 1/16 of the range
+// (the end points are rarely hit exactly, the interpolated colours often are)
+static void AxisEndpoints(const unsigned char block[16][4], int dims, float e0[4], float e1[4]) {
+    float mean[4], axis[4];
+    PrincipalAxis(block, dims, mean, axis);
+    float lo = 0.0f, hi = 0.0f;
+    for (int i = 0; i < 16; ++i) {
+        float t = 0.0f;
+        for (int c = 0; c < dims; ++c) t += (block[i][c] - mean[c]) * axis[c];
+        lo = std::min(lo, t);
+        hi = std::max(hi, t);
+    }
+    float inset = (hi - lo) / 16.0f;
+    for (int c = 0; c < 4; ++c) {
+        e0[c] = std::min(255.0f, std::max(0.0f, mean[c] + (hi - inset) * axis[c]));
+        e1[c] = std::min(255.0f, std::max(0.0f, mean[c] + (lo + inset) * axis[c]));
+    }
+}
+
+// Least-squares end points for fixed indices: texel i is w[i] * e1 + (1 - w[i]) * e0.
+// False when every texel uses the same weight.
+static bool RefineEndpoints(const unsigned char block[16][4], int dims, const float w[16], float e0[4], float e1[4]) {
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f, ax[4] = {}, bx[4] = {};
+    for (int i = 0; i < 16; ++i) {
+        float a = 1.0f - w[i], b = w[i];
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for (int c = 0; c < dims; ++c) {
+            ax[c] += a * block[i][c];
+            bx[c] += b * block[i][c];
+        }
+    }
+    float det = aa * bb - ab * ab;
+    if (std::fabs(det) < 1e-6f) return false;
+    for (int c = 0; c < dims; ++c) {
+        e0[c] = std::min(255.0f, std::max(0.0f, (ax[c] * bb - bx[c] * ab) / det));
+        e1[c] = std::min(255.0f, std::max(0.0f, (bx[c] * aa - ax[c] * ab) / det));
+    }
+    return true;
+}
+
+static uint16_t To565(const float c[3]) {
+    int r = (int)std::lround(c[0] * 31.0f / 255.0f), g = (int)std::lround(c[1] * 63.0f / 255.0f);
+    int b = (int)std::lround(c[2] * 31.0f / 255.0f);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void From565(uint16_t v, int out[3]) {
+    int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+    out[0] = (r << 3) | (r >> 2);
+    out[1] = (g << 2) | (g >> 4);
+    out[2] = (b << 3) | (b >> 2);
+}
+
+// 4-colour mode indices (0 = c0, 1 = c1, 2/3 = thirds); returns the squared error
+static int FitBC1(const unsigned char block[16][4], uint16_t c0, uint16_t c1, uint8_t idx[16]) {
+    int p[4][3];
+    From565(c0, p[0]);
+    From565(c1, p[1]);
+    for (int c = 0; c < 3; ++c) {
+        p[2][c] = (2 * p[0][c] + p[1][c]) / 3;
+        p[3][c] = (p[0][c] + 2 * p[1][c]) / 3;
+    }
+    int total = 0;
+    for (int i = 0; i < 16; ++i) {
+        int best = 0, bestErr = 1 << 30;
+        for (int k = 0; k < 4; ++k) {
+            int dr = block[i][0] - p[k][0], dg = block[i][1] - p[k][1], db = block[i][2] - p[k][2];
+            int err = dr * dr + dg * dg + db * db;
+            if (err < bestErr) {
+                best = k;
+                bestErr = err;
+            }
+        }
+        idx[i] = (uint8_t)best;
+        total += bestErr;
+    }
+    return total;
+}
+
+static void EncodeBC1(const unsigned char block[16][4], unsigned char* out) {
+    static const float kWeight[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+    float e0[4], e1[4];
+    AxisEndpoints(block, 3, e0, e1);
+    uint16_t c0 = To565(e0), c1 = To565(e1);
+    uint8_t idx[16];
+    int err = FitBC1(block, c0, c1, idx);
+    for (int it = 0; it < 2 && err > 0; ++it) {
+        float w[16];
+        for (int i = 0; i < 16; ++i) w[i] = kWeight[idx[i]];
+        if (!RefineEndpoints(block, 3, w, e0, e1)) break;
+        uint16_t r0 = To565(e0), r1 = To565(e1);
+        uint8_t ridx[16];
+        int rerr = FitBC1(block, r0, r1, ridx);
+        if (rerr >= err) break;
+        c0 = r0;
+        c1 = r1;
+        err = rerr;
+        std::memcpy(idx, ridx, sizeof(idx));
+    }
+    // c0 > c1 selects the 4-colour mode; equal end points decode every index to c0
+    if (c0 < c1) {
+        std::swap(c0, c1);
+        for (uint8_t& i : idx) i ^= 1;
+    }
+    uint32_t bits = 0;
+    for (int i = 0; i < 16; ++i) bits |= (uint32_t)(c0 == c1 ? 0 : idx[i]) << (i * 2);
+    out[0] = (unsigned char)(c0 & 0xFF);
+    out[1] = (unsigned char)(c0 >> 8);
+    out[2] = (unsigned char)(c1 & 0xFF);
+    out[3] = (unsigned char)(c1 >> 8);
+    for (int b = 0; b < 4; ++b) out[4 + b] = (unsigned char)(bits >> (b * 8));
+}
+
+// one channel, 8-value mode (e0 > e1: six interpolated steps)
+static void EncodeBC4(const unsigned char block[16][4], int channel, unsigned char* out) {
+    int lo = 255, hi = 0;
+    for (int i = 0; i < 16; ++i) {
+        lo = std::min(lo, (int)block[i][channel]);
+        hi = std::max(hi, (int)block[i][channel]);
+    }
+    out[0] = (unsigned char)hi;
+    out[1] = (unsigned char)lo;
+    uint64_t bits = 0;
+    if (hi > lo) {
+        int p[8] = { hi, lo };
+        for (int k = 2; k < 8; ++k) p[k] = ((8 - k) * hi + (k - 1) * lo) / 7;
+        for (int i = 0; i < 16; ++i) {
+            int v = block[i][channel], best = 0;
+            for (int k = 1; k < 8; ++k)
+                if (std::abs(p[k] - v) < std::abs(p[best] - v)) best = k;
+            bits |= (uint64_t)best << (i * 3);
+        }
+    }
+    for (int b = 0; b < 6; ++b) out[2 + b] = (unsigned char)(bits >> (b * 8));
+}
+
+struct BC7Endpoints {
+    int q[2][4]; // 7-bit
+    int p[2];    // p-bits
+};
+
+// 7-bit value + shared p-bit per end point, p chosen for the smaller error
+static void QuantizeBC7(const float e0[4], const float e1[4], BC7Endpoints& out) {
+    const float* e[2] = { e0, e1 };
+    for (int k = 0; k < 2; ++k) {
+        float bestErr = 1e30f;
+        for (int p = 0; p < 2; ++p) {
+            int q[4];
+            float err = 0.0f;
+            for (int c = 0; c < 4; ++c) {
+                q[c] = std::min(127, std::max(0, (int)std::lround((e[k][c] - p) / 2.0f)));
+                float d = (float)(q[c] * 2 + p) - e[k][c];
+                err += d * d;
+            }
+            if (err < bestErr) {
+                bestErr = err;
+                std::memcpy(out.q[k], q, sizeof(q));
+                out.p[k] = p;
+            }
+        }
+    }
+}
+
+static int FitBC7(const unsigned char block[16][4], const BC7Endpoints& ep, uint8_t idx[16]) {
+    int p[16][4];
+    for (int c = 0; c < 4; ++c) {
+        int a = ep.q[0][c] * 2 + ep.p[0], b = ep.q[1][c] * 2 + ep.p[1];
+        for (int k = 0; k < 16; ++k) p[k][c] = ((64 - kWeights4[k]) * a + kWeights4[k] * b + 32) >> 6;
+    }
+    int total = 0;
+    for (int i = 0; i < 16; ++i) {
+        int best = 0, bestErr = 1 << 30;
+        for (int k = 0; k < 16; ++k) {
+            int err = 0;
+            for (int c = 0; c < 4; ++c) {
+                int d = block[i][c] - p[k][c];
+                err += d * d;
+            }
+            if (err < bestErr) {
+                best = k;
+                bestErr = err;
+            }
+        }
+        idx[i] = (uint8_t)best;
+        total += bestErr;
+    }
+    return total;
+}
+
+// little-endian bit stream into one 16-byte block
+struct BlockBits {
+    unsigned char* out;
+    int pos = 0;
+    void Put(uint32_t v, int bits) {
+        for (int b = 0; b < bits; ++b, ++pos)
+            if (v & (1u << b)) out[pos >> 3] |= (unsigned char)(1u << (pos & 7));
+    }
+};
+
+// Mode 6: one RGBA line, 7777 + p-bit end points, 4-bit indices. Returns the error.
+static int EncodeBC7Mode6(const unsigned char block[16][4], unsigned char* out) {
+    float e0[4], e1[4];
+    AxisEndpoints(block, 4, e0, e1);
+    BC7Endpoints ep;
+    QuantizeBC7(e0, e1, ep);
+    uint8_t idx[16];
+    int err = FitBC7(block, ep, idx);
+    for (int it = 0; it < 2 && err > 0; ++it) {
+        float w[16];
+        for (int i = 0; i < 16; ++i) w[i] = kWeights4[idx[i]] / 64.0f;
+        if (!RefineEndpoints(block, 4, w, e0, e1)) break;
+        BC7Endpoints rep;
+        QuantizeBC7(e0, e1, rep);
+        uint8_t ridx[16];
+        int rerr = FitBC7(block, rep, ridx);
+        if (rerr >= err) break;
+        ep = rep;
+        err = rerr;
+        std::memcpy(idx, ridx, sizeof(idx));
+    }
+    // the first texel's index is stored without its top bit
+    if (idx[0] & 8) {
+        std::swap(ep.q[0], ep.q[1]);
+        std::swap(ep.p[0], ep.p[1]);
+        for (uint8_t& i : idx) i = (uint8_t)(15 - i);
+    }
+
+    std::memset(out, 0, 16);
+    BlockBits bits{ out };
+    bits.Put(1u << 6, 7);
+    for (int c = 0; c < 4; ++c) {
+        bits.Put(ep.q[0][c], 7);
+        bits.Put(ep.q[1][c], 7);
+    }
+    bits.Put(ep.p[0], 1);
+    bits.Put(ep.p[1], 1);
+    bits.Put(idx[0], 3);
+    for (int i = 1; i < 16; ++i) bits.Put(idx[i], 4);
+    return err;
+}
+
+static int Unquantize7(int q) { return (q << 1) | (q >> 6); }
+
+static int FitBC7Mode5Color(const unsigned char block[16][4], const int q[2][3], uint8_t idx[16]) {
+    int p[4][3];
+    for (int c = 0; c < 3; ++c) {
+        int a = Unquantize7(q[0][c]), b = Unquantize7(q[1][c]);
+        for (int k = 0; k < 4; ++k) p[k][c] = ((64 - kWeights2[k]) * a + kWeights2[k] * b + 32) >> 6;
+    }
+    int total = 0;
+    for (int i = 0; i < 16; ++i) {
+        int best = 0, bestErr = 1 << 30;
+        for (int k = 0; k < 4; ++k) {
+            int dr = block[i][0] - p[k][0], dg = block[i][1] - p[k][1], db = block[i][2] - p[k][2];
+            int err = dr * dr + dg * dg + db * db;
+            if (err < bestErr) {
+                best = k;
+                bestErr = err;
+            }
+        }
+        idx[i] = (uint8_t)best;
+        total += bestErr;
+    }
+    return total;
+}
+
+// Mode 5: RGB line (777) and alpha line (8 bits) with their own 2-bit indices, so
+// cut-out alpha does not pull the colour end points. Returns the error.
+static int EncodeBC7Mode5(const unsigned char block[16][4], unsigned char* out) {
+    auto quantize = [](const float e0[4], const float e1[4], int q[2][3]) {
+        for (int c = 0; c < 3; ++c) {
+            q[0][c] = std::min(127, std::max(0, (int)std::lround(e0[c] * 127.0f / 255.0f)));
+            q[1][c] = std::min(127, std::max(0, (int)std::lround(e1[c] * 127.0f / 255.0f)));
+        }
+    };
+    float e0[4], e1[4];
+    AxisEndpoints(block, 3, e0, e1);
+    int q[2][3];
+    quantize(e0, e1, q);
+    uint8_t ci[16];
+    int err = FitBC7Mode5Color(block, q, ci);
+    for (int it = 0; it < 2 && err > 0; ++it) {
+        float w[16];
+        for (int i = 0; i < 16; ++i) w[i] = kWeights2[ci[i]] / 64.0f;
+        if (!RefineEndpoints(block, 3, w, e0, e1)) break;
+        int rq[2][3];
+        quantize(e0, e1, rq);
+        uint8_t rci[16];
+        int rerr = FitBC7Mode5Color(block, rq, rci);
+        if (rerr >= err) break;
+        std::memcpy(q, rq, sizeof(q));
+        err = rerr;
+        std::memcpy(ci, rci, sizeof(ci));
+    }
+
+    int a[2] = { 255, 0 };
+    for (int i = 0; i < 16; ++i) {
+        a[0] = std::min(a[0], (int)block[i][3]);
+        a[1] = std::max(a[1], (int)block[i][3]);
+    }
+    uint8_t ai[16];
+    for (int i = 0; i < 16; ++i) {
+        int best = 0, bestErr = 1 << 30;
+        for (int k = 0; k < 4; ++k) {
+            int d = block[i][3] - (((64 - kWeights2[k]) * a[0] + kWeights2[k] * a[1] + 32) >> 6);
+            if (d * d < bestErr) {
+                best = k;
+                bestErr = d * d;
+            }
+        }
+        ai[i] = (uint8_t)best;
+        err += bestErr;
+    }
+    if (ci[0] & 2) {
+        std::swap(q[0], q[1]);
+        for (uint8_t& i : ci) i = (uint8_t)(3 - i);
+    }
+    if (ai[0] & 2) {
+        std::swap(a[0], a[1]);
+        for (uint8_t& i : ai) i = (uint8_t)(3 - i);
+    }
+
+    std::memset(out, 0, 16);
+    BlockBits bits{ out };
+    bits.Put(1u << 5, 6);
+    bits.Put(0, 2); // no channel rotation
+    for (int c = 0; c < 3; ++c) {
+        bits.Put(q[0][c], 7);
+        bits.Put(q[1][c], 7);
+    }
+    bits.Put(a[0], 8);
+    bits.Put(a[1], 8);
+    bits.Put(ci[0], 1);
+    for (int i = 1; i < 16; ++i) bits.Put(ci[i], 2);
+    bits.Put(ai[0], 1);
+    for (int i = 1; i < 16; ++i) bits.Put(ai[i], 2);
+    return err;
+}
+
+static void EncodeBC7(const unsigned char block[16][4], unsigned char* out) {
+    int err = EncodeBC7Mode6(block, out);
+    bool opaque = true;
+    for (int i = 0; i < 16 && opaque; ++i) opaque = block[i][3] == 255;
+    if (opaque || err == 0) return;
+    unsigned char mode5[16];
+    if (EncodeBC7Mode5(block, mode5) < err) std::memcpy(out, mode5, 16);
+}
+
+void CompressImage(BlockFormat format, const unsigned char* pixels, int width, int height, int channels, unsigned char* out) {
+    const int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    const size_t blockBytes = BlockBytes(format);
+    ParallelFor((size_t)blocksY, [&](size_t by) {
+        unsigned char block[16][4];
+        for (int bx = 0; bx < blocksX; ++bx) {
+            FetchBlock(pixels, width, height, channels, bx, (int)by, block);
+            unsigned char* dst = out + (by * blocksX + bx) * blockBytes;
+            switch (format) {
+            case BlockFormat::BC1: EncodeBC1(block, dst); break;
+            case BlockFormat::BC3: EncodeBC4(block, 3, dst); EncodeBC1(block, dst + 8); break;
+            case BlockFormat::BC4: EncodeBC4(block, 0, dst); break;
+            case BlockFormat::BC5: EncodeBC4(block, 0, dst); EncodeBC4(block, 1, dst + 8); break;
+            case BlockFormat::BC7: EncodeBC7(block, dst); break;
+            default: break;
+            }
+        }
+    });
+}
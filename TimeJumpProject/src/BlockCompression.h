@@ -0,0 +1,26 @@
+#pragma once
+
+// BlockCompression.h - CPU encoders for the BCn texture formats (4x4 blocks); mips come from ImageKernels.h
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+
+enum class BlockFormat : uint32_t {
+    None = 0,
+    BC1,   // RGB, 8 bytes per block (opaque, 4-colour mode only)
+    BC3,   // RGBA, BC1 colour + BC4 alpha, 16 bytes
+    BC4,   // R, 8 bytes
+    BC5,   // RG, two BC4 blocks, 16 bytes
+    BC7,   // RGBA, 16 bytes (modes 6 and 5 only: one subset; mode 5 for blocks with alpha)
+};
+
+size_t BlockBytes(BlockFormat format);
+// bytes of one w x h level (rounded up to whole blocks)
+size_t CompressedLevelSize(BlockFormat format, int width, int height);
+// GL internal format, 0 for None; BC1/BC3 are the EXT_texture_compression_s3tc enums
+GLenum BlockGLFormat(BlockFormat format);
+
+// Encodes a w x h image of 1-4 interleaved 8-bit channels into
+// CompressedLevelSize(format, w, h) bytes at out. Edge blocks repeat the last
+// row/column. Block rows are spread over worker threads.
+void CompressImage(BlockFormat format, const unsigned char* pixels, int width, int height, int channels, unsigned char* out);
@@ -0,0 +1,108 @@
+#pragma once
+
+// DepthSort.h - parallel radix sort of instances by quantized view depth
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Parallel.h"
+
+struct DepthSortScratch {
+    std::vector<uint64_t> items, temp;
+    std::vector<uint32_t> histograms; // 256 counters per chunk
+    std::vector<glm::vec2> ranges;    // per-chunk depth min/max
+};
+
+// Stable LSD radix sort of 'items' on bits [firstBit, firstBit + bits), 8 bits per pass.
+// Each pass is histogram (parallel per chunk) -> prefix sum -> scatter (parallel per
+// chunk). Chunks are fixed-size, so the result never depends on the thread count.
+inline void ParallelRadixSort(std::vector<uint64_t>& items, std::vector<uint64_t>& temp,
+    std::vector<uint32_t>& histograms, unsigned firstBit, unsigned bits)
+{
+    const size_t n = items.size();
+    const size_t chunk = 16384;
+    const size_t chunks = (n + chunk - 1) / chunk;
+    if (n < 2) return;
+    temp.resize(n);
+    histograms.resize(chunks * 256);
+
+    for (unsigned shift = firstBit; shift < firstBit + bits; shift += 8) {
+        std::fill(histograms.begin(), histograms.end(), 0u);
+        ParallelFor(chunks, [&](size_t c) {
+            uint32_t* h = &histograms[c * 256];
+            size_t end = std::min(n, (c + 1) * chunk);
+            for (size_t i = c * chunk; i < end; ++i) ++h[(items[i] >> shift) & 0xFF];
+        });
+
+        // exclusive prefix sum, digit-major so equal digits keep chunk order
+        uint32_t sum = 0;
+        for (size_t d = 0; d < 256; ++d) {
+            for (size_t c = 0; c < chunks; ++c) {
+                uint32_t count = histograms[c * 256 + d];
+                histograms[c * 256 + d] = sum;
+                sum += count;
+            }
+        }
+
+        ParallelFor(chunks, [&](size_t c) {
+            uint32_t* offset = &histograms[c * 256];
+            size_t end = std::min(n, (c + 1) * chunk);
+            for (size_t i = c * chunk; i < end; ++i) temp[offset[(items[i] >> shift) & 0xFF]++] = items[i];
+        });
+        items.swap(temp);
+    }
+}
+
+// Orders n instances back to front along viewDir (farthest first). pos(i) returns
+// the world position of instance i. Depth is quantized to 16 bits over the range
+// actually covered, so two 8-bit passes suffice. outOrder[k] = index of the k-th draw.
+template <typename GetPos>
+void SortBackToFront(size_t n, GetPos&& pos, const glm::vec3& eye, const glm::vec3& viewDir,
+    DepthSortScratch& scratch, std::vector<uint32_t>& outOrder)
+{
+    static_assert(sizeof(float) == sizeof(uint32_t), "depth is stored as raw float bits");
+    outOrder.resize(n);
+    if (n == 0) return;
+    const size_t chunk = 16384;
+    const size_t chunks = (n + chunk - 1) / chunk;
+
+    // depth per instance, parked in the low 32 bits as float for the min/max pass
+    scratch.items.resize(n);
+    scratch.ranges.resize(chunks);
+    ParallelFor(chunks, [&](size_t c) {
+        glm::vec2 r(1e30f, -1e30f);
+        size_t end = std::min(n, (c + 1) * chunk);
+        for (size_t i = c * chunk; i < end; ++i) {
+            float d = glm::dot(pos(i) - eye, viewDir);
+            r.x = std::min(r.x, d);
+            r.y = std::max(r.y, d);
+            uint32_t bitsOf;
+            std::memcpy(&bitsOf, &d, sizeof(d));
+            scratch.items[i] = bitsOf;
+        }
+        scratch.ranges[c] = r;
+    });
+    glm::vec2 range = scratch.ranges[0];
+    for (const glm::vec2& r : scratch.ranges) range = glm::vec2(std::min(range.x, r.x), std::max(range.y, r.y));
+    float scale = range.y > range.x ? 65535.0f / (range.y - range.x) : 0.0f;
+
+    // key = inverted depth in bits 32..47 (far sorts first), index in the low bits
+    ParallelFor(chunks, [&](size_t c) {
+        size_t end = std::min(n, (c + 1) * chunk);
+        for (size_t i = c * chunk; i < end; ++i) {
+            float d;
+            uint32_t bitsOf = (uint32_t)scratch.items[i];
+            std::memcpy(&d, &bitsOf, sizeof(d));
+            uint64_t q = (uint64_t)((range.y - d) * scale + 0.5f);
+            scratch.items[i] = (std::min<uint64_t>(q, 65535) << 32) | (uint64_t)i;
+        }
+    });
+
+    ParallelRadixSort(scratch.items, scratch.temp, scratch.histograms, 32, 16);
+
+    ParallelFor(chunks, [&](size_t c) {
+        size_t end = std::min(n, (c + 1) * chunk);
+        for (size_t i = c * chunk; i < end; ++i) outOrder[i] = (uint32_t)scratch.items[i];
+    });
+}
@@ -1,10 +1,11 @@
 #include "EnvSphere.h"
 #include <cmath>
+#include <iostream>
 #include <glm/gtc/constants.hpp>
 
-MeshGL CreateUVSphere(int latSegments, int longSegments, float radius) {
+MeshGL CreateUVSphere(int latSegments, int longSegments, float radius, GeometryArena* arena) {
     MeshGL mesh;
-    std::vector<float> verts; // pos.x, pos.y, pos.z, normal.x, normal.y, normal.z
+    std::vector<unsigned char> verts;
     std::vector<unsigned int> inds;
 
     for (int y = 0; y <= latSegments; ++y) {
@@ -26,12 +27,10 @@ MeshGL CreateUVSphere(int latSegments, int longSegments, float radius) {
             glm::vec3 pos(px, py, pz);
             glm::vec3 n = glm::normalize(pos);
 
-            verts.push_back(pos.x);
-            verts.push_back(pos.y);
-            verts.push_back(pos.z);
-            verts.push_back(n.x);
-            verts.push_back(n.y);
-            verts.push_back(n.z);
+            verts.resize(verts.size() + SphereVertexLayout::stride);
+            unsigned char* vert = &verts[verts.size() - SphereVertexLayout::stride];
+            SphereVertexLayout::Put<0>(vert, pos);
+            SphereVertexLayout::Put<1>(vert, n);
         }
     }
 
@@ -50,6 +49,20 @@ MeshGL CreateUVSphere(int latSegments, int longSegments, float radius) {
         }
     }
 
+    mesh.indexCount = (GLsizei)inds.size();
+    if (arena && arena->VertexStride() != (GLsizei)SphereVertexLayout::stride) {
+        std::cerr << "CreateUVSphere: arena vertex format does not match SphereVertexLayout\n";
+        arena = nullptr;
+    }
+    if (arena) {
+        mesh.arena = arena;
+        mesh.geometry = arena->Allocate(verts.data(), verts.size() / SphereVertexLayout::stride, inds.data(), inds.size());
+        mesh.VAO = arena->VAO();
+        return mesh;
+    }
+    mesh.geometry.vertexCount = (GLuint)(verts.size() / SphereVertexLayout::stride);
+    mesh.geometry.indexCount = (GLuint)inds.size();
+
     // create GL buffers
     glGenVertexArrays(1, &mesh.VAO);
     glGenBuffers(1, &mesh.VBO);
@@ -57,22 +70,15 @@ MeshGL CreateUVSphere(int latSegments, int longSegments, float radius) {
 
     glBindVertexArray(mesh.VAO);
     glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
-    glBufferData(GL_ARRAY_BUFFER, verts.size() * sizeof(float), verts.data(), GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, verts.size(), verts.data(), GL_STATIC_DRAW);
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBO);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, inds.size() * sizeof(unsigned int), inds.data(), GL_STATIC_DRAW);
 
-    // pos (location 0)
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(0));
-
-    // normal (location 1)
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+    // pos (location 0), normal (location 1)
+    SphereVertexLayout::Apply();
 
     glBindVertexArray(0);
-
-    mesh.indexCount = (GLsizei)inds.size();
     return mesh;
 }
 
@@ -107,10 +113,25 @@ MeshGL CreateScreenQuad() {
 
     glBindVertexArray(0);
     mesh.indexCount = 6;
+    mesh.geometry.vertexCount = 4;
+    mesh.geometry.indexCount = 6;
     return mesh;
 }
 
+void DrawMesh(const MeshGL& m) {
+    glBindVertexArray(m.VAO);
+    glDrawElementsBaseVertex(GL_TRIANGLES, m.indexCount, GL_UNSIGNED_INT,
+        (void*)((size_t)m.geometry.firstIndex * sizeof(unsigned int)), m.geometry.baseVertex);
+    glBindVertexArray(0);
+}
+
 void DestroyMesh(MeshGL& m) {
+    if (m.arena) {
+        // the arena owns the VAO and buffers
+        m.arena->Free(m.geometry);
+        m.arena = nullptr;
+        m.VAO = 0;
+    }
     if (m.EBO) { glDeleteBuffers(1, &m.EBO); m.EBO = 0; }
     if (m.VBO) { glDeleteBuffers(1, &m.VBO); m.VBO = 0; }
     if (m.VAO) { glDeleteVertexArrays(1, &m.VAO); m.VAO = 0; }
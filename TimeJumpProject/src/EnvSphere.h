@@ -2,15 +2,28 @@
 #include <vector>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include "VertexLayout.h"
+#include "GeometryArena.h"
 
 struct MeshGL {
     GLuint VAO = 0;
-    GLuint VBO = 0;
+    GLuint VBO = 0;                  // 0 when the mesh lives in an arena
     GLuint EBO = 0;
     GLsizei indexCount = 0;
+    GeometryArena* arena = nullptr;
+    GeometryRange geometry;
     glm::mat4 model = glm::mat4(1.0f);
 };
 
-MeshGL CreateUVSphere(int latSegments = 32, int longSegments = 32, float radius = 5.0f);
+// 12 bytes per vertex: half positions (a few mm at radius 15, so no bounds
+// normalization and no shader change), snorm normals
+typedef VertexLayout<
+    Attrib<0, AttribHalf4>,
+    Attrib<1, AttribSnorm1010102>> SphereVertexLayout;
+
+// with an arena (SphereVertexLayout) the sphere is stored there and uses its VAO
+MeshGL CreateUVSphere(int latSegments = 32, int longSegments = 32, float radius = 5.0f, GeometryArena* arena = nullptr);
 MeshGL CreateScreenQuad();
+// binds the mesh's VAO and draws all of it
+void DrawMesh(const MeshGL& m);
 void DestroyMesh(MeshGL& m);
@@ -0,0 +1,344 @@
+// ForestSim.cpp
+#include "ForestSim.h"
+#include "Parallel.h"
+#include "Terrain.h"
+
+#include <glm/gtc/constants.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FOREST_SIM_SSE2 1
+#endif
+
+namespace {
+
+// trees per ParallelFor item; a multiple of 4 so SIMD lanes never straddle chunks
+const size_t kChunk = 8192;
+
+// lowbias32 integer hash, used to derive per-tree random streams
+uint32_t Hash32(uint32_t x) {
+    x ^= x >> 16; x *= 0x7FEB352Du;
+    x ^= x >> 15; x *= 0x846CA68Bu;
+    x ^= x >> 16;
+    return x;
+}
+
+// xorshift32: only shifts and xors, so the SIMD kernel advances 4 streams at once
+inline uint32_t NextRng(uint32_t& x) {
+    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+    return x;
+}
+
+inline float Rng01(uint32_t& x) { return (float)(NextRng(x) >> 8) * (1.0f / 16777216.0f); }
+
+// per-step constants shared by the scalar and SIMD kernels
+struct StepConsts {
+    float dt, grow, invMaxAge, base, old, crowdMort, crowdPen;
+};
+
+// one tree, one step: age, approach the crowded site target, roll for death
+inline void StepScalar(const StepConsts& k, float& age, float& size, float site, float crowd,
+    float& alive, uint32_t& rng)
+{
+    float a = alive;
+    age += k.dt * a;
+    float target = site * std::max(1.0f - k.crowdPen * crowd, 0.0f);
+    size += a * k.grow * (target - size);
+    float r = age * k.invMaxAge, r2 = r * r;
+    // grouped as the SSE2 kernel adds them, so a tree rolls the same in either
+    float hd = (k.base + (k.old * (r2 * r2) + k.crowdMort * crowd)) * k.dt;
+    float p = hd / (1.0f + hd); // ~1 - exp(-hd) without the exp, stays below 1
+    if (Rng01(rng) < p) alive = 0.0f;
+}
+
+} // namespace
+
+ForestSim::~ForestSim() {
+    if (job.valid()) job.wait();
+}
+
+int ForestSim::CellOf(float x, float z) const {
+    int cx = std::min(std::max((int)std::floor((x - originX) / params.cellSize), 0), cellsX - 1);
+    int cz = std::min(std::max((int)std::floor((z - originZ) / params.cellSize), 0), cellsZ - 1);
+    return cz * cellsX + cx;
+}
+
+float ForestSim::SiteQuality(float x, float z) const {
+    const ScatterRules& r = params.placement;
+    if (x < r.minX || x > r.maxX || z < r.minZ || z > r.maxZ) return 0.0f;
+    float y = terrain->GetHeightAt(x, z);
+    if (!std::isfinite(y) || y < r.minHeight || y > r.maxHeight) return 0.0f;
+
+    glm::vec3 n = terrain->GetNormalAt(x, z);
+    float maxSlope = glm::radians(glm::clamp(r.maxSlopeDeg, 1.0f, 90.0f));
+    float slope = std::acos(glm::clamp(n.y, -1.0f, 1.0f));
+    if (!std::isfinite(slope) || slope > maxSlope) return 0.0f;
+
+    // steeper ground carries smaller trees
+    float q = 1.0f - 0.5f * (slope / maxSlope) * (slope / maxSlope);
+    if (r.density && !r.density->Empty())
+        q *= r.density->Sample((x - r.minX) / (r.maxX - r.minX), (z - r.minZ) / (r.maxZ - r.minZ));
+    return q;
+}
+
+size_t ForestSim::NewTree(float x, float z, float quality, uint32_t seed) {
+    size_t i;
+    if (!freeList.empty()) {
+        i = freeList.back();
+        freeList.pop_back();
+    }
+    else {
+        i = posX.size();
+        posX.push_back(0); posZ.push_back(0);
+        age.push_back(0); size.push_back(0); site.push_back(0); alive.push_back(0); crowd.push_back(0);
+        startAge.push_back(0); startSize.push_back(0);
+        rng.push_back(0); cell.push_back(0); handle.push_back(kInvalidTree); used.push_back(0);
+    }
+    posX[i] = x; posZ[i] = z;
+    age[i] = 0.0f;
+    size[i] = params.seedlingSize;
+    site[i] = quality;
+    alive[i] = 1.0f;
+    crowd[i] = 0.0f;
+    startAge[i] = startSize[i] = 0.0f; // born inside the pending jump: grows in from nothing
+    rng[i] = Hash32(seed) | 1u;        // xorshift must never be 0
+    cell[i] = CellOf(x, z);
+    handle[i] = kInvalidTree;
+    used[i] = 1;
+    return i;
+}
+
+void ForestSim::Init(TreeInstancer& inst, int s, const Terrain& t, const ForestParams& p) {
+    if (job.valid()) job.wait();
+    job = std::future<ForestStats>();
+    terrain = &t;
+    species = s;
+    params = p;
+    params.cellSize = std::max(params.cellSize, 1.0f);
+    stepCounter = 0;
+    pendingApply = false;
+
+    posX.clear(); posZ.clear(); age.clear(); size.clear(); site.clear(); alive.clear(); crowd.clear();
+    startAge.clear(); startSize.clear(); rng.clear(); cell.clear(); handle.clear(); used.clear();
+    freeList.clear();
+
+    const ScatterRules& r = params.placement;
+    originX = r.minX;
+    originZ = r.minZ;
+    cellsX = std::max(1, (int)std::ceil((r.maxX - r.minX) / params.cellSize));
+    cellsZ = std::max(1, (int)std::ceil((r.maxZ - r.minZ) / params.cellSize));
+    biomass.assign((size_t)cellsX * cellsZ, 0.0f);
+
+    // adopt the existing trees with a spread of ages so they do not all die at once
+    std::vector<TreeHandle> handles;
+    std::vector<glm::vec4> growth;
+    for (TreeHandle h = 0; h < (TreeHandle)inst.HandleCount(s) && posX.size() < params.maxTrees; ++h) {
+        glm::mat4 m;
+        if (!inst.GetInstance(s, h, m)) continue;
+        // placed by the scatter rules already, so keep every adopted tree viable
+        size_t i = NewTree(m[3].x, m[3].z, std::max(SiteQuality(m[3].x, m[3].z), 0.25f), r.seed ^ Hash32(h));
+        age[i] = (0.1f + 0.6f * Rng01(rng[i])) * params.maxAge;
+        size[i] = site[i] * (1.0f - std::exp(-params.growthRate * age[i]));
+        startAge[i] = age[i];
+        startSize[i] = size[i];
+        handle[i] = h;
+        handles.push_back(h);
+        growth.push_back(glm::vec4(size[i], size[i], age[i], age[i]));
+    }
+    inst.SetGrowth(s, handles, growth);
+    stats = ForestStats();
+    stats.alive = handles.size();
+}
+
+void ForestSim::StepKernel(size_t first, size_t last, float dt) {
+    StepConsts k;
+    k.dt = dt;
+    k.grow = 1.0f - std::exp(-params.growthRate * dt);
+    k.invMaxAge = 1.0f / std::max(params.maxAge, 1.0f);
+    k.base = params.baseMortality;
+    k.old = params.oldAgeMortality;
+    k.crowdMort = params.crowdMortality;
+    k.crowdPen = params.crowdGrowthPenalty;
+
+    size_t i = first;
+#ifdef FOREST_SIM_SSE2
+    const __m128 vDt = _mm_set1_ps(k.dt), vGrow = _mm_set1_ps(k.grow), vInvMax = _mm_set1_ps(k.invMaxAge);
+    const __m128 vBase = _mm_set1_ps(k.base), vOld = _mm_set1_ps(k.old), vCrowdMort = _mm_set1_ps(k.crowdMort);
+    const __m128 vPen = _mm_set1_ps(k.crowdPen), vOne = _mm_set1_ps(1.0f), vZero = _mm_setzero_ps();
+    const __m128 vInv24 = _mm_set1_ps(1.0f / 16777216.0f);
+
+    for (; i + 4 <= last; i += 4) {
+        __m128 a = _mm_loadu_ps(&alive[i]);
+        __m128 ag = _mm_loadu_ps(&age[i]);
+        __m128 sz = _mm_loadu_ps(&size[i]);
+        __m128 st = _mm_loadu_ps(&site[i]);
+        __m128 cr = _mm_loadu_ps(&crowd[i]);
+
+        ag = _mm_add_ps(ag, _mm_mul_ps(vDt, a));
+        __m128 target = _mm_mul_ps(st, _mm_max_ps(_mm_sub_ps(vOne, _mm_mul_ps(vPen, cr)), vZero));
+        sz = _mm_add_ps(sz, _mm_mul_ps(_mm_mul_ps(a, vGrow), _mm_sub_ps(target, sz)));
+
+        __m128 r = _mm_mul_ps(ag, vInvMax);
+        __m128 r2 = _mm_mul_ps(r, r);
+        __m128 hazard = _mm_add_ps(vBase, _mm_add_ps(_mm_mul_ps(vOld, _mm_mul_ps(r2, r2)), _mm_mul_ps(vCrowdMort, cr)));
+        __m128 hd = _mm_mul_ps(hazard, vDt);
+        __m128 p = _mm_div_ps(hd, _mm_add_ps(vOne, hd));
+
+        __m128i x = _mm_loadu_si128((const __m128i*)&rng[i]);
+        x = _mm_xor_si128(x, _mm_slli_epi32(x, 13));
+        x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+        x = _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+        __m128 u = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(x, 8)), vInv24);
+        a = _mm_and_ps(a, _mm_cmpge_ps(u, p));
+
+        _mm_storeu_ps(&alive[i], a);
+        _mm_storeu_ps(&age[i], ag);
+        _mm_storeu_ps(&size[i], sz);
+        _mm_storeu_si128((__m128i*)&rng[i], x);
+    }
+#endif
+    for (; i < last; ++i) StepScalar(k, age[i], size[i], site[i], crowd[i], alive[i], rng[i]);
+}
+
+void ForestSim::Seed(float dt) {
+    const size_t n = posX.size();
+    const size_t chunks = (n + kChunk - 1) / kChunk;
+    const float chance = std::min(params.seedRate * dt, 1.0f);
+    if (seedChunks.size() < chunks) seedChunks.resize(chunks);
+
+    // candidates in parallel (one per tree at most), against the step's start density;
+    // only a few trees seed per step, so each chunk keeps a short list
+    ParallelFor(chunks, [&](size_t c) {
+        std::vector<SeedCandidate>& out = seedChunks[c];
+        out.clear();
+        size_t end = std::min(n, (c + 1) * kChunk);
+        for (size_t i = c * kChunk; i < end; ++i) {
+            if (alive[i] == 0.0f || age[i] < params.maturityAge) continue;
+            if (Rng01(rng[i]) >= chance) continue;
+            float ang = Rng01(rng[i]) * glm::two_pi<float>();
+            float dist = params.seedRadius * std::sqrt(Rng01(rng[i]));
+            float x = posX[i] + std::cos(ang) * dist, z = posZ[i] + std::sin(ang) * dist;
+            if (biomass[CellOf(x, z)] + params.seedlingSize > params.cellCapacity) continue;
+            float q = SiteQuality(x, z);
+            if (q > 0.0f) out.push_back({ x, z, q, rng[i] });
+        }
+    });
+
+    // accept in chunk (= tree index) order so the outcome never depends on thread timing
+    for (size_t c = 0; c < chunks; ++c) {
+        for (const SeedCandidate& sc : seedChunks[c]) {
+            if (freeList.empty() && posX.size() >= params.maxTrees) return;
+            int cellIndex = CellOf(sc.x, sc.z);
+            if (biomass[cellIndex] + params.seedlingSize > params.cellCapacity) continue;
+            biomass[cellIndex] += params.seedlingSize;
+            NewTree(sc.x, sc.z, sc.quality, sc.seed ^ stepCounter);
+            ++stats.births;
+        }
+    }
+}
+
+void ForestSim::Step(float dt) {
+    // competition: summed size per grid cell
+    std::fill(biomass.begin(), biomass.end(), 0.0f);
+    const size_t n = posX.size();
+    for (size_t i = 0; i < n; ++i) biomass[cell[i]] += size[i] * alive[i];
+
+    ParallelFor((n + kChunk - 1) / kChunk, [&](size_t c) {
+        size_t first = c * kChunk, last = std::min(n, first + kChunk);
+        float inv = 1.0f / params.cellCapacity;
+        for (size_t i = first; i < last; ++i)
+            crowd[i] = std::max(biomass[cell[i]] - size[i] * alive[i], 0.0f) * inv;
+        StepKernel(first, last, dt);
+    });
+
+    Seed(dt);
+    ++stepCounter;
+}
+
+ForestStats ForestSim::Advance(float years) {
+    auto t0 = std::chrono::high_resolution_clock::now();
+    stats = ForestStats();
+
+    // 'from' state of the jump; trees that died earlier and are not committed stay hidden
+    size_t aliveBefore = 0;
+    for (size_t i = 0; i < posX.size(); ++i) {
+        startAge[i] = age[i];
+        startSize[i] = alive[i] != 0.0f ? size[i] : 0.0f;
+        aliveBefore += alive[i] != 0.0f;
+    }
+
+    if (terrain && years > 0.0f) {
+        int steps = std::min(std::max((int)std::ceil(years / params.maxStepYears), 1), std::max(params.maxSteps, 1));
+        float dt = years / (float)steps;
+        for (int s = 0; s < steps; ++s) Step(dt);
+        stats.steps = steps;
+    }
+
+    for (size_t i = 0; i < posX.size(); ++i) stats.alive += alive[i] != 0.0f;
+    stats.deaths = aliveBefore + stats.births - stats.alive;
+    stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+    pendingApply = true;
+    return stats;
+}
+
+bool ForestSim::StartAdvance(float years) {
+    if (job.valid() || !terrain) return false;
+    job = std::async(std::launch::async, [this, years]() { return Advance(years); });
+    return true;
+}
+
+bool ForestSim::Ready() {
+    if (job.valid()) {
+        if (job.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return false;
+        job.get();
+    }
+    return pendingApply;
+}
+
+void ForestSim::Apply(TreeInstancer& inst) {
+    if (!pendingApply || job.valid()) return;
+    pendingApply = false;
+
+    std::vector<TreeHandle> handles;
+    std::vector<glm::vec4> growth;
+    handles.reserve(posX.size());
+    growth.reserve(posX.size());
+    for (size_t i = 0; i < posX.size(); ++i) {
+        if (!used[i]) continue;
+        float to = alive[i] != 0.0f ? size[i] : 0.0f; // the dead shrink away during the blend
+        glm::vec4 g(startSize[i], to, startAge[i], age[i]);
+        if (handle[i] != kInvalidTree) {
+            handles.push_back(handle[i]);
+            growth.push_back(g);
+        }
+        else if (alive[i] != 0.0f) {
+            // seedling: base transform drawn from its own stream
+            uint32_t r = Hash32(rng[i]) | 1u;
+            ScatterInstance si;
+            si.position = glm::vec3(posX[i], terrain->GetHeightAt(posX[i], posZ[i]), posZ[i]);
+            si.rotation = Rng01(r) * glm::two_pi<float>();
+            si.scale = params.placement.minScale + (params.placement.maxScale - params.placement.minScale) * Rng01(r);
+            handle[i] = inst.AddInstance(species, InstanceMatrix(si), g);
+        }
+    }
+    inst.SetGrowth(species, handles, growth);
+}
+
+void ForestSim::Commit(TreeInstancer& inst) {
+    if (job.valid() || pendingApply) return; // the dead have not been shown shrinking yet
+    for (size_t i = 0; i < posX.size(); ++i) {
+        if (!used[i] || alive[i] != 0.0f) continue;
+        // seedlings that died inside one jump were never added
+        if (handle[i] != kInvalidTree) inst.RemoveInstance(species, handle[i]);
+        handle[i] = kInvalidTree;
+        used[i] = 0;
+        freeList.push_back((uint32_t)i);
+    }
+}
+
+size_t ForestSim::AliveCount() const {
+    return stats.alive;
+}
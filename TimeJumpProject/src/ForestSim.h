@@ -0,0 +1,108 @@
+#pragma once
+
+// ForestSim.h - tree ecosystem aged across time jumps (growth, death, seeding)
+#include <cstdint>
+#include <future>
+#include <vector>
+#include <glm/glm.hpp>
+#include "VegetationScatter.h"
+#include "TreeInstancer.h"
+
+class Terrain;
+
+struct ForestParams {
+    size_t maxTrees = 1000000;      // hard cap: extra adopted trees stay static, extra seedlings are dropped
+    float maxStepYears = 1.0f;      // a jump is split into steps of at most this...
+    int maxSteps = 32;              // ...but never more than this many (bounded jump time)
+
+    float growthRate = 0.06f;       // per year, size approaches the site's target exponentially
+    float maturityAge = 25.0f;      // years before a tree starts seeding
+    float maxAge = 180.0f;          // senescence scale
+    float baseMortality = 0.004f;   // per year
+    float oldAgeMortality = 0.08f;  // per year at maxAge, grows with (age / maxAge)^4
+    float crowdMortality = 0.05f;   // per year at full crowding
+    float crowdGrowthPenalty = 0.5f;
+    float seedRate = 0.12f;         // seedlings per mature tree per year
+    float seedRadius = 14.0f;
+    float seedlingSize = 0.05f;
+    float cellSize = 8.0f;          // competition grid
+    float cellCapacity = 1.0f;      // summed tree size per cell that counts as fully crowded
+
+    // where seedlings may take root (bounds, height, slope, density mask, base scale)
+    ScatterRules placement;
+};
+
+struct ForestStats {
+    size_t alive = 0;
+    size_t births = 0;
+    size_t deaths = 0;
+    int steps = 0;
+    double milliseconds = 0.0;
+};
+
+// Trees are kept as structure-of-arrays so one step is a handful of streaming
+// kernels (4-wide SSE where available) split over ParallelFor. Simulated trees map
+// to TreeInstancer handles of one species: Apply writes the before/after size of a
+// jump into their growth attribute and adds seedlings at size 0, Commit removes the
+// trees that died once the transition has played.
+class ForestSim {
+public:
+    ForestSim() = default;
+    ~ForestSim();
+
+    // adopts the species' current instances as a forest of mixed ages and writes
+    // their growth attribute
+    void Init(TreeInstancer& inst, int species, const Terrain& terrain, const ForestParams& params);
+
+    // runs 'years' of simulation on a background thread; false if one is running
+    bool StartAdvance(float years);
+    // synchronous version
+    ForestStats Advance(float years);
+    bool Busy() const { return job.valid(); }
+    // true once a StartAdvance result is ready for Apply
+    bool Ready();
+
+    // pushes the last advance into the instancer; blend uGrowthBlend 0 -> 1 afterwards
+    void Apply(TreeInstancer& inst);
+    // drops dead trees from the instancer (call when the blend reached 1)
+    void Commit(TreeInstancer& inst);
+
+    size_t AliveCount() const;
+    const ForestStats& LastStats() const { return stats; }
+
+private:
+    void Step(float dt);
+    void StepKernel(size_t first, size_t last, float dt);
+    void Seed(float dt);
+    size_t NewTree(float x, float z, float quality, uint32_t seed);
+    float SiteQuality(float x, float z) const;
+    int CellOf(float x, float z) const;
+
+    const Terrain* terrain = nullptr;
+    int species = -1;
+    ForestParams params;
+    uint32_t stepCounter = 0;
+
+    // SoA, one entry per tree index (indices are reused after Commit)
+    std::vector<float> posX, posZ;
+    std::vector<float> age, size, site, alive, crowd;
+    std::vector<float> startAge, startSize;   // state at the start of the pending jump
+    std::vector<uint32_t> rng;
+    std::vector<int32_t> cell;
+    std::vector<TreeHandle> handle;           // kInvalidTree until Apply adds it
+    std::vector<uint8_t> used;
+    std::vector<uint32_t> freeList;
+
+    // competition grid
+    int cellsX = 0, cellsZ = 0;
+    float originX = 0.0f, originZ = 0.0f;
+    std::vector<float> biomass;
+
+    // seeding scratch, candidates per ParallelFor chunk
+    struct SeedCandidate { float x, z, quality; uint32_t seed; };
+    std::vector<std::vector<SeedCandidate>> seedChunks;
+
+    std::future<ForestStats> job;
+    bool pendingApply = false;
+    ForestStats stats;
+};
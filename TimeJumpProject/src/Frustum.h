@@ -0,0 +1,37 @@
+#pragma once
+
+// Frustum.h - view frustum planes for CPU-side culling
+#include <glm/glm.hpp>
+
+struct Frustum {
+    glm::vec4 planes[6]; // xyz = inward normal, w = distance; left, right, bottom, top, near, far
+
+    // Gribb/Hartmann extraction from a combined proj * view matrix
+    static Frustum FromMatrix(const glm::mat4& viewProj) {
+        Frustum f;
+        glm::mat4 m = glm::transpose(viewProj); // rows of viewProj
+        f.planes[0] = m[3] + m[0];
+        f.planes[1] = m[3] - m[0];
+        f.planes[2] = m[3] + m[1];
+        f.planes[3] = m[3] - m[1];
+        f.planes[4] = m[3] + m[2];
+        f.planes[5] = m[3] - m[2];
+        for (glm::vec4& p : f.planes) p /= glm::length(glm::vec3(p));
+        return f;
+    }
+
+    bool IntersectsSphere(const glm::vec3& c, float r) const {
+        for (const glm::vec4& p : planes)
+            if (glm::dot(glm::vec3(p), c) + p.w < -r) return false;
+        return true;
+    }
+
+    bool IntersectsAABB(const glm::vec3& mn, const glm::vec3& mx) const {
+        for (const glm::vec4& p : planes) {
+            // farthest corner along the plane normal
+            glm::vec3 v(p.x >= 0.0f ? mx.x : mn.x, p.y >= 0.0f ? mx.y : mn.y, p.z >= 0.0f ? mx.z : mn.z);
+            if (glm::dot(glm::vec3(p), v) + p.w < 0.0f) return false;
+        }
+        return true;
+    }
+};
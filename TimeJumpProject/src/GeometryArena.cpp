@@ -0,0 +1,168 @@
+// GeometryArena.cpp
+#include "GeometryArena.h"
+
+#include <algorithm>
+
+// first allocation reserves this much of each buffer
+static const size_t kInitialBytes = 1 << 20;
+
+// null on contexts before 4.3 (see IndirectDrawList::LoadMultiDraw)
+static PFNGLMULTIDRAWELEMENTSINDIRECTPROC multiDrawElementsIndirect = nullptr;
+
+GeometryArena::GeometryArena(GLsizei vertexStride, LayoutFn layout)
+    : stride(vertexStride), applyLayout(layout) {}
+
+GeometryArena::~GeometryArena() {
+    Release();
+}
+
+void GeometryArena::Release() {
+    if (vbo) glDeleteBuffers(1, &vbo);
+    if (ebo) glDeleteBuffers(1, &ebo);
+    if (vao) glDeleteVertexArrays(1, &vao);
+    vao = vbo = ebo = 0;
+    vertexCapacity = indexCapacity = 0;
+    usedVertices = usedIndices = 0;
+    freeVertices.clear();
+    freeIndices.clear();
+}
+
+bool GeometryArena::Take(std::vector<Block>& freeBlocks, size_t count, size_t& outFirst) {
+    for (size_t i = 0; i < freeBlocks.size(); ++i) {
+        Block& b = freeBlocks[i];
+        if (b.count < count) continue;
+        outFirst = b.first;
+        b.first += count;
+        b.count -= count;
+        if (b.count == 0) freeBlocks.erase(freeBlocks.begin() + i);
+        return true;
+    }
+    return false;
+}
+
+void GeometryArena::Give(std::vector<Block>& freeBlocks, size_t first, size_t count) {
+    if (count == 0) return;
+    auto it = std::lower_bound(freeBlocks.begin(), freeBlocks.end(), first,
+        [](const Block& b, size_t f) { return b.first < f; });
+    it = freeBlocks.insert(it, Block{ first, count });
+    // merge with the next, then the previous neighbour
+    if (it + 1 != freeBlocks.end() && it->first + it->count == (it + 1)->first) {
+        it->count += (it + 1)->count;
+        freeBlocks.erase(it + 1);
+    }
+    if (it != freeBlocks.begin() && (it - 1)->first + (it - 1)->count == it->first) {
+        (it - 1)->count += it->count;
+        freeBlocks.erase(it);
+    }
+}
+
+void GeometryArena::Grow(GLenum target, GLuint& buffer, size_t& capacity, size_t elementSize, size_t need,
+    std::vector<Block>& freeBlocks)
+{
+    size_t newCapacity = std::max(capacity * 2, kInitialBytes / elementSize);
+    while (newCapacity < capacity + need) newCapacity *= 2;
+
+    GLuint grown = 0;
+    glGenBuffers(1, &grown);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+    glBufferData(GL_COPY_WRITE_BUFFER, newCapacity * elementSize, nullptr, GL_STATIC_DRAW);
+    if (buffer) {
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, capacity * elementSize);
+        glDeleteBuffers(1, &buffer);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    buffer = grown;
+    Give(freeBlocks, capacity, newCapacity - capacity);
+    capacity = newCapacity;
+
+    // re-point the VAO at the new store
+    glBindVertexArray(vao);
+    if (target == GL_ARRAY_BUFFER) {
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        applyLayout(0);
+    }
+    else {
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+    }
+    glBindVertexArray(0);
+}
+
+GeometryRange GeometryArena::Allocate(const void* vertices, size_t vertexCount,
+    const unsigned int* indices, size_t indexCount)
+{
+    GeometryRange range;
+    if (vao == 0) glGenVertexArrays(1, &vao);
+
+    size_t firstVertex = 0, firstIndex = 0;
+    if (!Take(freeVertices, vertexCount, firstVertex)) {
+        Grow(GL_ARRAY_BUFFER, vbo, vertexCapacity, (size_t)stride, vertexCount, freeVertices);
+        Take(freeVertices, vertexCount, firstVertex);
+    }
+    if (!Take(freeIndices, indexCount, firstIndex)) {
+        Grow(GL_ELEMENT_ARRAY_BUFFER, ebo, indexCapacity, sizeof(unsigned int), indexCount, freeIndices);
+        Take(freeIndices, indexCount, firstIndex);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferSubData(GL_ARRAY_BUFFER, firstVertex * stride, vertexCount * stride, vertices);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    // the element binding is VAO state, so upload through the copy target instead
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ebo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, firstIndex * sizeof(unsigned int), indexCount * sizeof(unsigned int), indices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    usedVertices += vertexCount;
+    usedIndices += indexCount;
+    range.baseVertex = (GLint)firstVertex;
+    range.firstIndex = (GLuint)firstIndex;
+    range.vertexCount = (GLuint)vertexCount;
+    range.indexCount = (GLuint)indexCount;
+    return range;
+}
+
+void GeometryArena::Free(const GeometryRange& range) {
+    Give(freeVertices, (size_t)range.baseVertex, range.vertexCount);
+    Give(freeIndices, range.firstIndex, range.indexCount);
+    usedVertices -= range.vertexCount;
+    usedIndices -= range.indexCount;
+}
+
+IndirectDrawList::~IndirectDrawList() {
+    if (buffer) glDeleteBuffers(1, &buffer);
+}
+
+bool IndirectDrawList::LoadMultiDraw(GLADloadproc load) {
+    multiDrawElementsIndirect = nullptr;
+    if (GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 3))
+        multiDrawElementsIndirect = (PFNGLMULTIDRAWELEMENTSINDIRECTPROC)load("glMultiDrawElementsIndirect");
+    return multiDrawElementsIndirect != nullptr;
+}
+
+bool IndirectDrawList::MultiDrawSupported() {
+    return multiDrawElementsIndirect != nullptr;
+}
+
+void IndirectDrawList::Submit(const std::function<void(GLuint baseInstance)>& rebase) {
+    if (commands.empty()) return;
+
+    if (!MultiDrawSupported()) {
+        for (const DrawElementsIndirectCommand& c : commands) {
+            if (rebase) rebase(c.baseInstance);
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, (GLsizei)c.count, GL_UNSIGNED_INT,
+                (void*)((size_t)c.firstIndex * sizeof(unsigned int)), (GLsizei)c.instanceCount, c.baseVertex);
+        }
+        return;
+    }
+
+    if (buffer == 0) glGenBuffers(1, &buffer);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffer);
+    size_t bytes = commands.size() * sizeof(DrawElementsIndirectCommand);
+    if (commands.size() > capacity) capacity = std::max<size_t>(commands.size() * 2, 64);
+    // re-specifying orphans the previous list, which the GPU may still be reading
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, capacity * sizeof(DrawElementsIndirectCommand), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, bytes, commands.data());
+    multiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, (GLsizei)commands.size(), 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
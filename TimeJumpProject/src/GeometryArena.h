@@ -0,0 +1,93 @@
+#pragma once
+
+// GeometryArena.h - one VAO/VBO/EBO shared by every static mesh of a vertex format,
+// and indirect multi-draw submission over it
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+// Where a mesh lives in its buffers. Indices stay relative to the mesh, so draws
+// add firstIndex to their index offset and pass baseVertex.
+struct GeometryRange {
+    GLint baseVertex = 0;
+    GLuint firstIndex = 0;
+    GLuint vertexCount = 0;
+    GLuint indexCount = 0;
+};
+
+// Suballocates vertex and index ranges (first fit, freed blocks coalesce) from two
+// buffers that double when full; the VAO handle survives growth, so meshes keep it.
+// GL objects are created on the first Allocate.
+class GeometryArena {
+public:
+    typedef void (*LayoutFn)(size_t baseOffset); // e.g. &ModelVertexLayout::Apply
+
+    GeometryArena(GLsizei vertexStride, LayoutFn applyLayout);
+    ~GeometryArena();
+    GeometryArena(const GeometryArena&) = delete;
+    GeometryArena& operator=(const GeometryArena&) = delete;
+
+    // copies one mesh in; vertices are vertexStride bytes each
+    GeometryRange Allocate(const void* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount);
+    void Free(const GeometryRange& range);
+    // deletes the GL objects (while the context is still alive); ranges become invalid
+    void Release();
+
+    GLuint VAO() const { return vao; }
+    GLuint IndexBuffer() const { return ebo; } // the VAO's element buffer
+    GLsizei VertexStride() const { return stride; }
+    size_t UsedBytes() const { return usedVertices * stride + usedIndices * sizeof(unsigned int); }
+    size_t CapacityBytes() const { return vertexCapacity * stride + indexCapacity * sizeof(unsigned int); }
+
+private:
+    struct Block { size_t first, count; };
+    static bool Take(std::vector<Block>& freeBlocks, size_t count, size_t& outFirst);
+    static void Give(std::vector<Block>& freeBlocks, size_t first, size_t count);
+    // reallocates 'buffer' with room for 'need' more elements, keeping its contents
+    void Grow(GLenum target, GLuint& buffer, size_t& capacity, size_t elementSize, size_t need,
+        std::vector<Block>& freeBlocks);
+
+    GLsizei stride;
+    LayoutFn applyLayout;
+    GLuint vao = 0, vbo = 0, ebo = 0;
+    size_t vertexCapacity = 0, indexCapacity = 0;   // in elements
+    size_t usedVertices = 0, usedIndices = 0;
+    std::vector<Block> freeVertices, freeIndices;   // sorted by first
+};
+
+// layout of GL_DRAW_INDIRECT_BUFFER entries
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+// Triangle draws that share one VAO, program and set of textures. On GL 4.3 Submit
+// is one glMultiDrawElementsIndirect; on 3.3 it loops glDrawElementsInstancedBaseVertex,
+// calling rebase(baseInstance) before each draw since 3.3 cannot offset instances
+// itself (pass null when no instanced attributes depend on it). Callers using
+// baseInstance bind their instanced attributes at instance 0.
+class IndirectDrawList {
+public:
+    ~IndirectDrawList();
+    // glad.c is generated for GL 3.3, so the 4.3 entry point is fetched here; call
+    // once after gladLoadGLLoader with the same loader. Returns MultiDrawSupported().
+    static bool LoadMultiDraw(GLADloadproc load);
+    static bool MultiDrawSupported();
+
+    void Clear() { commands.clear(); }
+    void Add(const DrawElementsIndirectCommand& c) { commands.push_back(c); }
+    bool Empty() const { return commands.empty(); }
+    size_t Size() const { return commands.size(); }
+
+    void Submit(const std::function<void(GLuint baseInstance)>& rebase = nullptr);
+
+private:
+    std::vector<DrawElementsIndirectCommand> commands;
+    GLuint buffer = 0;
+    size_t capacity = 0; // in commands
+};
@@ -0,0 +1,689 @@
+// GltfLoader.cpp
+#include "GltfLoader.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <utility>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+static const uint32_t kGlbMagic = 0x46546C67;     // "glTF"
+static const uint32_t kChunkJson = 0x4E4F534A;    // "JSON"
+static const uint32_t kChunkBin = 0x004E4942;     // "BIN\0"
+static const int kModeTriangles = 4;
+
+// ---- minimal JSON reader, enough for the GLB JSON chunk ----
+
+struct JsonValue {
+    enum Type { Null, Bool, Number, String, Array, Object };
+    Type type = Null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<JsonValue> items;                           // Array
+    std::vector<std::pair<std::string, JsonValue>> members; // Object
+
+    // missing keys / indices read as Null
+    const JsonValue& operator[](const char* key) const {
+        for (const auto& m : members)
+            if (m.first == key) return m.second;
+        return Missing();
+    }
+    const JsonValue& operator[](size_t i) const { return i < items.size() ? items[i] : Missing(); }
+    const JsonValue& operator[](int i) const { return i >= 0 ? (*this)[(size_t)i] : Missing(); }
+    size_t Size() const { return items.size(); }
+    bool IsNull() const { return type == Null; }
+    int Int(int fallback = -1) const { return type == Number ? (int)number : fallback; }
+    double Num(double fallback = 0.0) const { return type == Number ? number : fallback; }
+
+    static const JsonValue& Missing() {
+        static const JsonValue none;
+        return none;
+    }
+};
+
+class JsonReader {
+public:
+    JsonReader(const char* begin, const char* end) : p(begin), end(end) {}
+
+    bool Parse(JsonValue& out) {
+        if (!Value(out, 0)) return false;
+        SkipBlanks();
+        return p == end;
+    }
+
+private:
+    void SkipBlanks() {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r' || *p == '\0')) ++p;
+    }
+    bool Literal(const char* word) {
+        size_t n = std::strlen(word);
+        if ((size_t)(end - p) < n || std::memcmp(p, word, n) != 0) return false;
+        p += n;
+        return true;
+    }
+    // skips any separators; true when the container closes
+    bool Next(char close, bool& closed) {
+        SkipBlanks();
+        if (p < end && *p == ',') { ++p; closed = false; return true; }
+        if (p < end && *p == close) { ++p; closed = true; return true; }
+        return false;
+    }
+
+    bool Value(JsonValue& v, int depth) {
+        if (depth > 64) return false;
+        SkipBlanks();
+        if (p >= end) return false;
+        switch (*p) {
+        case '{': {
+            v.type = JsonValue::Object;
+            ++p;
+            SkipBlanks();
+            if (p < end && *p == '}') { ++p; return true; }
+            for (bool closed = false; !closed;) {
+                SkipBlanks();
+                std::string key;
+                if (!StringBody(key)) return false;
+                SkipBlanks();
+                if (p >= end || *p != ':') return false;
+                ++p;
+                v.members.emplace_back(std::move(key), JsonValue());
+                if (!Value(v.members.back().second, depth + 1) || !Next('}', closed)) return false;
+            }
+            return true;
+        }
+        case '[': {
+            v.type = JsonValue::Array;
+            ++p;
+            SkipBlanks();
+            if (p < end && *p == ']') { ++p; return true; }
+            for (bool closed = false; !closed;) {
+                v.items.emplace_back();
+                if (!Value(v.items.back(), depth + 1) || !Next(']', closed)) return false;
+            }
+            return true;
+        }
+        case '"':
+            v.type = JsonValue::String;
+            return StringBody(v.string);
+        case 't':
+            v.type = JsonValue::Bool;
+            v.boolean = true;
+            return Literal("true");
+        case 'f':
+            v.type = JsonValue::Bool;
+            return Literal("false");
+        case 'n':
+            return Literal("null");
+        default: {
+            // from_chars: locale-independent, and needs no terminator
+            v.type = JsonValue::Number;
+            auto result = std::from_chars(p, end, v.number);
+            if (result.ec != std::errc()) return false;
+            p = result.ptr;
+            return true;
+        }
+        }
+    }
+
+    bool StringBody(std::string& s) {
+        if (p >= end || *p != '"') return false;
+        ++p;
+        while (p < end && *p != '"') {
+            char c = *p++;
+            if (c != '\\') {
+                s += c;
+                continue;
+            }
+            if (p >= end) return false;
+            char e = *p++;
+            switch (e) {
+            case '"': case '\\': case '/': s += e; break;
+            case 'b': s += '\b'; break;
+            case 'f': s += '\f'; break;
+            case 'n': s += '\n'; break;
+            case 'r': s += '\r'; break;
+            case 't': s += '\t'; break;
+            case 'u': {
+                uint32_t cp = 0;
+                if (!Hex4(cp)) return false;
+                // surrogate pair
+                if (cp >= 0xD800 && cp < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+                    p += 2;
+                    uint32_t low = 0;
+                    if (!Hex4(low)) return false;
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                }
+                AppendUtf8(s, cp);
+                break;
+            }
+            default: return false;
+            }
+        }
+        if (p >= end) return false;
+        ++p;
+        return true;
+    }
+    bool Hex4(uint32_t& out) {
+        if (end - p < 4) return false;
+        auto result = std::from_chars(p, p + 4, out, 16);
+        if (result.ec != std::errc() || result.ptr != p + 4) return false;
+        p += 4;
+        return true;
+    }
+    static void AppendUtf8(std::string& s, uint32_t cp) {
+        if (cp < 0x80) s += (char)cp;
+        else if (cp < 0x800) { s += (char)(0xC0 | (cp >> 6)); s += (char)(0x80 | (cp & 0x3F)); }
+        else if (cp < 0x10000) { s += (char)(0xE0 | (cp >> 12)); s += (char)(0x80 | ((cp >> 6) & 0x3F)); s += (char)(0x80 | (cp & 0x3F)); }
+        else { s += (char)(0xF0 | (cp >> 18)); s += (char)(0x80 | ((cp >> 12) & 0x3F)); s += (char)(0x80 | ((cp >> 6) & 0x3F)); s += (char)(0x80 | (cp & 0x3F)); }
+    }
+
+    const char* p;
+    const char* end;
+};
+
+// ---- accessors ----
+
+struct Accessor {
+    GLenum componentType = 0;
+    int components = 0;
+    bool normalized = false;
+    size_t count = 0;
+    size_t stride = 0;          // bytes between elements
+    int view = -1;
+    size_t viewOffset = 0;      // bytes from the BIN chunk start
+    size_t offset = 0;          // accessor byteOffset inside the view
+    const unsigned char* data = nullptr; // first element
+    bool hasBounds = false;
+    glm::vec3 min{ 0.0f }, max{ 0.0f };
+};
+
+static size_t ComponentSize(GLenum type) {
+    switch (type) {
+    case GL_BYTE: case GL_UNSIGNED_BYTE: return 1;
+    case GL_SHORT: case GL_UNSIGNED_SHORT: return 2;
+    case GL_UNSIGNED_INT: case GL_FLOAT: return 4;
+    default: return 0;
+    }
+}
+
+static int ComponentCount(const std::string& type) {
+    if (type == "SCALAR") return 1;
+    if (type == "VEC2") return 2;
+    if (type == "VEC3") return 3;
+    if (type == "VEC4") return 4;
+    return 0;
+}
+
+static bool ResolveAccessor(const JsonValue& doc, int index, const unsigned char* bin, size_t binSize, Accessor& out) {
+    const JsonValue& a = doc["accessors"][(size_t)index];
+    if (index < 0 || a.IsNull()) return false;
+    if (!a["sparse"].IsNull()) {
+        std::cerr << "ImportGLB: sparse accessors are not supported\n";
+        return false;
+    }
+    out.componentType = (GLenum)a["componentType"].Int(0);
+    out.components = ComponentCount(a["type"].string);
+    out.normalized = a["normalized"].boolean;
+    out.count = (size_t)a["count"].Num(0.0);
+    out.view = a["bufferView"].Int(-1);
+    out.offset = (size_t)a["byteOffset"].Num(0.0);
+    size_t elementSize = ComponentSize(out.componentType) * (size_t)out.components;
+    if (elementSize == 0 || out.view < 0) return false;
+
+    const JsonValue& v = doc["bufferViews"][(size_t)out.view];
+    if (v.IsNull() || v["buffer"].Int(0) != 0) {
+        std::cerr << "ImportGLB: only the embedded BIN buffer is supported\n";
+        return false;
+    }
+    out.viewOffset = (size_t)v["byteOffset"].Num(0.0);
+    size_t viewLength = (size_t)v["byteLength"].Num(0.0);
+    out.stride = (size_t)v["byteStride"].Num(0.0);
+    if (out.stride == 0) out.stride = elementSize;
+    if (out.viewOffset + viewLength > binSize) return false;
+    if (out.count > 0 && out.offset + (out.count - 1) * out.stride + elementSize > viewLength) return false;
+    out.data = bin + out.viewOffset + out.offset;
+
+    const JsonValue& mn = a["min"];
+    const JsonValue& mx = a["max"];
+    out.hasBounds = mn.Size() >= 3 && mx.Size() >= 3;
+    for (int c = 0; out.hasBounds && c < 3; ++c) {
+        out.min[c] = (float)mn[(size_t)c].Num();
+        out.max[c] = (float)mx[(size_t)c].Num();
+    }
+    return true;
+}
+
+// component c of element i as float, normalized integers mapped per the glTF spec
+static float ReadFloat(const Accessor& a, size_t i, int c) {
+    const unsigned char* e = a.data + i * a.stride + (size_t)c * ComponentSize(a.componentType);
+    switch (a.componentType) {
+    case GL_FLOAT: { float f; std::memcpy(&f, e, 4); return f; }
+    case GL_BYTE: { int8_t v; std::memcpy(&v, e, 1); return a.normalized ? std::max(v / 127.0f, -1.0f) : (float)v; }
+    case GL_UNSIGNED_BYTE: { uint8_t v = *e; return a.normalized ? v / 255.0f : (float)v; }
+    case GL_SHORT: { int16_t v; std::memcpy(&v, e, 2); return a.normalized ? std::max(v / 32767.0f, -1.0f) : (float)v; }
+    case GL_UNSIGNED_SHORT: { uint16_t v; std::memcpy(&v, e, 2); return a.normalized ? v / 65535.0f : (float)v; }
+    case GL_UNSIGNED_INT: { uint32_t v; std::memcpy(&v, e, 4); return (float)v; }
+    default: return 0.0f;
+    }
+}
+
+static uint32_t ReadIndex(const Accessor& a, size_t i) {
+    const unsigned char* e = a.data + i * a.stride;
+    switch (a.componentType) {
+    case GL_UNSIGNED_BYTE: return *e;
+    case GL_UNSIGNED_SHORT: { uint16_t v; std::memcpy(&v, e, 2); return v; }
+    case GL_UNSIGNED_INT: { uint32_t v; std::memcpy(&v, e, 4); return v; }
+    default: return 0;
+    }
+}
+
+// ---- scene ----
+
+struct MeshInstance {
+    int mesh;
+    glm::mat4 world;
+};
+
+static glm::mat4 NodeTransform(const JsonValue& node) {
+    const JsonValue& m = node["matrix"];
+    if (m.Size() == 16) {
+        float f[16];
+        for (size_t i = 0; i < 16; ++i) f[i] = (float)m[i].Num();
+        return glm::make_mat4(f); // column-major, like glTF
+    }
+    glm::vec3 t(0.0f), s(1.0f);
+    glm::quat r(1.0f, 0.0f, 0.0f, 0.0f);
+    const JsonValue& tv = node["translation"];
+    const JsonValue& rv = node["rotation"];
+    const JsonValue& sv = node["scale"];
+    if (tv.Size() == 3) t = glm::vec3((float)tv[0].Num(), (float)tv[1].Num(), (float)tv[2].Num());
+    if (rv.Size() == 4) r = glm::quat((float)rv[3].Num(), (float)rv[0].Num(), (float)rv[1].Num(), (float)rv[2].Num());
+    if (sv.Size() == 3) s = glm::vec3((float)sv[0].Num(1.0), (float)sv[1].Num(1.0), (float)sv[2].Num(1.0));
+    glm::mat4 out = glm::mat4_cast(r);
+    out[0] *= s.x;
+    out[1] *= s.y;
+    out[2] *= s.z;
+    out[3] = glm::vec4(t, 1.0f);
+    return out;
+}
+
+static void CollectInstances(const JsonValue& doc, int node, const glm::mat4& parent, int depth,
+    std::vector<MeshInstance>& out)
+{
+    const JsonValue& n = doc["nodes"][(size_t)node];
+    if (node < 0 || n.IsNull() || depth > 64) return;
+    glm::mat4 world = parent * NodeTransform(n);
+    if (n["mesh"].Int() >= 0) out.push_back(MeshInstance{ n["mesh"].Int(), world });
+    const JsonValue& children = n["children"];
+    for (size_t i = 0; i < children.Size(); ++i)
+        CollectInstances(doc, children[i].Int(), world, depth + 1, out);
+}
+
+// ---- import ----
+
+static const char* const kSemantics[3] = { "POSITION", "NORMAL", "TEXCOORD_0" };
+
+// Every primitive's attributes must come from the same views in the same formats,
+// at the same vertex offset for all semantics (its baseVertex), with uint32 indices.
+static bool BuildDirect(const JsonValue& doc, const std::vector<MeshInstance>& instances,
+    const unsigned char* bin, size_t binSize, GlbAsset& out)
+{
+    for (const MeshInstance& inst : instances)
+        if (inst.world != glm::mat4(1.0f)) return false;
+
+    Accessor first[3];
+    bool seen = false;
+    size_t gpuBegin = binSize, gpuEnd = 0;
+    auto coverView = [&](const Accessor& a) {
+        const JsonValue& v = doc["bufferViews"][(size_t)a.view];
+        gpuBegin = std::min(gpuBegin, a.viewOffset);
+        gpuEnd = std::max(gpuEnd, a.viewOffset + (size_t)v["byteLength"].Num(0.0));
+    };
+
+    struct Pending { SubMeshRange range; size_t indexByteOffset; };
+    std::vector<Pending> pending;
+    bool hasBounds = false;
+    for (const MeshInstance& inst : instances) {
+        const JsonValue& prims = doc["meshes"][(size_t)inst.mesh]["primitives"];
+        for (size_t p = 0; p < prims.Size(); ++p) {
+            const JsonValue& prim = prims[p];
+            if (prim["mode"].Int(kModeTriangles) != kModeTriangles) continue;
+            Accessor idx;
+            if (!ResolveAccessor(doc, prim["indices"].Int(), bin, binSize, idx)) return false;
+            if (idx.componentType != GL_UNSIGNED_INT || idx.stride != 4) return false;
+
+            long long base = -1;
+            Accessor attr[3];
+            for (int s = 0; s < 3; ++s) {
+                int a = prim["attributes"][kSemantics[s]].Int();
+                bool present = a >= 0 && ResolveAccessor(doc, a, bin, binSize, attr[s]);
+                if (s == 0 && !present) return false;
+                if (!seen) {
+                    if (present) first[s] = attr[s];
+                    continue;
+                }
+                if (present != (first[s].components != 0)) return false;
+                if (!present) continue;
+                const Accessor& f = first[s];
+                if (attr[s].view != f.view || attr[s].componentType != f.componentType ||
+                    attr[s].components != f.components || attr[s].normalized != f.normalized ||
+                    attr[s].stride != f.stride || attr[s].offset % f.stride != f.offset % f.stride) return false;
+            }
+            for (int s = 0; s < 3; ++s) {
+                if (attr[s].components == 0) continue;
+                long long b = (long long)(attr[s].offset / attr[s].stride);
+                if (base >= 0 && b != base) return false;
+                base = b;
+                coverView(attr[s]);
+            }
+            seen = true;
+            coverView(idx);
+
+            Pending pr;
+            pr.range.materialId = prim["material"].Int();
+            pr.range.indexCount = idx.count;
+            pr.range.baseVertex = (int)base;
+            pr.indexByteOffset = idx.viewOffset + idx.offset;
+            pending.push_back(pr);
+            out.vertexCount = std::max(out.vertexCount, (size_t)base + attr[0].count);
+            out.indexCount += idx.count;
+            if (attr[0].hasBounds) {
+                out.boundsMin = hasBounds ? glm::min(out.boundsMin, attr[0].min) : attr[0].min;
+                out.boundsMax = hasBounds ? glm::max(out.boundsMax, attr[0].max) : attr[0].max;
+                hasBounds = true;
+            }
+        }
+    }
+    if (!seen || !hasBounds) return false;
+
+    gpuBegin &= ~(size_t)3; // keeps uint32 index offsets whole
+    out.gpuData = bin + gpuBegin;
+    out.gpuSize = gpuEnd - gpuBegin;
+    for (int s = 0; s < 3; ++s) {
+        const Accessor& f = first[s];
+        GlbAttribute& a = out.attributes[s];
+        a = GlbAttribute();
+        if (f.components == 0) continue;
+        a.components = f.components;
+        a.type = f.componentType;
+        a.normalized = f.normalized ? GL_TRUE : GL_FALSE;
+        a.stride = (GLsizei)f.stride;
+        a.offset = f.viewOffset + f.offset % f.stride - gpuBegin;
+    }
+    out.submeshes.clear();
+    for (Pending& pr : pending) {
+        pr.range.indexOffset = (pr.indexByteOffset - gpuBegin) / sizeof(uint32_t);
+        out.submeshes.push_back(pr.range);
+    }
+    out.direct = true;
+    return true;
+}
+
+static bool DecodeMeshes(const JsonValue& doc, const std::vector<MeshInstance>& instances,
+    const unsigned char* bin, size_t binSize, MeshData& data)
+{
+    data = MeshData();
+    for (const MeshInstance& inst : instances) {
+        glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(inst.world)));
+        const JsonValue& prims = doc["meshes"][(size_t)inst.mesh]["primitives"];
+        for (size_t p = 0; p < prims.Size(); ++p) {
+            const JsonValue& prim = prims[p];
+            if (prim["mode"].Int(kModeTriangles) != kModeTriangles) continue;
+            Accessor attr[3];
+            for (int s = 0; s < 3; ++s) {
+                int a = prim["attributes"][kSemantics[s]].Int();
+                if (a >= 0 && !ResolveAccessor(doc, a, bin, binSize, attr[s])) return false;
+            }
+            if (attr[0].components < 3) return false;
+
+            size_t base = data.vertices.size();
+            for (size_t i = 0; i < attr[0].count; ++i) {
+                ModelVertex v{};
+                glm::vec3 pos = glm::vec3(inst.world * glm::vec4(ReadFloat(attr[0], i, 0), ReadFloat(attr[0], i, 1), ReadFloat(attr[0], i, 2), 1.0f));
+                v.px = pos.x; v.py = pos.y; v.pz = pos.z;
+                if (attr[1].components >= 3 && i < attr[1].count) {
+                    glm::vec3 n = normalMatrix * glm::vec3(ReadFloat(attr[1], i, 0), ReadFloat(attr[1], i, 1), ReadFloat(attr[1], i, 2));
+                    float len = glm::length(n);
+                    if (len > 0.0f) n /= len;
+                    v.nx = n.x; v.ny = n.y; v.nz = n.z;
+                }
+                if (attr[2].components >= 2 && i < attr[2].count) {
+                    v.u = ReadFloat(attr[2], i, 0);
+                    v.v = ReadFloat(attr[2], i, 1);
+                }
+                data.vertices.push_back(v);
+            }
+
+            SubMeshRange r;
+            r.materialId = prim["material"].Int();
+            r.indexOffset = data.indices.size();
+            Accessor idx;
+            int indices = prim["indices"].Int();
+            if (indices >= 0) {
+                if (!ResolveAccessor(doc, indices, bin, binSize, idx)) return false;
+                for (size_t i = 0; i + 2 < idx.count; i += 3) {
+                    for (int k = 0; k < 3; ++k) {
+                        uint32_t index = ReadIndex(idx, i + k);
+                        if (index >= attr[0].count) return false;
+                        data.indices.push_back((unsigned int)(base + index));
+                    }
+                }
+            }
+            else {
+                for (size_t i = 0; i + 2 < attr[0].count; i += 3)
+                    for (int k = 0; k < 3; ++k) data.indices.push_back((unsigned int)(base + i + k));
+            }
+            r.indexCount = data.indices.size() - r.indexOffset;
+            // a transform that mirrors flips the winding
+            if (glm::determinant(glm::mat3(inst.world)) < 0.0f)
+                for (size_t i = r.indexOffset; i < data.indices.size(); i += 3) std::swap(data.indices[i + 1], data.indices[i + 2]);
+            data.submeshes.push_back(r);
+        }
+    }
+    return !data.indices.empty();
+}
+
+static void ReadMaterials(const JsonValue& doc, const unsigned char* bin, size_t binSize,
+    const std::string& folder, std::vector<GlbMaterial>& out)
+{
+    const JsonValue& materials = doc["materials"];
+    out.assign(materials.Size(), GlbMaterial());
+    for (size_t i = 0; i < materials.Size(); ++i) {
+        const JsonValue& m = materials[i];
+        GlbMaterial& g = out[i];
+        g.name = m["name"].string;
+        g.blend = !m["alphaMode"].IsNull() && m["alphaMode"].string != "OPAQUE";
+        int texture = m["pbrMetallicRoughness"]["baseColorTexture"]["index"].Int();
+        if (texture < 0) continue;
+        const JsonValue& image = doc["images"][(size_t)doc["textures"][(size_t)texture]["source"].Int(0)];
+        if (image.IsNull()) continue;
+        int view = image["bufferView"].Int();
+        if (view >= 0) {
+            const JsonValue& v = doc["bufferViews"][(size_t)view];
+            size_t offset = (size_t)v["byteOffset"].Num(0.0), length = (size_t)v["byteLength"].Num(0.0);
+            if (v["buffer"].Int(0) == 0 && offset + length <= binSize) {
+                g.imageData = bin + offset;
+                g.imageSize = length;
+            }
+        }
+        else if (!image["uri"].string.empty() && image["uri"].string.compare(0, 5, "data:") != 0) {
+            g.imagePath = (std::filesystem::path(folder) / image["uri"].string).string();
+        }
+        else {
+            std::cerr << "ImportGLB: material " << g.name << ": data URIs are not supported\n";
+        }
+    }
+}
+
+bool ImportGLB(const std::string& path, MappedFile& file, GlbAsset& out, bool allowDirect) {
+    out = GlbAsset();
+    if (!file.Open(path)) return false;
+    const unsigned char* base = file.Data();
+    size_t size = file.Size();
+
+    uint32_t header[3];
+    if (size < 20) {
+        std::cerr << "ImportGLB: " << path << " is too small\n";
+        return false;
+    }
+    std::memcpy(header, base, sizeof(header));
+    if (header[0] != kGlbMagic || header[1] != 2 || header[2] > size) {
+        std::cerr << "ImportGLB: " << path << " is not a glTF 2.0 binary\n";
+        return false;
+    }
+
+    // JSON chunk first, then an optional BIN chunk
+    const char* json = nullptr;
+    size_t jsonSize = 0;
+    const unsigned char* bin = nullptr;
+    size_t binSize = 0;
+    for (size_t offset = 12; offset + 8 <= header[2];) {
+        uint32_t chunk[2];
+        std::memcpy(chunk, base + offset, sizeof(chunk));
+        if (offset + 8 + chunk[0] > header[2]) break;
+        if (chunk[1] == kChunkJson && !json) {
+            json = (const char*)base + offset + 8;
+            jsonSize = chunk[0];
+        }
+        else if (chunk[1] == kChunkBin && !bin) {
+            bin = base + offset + 8;
+            binSize = chunk[0];
+        }
+        offset += 8 + ((chunk[0] + 3) & ~3u);
+    }
+    JsonValue doc;
+    if (!json || !JsonReader(json, json + jsonSize).Parse(doc)) {
+        std::cerr << "ImportGLB: " << path << ": malformed JSON chunk\n";
+        return false;
+    }
+
+    std::vector<MeshInstance> instances;
+    const JsonValue& scene = doc["scenes"][(size_t)doc["scene"].Int(0)];
+    if (!scene.IsNull()) {
+        const JsonValue& roots = scene["nodes"];
+        for (size_t i = 0; i < roots.Size(); ++i) CollectInstances(doc, roots[i].Int(), glm::mat4(1.0f), 0, instances);
+    }
+    else {
+        for (size_t m = 0; m < doc["meshes"].Size(); ++m) instances.push_back(MeshInstance{ (int)m, glm::mat4(1.0f) });
+    }
+
+    out.path = path;
+    if (!allowDirect || !BuildDirect(doc, instances, bin, binSize, out)) {
+        out.direct = false;
+        out.submeshes.clear();
+        auto cacheFile = std::make_shared<MappedFile>();
+        if (OpenMeshCache(MeshCachePath(path), path, *cacheFile, out.cached)) {
+            // processed on an earlier run: LODs included
+            out.cacheFile = std::move(cacheFile);
+            out.vertexCount = out.cached.mesh.vertexCount;
+            out.indexCount = out.cached.mesh.indexCount;
+            out.processed = true;
+        }
+        else {
+            out.vertexCount = out.indexCount = 0;
+            if (!DecodeMeshes(doc, instances, bin, binSize, out.mesh)) {
+                std::cerr << "ImportGLB: " << path << ": no readable triangle meshes\n";
+                return false;
+            }
+            out.vertexCount = out.mesh.vertices.size();
+            out.indexCount = out.mesh.indices.size();
+        }
+    }
+    std::filesystem::path folder = std::filesystem::path(path).parent_path();
+    ReadMaterials(doc, bin, binSize, folder.string(), out.materials);
+    return true;
+}
+
+// ---- upload ----
+
+static void LoadGlbMaterials(const std::vector<GlbMaterial>& materials, MeshGL_Model& outModel, bool loadTextures) {
+    outModel.materials.resize(materials.size());
+    for (size_t i = 0; i < materials.size(); ++i) {
+        const GlbMaterial& g = materials[i];
+        MaterialGL& m = outModel.materials[i];
+        m.name = g.name;
+        m.usesAlpha = g.blend;
+        bool hasAlpha = false;
+        // glTF UVs start at the top: no flip
+        if (!loadTextures) continue;
+        if (g.imageData) m.diffuseTex = LoadTexture2DFromMemory(g.imageData, g.imageSize, hasAlpha, false);
+        else if (!g.imagePath.empty()) m.diffuseTex = LoadTexture2D(g.imagePath, hasAlpha, false);
+    }
+    if (outModel.materials.empty()) {
+        outModel.materials.push_back(MaterialGL{ "default", 0, false });
+    }
+}
+
+void ProcessGLB(GlbAsset& asset) {
+    if (asset.direct || asset.processed) return;
+    OptimizeMesh(asset.mesh);
+    BuildMeshLods(asset.mesh);
+    QuantizeMesh(asset.mesh);
+    asset.processed = true;
+    SourceInfo source;
+    if (!asset.path.empty() && StatSource(asset.path, source, true))
+        WriteMeshCache(MeshCachePath(asset.path), asset.mesh, source);
+}
+
+void UploadGLB(GlbAsset& asset, MeshGL_Model& outModel, GeometryArena* arena, bool loadTextures) {
+    if (!asset.direct && asset.cacheFile) {
+        UploadMeshBuffers(asset.cached.mesh, outModel, arena);
+        outModel.submeshes = asset.cached.submeshes;
+        outModel.lods = asset.cached.lods;
+        outModel.meshlets = asset.cached.meshlets;
+        LoadGlbMaterials(asset.materials, outModel, loadTextures);
+        return;
+    }
+    if (!asset.direct) {
+        ProcessGLB(asset);
+        UploadMeshBuffers(ViewOf(asset.mesh), outModel, arena);
+        outModel.submeshes = asset.mesh.submeshes;
+        outModel.lods = asset.mesh.lods;
+        outModel.meshlets = asset.mesh.meshlets;
+        LoadGlbMaterials(asset.materials, outModel, loadTextures);
+        return;
+    }
+
+    // the file's own bytes are the vertex and index buffer
+    glGenVertexArrays(1, &outModel.VAO);
+    glGenBuffers(1, &outModel.VBO);
+    glBindVertexArray(outModel.VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, outModel.VBO);
+    glBufferData(GL_ARRAY_BUFFER, asset.gpuSize, asset.gpuData, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, outModel.VBO);
+    for (GLuint loc = 0; loc < 3; ++loc) {
+        const GlbAttribute& a = asset.attributes[loc];
+        if (a.components == 0) continue;
+        glEnableVertexAttribArray(loc);
+        glVertexAttribPointer(loc, a.components, a.type, a.normalized, a.stride, (void*)a.offset);
+    }
+    glBindVertexArray(0);
+
+    outModel.EBO = outModel.VBO; // same buffer, bound to both targets
+    outModel.arena = nullptr;
+    outModel.indexCount = asset.indexCount;
+    outModel.vertexCount = asset.vertexCount;
+    outModel.geometry = GeometryRange();
+    outModel.geometry.vertexCount = (GLuint)asset.vertexCount;
+    outModel.geometry.indexCount = (GLuint)asset.indexCount;
+    outModel.boundsMin = asset.boundsMin;
+    outModel.boundsMax = asset.boundsMax;
+    outModel.dequant = VertexDequant(); // stored values are object space already
+    outModel.submeshes = asset.submeshes;
+    outModel.lods.clear();
+    outModel.meshlets.Clear();
+    LoadGlbMaterials(asset.materials, outModel, loadTextures);
+}
+
+bool LoadGLBWithMaterials(const std::string& path, MeshGL_Model& outMesh, GeometryArena* arena) {
+    MappedFile file;
+    GlbAsset asset;
+    if (!ImportGLB(path, file, asset)) return false;
+    UploadGLB(asset, outMesh, arena);
+    return true;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+// GltfLoader.h - glTF 2.0 binary (.glb) import
+#include <glad/glad.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "ModelLoader.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+
+// one vertex attribute as stored in the BIN chunk, ready for glVertexAttribPointer
+struct GlbAttribute {
+    GLint components = 0;                  // 0 = absent
+    GLenum type = GL_FLOAT;                // glTF component types are GL enums
+    GLboolean normalized = GL_FALSE;
+    GLsizei stride = 0;
+    size_t offset = 0;                     // bytes from GlbAsset::gpuData
+};
+
+struct GlbMaterial {
+    std::string name;
+    std::string imagePath;                 // external base color image, or empty
+    const unsigned char* imageData = nullptr; // embedded image (points into the mapping)
+    size_t imageSize = 0;
+    bool blend = false;                    // alphaMode MASK or BLEND
+};
+
+// A parsed .glb, pointing into the mapping it was imported from.
+//  - direct (only when asked for): every primitive reads one shared vertex stream and
+//    uint32 indices, and every instancing node has an identity transform. The byte
+//    range holding the vertex and index views uploads as-is (gpuData/gpuSize),
+//    'attributes' point into it and each primitive is a submesh with its own
+//    baseVertex. Nothing is decoded, so there are no LODs either.
+//  - otherwise the accessors are decoded into 'mesh' (ModelVertex, node transforms
+//    baked in), one submesh per primitive instance; or, when "<path>.meshbin" matches
+//    the file, its processed geometry is mapped into 'cached' instead (MeshCache.h).
+struct GlbAsset {
+    bool direct = false;
+    const unsigned char* gpuData = nullptr;
+    size_t gpuSize = 0;
+    GlbAttribute attributes[3];            // POSITION, NORMAL, TEXCOORD_0 -> locations 0, 1, 2
+    std::vector<SubMeshRange> submeshes;   // direct: indexOffset counts uint32s from gpuData
+    size_t vertexCount = 0;
+    size_t indexCount = 0;
+    glm::vec3 boundsMin{ 0.0f };
+    glm::vec3 boundsMax{ 0.0f };
+
+    MeshData mesh;                         // decoded geometry when !direct and not cached
+    bool processed = false;                // ProcessGLB ran, or the cache held its result
+    std::string path;                      // the source, which the mesh cache is checked against
+    std::shared_ptr<MappedFile> cacheFile; // set when the mesh cache matched
+    MeshCacheView cached;                  // points into cacheFile
+    std::vector<GlbMaterial> materials;
+};
+
+// Maps path into 'file' and parses every mesh the default scene instances (every
+// mesh, if the file has no scenes). Triangle primitives only; no sparse accessors
+// or external buffers. False with a message on std::cerr on malformed input.
+// allowDirect: the caller draws full detail only (no LOD selection), so a file
+// laid out for it may skip decoding.
+bool ImportGLB(const std::string& path, MappedFile& file, GlbAsset& out, bool allowDirect = false);
+
+// decoded assets: OptimizeMesh, BuildMeshLods and QuantizeMesh (as PrepareOBJ), then the
+// mesh cache is written; no GL calls, so a loader thread can take it off UploadGLB,
+// which otherwise runs it
+void ProcessGLB(GlbAsset& asset);
+
+// direct assets get their own VAO and buffer; decoded ones may go into 'arena'
+// (ModelVertexLayout). Base color textures load unflipped into outMesh.materials,
+// unless loadTextures is false (materials then have names and no textures).
+void UploadGLB(GlbAsset& asset, MeshGL_Model& outMesh, GeometryArena* arena = nullptr, bool loadTextures = true);
+
+// ImportGLB + UploadGLB
+bool LoadGLBWithMaterials(const std::string& path, MeshGL_Model& outMesh, GeometryArena* arena = nullptr);
@@ -0,0 +1,108 @@
+// GrassRenderer.cpp
+#include "GrassRenderer.h"
+#include "Terrain.h"
+#include "Shader.h"
+#include "Frustum.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+GrassRenderer::~GrassRenderer() {
+    if (emptyVAO) glDeleteVertexArrays(1, &emptyVAO);
+}
+
+bool GrassRenderer::Init(const Terrain& t, float size, uint32_t seed) {
+    if (t.GetHeightTexture() == 0 || size <= 0.0f) {
+        std::cerr << "GrassRenderer: terrain has no height texture\n";
+        return false;
+    }
+    terrain = &t;
+    tileSize = size;
+    tiles.clear();
+
+    int tilesX = (int)std::ceil(t.GetSizeX() / size);
+    int tilesZ = (int)std::ceil(t.GetSizeZ() / size);
+    float x0 = -0.5f * t.GetSizeX(), z0 = -0.5f * t.GetSizeZ();
+    tiles.reserve((size_t)tilesX * tilesZ);
+
+    for (int tz = 0; tz < tilesZ; ++tz) {
+        for (int tx = 0; tx < tilesX; ++tx) {
+            GrassTile tile;
+            tile.origin = glm::vec2(x0 + tx * size, z0 + tz * size);
+            float lo = 0.0f, hi = 0.0f;
+            t.GetHeightRange(tile.origin.x, tile.origin.y, tile.origin.x + size, tile.origin.y + size, lo, hi);
+            // blades bend sideways in the wind, pad XZ a little too
+            tile.boundsMin = glm::vec3(tile.origin.x - 1.0f, lo, tile.origin.y - 1.0f);
+            tile.boundsMax = glm::vec3(tile.origin.x + size + 1.0f, hi + maxBladeHeight, tile.origin.y + size + 1.0f);
+            uint32_t h = seed ^ ((uint32_t)tx * 0x9E3779B1u) ^ ((uint32_t)tz * 0x85EBCA77u);
+            tile.seed = (int)(h & 0x7FFFFFFF);
+            tiles.push_back(tile);
+        }
+    }
+
+    if (emptyVAO == 0) glGenVertexArrays(1, &emptyVAO);
+    return true;
+}
+
+void GrassRenderer::CacheLocations(const Shader& shader) {
+    cachedShader = &shader;
+    cachedProgram = shader.ID;
+    uTileOrigin = shader.Uniform<glm::vec2>("uTileOrigin");
+    uTileSeed = shader.Uniform<int>("uTileSeed");
+    uBladeCount = shader.Uniform<float>("uBladeCount");
+    uWidthScale = shader.Uniform<float>("uWidthScale");
+}
+
+void GrassRenderer::Draw(const Shader& shader, const glm::mat4& view, const glm::mat4& proj,
+    const glm::vec3& camPos, float time)
+{
+    lastBlades = lastTiles = 0;
+    if (!terrain || tiles.empty() || emptyVAO == 0) return;
+    if (cachedShader != &shader || cachedProgram != shader.ID) CacheLocations(shader);
+
+    // assume shader.Use() already called
+    shader.SetMat4("uView", view);
+    shader.SetMat4("uProj", proj);
+    shader.SetInt("uHeightMap", 0);
+    shader.SetVec2("uHeightMapSize", glm::vec2((float)terrain->GetHeightMapWidth(), (float)terrain->GetHeightMapHeight()));
+    shader.SetFloat("uHeightScale", terrain->GetHeightScale());
+    shader.SetFloat("uTerrainSize", terrain->GetSizeX());
+    shader.SetFloat("uTileSize", tileSize);
+    shader.SetFloat("uTime", time);
+    shader.SetVec2("uWindDir", glm::normalize(windDir));
+    shader.SetFloat("uWindStrength", windStrength);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, terrain->GetHeightTexture());
+
+    Frustum frustum = Frustum::FromMatrix(proj * view);
+    float falloff = std::max(farDistance - nearDistance, 1e-3f);
+
+    glDisable(GL_CULL_FACE); // blades are seen from both sides
+    glBindVertexArray(emptyVAO);
+    for (const GrassTile& tile : tiles) {
+        // distance from the camera to the tile rectangle (0 when standing on it)
+        glm::vec2 c = glm::clamp(glm::vec2(camPos.x, camPos.z), tile.origin, tile.origin + glm::vec2(tileSize));
+        float dist = glm::length(glm::vec2(camPos.x, camPos.z) - c);
+        if (dist >= farDistance) continue;
+        if (!frustum.IntersectsAABB(tile.boundsMin, tile.boundsMax)) continue;
+
+        // quadratic density falloff; survivors widen so coverage reads the same
+        float k = 1.0f - glm::clamp((dist - nearDistance) / falloff, 0.0f, 1.0f);
+        float blades = std::max((float)maxBladesPerTile * k * k, 16.0f);
+        float widthScale = std::min(std::sqrt((float)maxBladesPerTile / blades), 4.0f);
+        GLsizei instances = (GLsizei)std::ceil(blades);
+
+        shader.Set(uTileOrigin, tile.origin);
+        shader.Set(uTileSeed, tile.seed);
+        shader.Set(uBladeCount, blades);
+        shader.Set(uWidthScale, widthScale);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 15, instances);
+
+        lastBlades += (size_t)instances;
+        ++lastTiles;
+    }
+    glBindVertexArray(0);
+    glEnable(GL_CULL_FACE);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+// GrassRenderer.h - procedural GPU grass over the terrain
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Shader.h"
+
+class Terrain;
+
+struct GrassTile {
+    glm::vec2 origin;      // world XZ of the min corner
+    glm::vec3 boundsMin;   // AABB incl. blade height, for frustum culling
+    glm::vec3 boundsMax;
+    int seed = 0;
+};
+
+// Splits the terrain into square tiles. Every visible tile is one instanced draw
+// whose blades are generated entirely in grass.vert (position from the tile seed,
+// height from the terrain height texture, wind in the vertex shader). Blade count
+// per tile falls off with distance, so nothing per-blade lives on the CPU.
+class GrassRenderer {
+public:
+    GrassRenderer() = default;
+    ~GrassRenderer();
+
+    bool Init(const Terrain& terrain, float tileSize = 16.0f, uint32_t seed = 1337);
+    void Draw(const Shader& shader, const glm::mat4& view, const glm::mat4& proj,
+        const glm::vec3& camPos, float time);
+
+    // density / LOD controls
+    int maxBladesPerTile = 6144;   // at and inside nearDistance
+    float nearDistance = 24.0f;
+    float farDistance = 140.0f;    // tiles beyond this are skipped
+    float maxBladeHeight = 1.0f;   // for tile bounds
+    glm::vec2 windDir = glm::vec2(0.8f, 0.6f);
+    float windStrength = 0.35f;
+
+    size_t LastBladeCount() const { return lastBlades; }
+    size_t LastTileCount() const { return lastTiles; }
+
+private:
+    void CacheLocations(const Shader& shader);
+
+    const Terrain* terrain = nullptr;
+    std::vector<GrassTile> tiles;
+    float tileSize = 16.0f;
+    GLuint emptyVAO = 0;          // core profile needs a VAO even without attributes
+
+    // per-tile uniforms are set hundreds of times a frame, so resolve them once per shader
+    const Shader* cachedShader = nullptr;
+    GLuint cachedProgram = 0;
+    UniformHandle<glm::vec2> uTileOrigin;
+    UniformHandle<int> uTileSeed;
+    UniformHandle<float> uBladeCount, uWidthScale;
+
+    size_t lastBlades = 0, lastTiles = 0;
+};
@@ -0,0 +1,609 @@
+// ImageKernels.cpp
+#include "ImageKernels.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#define IMAGE_KERNELS_X86 1
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define AVX2_FN                 // MSVC compiles AVX2 intrinsics anywhere
+#else
+#define AVX2_FN __attribute__((target("avx2")))
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define IMAGE_KERNELS_NEON 1
+#endif
+
+namespace {
+
+const double kPi = 3.14159265358979323846;
+const double kKaiserWidth = 3.0;    // destination pixels each side
+const double kKaiserAlpha = 4.0;
+
+struct Kernels {
+    void (*u8ToFloat)(const uint8_t*, float*, size_t, float);
+    void (*u16ToFloat)(const uint16_t*, float*, size_t, float);
+    void (*floatToU8)(const float*, uint8_t*, size_t, float);
+    void (*floatToU16)(const float*, uint16_t*, size_t, float);
+    void (*expandRgb)(const uint8_t*, uint8_t*, size_t, uint8_t);
+    void (*premultiply)(uint8_t*, size_t);
+    void (*addScaled)(float*, const float*, size_t, float);    // dst += src * w
+};
+
+// ---------- scalar: the reference every other version matches ----------
+
+void U8ToFloatScalar(const uint8_t* src, float* dst, size_t n, float scale) {
+    for (size_t i = 0; i < n; ++i) dst[i] = (float)src[i] * scale;
+}
+
+void U16ToFloatScalar(const uint16_t* src, float* dst, size_t n, float scale) {
+    for (size_t i = 0; i < n; ++i) dst[i] = (float)src[i] * scale;
+}
+
+// max(0, v) first: NaN becomes 0, as _mm_max_ps / vmaxnmq_f32 make it
+inline float Clamp(float v, float hi) { return std::min(std::max(0.0f, v), hi); }
+
+void FloatToU8Scalar(const float* src, uint8_t* dst, size_t n, float scale) {
+    for (size_t i = 0; i < n; ++i) dst[i] = (uint8_t)std::nearbyint(Clamp(src[i] * scale, 255.0f));
+}
+
+void FloatToU16Scalar(const float* src, uint16_t* dst, size_t n, float scale) {
+    for (size_t i = 0; i < n; ++i) dst[i] = (uint16_t)std::nearbyint(Clamp(src[i] * scale, 65535.0f));
+}
+
+void ExpandRgbScalar(const uint8_t* rgb, uint8_t* rgba, size_t n, uint8_t alpha) {
+    for (size_t i = 0; i < n; ++i, rgb += 3, rgba += 4) {
+        rgba[0] = rgb[0];
+        rgba[1] = rgb[1];
+        rgba[2] = rgb[2];
+        rgba[3] = alpha;
+    }
+}
+
+// round(c * a / 255) without a divide
+inline uint8_t MulDiv255(unsigned c, unsigned a) {
+    unsigned t = c * a + 128;
+    return (uint8_t)((t + (t >> 8)) >> 8);
+}
+
+void PremultiplyScalar(uint8_t* p, size_t n) {
+    for (size_t i = 0; i < n; ++i, p += 4) {
+        p[0] = MulDiv255(p[0], p[3]);
+        p[1] = MulDiv255(p[1], p[3]);
+        p[2] = MulDiv255(p[2], p[3]);
+    }
+}
+
+void AddScaledScalar(float* dst, const float* src, size_t n, float w) {
+    for (size_t i = 0; i < n; ++i) dst[i] += src[i] * w;
+}
+
+const Kernels kScalar = { U8ToFloatScalar, U16ToFloatScalar, FloatToU8Scalar, FloatToU16Scalar, ExpandRgbScalar,
+    PremultiplyScalar, AddScaledScalar };
+
+#ifdef IMAGE_KERNELS_X86
+// ---------- SSE2 ----------
+
+void U8ToFloatSse2(const uint8_t* src, float* dst, size_t n, float scale) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 k = _mm_set1_ps(scale);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i lo = _mm_unpacklo_epi8(v, zero), hi = _mm_unpackhi_epi8(v, zero);
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), k));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), k));
+        _mm_storeu_ps(dst + i + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), k));
+        _mm_storeu_ps(dst + i + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), k));
+    }
+    U8ToFloatScalar(src + i, dst + i, n - i, scale);
+}
+
+void U16ToFloatSse2(const uint16_t* src, float* dst, size_t n, float scale) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 k = _mm_set1_ps(scale);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero)), k));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(v, zero)), k));
+    }
+    U16ToFloatScalar(src + i, dst + i, n - i, scale);
+}
+
+// clamped and rounded (cvtps rounds to nearest even, as nearbyint does)
+inline __m128i ToIntSse2(const float* src, __m128 k, __m128 hi) {
+    return _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src), k), _mm_setzero_ps()), hi));
+}
+
+void FloatToU8Sse2(const float* src, uint8_t* dst, size_t n, float scale) {
+    const __m128 k = _mm_set1_ps(scale), hi = _mm_set1_ps(255.0f);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i a = _mm_packs_epi32(ToIntSse2(src + i, k, hi), ToIntSse2(src + i + 4, k, hi));
+        __m128i b = _mm_packs_epi32(ToIntSse2(src + i + 8, k, hi), ToIntSse2(src + i + 12, k, hi));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(a, b));
+    }
+    FloatToU8Scalar(src + i, dst + i, n - i, scale);
+}
+
+void FloatToU16Sse2(const float* src, uint16_t* dst, size_t n, float scale) {
+    // SSE2 only packs signed: shift into int16 range, pack, flip the top bit back
+    const __m128 k = _mm_set1_ps(scale), hi = _mm_set1_ps(65535.0f);
+    const __m128i bias = _mm_set1_epi32(32768), flip = _mm_set1_epi16(-32768);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i a = _mm_sub_epi32(ToIntSse2(src + i, k, hi), bias);
+        __m128i b = _mm_sub_epi32(ToIntSse2(src + i + 4, k, hi), bias);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_xor_si128(_mm_packs_epi32(a, b), flip));
+    }
+    FloatToU16Scalar(src + i, dst + i, n - i, scale);
+}
+
+// two RGBA pixels widened to 16 bits: colour * alpha / 255, alpha kept (times 255 / 255)
+inline __m128i Premultiply2Sse2(__m128i px) {
+    const __m128i alphaLanes = _mm_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1);
+    __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(px, 0xFF), 0xFF);
+    a = _mm_or_si128(_mm_andnot_si128(alphaLanes, a), _mm_and_si128(alphaLanes, _mm_set1_epi16(255)));
+    __m128i t = _mm_add_epi16(_mm_mullo_epi16(px, a), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+void PremultiplySse2(uint8_t* p, size_t n) {
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + i * 4));
+        __m128i lo = Premultiply2Sse2(_mm_unpacklo_epi8(v, zero)), hi = Premultiply2Sse2(_mm_unpackhi_epi8(v, zero));
+        _mm_storeu_si128((__m128i*)(p + i * 4), _mm_packus_epi16(lo, hi));
+    }
+    PremultiplyScalar(p + i * 4, n - i);
+}
+
+void AddScaledSse2(float* dst, const float* src, size_t n, float w) {
+    const __m128 k = _mm_set1_ps(w);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(_mm_loadu_ps(src + i), k)));
+        _mm_storeu_ps(dst + i + 4, _mm_add_ps(_mm_loadu_ps(dst + i + 4), _mm_mul_ps(_mm_loadu_ps(src + i + 4), k)));
+    }
+    AddScaledScalar(dst + i, src + i, n - i, w);
+}
+
+// SSE2 has no byte shuffle for RGB -> RGBA: scalar until AVX2
+const Kernels kSse2 = { U8ToFloatSse2, U16ToFloatSse2, FloatToU8Sse2, FloatToU16Sse2, ExpandRgbScalar,
+    PremultiplySse2, AddScaledSse2 };
+
+// ---------- AVX2 (run-time dispatched) ----------
+// Each ends with _mm256_zeroupper before its scalar tail: compilers drop the implicit
+// one on tail calls, and dirty upper halves slow down all SSE code that follows.
+
+AVX2_FN void U8ToFloatAvx2(const uint8_t* src, float* dst, size_t n, float scale) {
+    const __m256 k = _mm256_set1_ps(scale);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i a = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(src + i)));
+        __m256i b = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(src + i + 8)));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(a), k));
+        _mm256_storeu_ps(dst + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(b), k));
+    }
+    _mm256_zeroupper();
+    U8ToFloatScalar(src + i, dst + i, n - i, scale);
+}
+
+AVX2_FN void U16ToFloatAvx2(const uint16_t* src, float* dst, size_t n, float scale) {
+    const __m256 k = _mm256_set1_ps(scale);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i a = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(src + i)));
+        __m256i b = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(src + i + 8)));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(a), k));
+        _mm256_storeu_ps(dst + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(b), k));
+    }
+    _mm256_zeroupper();
+    U16ToFloatScalar(src + i, dst + i, n - i, scale);
+}
+
+AVX2_FN inline __m256i ToIntAvx2(const float* src, __m256 k, __m256 hi) {
+    return _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(src), k),
+        _mm256_setzero_ps()), hi));
+}
+
+AVX2_FN void FloatToU8Avx2(const float* src, uint8_t* dst, size_t n, float scale) {
+    const __m256 k = _mm256_set1_ps(scale), hi = _mm256_set1_ps(255.0f);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        // packs work within 128-bit lanes; the permute puts the 16 bytes back in order
+        __m256i w = _mm256_packs_epi32(ToIntAvx2(src + i, k, hi), ToIntAvx2(src + i + 8, k, hi));
+        w = _mm256_permute4x64_epi64(w, 0xD8);
+        __m128i b = _mm_packus_epi16(_mm256_castsi256_si128(w), _mm256_extracti128_si256(w, 1));
+        _mm_storeu_si128((__m128i*)(dst + i), b);
+    }
+    _mm256_zeroupper();
+    FloatToU8Scalar(src + i, dst + i, n - i, scale);
+}
+
+AVX2_FN void FloatToU16Avx2(const float* src, uint16_t* dst, size_t n, float scale) {
+    const __m256 k = _mm256_set1_ps(scale), hi = _mm256_set1_ps(65535.0f);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i w = _mm256_packus_epi32(ToIntAvx2(src + i, k, hi), ToIntAvx2(src + i + 8, k, hi));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_permute4x64_epi64(w, 0xD8));
+    }
+    _mm256_zeroupper();
+    FloatToU16Scalar(src + i, dst + i, n - i, scale);
+}
+
+AVX2_FN void ExpandRgbAvx2(const uint8_t* rgb, uint8_t* rgba, size_t n, uint8_t alpha) {
+    // per 128-bit lane: 12 bytes of RGB in, 4 RGBA pixels out
+    const __m256i shuffle = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+        0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m256i a = _mm256_set1_epi32((int)((uint32_t)alpha << 24));
+    size_t i = 0;
+    for (; i + 10 <= n; i += 8) { // the 16-byte loads read 4 bytes past the 8 pixels
+        __m128i lo = _mm_loadu_si128((const __m128i*)(rgb + i * 3));
+        __m128i hi = _mm_loadu_si128((const __m128i*)(rgb + i * 3 + 12));
+        __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        _mm256_storeu_si256((__m256i*)(rgba + i * 4), _mm256_or_si256(_mm256_shuffle_epi8(v, shuffle), a));
+    }
+    _mm256_zeroupper();
+    ExpandRgbScalar(rgb + i * 3, rgba + i * 4, n - i, alpha);
+}
+
+AVX2_FN inline __m256i Premultiply4Avx2(__m256i px) {
+    const __m256i alphaLanes = _mm256_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1);
+    __m256i a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(px, 0xFF), 0xFF);
+    a = _mm256_or_si256(_mm256_andnot_si256(alphaLanes, a), _mm256_and_si256(alphaLanes, _mm256_set1_epi16(255)));
+    __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(px, a), _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+AVX2_FN void PremultiplyAvx2(uint8_t* p, size_t n) {
+    const __m256i zero = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        // unpack and pack both stay within lanes, so the pixels come back in place
+        __m256i v = _mm256_loadu_si256((const __m256i*)(p + i * 4));
+        __m256i lo = Premultiply4Avx2(_mm256_unpacklo_epi8(v, zero));
+        __m256i hi = Premultiply4Avx2(_mm256_unpackhi_epi8(v, zero));
+        _mm256_storeu_si256((__m256i*)(p + i * 4), _mm256_packus_epi16(lo, hi));
+    }
+    _mm256_zeroupper();
+    PremultiplyScalar(p + i * 4, n - i);
+}
+
+AVX2_FN void AddScaledAvx2(float* dst, const float* src, size_t n, float w) {
+    const __m256 k = _mm256_set1_ps(w);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), _mm256_mul_ps(_mm256_loadu_ps(src + i), k)));
+        _mm256_storeu_ps(dst + i + 8,
+            _mm256_add_ps(_mm256_loadu_ps(dst + i + 8), _mm256_mul_ps(_mm256_loadu_ps(src + i + 8), k)));
+    }
+    _mm256_zeroupper();
+    AddScaledScalar(dst + i, src + i, n - i, w);
+}
+
+const Kernels kAvx2 = { U8ToFloatAvx2, U16ToFloatAvx2, FloatToU8Avx2, FloatToU16Avx2, ExpandRgbAvx2,
+    PremultiplyAvx2, AddScaledAvx2 };
+
+bool CpuHasAvx2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int r[4];
+    __cpuid(r, 0);
+    if (r[0] < 7) return false;
+    __cpuid(r, 1);
+    const bool osSavesYmm = (r[2] & (1 << 27)) && (r[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+    __cpuidex(r, 7, 0);
+    return osSavesYmm && (r[1] & (1 << 5));
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif // IMAGE_KERNELS_X86
+
+#ifdef IMAGE_KERNELS_NEON
+// ---------- NEON ----------
+
+void U8ToFloatNeon(const uint8_t* src, float* dst, size_t n, float scale) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint8x16_t v = vld1q_u8(src + i);
+        uint16x8_t lo = vmovl_u8(vget_low_u8(v)), hi = vmovl_u8(vget_high_u8(v));
+        vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(lo))), scale));
+        vst1q_f32(dst + i + 4, vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(lo))), scale));
+        vst1q_f32(dst + i + 8, vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(hi))), scale));
+        vst1q_f32(dst + i + 12, vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(hi))), scale));
+    }
+    U8ToFloatScalar(src + i, dst + i, n - i, scale);
+}
+
+void U16ToFloatNeon(const uint16_t* src, float* dst, size_t n, float scale) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint16x8_t v = vld1q_u16(src + i);
+        vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(v))), scale));
+        vst1q_f32(dst + i + 4, vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(v))), scale));
+    }
+    U16ToFloatScalar(src + i, dst + i, n - i, scale);
+}
+
+// clamped (vmaxnm turns NaN into 0) and rounded to nearest even
+inline uint32x4_t ToUintNeon(const float* src, float scale, float hi) {
+    float32x4_t v = vminq_f32(vmaxnmq_f32(vmulq_n_f32(vld1q_f32(src), scale), vdupq_n_f32(0.0f)), vdupq_n_f32(hi));
+    return vcvtnq_u32_f32(v);
+}
+
+void FloatToU8Neon(const float* src, uint8_t* dst, size_t n, float scale) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint16x8_t w = vcombine_u16(vmovn_u32(ToUintNeon(src + i, scale, 255.0f)),
+            vmovn_u32(ToUintNeon(src + i + 4, scale, 255.0f)));
+        vst1_u8(dst + i, vmovn_u16(w));
+    }
+    FloatToU8Scalar(src + i, dst + i, n - i, scale);
+}
+
+void FloatToU16Neon(const float* src, uint16_t* dst, size_t n, float scale) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        vst1q_u16(dst + i, vcombine_u16(vmovn_u32(ToUintNeon(src + i, scale, 65535.0f)),
+            vmovn_u32(ToUintNeon(src + i + 4, scale, 65535.0f))));
+    }
+    FloatToU16Scalar(src + i, dst + i, n - i, scale);
+}
+
+void ExpandRgbNeon(const uint8_t* rgb, uint8_t* rgba, size_t n, uint8_t alpha) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint8x16x3_t v = vld3q_u8(rgb + i * 3);
+        uint8x16x4_t o = { { v.val[0], v.val[1], v.val[2], vdupq_n_u8(alpha) } };
+        vst4q_u8(rgba + i * 4, o);
+    }
+    ExpandRgbScalar(rgb + i * 3, rgba + i * 4, n - i, alpha);
+}
+
+// (t + ((t + 128) >> 8) + 128) >> 8: the same rounding as MulDiv255
+inline uint8x16_t MulDiv255Neon(uint8x16_t c, uint8x16_t a) {
+    uint16x8_t lo = vmull_u8(vget_low_u8(c), vget_low_u8(a)), hi = vmull_u8(vget_high_u8(c), vget_high_u8(a));
+    return vcombine_u8(vraddhn_u16(lo, vrshrq_n_u16(lo, 8)), vraddhn_u16(hi, vrshrq_n_u16(hi, 8)));
+}
+
+void PremultiplyNeon(uint8_t* p, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint8x16x4_t v = vld4q_u8(p + i * 4);
+        v.val[0] = MulDiv255Neon(v.val[0], v.val[3]);
+        v.val[1] = MulDiv255Neon(v.val[1], v.val[3]);
+        v.val[2] = MulDiv255Neon(v.val[2], v.val[3]);
+        vst4q_u8(p + i * 4, v);
+    }
+    PremultiplyScalar(p + i * 4, n - i);
+}
+
+void AddScaledNeon(float* dst, const float* src, size_t n, float w) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        // multiply, then add: a fused vfma would round differently from the scalar version
+        vst1q_f32(dst + i, vaddq_f32(vld1q_f32(dst + i), vmulq_n_f32(vld1q_f32(src + i), w)));
+        vst1q_f32(dst + i + 4, vaddq_f32(vld1q_f32(dst + i + 4), vmulq_n_f32(vld1q_f32(src + i + 4), w)));
+    }
+    AddScaledScalar(dst + i, src + i, n - i, w);
+}
+
+const Kernels kNeon = { U8ToFloatNeon, U16ToFloatNeon, FloatToU8Neon, FloatToU16Neon, ExpandRgbNeon,
+    PremultiplyNeon, AddScaledNeon };
+#endif // IMAGE_KERNELS_NEON
+
+const Kernels* KernelsFor(SimdLevel level) {
+    switch (level) {
+#ifdef IMAGE_KERNELS_X86
+    case SimdLevel::SSE2: return &kSse2;
+    case SimdLevel::AVX2: return &kAvx2;
+#endif
+#ifdef IMAGE_KERNELS_NEON
+    case SimdLevel::NEON: return &kNeon;
+#endif
+    default: return &kScalar;
+    }
+}
+
+std::atomic<int> activeLevel{ -1 };   // -1: DetectSimdLevel on first use
+
+const Kernels& Active() {
+    int level = activeLevel.load(std::memory_order_relaxed);
+    if (level < 0) {
+        level = (int)DetectSimdLevel();
+        activeLevel.store(level, std::memory_order_relaxed);
+    }
+    return *KernelsFor((SimdLevel)level);
+}
+
+// ---------- sRGB ----------
+
+double DecodeSrgb(double c) { return c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4); }
+double EncodeSrgb(double v) { return v <= 0.0031308 ? v * 12.92 : 1.055 * std::pow(v, 1.0 / 2.4) - 0.055; }
+
+const size_t kSrgbEncodeSteps = 65536; // linear values step 1/65535: well under half an 8-bit code near black
+
+struct SrgbTables {
+    float decode[256];
+    uint8_t encode[kSrgbEncodeSteps];
+    SrgbTables() {
+        for (int i = 0; i < 256; ++i) decode[i] = (float)DecodeSrgb(i / 255.0);
+        for (size_t i = 0; i < kSrgbEncodeSteps; ++i)
+            encode[i] = (uint8_t)std::lround(EncodeSrgb((double)i / (kSrgbEncodeSteps - 1)) * 255.0);
+    }
+};
+
+const SrgbTables& Srgb() {
+    static const SrgbTables tables;
+    return tables;
+}
+
+// ---------- downsampling ----------
+
+// destination d reads the source at index[first[d] .. first[d + 1]) with the same weights
+struct Taps {
+    std::vector<int> first, index;
+    std::vector<float> weight;
+};
+
+double BesselI0(double x) {
+    double sum = 1.0, term = 1.0, q = x * x / 4.0;
+    for (int k = 1; term > sum * 1e-12; ++k) {
+        term *= q / ((double)k * k);
+        sum += term;
+    }
+    return sum;
+}
+
+double KaiserSinc(double t) {
+    if (std::fabs(t) >= kKaiserWidth) return 0.0;
+    double sinc = t == 0.0 ? 1.0 : std::sin(kPi * t) / (kPi * t);
+    double r = t / kKaiserWidth;
+    return sinc * BesselI0(kKaiserAlpha * std::sqrt(1.0 - r * r)) / BesselI0(kKaiserAlpha);
+}
+
+Taps MakeTaps(int src, int dst, MipFilter filter) {
+    Taps taps;
+    taps.first.push_back(0);
+    const double scale = (double)src / dst;
+    for (int d = 0; d < dst; ++d) {
+        if (filter == MipFilter::Box || src == dst) {
+            int s0 = std::min(d * 2, src - 1);
+            int s1 = src == dst ? s0 : (src & 1) && d == dst - 1 ? src - 1 : s0 + 1;
+            for (int s = s0; s <= s1; ++s) {
+                taps.index.push_back(s);
+                taps.weight.push_back(1.0f / (s1 - s0 + 1));
+            }
+        }
+        else {
+            // source pixel centres within kKaiserWidth destination pixels; edges clamp
+            const double c = (d + 0.5) * scale - 0.5, reach = kKaiserWidth * scale;
+            double sum = 0.0;
+            std::vector<double> w;
+            for (int s = (int)std::ceil(c - reach); s <= (int)std::floor(c + reach); ++s) {
+                double k = KaiserSinc((s - c) / scale);
+                if (k == 0.0) continue;
+                taps.index.push_back(std::min(std::max(s, 0), src - 1));
+                w.push_back(k);
+                sum += k;
+            }
+            for (double k : w) taps.weight.push_back((float)(k / sum));
+        }
+        taps.first.push_back((int)taps.index.size());
+    }
+    return taps;
+}
+
+void DecodeRow(const unsigned char* src, float* dst, int width, int channels, bool srgb, const Kernels& k) {
+    const size_t n = (size_t)width * channels;
+    k.u8ToFloat(src, dst, n, 1.0f / 255.0f); // alpha and data channels
+    if (!srgb) return;
+    const float* decode = Srgb().decode;
+    for (size_t i = 0; i < n; i += channels) {
+        dst[i] = decode[src[i]];
+        dst[i + 1] = decode[src[i + 1]];
+        dst[i + 2] = decode[src[i + 2]];
+    }
+}
+
+void EncodeRow(const float* src, unsigned char* dst, int width, int channels, bool srgb, const Kernels& k) {
+    const size_t n = (size_t)width * channels;
+    k.floatToU8(src, dst, n, 255.0f);
+    if (!srgb) return;
+    for (size_t i = 0; i < n; i += channels) {
+        dst[i] = LinearToSrgb(src[i]);
+        dst[i + 1] = LinearToSrgb(src[i + 1]);
+        dst[i + 2] = LinearToSrgb(src[i + 2]);
+    }
+}
+
+} // namespace
+
+SimdLevel DetectSimdLevel() {
+#if defined(IMAGE_KERNELS_X86)
+    return CpuHasAvx2() ? SimdLevel::AVX2 : SimdLevel::SSE2;
+#elif defined(IMAGE_KERNELS_NEON)
+    return SimdLevel::NEON;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+SimdLevel ActiveSimdLevel() {
+    Active();
+    return (SimdLevel)activeLevel.load(std::memory_order_relaxed);
+}
+
+void SetSimdLevel(SimdLevel level) {
+    SimdLevel best = DetectSimdLevel();
+    bool runs = level == SimdLevel::Scalar || level == best || (level == SimdLevel::SSE2 && best == SimdLevel::AVX2);
+    activeLevel.store((int)(runs ? level : best), std::memory_order_relaxed);
+}
+
+const char* SimdLevelName(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::SSE2: return "SSE2";
+    case SimdLevel::AVX2: return "AVX2";
+    case SimdLevel::NEON: return "NEON";
+    default: return "scalar";
+    }
+}
+
+void U8ToFloat(const uint8_t* src, float* dst, size_t count, float scale) { Active().u8ToFloat(src, dst, count, scale); }
+void U16ToFloat(const uint16_t* src, float* dst, size_t count, float scale) { Active().u16ToFloat(src, dst, count, scale); }
+void FloatToU8(const float* src, uint8_t* dst, size_t count, float scale) { Active().floatToU8(src, dst, count, scale); }
+void FloatToU16(const float* src, uint16_t* dst, size_t count, float scale) { Active().floatToU16(src, dst, count, scale); }
+
+void ExpandRgbToRgba(const uint8_t* rgb, uint8_t* rgba, size_t pixels, uint8_t alpha) {
+    Active().expandRgb(rgb, rgba, pixels, alpha);
+}
+
+void PremultiplyAlpha(uint8_t* rgba, size_t pixels) {
+    Active().premultiply(rgba, pixels);
+}
+
+float SrgbToLinear(uint8_t v) {
+    return Srgb().decode[v];
+}
+
+uint8_t LinearToSrgb(float v) {
+    return Srgb().encode[(size_t)std::nearbyint(Clamp(v, 1.0f) * (kSrgbEncodeSteps - 1))];
+}
+
+void DownsampleImage(const unsigned char* pixels, int width, int height, int channels, MipFilter filter, bool srgb,
+    std::vector<unsigned char>& out)
+{
+    const int w = std::max(1, width / 2), h = std::max(1, height / 2);
+    out.resize((size_t)w * h * channels);
+    srgb = srgb && channels >= 3;
+    const Taps rows = MakeTaps(height, h, filter), cols = MakeTaps(width, w, filter);
+    const Kernels& k = Active();
+    Srgb(); // built once, before the workers want it
+    const size_t srcRow = (size_t)width * channels, dstRow = (size_t)w * channels;
+    ParallelFor((size_t)h, [&](size_t y) {
+        // vertical taps over whole rows (the SIMD part), then horizontal per pixel
+        std::vector<float> decoded(srcRow), sum(srcRow, 0.0f), row(dstRow);
+        for (int t = rows.first[y]; t < rows.first[y + 1]; ++t) {
+            DecodeRow(pixels + rows.index[t] * srcRow, decoded.data(), width, channels, srgb, k);
+            k.addScaled(sum.data(), decoded.data(), srcRow, rows.weight[t]);
+        }
+        for (int x = 0; x < w; ++x) {
+            float v[4] = {};
+            for (int t = cols.first[x]; t < cols.first[x + 1]; ++t) {
+                const float* px = &sum[(size_t)cols.index[t] * channels];
+                for (int c = 0; c < channels; ++c) v[c] += cols.weight[t] * px[c];
+            }
+            std::copy(v, v + channels, &row[(size_t)x * channels]);
+        }
+        EncodeRow(row.data(), out.data() + y * dstRow, w, channels, srgb, k);
+    });
+}
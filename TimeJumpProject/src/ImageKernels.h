@@ -0,0 +1,47 @@
+#pragma once
+
+// ImageKernels.h - per-pixel conversions for the load path (byte/u16 <-> float,
+// RGB -> RGBA, alpha premultiplication) and the mip downsampler behind the texture
+// cache. Each kernel has a scalar version and SSE2 (x86) / NEON (ARM64) versions
+// picked at compile time; on x86 the AVX2 versions take over at run time when the
+// CPU has it. The integer results match the scalar version's bit for bit.
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class SimdLevel { Scalar, SSE2, AVX2, NEON };
+
+// the best level this build and CPU run
+SimdLevel DetectSimdLevel();
+SimdLevel ActiveSimdLevel();
+// caps the level the kernels use (benchmarks, checking one level against another);
+// clamped to DetectSimdLevel. Not while kernels run on other threads.
+void SetSimdLevel(SimdLevel level);
+const char* SimdLevelName(SimdLevel level);
+
+// dst[i] = src[i] * scale
+void U8ToFloat(const uint8_t* src, float* dst, size_t count, float scale);
+void U16ToFloat(const uint16_t* src, float* dst, size_t count, float scale);
+// dst[i] = src[i] * scale, clamped to the type's range and rounded to nearest (ties to even)
+void FloatToU8(const float* src, uint8_t* dst, size_t count, float scale);
+void FloatToU16(const float* src, uint16_t* dst, size_t count, float scale);
+
+// 3 bytes per pixel -> 4, with the given alpha; rgb and rgba must not overlap
+void ExpandRgbToRgba(const uint8_t* rgb, uint8_t* rgba, size_t pixels, uint8_t alpha = 255);
+// RGBA in place: colour = round(colour * alpha / 255)
+void PremultiplyAlpha(uint8_t* rgba, size_t pixels);
+
+// 8-bit sRGB <-> linear [0, 1]
+float SrgbToLinear(uint8_t v);
+uint8_t LinearToSrgb(float v);
+
+enum class MipFilter {
+    Box,        // 2x2 average (the odd last row/column folds into its neighbour)
+    Kaiser,     // Kaiser-windowed sinc over 3 destination pixels each side: sharper mips
+};
+
+// Next mip level, at least 1x1. With srgb the colour channels (the first three of
+// 3 or 4) are filtered in linear light and the alpha channel as is; without, every
+// channel is filtered as stored (data: heights, masks). Rows spread over worker threads.
+void DownsampleImage(const unsigned char* pixels, int width, int height, int channels, MipFilter filter, bool srgb,
+    std::vector<unsigned char>& out);
@@ -0,0 +1,126 @@
+// Lz4.cpp
+#include "Lz4.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+const size_t kMinMatch = 4;
+const size_t kLastLiterals = 5;     // a block ends in at least this many literals
+const size_t kMatchStartLimit = 12; // and no match starts closer to its end
+const size_t kMaxOffset = 65535;
+const int kHashBits = 16;
+
+uint32_t Read32(const unsigned char* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+uint32_t Hash(uint32_t v) { return (v * 2654435761u) >> (32 - kHashBits); }
+
+void PutLength(size_t rest, unsigned char*& op) {
+    for (; rest >= 255; rest -= 255) *op++ = 255;
+    *op++ = (unsigned char)rest;
+}
+
+// One sequence: literals, then a match of matchLength bytes at offset back, or no
+// match at all (matchLength 0) for the last sequence
+bool EmitSequence(const unsigned char* literals, size_t literalLength, size_t offset, size_t matchLength,
+    unsigned char*& op, const unsigned char* end)
+{
+    size_t need = 1 + literalLength / 255 + 1 + literalLength + (matchLength ? 2 + matchLength / 255 + 1 : 0);
+    if ((size_t)(end - op) < need) return false;
+    unsigned char* token = op++;
+    *token = (unsigned char)(std::min<size_t>(literalLength, 15) << 4);
+    if (literalLength >= 15) PutLength(literalLength - 15, op);
+    if (literalLength) std::memcpy(op, literals, literalLength);
+    op += literalLength;
+    if (matchLength == 0) return true;
+
+    *op++ = (unsigned char)(offset & 0xff);
+    *op++ = (unsigned char)(offset >> 8);
+    size_t code = matchLength - kMinMatch;
+    *token |= (unsigned char)std::min<size_t>(code, 15);
+    if (code >= 15) PutLength(code - 15, op);
+    return true;
+}
+
+// the 4-bit length plus its 255-continued extension bytes
+bool GetLength(size_t& length, const unsigned char* src, size_t size, size_t& ip) {
+    if (length != 15) return true;
+    unsigned char b;
+    do {
+        if (ip >= size) return false;
+        b = src[ip++];
+        length += b;
+    } while (b == 255);
+    return true;
+}
+
+} // namespace
+
+size_t Lz4Compress(const unsigned char* src, size_t size, unsigned char* dst, size_t capacity) {
+    unsigned char* op = dst;
+    const unsigned char* end = dst + capacity;
+    size_t anchor = 0; // first byte not yet emitted
+    if (size > kMatchStartLimit) {
+        std::vector<uint32_t> table(size_t(1) << kHashBits, 0); // last position + 1 per hash, 0 = none
+        const size_t matchStartEnd = size - kMatchStartLimit;
+        const size_t matchEnd = size - kLastLiterals;
+        size_t ip = 0, misses = 0;
+        while (ip < matchStartEnd) {
+            uint32_t seq = Read32(src + ip);
+            uint32_t& slot = table[Hash(seq)];
+            size_t ref = slot;
+            slot = (uint32_t)ip + 1;
+            if (ref == 0 || ip - (ref - 1) > kMaxOffset || Read32(src + ref - 1) != seq) {
+                ip += 1 + (misses++ >> 6); // stride up through data that does not compress
+                continue;
+            }
+            ref -= 1;
+            misses = 0;
+            while (ip > anchor && ref > 0 && src[ip - 1] == src[ref - 1]) {
+                --ip;
+                --ref;
+            }
+            size_t length = kMinMatch;
+            while (ip + length < matchEnd && src[ip + length] == src[ref + length]) ++length;
+            if (!EmitSequence(src + anchor, ip - anchor, ip - ref, length, op, end)) return 0;
+            ip += length;
+            anchor = ip;
+        }
+    }
+    if (!EmitSequence(src + anchor, size - anchor, 0, 0, op, end)) return 0;
+    return (size_t)(op - dst);
+}
+
+bool Lz4Decompress(const unsigned char* src, size_t size, unsigned char* dst, size_t dstSize) {
+    size_t ip = 0, op = 0;
+    for (;;) {
+        if (ip >= size) return false;
+        const unsigned char token = src[ip++];
+        size_t literals = token >> 4;
+        if (!GetLength(literals, src, size, ip)) return false;
+        if (literals > size - ip || literals > dstSize - op) return false;
+        if (literals) std::memcpy(dst + op, src + ip, literals);
+        ip += literals;
+        op += literals;
+        if (ip == size) return op == dstSize; // the last sequence has no match
+
+        if (size - ip < 2) return false;
+        const size_t offset = src[ip] | (size_t)src[ip + 1] << 8;
+        ip += 2;
+        size_t length = token & 15;
+        if (!GetLength(length, src, size, ip)) return false;
+        length += kMinMatch;
+        if (offset == 0 || offset > op || length > dstSize - op) return false;
+        const unsigned char* match = dst + op - offset;
+        if (offset >= length) std::memcpy(dst + op, match, length);
+        else for (size_t i = 0; i < length; ++i) dst[op + i] = match[i]; // overlapping: repeats the last offset bytes
+        op += length;
+    }
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+// Lz4.h - LZ4 block format (no frame header): a greedy single-probe compressor and a
+// bounds-checked decompressor; the output reads with any LZ4 block decoder
+#include <cstddef>
+
+// worst case for Lz4Compress: incompressible input grows by a little over 1/255
+inline size_t Lz4CompressBound(size_t size) { return size + size / 255 + 16; }
+
+// Compresses size bytes into at most capacity bytes at dst; returns the compressed
+// size, 0 if it does not fit
+size_t Lz4Compress(const unsigned char* src, size_t size, unsigned char* dst, size_t capacity);
+
+// Decompresses one block that must expand to exactly dstSize bytes; false on
+// malformed input (never reads or writes out of bounds)
+bool Lz4Decompress(const unsigned char* src, size_t size, unsigned char* dst, size_t dstSize);
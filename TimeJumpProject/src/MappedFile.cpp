@@ -0,0 +1,124 @@
+// MappedFile.cpp
+#include "MappedFile.h"
+#include "AssetPack.h"
+#include "SharedCache.h"
+
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool MappedFile::Open(const std::string& path, bool quiet) {
+    Close();
+    const AssetPackEntry* e = AssetPack::Lookup(path);
+    if (!e) return Map(path, quiet);
+    const AssetPack* pack = AssetPack::Mounted();
+    if (const unsigned char* stored = pack->Stored(*e)) {
+        data = stored;
+        size = (size_t)e->size;
+        opened = true;
+        return true;
+    }
+
+    // compressed: with the shared cache on, decompressed once per host and mapped
+    // by every instance from there
+    const bool share = SharedCacheEnabled() && e->size >= kSharedCacheMinBytes;
+    uint64_t key = 0;
+    if (share) {
+        key = SharedKey(SharedKey(SharedKey(SharedKey(kSharedKeySeed, 'P'), e->nameHash), e->sourceMTime), e->size);
+        if (OpenSharedEntry(key, *this) && size == e->size) return true;
+        Close();
+    }
+    unpacked.resize((size_t)e->size);
+    if (!pack->Decompress(*e, unpacked.data())) {
+        Close();
+        return false;
+    }
+    if (share && WriteSharedEntry(key, { { unpacked.data(), unpacked.size() } })) {
+        // map the entry just written too, so this instance holds no copy of its own
+        std::vector<unsigned char> own;
+        own.swap(unpacked);
+        if (OpenSharedEntry(key, *this) && size == own.size()) return true;
+        Close();
+        own.swap(unpacked);
+    }
+    data = unpacked.data();
+    size = unpacked.size();
+    opened = true;
+    return true;
+}
+
+bool MappedFile::Map(const std::string& path, bool quiet) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        if (!quiet) std::cerr << "MappedFile: cannot open " << path << "\n";
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(file, &fileSize);
+    fileHandle = file;
+    size = (size_t)fileSize.QuadPart;
+    opened = true;
+    if (size == 0) return true; // empty files cannot be mapped
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!view) {
+        if (!quiet) std::cerr << "MappedFile: cannot map " << path << "\n";
+        if (mapping) CloseHandle(mapping);
+        Close();
+        return false;
+    }
+    mappingHandle = mapping;
+    data = (const unsigned char*)view;
+#else
+    fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        if (!quiet) std::cerr << "MappedFile: cannot open " << path << "\n";
+        return false;
+    }
+    struct stat st;
+    fstat(fd, &st);
+    size = (size_t)st.st_size;
+    opened = true;
+    if (size == 0) return true;
+    void* view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (view == MAP_FAILED) {
+        if (!quiet) std::cerr << "MappedFile: cannot map " << path << "\n";
+        Close();
+        return false;
+    }
+    data = (const unsigned char*)view;
+#endif
+    return true;
+}
+
+void MappedFile::Close() {
+#ifdef _WIN32
+    if (mappingHandle) {
+        UnmapViewOfFile(data);
+        CloseHandle((HANDLE)mappingHandle);
+    }
+    if (fileHandle) CloseHandle((HANDLE)fileHandle);
+    mappingHandle = fileHandle = nullptr;
+#else
+    if (fd >= 0) {
+        if (data) munmap((void*)data, size);
+        close(fd);
+    }
+    fd = -1;
+#endif
+    std::vector<unsigned char>().swap(unpacked);
+    data = nullptr;
+    size = 0;
+    opened = false;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+// MappedFile.h - read-only memory-mapped file (Win32 file mapping / POSIX mmap), or
+// the same bytes out of the mounted AssetPack when it holds the path
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile() { Close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // maps the whole file: a view into the pack for stored entries, a decompressed
+    // copy for compressed ones (mapped from the SharedCache when it is on), else the
+    // loose file; false (and a message on
+    // std::cerr unless quiet) on failure
+    bool Open(const std::string& path, bool quiet = false);
+    void Close();
+
+    bool IsOpen() const { return opened; }
+    const unsigned char* Data() const { return data; }
+    size_t Size() const { return size; }
+
+private:
+    bool Map(const std::string& path, bool quiet);
+
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+    bool opened = false;
+    std::vector<unsigned char> unpacked;     // a compressed pack entry
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#else
+    int fd = -1;
+#endif
+};
@@ -0,0 +1,257 @@
+// MeshCache.cpp
+#include "MeshCache.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+// bump whenever ImportOBJ / the GLB decode / OptimizeMesh / BuildMeshLods / ClusterMesh /
+// QuantizeMesh output or the layout below changes
+static const uint32_t kMeshCacheVersion = 5;
+static const char kMeshCacheMagic[8] = { 'T', 'J', 'M', 'E', 'S', 'H', 'C', '\0' };
+
+struct MeshCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t vertexSize;        // ModelVertexLayout::stride when written
+    uint64_t sourceMTime;
+    uint64_t sourceSize;
+    uint64_t sourceHash;
+    uint64_t vertexCount, indexCount, submeshCount, materialCount;
+    uint64_t vertexOffset, indexOffset, submeshOffset, stringOffset;
+    uint64_t fileSize;
+    float boundsMin[3], boundsMax[3];
+    float posScale[3], posOffset[3];
+    float uvScale[2], uvOffset[2];
+    uint32_t lodCount;          // levels after full detail
+    float lodError[kMaxMeshLods];
+    uint64_t meshletCount, meshletVertexCount, meshletTriangleBytes;
+    uint64_t meshletOffset, meshletVertexOffset, meshletTriangleOffset;
+};
+
+// full detail first, then every LOD's ranges in order
+struct CachedSubMesh {
+    int32_t materialId;
+    uint32_t lod;
+    uint64_t indexOffset;
+    uint64_t indexCount;
+};
+
+static uint64_t Align16(uint64_t v) { return (v + 15) & ~(uint64_t)15; }
+
+std::string MeshCachePath(const std::string& sourcePath) {
+    return sourcePath + ".meshbin";
+}
+
+bool WriteMeshCache(const std::string& cachePath, const MeshData& data, const SourceInfo& source) {
+    namespace fs = std::filesystem;
+    fs::path folder = fs::path(cachePath).parent_path();
+
+    std::vector<char> strings;
+    auto pushString = [&](const std::string& s) {
+        uint32_t len = (uint32_t)s.size();
+        strings.insert(strings.end(), (const char*)&len, (const char*)&len + sizeof(len));
+        strings.insert(strings.end(), s.begin(), s.end());
+    };
+    for (const MaterialSource& m : data.materials) {
+        pushString(m.name);
+        std::string path = m.diffusePath;
+        if (!path.empty()) {
+            fs::path rel = fs::path(path).lexically_relative(folder);
+            if (!rel.empty()) path = rel.generic_string();
+        }
+        pushString(path);
+    }
+
+    std::vector<CachedSubMesh> submeshes;
+    for (const SubMeshRange& r : data.submeshes)
+        submeshes.push_back(CachedSubMesh{ r.materialId, 0, (uint64_t)r.indexOffset, (uint64_t)r.indexCount });
+    for (size_t l = 0; l < data.lods.size(); ++l) {
+        for (const SubMeshRange& r : data.lods[l].submeshes)
+            submeshes.push_back(CachedSubMesh{ r.materialId, (uint32_t)l + 1, (uint64_t)r.indexOffset, (uint64_t)r.indexCount });
+    }
+
+    MeshCacheHeader h{};
+    std::memcpy(h.magic, kMeshCacheMagic, sizeof(h.magic));
+    h.version = kMeshCacheVersion;
+    h.vertexSize = (uint32_t)ModelVertexLayout::stride;
+    h.sourceMTime = source.mtime;
+    h.sourceSize = source.size;
+    h.sourceHash = source.hash;
+    h.vertexCount = data.packedVertices.size() / ModelVertexLayout::stride;
+    h.indexCount = data.indices.size();
+    h.submeshCount = submeshes.size();
+    h.materialCount = data.materials.size();
+    h.vertexOffset = Align16(sizeof(h));
+    h.indexOffset = Align16(h.vertexOffset + data.packedVertices.size());
+    h.submeshOffset = Align16(h.indexOffset + h.indexCount * sizeof(unsigned int));
+    const MeshletData& ml = data.meshlets;
+    h.meshletCount = ml.meshlets.size();
+    h.meshletVertexCount = ml.vertices.size();
+    h.meshletTriangleBytes = ml.triangles.size();
+    h.meshletOffset = Align16(h.submeshOffset + h.submeshCount * sizeof(CachedSubMesh));
+    h.meshletVertexOffset = Align16(h.meshletOffset + h.meshletCount * sizeof(Meshlet));
+    h.meshletTriangleOffset = Align16(h.meshletVertexOffset + h.meshletVertexCount * sizeof(unsigned int));
+    h.stringOffset = Align16(h.meshletTriangleOffset + h.meshletTriangleBytes);
+    h.fileSize = h.stringOffset + strings.size();
+    for (int i = 0; i < 3; ++i) {
+        h.boundsMin[i] = data.boundsMin[i];
+        h.boundsMax[i] = data.boundsMax[i];
+        h.posScale[i] = data.dequant.posScale[i];
+        h.posOffset[i] = data.dequant.posOffset[i];
+    }
+    for (int i = 0; i < 2; ++i) {
+        h.uvScale[i] = data.dequant.uvScale[i];
+        h.uvOffset[i] = data.dequant.uvOffset[i];
+    }
+    h.lodCount = (uint32_t)std::min<size_t>(data.lods.size(), kMaxMeshLods - 1);
+    for (uint32_t l = 0; l < h.lodCount; ++l) h.lodError[l] = data.lods[l].error;
+
+    return WriteCacheFile(cachePath, [&](std::ostream& f) {
+        auto writeAt = [&](uint64_t offset, const void* bytes, size_t size) {
+            static const char zeros[16] = {};
+            uint64_t pos = (uint64_t)f.tellp();
+            if (offset > pos) f.write(zeros, (std::streamsize)(offset - pos));
+            if (size) f.write((const char*)bytes, (std::streamsize)size);
+        };
+        writeAt(0, &h, sizeof(h));
+        writeAt(h.vertexOffset, data.packedVertices.data(), data.packedVertices.size());
+        writeAt(h.indexOffset, data.indices.data(), data.indices.size() * sizeof(unsigned int));
+        writeAt(h.submeshOffset, submeshes.data(), submeshes.size() * sizeof(CachedSubMesh));
+        writeAt(h.meshletOffset, ml.meshlets.data(), ml.meshlets.size() * sizeof(Meshlet));
+        writeAt(h.meshletVertexOffset, ml.vertices.data(), ml.vertices.size() * sizeof(unsigned int));
+        writeAt(h.meshletTriangleOffset, ml.triangles.data(), ml.triangles.size());
+        writeAt(h.stringOffset, strings.data(), strings.size());
+        return (bool)f;
+    }, "WriteMeshCache");
+}
+
+// header checks that do not need the source file
+static const MeshCacheHeader* ValidHeader(const MappedFile& file) {
+    if (file.Size() < sizeof(MeshCacheHeader)) return nullptr;
+    const MeshCacheHeader* h = (const MeshCacheHeader*)file.Data();
+    if (std::memcmp(h->magic, kMeshCacheMagic, sizeof(h->magic)) != 0) return nullptr;
+    if (h->version != kMeshCacheVersion || h->vertexSize != ModelVertexLayout::stride) return nullptr;
+    if (h->fileSize != file.Size()) return nullptr;
+    if (h->vertexOffset + h->vertexCount * ModelVertexLayout::stride > h->indexOffset ||
+        h->indexOffset + h->indexCount * sizeof(unsigned int) > h->submeshOffset ||
+        h->submeshOffset + h->submeshCount * sizeof(CachedSubMesh) > h->meshletOffset ||
+        h->meshletOffset + h->meshletCount * sizeof(Meshlet) > h->meshletVertexOffset ||
+        h->meshletVertexOffset + h->meshletVertexCount * sizeof(unsigned int) > h->meshletTriangleOffset ||
+        h->meshletTriangleOffset + h->meshletTriangleBytes > h->stringOffset ||
+        h->stringOffset > h->fileSize) return nullptr;
+    if (h->lodCount >= (uint32_t)kMaxMeshLods) return nullptr;
+    return h;
+}
+
+bool OpenMeshCache(const std::string& cachePath, const std::string& sourcePath,
+    MappedFile& file, MeshCacheView& out)
+{
+    namespace fs = std::filesystem;
+    if (!file.Open(cachePath, true)) return false;
+    const MeshCacheHeader* h = ValidHeader(file);
+    if (!h) {
+        file.Close();
+        return false;
+    }
+
+    SourceInfo source;
+    if (!StatSource(sourcePath, source, false)) {
+        file.Close();
+        return false;
+    }
+    if (source.mtime != h->sourceMTime || source.size != h->sourceSize) {
+        // touched: only the content decides
+        if (source.size != h->sourceSize || !StatSource(sourcePath, source, true) || source.hash != h->sourceHash) {
+            file.Close();
+            return false;
+        }
+        // same bytes, new mtime: patch the header so the next start skips the hash
+        if (!RestampCacheFile(cachePath, file, offsetof(MeshCacheHeader, sourceMTime), source.mtime, "OpenMeshCache") ||
+            !(h = ValidHeader(file))) {
+            file.Close();
+            return false;
+        }
+    }
+
+    const unsigned char* base = file.Data();
+    MeshView& mesh = out.mesh;
+    mesh.vertices = base + h->vertexOffset;
+    mesh.vertexCount = (size_t)h->vertexCount;
+    mesh.indices = (const unsigned int*)(base + h->indexOffset);
+    mesh.indexCount = (size_t)h->indexCount;
+    for (int i = 0; i < 3; ++i) {
+        mesh.boundsMin[i] = h->boundsMin[i];
+        mesh.boundsMax[i] = h->boundsMax[i];
+        mesh.dequant.posScale[i] = h->posScale[i];
+        mesh.dequant.posOffset[i] = h->posOffset[i];
+    }
+    for (int i = 0; i < 2; ++i) {
+        mesh.dequant.uvScale[i] = h->uvScale[i];
+        mesh.dequant.uvOffset[i] = h->uvOffset[i];
+    }
+
+    const CachedSubMesh* sub = (const CachedSubMesh*)(base + h->submeshOffset);
+    out.submeshes.clear();
+    out.lods.assign(h->lodCount, MeshLod());
+    for (uint32_t l = 0; l < h->lodCount; ++l) out.lods[l].error = h->lodError[l];
+    for (size_t i = 0; i < (size_t)h->submeshCount; ++i) {
+        if (sub[i].indexOffset + sub[i].indexCount > h->indexCount || sub[i].lod > h->lodCount) {
+            file.Close();
+            return false;
+        }
+        SubMeshRange r;
+        r.materialId = sub[i].materialId;
+        r.indexOffset = (size_t)sub[i].indexOffset;
+        r.indexCount = (size_t)sub[i].indexCount;
+        (sub[i].lod == 0 ? out.submeshes : out.lods[sub[i].lod - 1].submeshes).push_back(r);
+    }
+
+    // meshlets are small next to the geometry: copied out rather than kept mapped
+    const Meshlet* meshlets = (const Meshlet*)(base + h->meshletOffset);
+    const unsigned int* meshletVertices = (const unsigned int*)(base + h->meshletVertexOffset);
+    const unsigned char* meshletTriangles = base + h->meshletTriangleOffset;
+    out.meshlets.meshlets.assign(meshlets, meshlets + h->meshletCount);
+    out.meshlets.vertices.assign(meshletVertices, meshletVertices + h->meshletVertexCount);
+    out.meshlets.triangles.assign(meshletTriangles, meshletTriangles + h->meshletTriangleBytes);
+    for (const Meshlet& m : out.meshlets.meshlets) {
+        if ((uint64_t)m.vertexOffset + m.vertexCount > h->meshletVertexCount ||
+            (uint64_t)m.triangleOffset + m.triangleCount * 3 > h->meshletTriangleBytes ||
+            m.vertexCount > kMeshletMaxVertices || m.submesh >= out.submeshes.size()) {
+            file.Close();
+            return false;
+        }
+    }
+    for (unsigned int v : out.meshlets.vertices) {
+        if (v >= mesh.vertexCount) {
+            file.Close();
+            return false;
+        }
+    }
+
+    fs::path folder = fs::path(cachePath).parent_path();
+    const unsigned char* s = base + h->stringOffset;
+    const unsigned char* end = base + h->fileSize;
+    auto readString = [&](std::string& str) {
+        uint32_t len = 0;
+        if (end - s < (ptrdiff_t)sizeof(len)) return false;
+        std::memcpy(&len, s, sizeof(len));
+        s += sizeof(len);
+        if ((size_t)(end - s) < len) return false;
+        str.assign((const char*)s, len);
+        s += len;
+        return true;
+    };
+    out.materials.resize((size_t)h->materialCount);
+    for (MaterialSource& m : out.materials) {
+        if (!readString(m.name) || !readString(m.diffusePath)) {
+            file.Close();
+            return false;
+        }
+        if (!m.diffusePath.empty() && fs::path(m.diffusePath).is_relative())
+            m.diffusePath = (folder / m.diffusePath).string();
+    }
+    return true;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+// MeshCache.h - binary, mmap-ready cache of imported (and optimized) meshes
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ModelLoader.h"
+#include "MappedFile.h"
+#include "SourceFile.h"
+
+// "<model>.obj" -> "<model>.obj.meshbin", next to the source
+std::string MeshCachePath(const std::string& sourcePath);
+
+// Layout: header (with bounds, dequantization and LOD errors), packed vertices
+// (ModelVertexLayout), indices (uint32, all LODs), submesh table (every level's
+// ranges, tagged with their LOD), meshlets with their vertex and triangle arrays,
+// then the material strings; every section 16-byte aligned, so the mapped ranges go
+// straight to glBufferData. Texture paths are stored relative to the cache's folder.
+// 'data' must be quantized (QuantizeMesh).
+bool WriteMeshCache(const std::string& cachePath, const MeshData& data, const SourceInfo& source);
+
+// mesh points into the mapping held by the MappedFile passed to OpenMeshCache
+struct MeshCacheView {
+    MeshView mesh;
+    std::vector<SubMeshRange> submeshes;
+    std::vector<MeshLod> lods;
+    MeshletData meshlets;
+    std::vector<MaterialSource> materials;
+};
+
+// Maps cachePath and validates it against sourcePath (format version, mtime/size,
+// then content hash). False when the cache is missing, stale or malformed.
+bool OpenMeshCache(const std::string& cachePath, const std::string& sourcePath,
+    MappedFile& file, MeshCacheView& out);
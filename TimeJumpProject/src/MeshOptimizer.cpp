@@ -0,0 +1,212 @@
+// MeshOptimizer.cpp
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <glm/glm.hpp>
+
+static const unsigned int kUnused = 0xFFFFFFFFu;
+
+float AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned cacheSize) {
+    if (indexCount < 3) return 0.0f;
+    // FIFO via insertion stamps: a vertex is cached while fewer than cacheSize
+    // misses happened since it was inserted
+    std::vector<unsigned int> stamp(vertexCount, 0);
+    unsigned int time = cacheSize + 1;
+    size_t misses = 0;
+    for (size_t i = 0; i < indexCount; ++i) {
+        unsigned int v = indices[i];
+        if (time - stamp[v] > cacheSize) {
+            stamp[v] = time++;
+            ++misses;
+        }
+    }
+    return (float)misses / (float)(indexCount / 3);
+}
+
+float AnalyzeVertexFetch(const unsigned int* indices, size_t indexCount, size_t vertexCount,
+    size_t vertexSize, unsigned cacheSize)
+{
+    if (indexCount == 0 || vertexCount == 0) return 0.0f;
+    const size_t kLine = 64, kLines = 256; // 16 KB, roughly one texture/vertex L1
+    std::vector<uint64_t> lines(kLines, ~0ull);
+    std::vector<unsigned int> stamp(vertexCount, 0);
+    unsigned int time = cacheSize + 1;
+    size_t fetched = 0;
+    for (size_t i = 0; i < indexCount; ++i) {
+        unsigned int v = indices[i];
+        if (time - stamp[v] <= cacheSize) continue;
+        stamp[v] = time++;
+        uint64_t first = (uint64_t)v * vertexSize / kLine;
+        uint64_t last = ((uint64_t)v * vertexSize + vertexSize - 1) / kLine;
+        for (uint64_t line = first; line <= last; ++line) {
+            if (lines[line % kLines] == line) continue;
+            lines[line % kLines] = line;
+            fetched += kLine;
+        }
+    }
+    return (float)fetched / (float)(vertexCount * vertexSize);
+}
+
+void OptimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount,
+    unsigned cacheSize, std::vector<unsigned int>* clusters)
+{
+    if (clusters) clusters->clear();
+    const size_t triCount = indexCount / 3;
+    if (triCount == 0) return;
+
+    // work on a dense local numbering so a small range of a big vertex buffer
+    // does not pay for the whole buffer in the dead-end scan
+    std::vector<unsigned int> toLocal(vertexCount, kUnused), toGlobal;
+    std::vector<unsigned int> local(triCount * 3);
+    for (size_t i = 0; i < triCount * 3; ++i) {
+        unsigned int& l = toLocal[indices[i]];
+        if (l == kUnused) {
+            l = (unsigned int)toGlobal.size();
+            toGlobal.push_back(indices[i]);
+        }
+        local[i] = l;
+    }
+    const size_t n = toGlobal.size();
+
+    // vertex -> triangle adjacency (CSR) and live triangle count per vertex
+    std::vector<unsigned int> live(n, 0), offsets(n + 1, 0), adjacency(triCount * 3);
+    for (unsigned int v : local) ++live[v];
+    for (size_t v = 0; v < n; ++v) offsets[v + 1] = offsets[v] + live[v];
+    std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t t = 0; t < triCount; ++t)
+        for (int k = 0; k < 3; ++k) adjacency[fill[local[t * 3 + k]]++] = (unsigned int)t;
+
+    std::vector<unsigned int> stamp(n, 0), deadEnd, candidates, out;
+    std::vector<uint8_t> emitted(triCount, 0);
+    deadEnd.reserve(triCount * 3);
+    out.reserve(triCount * 3);
+    unsigned int time = cacheSize + 1;
+    size_t cursor = 0;
+    unsigned int fan = 0;
+    bool newCluster = true;
+
+    while (fan != kUnused) {
+        // emit every remaining triangle around the fanning vertex
+        candidates.clear();
+        for (unsigned int a = offsets[fan]; a < offsets[fan + 1]; ++a) {
+            unsigned int t = adjacency[a];
+            if (emitted[t]) continue;
+            if (newCluster && clusters) clusters->push_back((unsigned int)(out.size() / 3));
+            newCluster = false;
+            for (int k = 0; k < 3; ++k) {
+                unsigned int v = local[t * 3 + k];
+                out.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                --live[v];
+                if (time - stamp[v] > cacheSize) stamp[v] = time++;
+            }
+            emitted[t] = 1;
+        }
+
+        // next fan: the candidate that stays in the cache longest while its own
+        // triangles are emitted (each adds up to 2 new vertices)
+        unsigned int next = kUnused;
+        int best = -1;
+        for (unsigned int v : candidates) {
+            if (live[v] == 0) continue;
+            int priority = 0;
+            if (time - stamp[v] + 2 * live[v] <= cacheSize) priority = (int)(time - stamp[v]);
+            if (priority > best) {
+                best = priority;
+                next = v;
+            }
+        }
+        if (next != kUnused) {
+            fan = next;
+            continue;
+        }
+
+        // dead end: most recent vertex with work left, else scan forwards
+        newCluster = true;
+        while (!deadEnd.empty()) {
+            unsigned int d = deadEnd.back();
+            deadEnd.pop_back();
+            if (live[d] > 0) {
+                next = d;
+                break;
+            }
+        }
+        while (next == kUnused && cursor < n) {
+            if (live[cursor] > 0) next = (unsigned int)cursor;
+            ++cursor;
+        }
+        fan = next;
+    }
+
+    for (size_t i = 0; i < out.size(); ++i) indices[i] = toGlobal[out[i]];
+}
+
+void OptimizeOverdraw(unsigned int* indices, size_t indexCount, const float* positions,
+    size_t positionStride, const std::vector<unsigned int>& clusters)
+{
+    const size_t triCount = indexCount / 3;
+    if (clusters.size() < 2 || triCount == 0) return;
+
+    auto position = [&](unsigned int v) {
+        const float* p = (const float*)((const char*)positions + (size_t)v * positionStride);
+        return glm::vec3(p[0], p[1], p[2]);
+    };
+
+    struct Cluster { unsigned int first, count; glm::vec3 centroid, normal; float area, key; };
+    std::vector<Cluster> list(clusters.size());
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (size_t c = 0; c < clusters.size(); ++c) {
+        Cluster& cl = list[c];
+        cl.first = clusters[c];
+        cl.count = (unsigned int)((c + 1 < clusters.size() ? clusters[c + 1] : triCount) - cl.first);
+        cl.centroid = cl.normal = glm::vec3(0.0f);
+        cl.area = 0.0f;
+        for (unsigned int t = cl.first; t < cl.first + cl.count; ++t) {
+            glm::vec3 a = position(indices[t * 3]), b = position(indices[t * 3 + 1]), d = position(indices[t * 3 + 2]);
+            glm::vec3 n = glm::cross(b - a, d - a);
+            float area = glm::length(n);
+            cl.normal += n;                    // area-weighted
+            cl.centroid += (a + b + d) * (area / 3.0f);
+            cl.area += area;
+        }
+        meshCentroid += cl.centroid;
+        meshArea += cl.area;
+        if (cl.area > 0.0f) cl.centroid /= cl.area;
+    }
+    if (meshArea > 0.0f) meshCentroid /= meshArea;
+
+    // Sander et al.: dot(cluster centroid - mesh centroid, cluster normal), high first
+    for (Cluster& cl : list) {
+        float len = glm::length(cl.normal);
+        cl.key = len > 0.0f ? glm::dot(cl.centroid - meshCentroid, cl.normal / len) : 0.0f;
+    }
+    std::stable_sort(list.begin(), list.end(), [](const Cluster& a, const Cluster& b) { return a.key > b.key; });
+
+    std::vector<unsigned int> sorted;
+    sorted.reserve(triCount * 3);
+    for (const Cluster& cl : list)
+        sorted.insert(sorted.end(), indices + (size_t)cl.first * 3, indices + (size_t)(cl.first + cl.count) * 3);
+    std::copy(sorted.begin(), sorted.end(), indices);
+}
+
+size_t OptimizeVertexFetch(void* vertices, size_t vertexCount, size_t vertexSize,
+    unsigned int* indices, size_t indexCount)
+{
+    std::vector<unsigned int> remap(vertexCount, kUnused);
+    unsigned int next = 0;
+    for (size_t i = 0; i < indexCount; ++i) {
+        unsigned int& r = remap[indices[i]];
+        if (r == kUnused) r = next++;
+        indices[i] = r;
+    }
+
+    unsigned char* data = (unsigned char*)vertices;
+    std::vector<unsigned char> copy(data, data + vertexCount * vertexSize);
+    for (size_t v = 0; v < vertexCount; ++v)
+        if (remap[v] != kUnused) std::memcpy(data + (size_t)remap[v] * vertexSize, &copy[v * vertexSize], vertexSize);
+    return next;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+// MeshOptimizer.h - triangle/vertex reordering for the post-transform cache,
+// overdraw and vertex fetch, plus the cache simulations used to measure them
+#include <cstddef>
+#include <vector>
+
+// Simulated FIFO post-transform cache over one index range. Returns the ACMR
+// (transformed vertices per triangle): 3 is the worst case, ~0.5-0.7 is good.
+float AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount,
+    unsigned cacheSize = 16);
+
+// Simulated vertex fetch: every post-transform cache miss reads its vertex through a
+// small direct-mapped cache of 64-byte lines. Returns bytes read / vertex buffer size
+// (1 = every byte fetched once).
+float AnalyzeVertexFetch(const unsigned int* indices, size_t indexCount, size_t vertexCount,
+    size_t vertexSize, unsigned cacheSize = 16);
+
+// Tipsify (Sander et al. 2007): reorders the triangles of one index range in place
+// for a FIFO cache of cacheSize entries, in linear time. If clusters is given it
+// receives the first triangle of every cluster, i.e. each point where the walk hit
+// a dead end and jumped; those are the cuts OptimizeOverdraw may reorder at.
+void OptimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount,
+    unsigned cacheSize = 16, std::vector<unsigned int>* clusters = nullptr);
+
+// Reorders the clusters of a cache-optimized range so that ones facing away from
+// the mesh centre (likely occluders from any view) draw first. Triangles inside a
+// cluster keep their order, so the ACMR only changes at cluster seams.
+// positions: xyz floats of vertex i at byte offset i * positionStride.
+void OptimizeOverdraw(unsigned int* indices, size_t indexCount, const float* positions,
+    size_t positionStride, const std::vector<unsigned int>& clusters);
+
+// Renumbers vertices in first-use order of the whole index buffer so fetches walk
+// the vertex buffer forwards, and moves the vertices to match. Unreferenced
+// vertices are dropped; returns the new vertex count.
+size_t OptimizeVertexFetch(void* vertices, size_t vertexCount, size_t vertexSize,
+    unsigned int* indices, size_t indexCount);
@@ -0,0 +1,279 @@
+// MeshSimplifier.cpp
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+
+static const unsigned int kUnused = 0xFFFFFFFFu;
+
+// open borders pull harder than surfaces so outlines stay put
+static const double kBorderWeight = 10.0;
+
+// error(p) = p'Ap + 2b'p + c, summed over planes and divided by their total weight
+struct Quadric {
+    double a00 = 0, a11 = 0, a22 = 0, a01 = 0, a02 = 0, a12 = 0;
+    double b0 = 0, b1 = 0, b2 = 0, c = 0, w = 0;
+
+    void AddPlane(const glm::dvec3& n, double d, double weight) {
+        a00 += weight * n.x * n.x; a11 += weight * n.y * n.y; a22 += weight * n.z * n.z;
+        a01 += weight * n.x * n.y; a02 += weight * n.x * n.z; a12 += weight * n.y * n.z;
+        b0 += weight * n.x * d; b1 += weight * n.y * d; b2 += weight * n.z * d;
+        c += weight * d * d;
+        w += weight;
+    }
+    void Add(const Quadric& q) {
+        a00 += q.a00; a11 += q.a11; a22 += q.a22; a01 += q.a01; a02 += q.a02; a12 += q.a12;
+        b0 += q.b0; b1 += q.b1; b2 += q.b2; c += q.c; w += q.w;
+    }
+    // mean squared distance to the planes
+    double Eval(const glm::dvec3& p) const {
+        if (w <= 0.0) return 0.0;
+        double e = a00 * p.x * p.x + a11 * p.y * p.y + a22 * p.z * p.z
+            + 2.0 * (a01 * p.x * p.y + a02 * p.x * p.z + a12 * p.y * p.z)
+            + 2.0 * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+        return std::max(e, 0.0) / w;
+    }
+};
+
+struct PositionKey {
+    float x, y, z;
+    bool operator==(const PositionKey& o) const { return std::memcmp(this, &o, sizeof(*this)) == 0; }
+};
+
+struct PositionKeyHash {
+    size_t operator()(const PositionKey& k) const {
+        uint32_t b[3];
+        std::memcpy(b, &k, sizeof(b));
+        uint64_t h = b[0] * 0x9E3779B97F4A7C15ull;
+        h ^= b[1] + 0x7F4A7C159E3779B9ull + (h << 6) + (h >> 2);
+        h ^= b[2] + 0x94D049BB133111EBull + (h << 6) + (h >> 2);
+        return (size_t)(h ^ (h >> 31));
+    }
+};
+
+enum VertexKind : unsigned char { kManifold, kBorder, kLocked };
+
+struct Collapse {
+    unsigned int from, to;
+    double cost;
+};
+
+static uint64_t EdgeKey(unsigned int a, unsigned int b) { return ((uint64_t)a << 32) | b; }
+
+size_t SimplifyMesh(unsigned int* destination, const unsigned int* indices, size_t indexCount,
+    const float* positions, size_t positionStride, size_t vertexCount,
+    size_t targetIndexCount, float maxError, float* outError)
+{
+    if (outError) *outError = 0.0f;
+    indexCount -= indexCount % 3;
+    if (indexCount == 0) return 0;
+
+    // dense local numbering; positions normalized to the unit cube for stable quadrics
+    std::vector<unsigned int> local(vertexCount, kUnused);
+    std::vector<unsigned int> global;
+    std::vector<unsigned int> tris(indexCount);
+    for (size_t i = 0; i < indexCount; ++i) {
+        unsigned int v = indices[i];
+        if (local[v] == kUnused) {
+            local[v] = (unsigned int)global.size();
+            global.push_back(v);
+        }
+        tris[i] = local[v];
+    }
+    const size_t n = global.size();
+    auto sourcePos = [&](unsigned int v) {
+        return (const float*)((const unsigned char*)positions + (size_t)v * positionStride);
+    };
+    glm::dvec3 lo(sourcePos(global[0])[0], sourcePos(global[0])[1], sourcePos(global[0])[2]), hi = lo;
+    for (unsigned int v : global) {
+        const float* p = sourcePos(v);
+        lo = glm::min(lo, glm::dvec3(p[0], p[1], p[2]));
+        hi = glm::max(hi, glm::dvec3(p[0], p[1], p[2]));
+    }
+    double extent = std::max(std::max(hi.x - lo.x, hi.y - lo.y), std::max(hi.z - lo.z, 1e-12));
+    std::vector<glm::dvec3> pos(n);
+    for (size_t l = 0; l < n; ++l) {
+        const float* p = sourcePos(global[l]);
+        pos[l] = (glm::dvec3(p[0], p[1], p[2]) - lo) / extent;
+    }
+
+    // wedges: vertices that only differ in normal/UV share one canonical id
+    std::vector<unsigned int> canon(n);
+    std::vector<unsigned int> wedges(n, 0);
+    {
+        std::unordered_map<PositionKey, unsigned int, PositionKeyHash> byPosition;
+        byPosition.reserve(n);
+        for (size_t l = 0; l < n; ++l) {
+            const float* p = sourcePos(global[l]);
+            canon[l] = byPosition.emplace(PositionKey{ p[0], p[1], p[2] }, (unsigned int)l).first->second;
+            wedges[canon[l]]++;
+        }
+    }
+
+    // directed edges between canonical vertices; an edge without its twin is a border
+    std::vector<uint64_t> edges;
+    edges.reserve(indexCount);
+    for (size_t t = 0; t < indexCount; t += 3) {
+        for (int e = 0; e < 3; ++e) {
+            unsigned int a = canon[tris[t + e]], b = canon[tris[t + (e + 1) % 3]];
+            if (a != b) edges.push_back(EdgeKey(a, b));
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    auto hasEdge = [&](unsigned int a, unsigned int b) {
+        return std::binary_search(edges.begin(), edges.end(), EdgeKey(a, b));
+    };
+    auto isBorder = [&](unsigned int a, unsigned int b) { return !hasEdge(b, a) || !hasEdge(a, b); };
+
+    std::vector<unsigned char> kind(n, kManifold);
+    {
+        std::vector<unsigned int> borderEdges(n, 0);
+        for (size_t i = 0; i < edges.size(); ++i) {
+            unsigned int a = (unsigned int)(edges[i] >> 32), b = (unsigned int)edges[i];
+            if (i + 1 < edges.size() && edges[i + 1] == edges[i]) {
+                kind[a] = kind[b] = kLocked; // non-manifold edge
+                continue;
+            }
+            if (!hasEdge(b, a)) {
+                borderEdges[a]++;
+                borderEdges[b]++;
+            }
+        }
+        for (size_t l = 0; l < n; ++l) {
+            unsigned int c = canon[l];
+            if (wedges[c] > 1 || kind[c] == kLocked) kind[l] = kLocked;
+            else if (borderEdges[c] == 2) kind[l] = kBorder;
+            else if (borderEdges[c] != 0) kind[l] = kLocked; // border corner / bow-tie
+        }
+    }
+
+    // area-weighted face planes, plus planes perpendicular to each border edge
+    std::vector<Quadric> quadrics(n);
+    for (size_t t = 0; t < indexCount; t += 3) {
+        const glm::dvec3& p0 = pos[tris[t]];
+        glm::dvec3 normal = glm::cross(pos[tris[t + 1]] - p0, pos[tris[t + 2]] - p0);
+        double area2 = glm::length(normal);
+        if (area2 <= 0.0) continue;
+        normal /= area2;
+        for (int e = 0; e < 3; ++e)
+            quadrics[canon[tris[t + e]]].AddPlane(normal, -glm::dot(normal, p0), area2 * 0.5);
+        for (int e = 0; e < 3; ++e) {
+            unsigned int a = canon[tris[t + e]], b = canon[tris[t + (e + 1) % 3]];
+            if (a == b || hasEdge(b, a)) continue;
+            glm::dvec3 edge = pos[b] - pos[a];
+            glm::dvec3 side = glm::cross(edge, normal);
+            double len = glm::length(side);
+            if (len <= 0.0) continue;
+            side /= len;
+            double weight = glm::dot(edge, edge) * kBorderWeight;
+            quadrics[a].AddPlane(side, -glm::dot(side, pos[a]), weight);
+            quadrics[b].AddPlane(side, -glm::dot(side, pos[a]), weight);
+        }
+    }
+
+    auto canCollapse = [&](unsigned int from, unsigned int to) {
+        if (kind[from] == kManifold) return true;
+        if (kind[from] == kBorder) return kind[to] != kManifold && isBorder(canon[from], canon[to]);
+        return false;
+    };
+
+    const double limit = std::pow((double)maxError / extent, 2.0);
+    const size_t target = targetIndexCount - targetIndexCount % 3;
+    double worst = 0.0;
+    std::vector<unsigned int> adjOffset, adjTris;
+    std::vector<Collapse> candidates;
+    std::vector<unsigned int> remap(n);
+    std::vector<unsigned char> touched(n);
+
+    while (tris.size() > target) {
+        // vertex -> triangle adjacency of the current triangles
+        adjOffset.assign(n + 1, 0);
+        for (unsigned int v : tris) adjOffset[v + 1]++;
+        for (size_t l = 0; l < n; ++l) adjOffset[l + 1] += adjOffset[l];
+        adjTris.resize(tris.size());
+        {
+            std::vector<unsigned int> fill(adjOffset.begin(), adjOffset.end() - 1);
+            for (size_t i = 0; i < tris.size(); ++i) adjTris[fill[tris[i]]++] = (unsigned int)(i / 3);
+        }
+
+        // cheapest direction of every edge
+        candidates.clear();
+        for (size_t t = 0; t < tris.size(); t += 3) {
+            for (int e = 0; e < 3; ++e) {
+                unsigned int a = tris[t + e], b = tris[t + (e + 1) % 3];
+                if (a > b && hasEdge(canon[b], canon[a])) continue; // interior edges once
+                Collapse best{ kUnused, kUnused, 0.0 };
+                for (int dir = 0; dir < 2; ++dir) {
+                    unsigned int from = dir ? b : a, to = dir ? a : b;
+                    if (!canCollapse(from, to)) continue;
+                    Quadric q = quadrics[canon[from]];
+                    q.Add(quadrics[canon[to]]);
+                    double cost = q.Eval(pos[to]);
+                    if (best.from == kUnused || cost < best.cost) best = Collapse{ from, to, cost };
+                }
+                if (best.from != kUnused && best.cost <= limit) candidates.push_back(best);
+            }
+        }
+        if (candidates.empty()) break;
+        std::sort(candidates.begin(), candidates.end(),
+            [](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+        // an interior collapse removes two triangles; the 1-ring of every collapse is
+        // frozen for the rest of the pass so the flip tests below stay valid
+        size_t budget = (tris.size() - target) / 6 + 1;
+        size_t collapsed = 0;
+        for (size_t l = 0; l < n; ++l) remap[l] = (unsigned int)l;
+        std::fill(touched.begin(), touched.end(), 0);
+        for (const Collapse& c : candidates) {
+            if (collapsed >= budget) break;
+            if (touched[c.from] || touched[c.to]) continue;
+
+            bool flips = false;
+            for (unsigned int k = adjOffset[c.from]; k < adjOffset[c.from + 1] && !flips; ++k) {
+                const unsigned int* tri = &tris[adjTris[k] * 3];
+                if (canon[tri[0]] == canon[c.to] || canon[tri[1]] == canon[c.to] || canon[tri[2]] == canon[c.to])
+                    continue; // degenerates and disappears
+                glm::dvec3 p[3], q[3];
+                for (int e = 0; e < 3; ++e) {
+                    p[e] = pos[tri[e]];
+                    q[e] = tri[e] == c.from ? pos[c.to] : p[e];
+                }
+                glm::dvec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                glm::dvec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+                flips = glm::dot(before, after) <= 0.25 * glm::length(before) * glm::length(after);
+            }
+            if (flips) continue;
+
+            remap[c.from] = c.to;
+            quadrics[canon[c.to]].Add(quadrics[canon[c.from]]);
+            for (unsigned int k = adjOffset[c.from]; k < adjOffset[c.from + 1]; ++k) {
+                const unsigned int* tri = &tris[adjTris[k] * 3];
+                touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = 1;
+            }
+            touched[c.to] = 1;
+            worst = std::max(worst, c.cost);
+            ++collapsed;
+        }
+        if (collapsed == 0) break;
+
+        // apply, dropping triangles that lost their area
+        size_t out = 0;
+        for (size_t t = 0; t < tris.size(); t += 3) {
+            unsigned int a = remap[tris[t]], b = remap[tris[t + 1]], c = remap[tris[t + 2]];
+            if (canon[a] == canon[b] || canon[b] == canon[c] || canon[a] == canon[c]) continue;
+            tris[out++] = a;
+            tris[out++] = b;
+            tris[out++] = c;
+        }
+        tris.resize(out);
+    }
+
+    for (size_t i = 0; i < tris.size(); ++i) destination[i] = global[tris[i]];
+    if (outError) *outError = (float)(std::sqrt(worst) * extent);
+    return tris.size();
+}
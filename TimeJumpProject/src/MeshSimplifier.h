@@ -0,0 +1,20 @@
+#pragma once
+
+// MeshSimplifier.h - quadric error edge-collapse simplification for mesh LODs
+#include <cstddef>
+
+// Garland & Heckbert (1997) edge collapse over one index range. Edges collapse into
+// one of their endpoints, so vertices are never moved or created and the result
+// indexes the original vertex buffer (LODs share it with full detail).
+//  - attribute seams (one position, several normals/UVs) are locked, so the UV and
+//    normal splits survive at every level
+//  - open borders of the range only collapse along themselves, which keeps the
+//    outline of a submesh and its seams against neighbouring submeshes
+//  - collapses that would flip a triangle are rejected
+// Stops at targetIndexCount or when the next collapse would exceed maxError.
+// positions: xyz floats of vertex i at byte offset i * positionStride; errors are
+// object-space distances. destination needs indexCount entries; returns the number
+// of indices written. outError (optional) receives the largest error introduced.
+size_t SimplifyMesh(unsigned int* destination, const unsigned int* indices, size_t indexCount,
+    const float* positions, size_t positionStride, size_t vertexCount,
+    size_t targetIndexCount, float maxError, float* outError = nullptr);
@@ -0,0 +1,241 @@
+// Meshlet.cpp
+#include "Meshlet.h"
+#include "ModelLoader.h"
+#include "Frustum.h"
+#include "TextureManager.h"
+
+#include <algorithm>
+#include <cmath>
+
+static const unsigned char kNotLocal = 0xFF;
+
+// cones wider than this (min normal . axis) would never pass the back-face test
+static const float kMinConeDot = 0.1f;
+
+static glm::vec3 PositionOf(const float* positions, size_t stride, unsigned int v) {
+    const float* p = (const float*)((const unsigned char*)positions + v * stride);
+    return glm::vec3(p[0], p[1], p[2]);
+}
+
+static void ComputeBounds(Meshlet& m, const MeshletData& data, const float* positions, size_t stride) {
+    const unsigned int* verts = &data.vertices[m.vertexOffset];
+    const unsigned char* tris = &data.triangles[m.triangleOffset];
+
+    glm::vec3 lo = PositionOf(positions, stride, verts[0]), hi = lo;
+    for (uint32_t i = 1; i < m.vertexCount; ++i) {
+        glm::vec3 p = PositionOf(positions, stride, verts[i]);
+        lo = glm::min(lo, p);
+        hi = glm::max(hi, p);
+    }
+    m.center = (lo + hi) * 0.5f;
+    m.radius = 0.0f;
+    for (uint32_t i = 0; i < m.vertexCount; ++i)
+        m.radius = std::max(m.radius, glm::length(PositionOf(positions, stride, verts[i]) - m.center));
+
+    glm::vec3 normals[kMeshletMaxTriangles];
+    size_t normalCount = 0;
+    glm::vec3 sum(0.0f);
+    for (uint32_t t = 0; t < m.triangleCount; ++t) {
+        glm::vec3 a = PositionOf(positions, stride, verts[tris[t * 3 + 0]]);
+        glm::vec3 b = PositionOf(positions, stride, verts[tris[t * 3 + 1]]);
+        glm::vec3 c = PositionOf(positions, stride, verts[tris[t * 3 + 2]]);
+        glm::vec3 n = glm::cross(b - a, c - a);
+        float len = glm::length(n);
+        if (len <= 0.0f) continue; // degenerate: no facing
+        normals[normalCount++] = n / len;
+        sum += n / len;
+    }
+    m.coneCutoff = 2.0f;
+    float sumLen = glm::length(sum);
+    if (normalCount == 0 || sumLen < 1e-6f) return;
+    m.coneAxis = sum / sumLen;
+    float minDot = 1.0f;
+    for (size_t i = 0; i < normalCount; ++i) minDot = std::min(minDot, glm::dot(normals[i], m.coneAxis));
+    if (minDot > kMinConeDot) m.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+void BuildMeshlets(unsigned int* indices, size_t indexCount, const float* positions, size_t positionStride,
+    size_t vertexCount, uint32_t submesh, MeshletData& out)
+{
+    const size_t triCount = indexCount / 3;
+    if (triCount == 0) return;
+
+    // vertex -> triangles using it
+    std::vector<unsigned int> firstTri(vertexCount + 1, 0), adjacency(triCount * 3);
+    for (size_t i = 0; i < triCount * 3; ++i) ++firstTri[indices[i] + 1];
+    for (size_t v = 0; v < vertexCount; ++v) firstTri[v + 1] += firstTri[v];
+    {
+        std::vector<unsigned int> fill(firstTri.begin(), firstTri.end() - 1);
+        for (size_t i = 0; i < triCount * 3; ++i) adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+    }
+    std::vector<glm::vec3> centroids(triCount);
+    for (size_t t = 0; t < triCount; ++t) {
+        centroids[t] = (PositionOf(positions, positionStride, indices[t * 3]) +
+            PositionOf(positions, positionStride, indices[t * 3 + 1]) +
+            PositionOf(positions, positionStride, indices[t * 3 + 2])) / 3.0f;
+    }
+
+    std::vector<unsigned char> used(triCount, 0);
+    std::vector<unsigned int> live(vertexCount, 0);           // unused triangles per vertex
+    for (size_t v = 0; v < vertexCount; ++v) live[v] = firstTri[v + 1] - firstTri[v];
+    std::vector<unsigned char> local(vertexCount, kNotLocal); // slot in the open meshlet
+    std::vector<unsigned int> order;                          // triangles in meshlet order
+    std::vector<unsigned int> candidates;                     // may hold used / duplicate entries
+    order.reserve(triCount);
+    size_t scan = 0;
+
+    while (order.size() < triCount) {
+        // Seed next to the previous meshlet, at its most enclosed unused neighbour, so
+        // growth sweeps the surface instead of leaving slivers behind; else the first
+        // unused triangle.
+        size_t seed = triCount;
+        unsigned int seedLive = ~0u;
+        for (unsigned int t : candidates) {
+            if (used[t]) continue;
+            unsigned int l = live[indices[t * 3]] + live[indices[t * 3 + 1]] + live[indices[t * 3 + 2]];
+            if (l < seedLive) {
+                seed = t;
+                seedLive = l;
+            }
+        }
+        if (seed == triCount) {
+            while (used[scan]) ++scan;
+            seed = scan;
+        }
+        Meshlet m;
+        m.submesh = submesh;
+        m.vertexOffset = (uint32_t)out.vertices.size();
+        m.triangleOffset = (uint32_t)out.triangles.size();
+        glm::vec3 centroidSum(0.0f);
+        candidates.clear();
+
+        for (size_t next = seed;;) {
+            used[next] = 1;
+            order.push_back((unsigned int)next);
+            for (int k = 0; k < 3; ++k) {
+                unsigned int v = indices[next * 3 + k];
+                --live[v];
+                if (local[v] == kNotLocal) {
+                    local[v] = (unsigned char)m.vertexCount++;
+                    out.vertices.push_back(v);
+                    for (unsigned int a = firstTri[v]; a < firstTri[v + 1]; ++a)
+                        if (!used[adjacency[a]]) candidates.push_back(adjacency[a]);
+                }
+                out.triangles.push_back(local[v]);
+            }
+            centroidSum += centroids[next];
+            if (++m.triangleCount == kMeshletMaxTriangles) break;
+
+            // triangles adding no vertex first, then the closest to the meshlet
+            glm::vec3 centroid = centroidSum / (float)m.triangleCount;
+            size_t best = triCount;
+            int bestExtra = 4;
+            float bestDist = 0.0f;
+            for (size_t i = 0; i < candidates.size();) {
+                unsigned int t = candidates[i];
+                if (used[t]) {
+                    candidates[i] = candidates.back();
+                    candidates.pop_back();
+                    continue;
+                }
+                ++i;
+                int extra = (local[indices[t * 3]] == kNotLocal) + (local[indices[t * 3 + 1]] == kNotLocal) +
+                    (local[indices[t * 3 + 2]] == kNotLocal);
+                if (m.vertexCount + extra > kMeshletMaxVertices) continue;
+                if (extra > 0) extra = 1;
+                if (extra > bestExtra) continue;
+                // triangles whose corners have few unused triangles left sit in
+                // corners of the remaining surface: take them before they get cut off
+                unsigned int enclosed = std::min({ live[indices[t * 3]], live[indices[t * 3 + 1]], live[indices[t * 3 + 2]] });
+                glm::vec3 d = centroids[t] - centroid;
+                float dist = std::sqrt(glm::dot(d, d)) * (float)(1 + enclosed);
+                if (extra < bestExtra || dist < bestDist) {
+                    best = t;
+                    bestExtra = extra;
+                    bestDist = dist;
+                }
+            }
+            if (best == triCount) break; // full, or no connected triangle left
+            next = best;
+        }
+
+        for (uint32_t i = 0; i < m.vertexCount; ++i) local[out.vertices[m.vertexOffset + i]] = kNotLocal;
+        ComputeBounds(m, out, positions, positionStride);
+        out.meshlets.push_back(m);
+    }
+
+    std::vector<unsigned int> reordered(triCount * 3);
+    for (size_t i = 0; i < triCount; ++i)
+        for (int k = 0; k < 3; ++k) reordered[i * 3 + k] = indices[order[i] * 3 + k];
+    std::copy(reordered.begin(), reordered.end(), indices);
+}
+
+MeshletCuller::~MeshletCuller() {
+    if (ebo) glDeleteBuffers(1, &ebo);
+}
+
+size_t MeshletCuller::Cull(const MeshGL_Model& mesh, const glm::mat4& model, const glm::mat4& view, const glm::mat4& proj) {
+    runs.clear();
+    culledFrustum = culledBackface = 0;
+    const MeshletData& data = mesh.meshlets;
+    if (data.Empty()) {
+        stream.clear();
+        return 0;
+    }
+
+    // both tests in object space: no meshlet bound gets transformed
+    Frustum frustum = Frustum::FromMatrix(proj * view * model);
+    glm::vec3 eye(glm::inverse(view * model)[3]);
+    stream.resize(data.triangles.size()); // every meshlet kept, at most
+    size_t kept = 0, size = 0;
+    for (const Meshlet& m : data.meshlets) {
+        if (!frustum.IntersectsSphere(m.center, m.radius)) {
+            ++culledFrustum;
+            continue;
+        }
+        if (MeshletBackfacing(m, eye)) {
+            ++culledBackface;
+            continue;
+        }
+        if (runs.empty() || runs.back().submesh != m.submesh) runs.push_back(Run{ m.submesh, size, 0 });
+        const unsigned int* verts = &data.vertices[m.vertexOffset];
+        const unsigned char* tris = &data.triangles[m.triangleOffset];
+        unsigned int* dst = stream.data() + size;
+        for (uint32_t i = 0; i < m.triangleCount * 3; ++i) dst[i] = verts[tris[i]];
+        size += m.triangleCount * 3;
+        runs.back().count += m.triangleCount * 3;
+        ++kept;
+    }
+    stream.resize(size);
+    return kept;
+}
+
+void MeshletCuller::Draw(const MeshGL_Model& mesh) {
+    if (stream.empty() || mesh.VAO == 0) return;
+    glBindVertexArray(mesh.VAO);
+    if (ebo == 0) glGenBuffers(1, &ebo);
+    // the element binding is VAO state: swapped in here, restored below
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    if (stream.size() > capacity) capacity = std::max<size_t>(stream.size() + stream.size() / 2, 4096);
+    // re-specifying orphans last frame's stream, which the GPU may still be reading
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, capacity * sizeof(unsigned int), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, stream.size() * sizeof(unsigned int), stream.data());
+
+    glActiveTexture(GL_TEXTURE0);
+    for (const Run& r : runs) {
+        int baseVertex = mesh.geometry.baseVertex;
+        if (r.submesh < mesh.submeshes.size()) {
+            const SubMeshRange& sm = mesh.submeshes[r.submesh];
+            baseVertex += sm.baseVertex;
+            if (sm.materialId >= 0 && sm.materialId < (int)mesh.materials.size())
+            {
+                glBindTexture(GL_TEXTURE_2D, mesh.materials[sm.materialId].diffuseTex);
+                TextureManager::Instance().Touch(mesh.materials[sm.materialId].diffuseTex);
+            }
+        }
+        glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)r.count, GL_UNSIGNED_INT,
+            (void*)(r.first * sizeof(unsigned int)), baseVertex);
+    }
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.arena ? mesh.arena->IndexBuffer() : mesh.EBO);
+    glBindVertexArray(0);
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+// Meshlet.h - small vertex/triangle clusters with bounds for per-cluster culling
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+struct MeshGL_Model;
+
+const size_t kMeshletMaxVertices = 64;
+const size_t kMeshletMaxTriangles = 124;
+
+// One cluster of full detail. Its triangles are 3 bytes each, indexing the
+// cluster's own vertex list, which holds vertex indices of the mesh.
+struct Meshlet {
+    glm::vec3 center{ 0.0f };     // bounding sphere, object space
+    float radius = 0.0f;
+    glm::vec3 coneAxis{ 0.0f };   // mean facing of the triangles
+    float coneCutoff = 2.0f;      // sin of the normal cone's half-angle; > 1 never culls
+    uint32_t vertexOffset = 0;    // into MeshletData::vertices
+    uint32_t triangleOffset = 0;  // into MeshletData::triangles, in bytes
+    uint32_t vertexCount = 0;     // <= kMeshletMaxVertices
+    uint32_t triangleCount = 0;   // <= kMeshletMaxTriangles
+    uint32_t submesh = 0;         // full-detail submesh (material range) it belongs to
+};
+
+struct MeshletData {
+    std::vector<Meshlet> meshlets;            // grouped by submesh, in submesh order
+    std::vector<unsigned int> vertices;       // mesh vertex indices
+    std::vector<unsigned char> triangles;     // local indices, 3 per triangle
+
+    bool Empty() const { return meshlets.empty(); }
+    void Clear() { meshlets.clear(); vertices.clear(); triangles.clear(); }
+};
+
+// Greedily grows meshlets over one submesh's index range. Each is seeded next to the
+// previous one and adds the adjacent triangle that brings no new vertex, else the
+// one nearest its centroid (weighted towards triangles the rest of the surface has
+// nearly enclosed, so no slivers are left behind), until it holds kMeshletMaxVertices
+// vertices or kMeshletMaxTriangles triangles. The range is rewritten in meshlet order
+// (same triangles, so it still draws as one range) and the meshlets appended to 'out'.
+// positions: xyz floats of vertex i at byte offset i * positionStride.
+void BuildMeshlets(unsigned int* indices, size_t indexCount, const float* positions, size_t positionStride,
+    size_t vertexCount, uint32_t submesh, MeshletData& out);
+
+// True when no triangle of m can face a camera at 'eye' (object space).
+inline bool MeshletBackfacing(const Meshlet& m, const glm::vec3& eye) {
+    glm::vec3 d = m.center - eye;
+    return glm::dot(d, m.coneAxis) >= m.coneCutoff * glm::length(d) + m.radius * (1.0f + m.coneCutoff);
+}
+
+// Per-frame meshlet culling of one mesh instance. Cull tests every meshlet of
+// mesh.meshlets against the frustum and its normal cone in object space, then
+// expands the survivors into a compacted index stream (one run per submesh); Draw
+// streams that into its own element buffer and draws it with the mesh's VAO.
+// Back-facing is affine-invariant, so non-uniform model scale is fine.
+class MeshletCuller {
+public:
+    ~MeshletCuller();
+
+    // returns the meshlets kept
+    size_t Cull(const MeshGL_Model& mesh, const glm::mat4& model, const glm::mat4& view, const glm::mat4& proj);
+    // binds each run's diffuse texture to unit 0; the caller sets up the program
+    // (model matrix, SetDequantUniforms) as for any draw of the mesh
+    void Draw(const MeshGL_Model& mesh);
+
+    size_t VisibleTriangles() const { return stream.size() / 3; }
+    size_t CulledFrustum() const { return culledFrustum; }
+    size_t CulledBackface() const { return culledBackface; }
+
+private:
+    struct Run { uint32_t submesh; size_t first, count; };
+    std::vector<unsigned int> stream;
+    std::vector<Run> runs;
+    size_t culledFrustum = 0, culledBackface = 0;
+    GLuint ebo = 0;
+    size_t capacity = 0; // in indices
+};
@@ -1,13 +1,37 @@
 // ModelLoader.cpp
 #include "tiny_obj_loader.h"
 
-#include "stb_image.h"
-
 #include "ModelLoader.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "MeshCache.h"
+#include "ObjParser.h"
+#include "TextureManager.h"
+#include "Parallel.h"
 
 #include <iostream>
 #include <filesystem>
 #include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+
+// one OBJ face corner: (position, normal, texcoord) indices, -1 when absent
+struct CornerKey {
+    int v, n, t;
+    bool operator==(const CornerKey& o) const { return v == o.v && n == o.n && t == o.t; }
+};
+
+struct CornerKeyHash {
+    size_t operator()(const CornerKey& k) const {
+        // 64-bit mix of the three indices (splitmix finalizer)
+        uint64_t h = (uint64_t)(uint32_t)k.v * 0x9E3779B97F4A7C15ull;
+        h ^= (uint64_t)(uint32_t)k.n + 0x7F4A7C159E3779B9ull + (h << 6) + (h >> 2);
+        h ^= (uint64_t)(uint32_t)k.t + 0x94D049BB133111EBull + (h << 6) + (h >> 2);
+        h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ull;
+        h = (h ^ (h >> 27)) * 0x94D049BB133111EBull;
+        return (size_t)(h ^ (h >> 31));
+    }
+};
 
 static std::string GetFolder(const std::string& path) {
     std::filesystem::path p(path);
@@ -15,53 +39,50 @@ static std::string GetFolder(const std::string& path) {
     return "./";
 }
 
-GLuint LoadTexture2D(const std::string& path, bool& outHasAlpha) {
-    outHasAlpha = false;
-    if (path.empty()) return 0;
-    stbi_set_flip_vertically_on_load(true);
-    int w = 0, h = 0, comp = 0;
-    unsigned char* data = stbi_load(path.c_str(), &w, &h, &comp, 0);
-    if (!data) {
-        std::cerr << "LoadTexture2D: failed to load " << path << "\n";
-        return 0;
-    }
-    GLenum fmt = (comp == 3) ? GL_RGB : GL_RGBA;
-    outHasAlpha = (comp == 4);
-    GLuint tex = 0;
-    glGenTextures(1, &tex);
-    glBindTexture(GL_TEXTURE_2D, tex);
-    glTexImage2D(GL_TEXTURE_2D, 0, fmt, w, h, 0, fmt, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    stbi_image_free(data);
+GLuint LoadTexture2D(const std::string& path, bool& outHasAlpha, bool flipVertically) {
+    TextureOptions options;
+    options.flipVertically = flipVertically;
+    TextureInfo info;
+    GLuint tex = TextureManager::Instance().Load(path, options, &info);
+    outHasAlpha = tex && info.hasAlpha;
+    return tex;
+}
+
+GLuint LoadTexture2DFromMemory(const unsigned char* bytes, size_t size, bool& outHasAlpha, bool flipVertically) {
+    TextureOptions options;
+    options.flipVertically = flipVertically;
+    TextureInfo info;
+    GLuint tex = TextureManager::Instance().LoadFromMemory(bytes, size, options, &info);
+    outHasAlpha = tex && info.hasAlpha;
     return tex;
 }
 
-bool LoadOBJWithMaterials(const std::string& path, MeshGL_Model& outModel, const std::string& workingFolderFallback) {
+bool ImportOBJSerial(const std::string& path, MeshData& outData, const std::string& workingFolderFallback) {
     tinyobj::attrib_t attrib;
     std::vector<tinyobj::shape_t> shapes;
     std::vector<tinyobj::material_t> materials;
-    std::string warn, err;
+    std::string err; // this tinyobj reports warnings here too
 
     std::string folder = GetFolder(path);
     if (folder.empty() && !workingFolderFallback.empty()) folder = workingFolderFallback;
 
     bool ok = tinyobj::LoadObj(&attrib, &shapes, &materials, &err, path.c_str(), folder.c_str(), true);
-    if (!warn.empty()) std::cout << "tinyobj warn: " << warn << "\n";
     if (!err.empty()) std::cerr << "tinyobj err: " << err << "\n";
     if (!ok) return false;
 
+    std::vector<ModelVertex>& vertices = outData.vertices;
+    std::vector<unsigned int>& indices = outData.indices;
+    std::vector<SubMeshRange>& submeshes = outData.submeshes;
+    vertices.clear();
+    indices.clear();
+    submeshes.clear();
 
-    struct V { float px, py, pz; float nx, ny, nz; float u, v; };
-    std::vector<V> vertices;
-    std::vector<unsigned int> indices;
-    std::vector<SubMeshRange> submeshes;
-
-    // Map to track per-material submesh accumulation
-    int globalIndexOffset = 0;
+    // identical corners share one vertex; OBJ corners repeat ~6x on closed meshes
+    std::unordered_map<CornerKey, unsigned int, CornerKeyHash> cornerToVertex;
+    size_t cornerCount = 0;
+    for (const auto& shape : shapes) cornerCount += shape.mesh.indices.size();
+    cornerToVertex.reserve(cornerCount / 4 + 16);
+    indices.reserve(cornerCount);
 
     // tinyobj stores per-face material id in shape.mesh.material_ids. We'll iterate faces.
     for (const auto& shape : shapes) {
@@ -82,7 +103,15 @@ bool LoadOBJWithMaterials(const std::string& path, MeshGL_Model& outModel, const
 
             for (int v = 0; v < fv; ++v) {
                 tinyobj::index_t idx = shape.mesh.indices[faceOffset + v];
-                V vert{};
+                CornerKey key{ idx.vertex_index, idx.normal_index, idx.texcoord_index };
+                auto found = cornerToVertex.find(key);
+                if (found != cornerToVertex.end()) {
+                    indices.push_back(found->second);
+                    submeshes.back().indexCount++;
+                    continue;
+                }
+
+                ModelVertex vert{};
                 if (idx.vertex_index >= 0) {
                     vert.px = attrib.vertices[3 * idx.vertex_index + 0];
                     vert.py = attrib.vertices[3 * idx.vertex_index + 1];
@@ -105,6 +134,7 @@ bool LoadOBJWithMaterials(const std::string& path, MeshGL_Model& outModel, const
                 }
 
                 unsigned int newIndex = static_cast<unsigned int>(vertices.size());
+                cornerToVertex.emplace(key, newIndex);
                 vertices.push_back(vert);
                 indices.push_back(newIndex);
                 submeshes.back().indexCount++;
@@ -113,6 +143,189 @@ bool LoadOBJWithMaterials(const std::string& path, MeshGL_Model& outModel, const
         }
     }
 
+    outData.materials.resize(materials.size());
+    for (size_t i = 0; i < materials.size(); ++i) {
+        outData.materials[i].name = materials[i].name;
+        outData.materials[i].diffusePath = materials[i].diffuse_texname.empty() ? "" : folder + materials[i].diffuse_texname;
+    }
+    return true;
+}
+
+bool ImportOBJ(const std::string& path, MeshData& outData, const std::string& workingFolderFallback) {
+    return ParseOBJParallel(path, outData, workingFolderFallback);
+}
+
+void OptimizeMesh(MeshData& data) {
+    if (data.vertices.empty()) return;
+    // submeshes share the vertex buffer but not triangles, so they run in parallel
+    ParallelFor(data.submeshes.size(), [&](size_t i) {
+        const SubMeshRange& r = data.submeshes[i];
+        unsigned int* idx = data.indices.data() + r.indexOffset;
+        std::vector<unsigned int> clusters;
+        OptimizeVertexCache(idx, r.indexCount, data.vertices.size(), 16, &clusters);
+        OptimizeOverdraw(idx, r.indexCount, &data.vertices[0].px, sizeof(ModelVertex), clusters);
+    });
+    size_t used = OptimizeVertexFetch(data.vertices.data(), data.vertices.size(), sizeof(ModelVertex),
+        data.indices.data(), data.indices.size());
+    data.vertices.resize(used);
+}
+
+void BuildMeshLods(MeshData& data) {
+    data.lods.clear();
+    if (data.vertices.empty() || data.submeshes.empty()) return;
+
+    glm::vec3 lo(data.vertices[0].px, data.vertices[0].py, data.vertices[0].pz), hi = lo;
+    for (const ModelVertex& v : data.vertices) {
+        lo = glm::min(lo, glm::vec3(v.px, v.py, v.pz));
+        hi = glm::max(hi, glm::vec3(v.px, v.py, v.pz));
+    }
+    const float maxError = 0.04f * glm::length(hi - lo);
+
+    // every (level, submesh) pair simplifies full detail on its own, so all run at once
+    struct LodPart {
+        std::vector<unsigned int> indices;
+        float error = 0.0f;
+    };
+    const size_t subCount = data.submeshes.size();
+    std::vector<LodPart> parts((kMaxMeshLods - 1) * subCount);
+    ParallelFor(parts.size(), [&](size_t j) {
+        size_t level = j / subCount + 1;
+        const SubMeshRange& r = data.submeshes[j % subCount];
+        LodPart& part = parts[j];
+        part.indices.resize(r.indexCount);
+        size_t count = SimplifyMesh(part.indices.data(), data.indices.data() + r.indexOffset, r.indexCount,
+            &data.vertices[0].px, sizeof(ModelVertex), data.vertices.size(),
+            (r.indexCount >> level) / 3 * 3, maxError, &part.error);
+        part.indices.resize(count);
+        OptimizeVertexCache(part.indices.data(), count, data.vertices.size());
+    });
+
+    size_t previous = 0;
+    for (const SubMeshRange& r : data.submeshes) previous += r.indexCount;
+    for (int level = 1; level < kMaxMeshLods; ++level) {
+        const LodPart* row = &parts[(level - 1) * subCount];
+        size_t total = 0;
+        float error = data.lods.empty() ? 0.0f : data.lods.back().error;
+        for (size_t s = 0; s < subCount; ++s) {
+            total += row[s].indices.size();
+            error = std::max(error, row[s].error);
+        }
+        if (total == 0 || total > previous * 9 / 10) break; // hit the error limit
+
+        MeshLod lod;
+        lod.error = error;
+        for (size_t s = 0; s < subCount; ++s) {
+            SubMeshRange r;
+            r.materialId = data.submeshes[s].materialId;
+            r.indexOffset = data.indices.size();
+            r.indexCount = row[s].indices.size();
+            data.indices.insert(data.indices.end(), row[s].indices.begin(), row[s].indices.end());
+            lod.submeshes.push_back(r);
+        }
+        data.lods.push_back(std::move(lod));
+        previous = total;
+    }
+}
+
+void ClusterMesh(MeshData& data) {
+    data.meshlets.Clear();
+    size_t triangles = 0;
+    for (const SubMeshRange& r : data.submeshes) triangles += r.indexCount / 3;
+    if (triangles < kMeshletMinTriangles || data.vertices.empty()) return;
+
+    // per submesh in parallel, then concatenated in submesh order
+    std::vector<MeshletData> parts(data.submeshes.size());
+    ParallelFor(parts.size(), [&](size_t i) {
+        const SubMeshRange& r = data.submeshes[i];
+        BuildMeshlets(data.indices.data() + r.indexOffset, r.indexCount, &data.vertices[0].px, sizeof(ModelVertex),
+            data.vertices.size(), (uint32_t)i, parts[i]);
+    });
+    MeshletData& out = data.meshlets;
+    for (const MeshletData& part : parts) {
+        uint32_t vertexBase = (uint32_t)out.vertices.size(), triangleBase = (uint32_t)out.triangles.size();
+        for (Meshlet m : part.meshlets) {
+            m.vertexOffset += vertexBase;
+            m.triangleOffset += triangleBase;
+            out.meshlets.push_back(m);
+        }
+        out.vertices.insert(out.vertices.end(), part.vertices.begin(), part.vertices.end());
+        out.triangles.insert(out.triangles.end(), part.triangles.begin(), part.triangles.end());
+    }
+}
+
+void QuantizeMesh(MeshData& data) {
+    const std::vector<ModelVertex>& vertices = data.vertices;
+    data.packedVertices.assign(vertices.size() * ModelVertexLayout::stride, 0);
+    data.dequant = VertexDequant();
+    data.boundsMin = data.boundsMax = glm::vec3(0.0f);
+    if (vertices.empty()) return;
+
+    glm::vec3 pMin(vertices[0].px, vertices[0].py, vertices[0].pz), pMax = pMin;
+    glm::vec2 uvMin(vertices[0].u, vertices[0].v), uvMax = uvMin;
+    for (const ModelVertex& v : vertices) {
+        pMin = glm::min(pMin, glm::vec3(v.px, v.py, v.pz));
+        pMax = glm::max(pMax, glm::vec3(v.px, v.py, v.pz));
+        uvMin = glm::min(uvMin, glm::vec2(v.u, v.v));
+        uvMax = glm::max(uvMax, glm::vec2(v.u, v.v));
+    }
+    data.boundsMin = pMin;
+    data.boundsMax = pMax;
+
+    // positions -> [-1, 1] around the bounds centre, UVs -> [0, 1] of their range
+    VertexDequant& d = data.dequant;
+    d.posOffset = (pMin + pMax) * 0.5f;
+    d.posScale = glm::max((pMax - pMin) * 0.5f, glm::vec3(1e-6f));
+    d.uvOffset = uvMin;
+    d.uvScale = glm::max(uvMax - uvMin, glm::vec2(1e-6f));
+
+    const size_t kBlock = 16384;
+    ParallelFor((vertices.size() + kBlock - 1) / kBlock, [&](size_t b) {
+        size_t end = std::min(vertices.size(), (b + 1) * kBlock);
+        for (size_t i = b * kBlock; i < end; ++i) {
+            const ModelVertex& v = vertices[i];
+            unsigned char* dst = &data.packedVertices[i * ModelVertexLayout::stride];
+            glm::vec3 n(v.nx, v.ny, v.nz);
+            float len = glm::length(n);
+            ModelVertexLayout::Put<0>(dst, (glm::vec3(v.px, v.py, v.pz) - d.posOffset) / d.posScale);
+            ModelVertexLayout::Put<1>(dst, len > 0.0f ? n / len : n);
+            ModelVertexLayout::Put<2>(dst, (glm::vec2(v.u, v.v) - d.uvOffset) / d.uvScale);
+        }
+    });
+}
+
+MeshView ViewOf(const MeshData& data) {
+    MeshView view;
+    view.vertices = data.packedVertices.data();
+    view.vertexCount = data.packedVertices.size() / ModelVertexLayout::stride;
+    view.indices = data.indices.data();
+    view.indexCount = data.indices.size();
+    view.boundsMin = data.boundsMin;
+    view.boundsMax = data.boundsMax;
+    view.dequant = data.dequant;
+    return view;
+}
+
+void UploadMeshBuffers(const MeshView& view, MeshGL_Model& outModel, GeometryArena* arena) {
+    outModel.indexCount = view.indexCount;
+    outModel.vertexCount = view.vertexCount;
+    outModel.boundsMin = view.boundsMin;
+    outModel.boundsMax = view.boundsMax;
+    outModel.dequant = view.dequant;
+
+    if (arena && arena->VertexStride() != (GLsizei)ModelVertexLayout::stride) {
+        std::cerr << "UploadMeshBuffers: arena vertex format does not match ModelVertexLayout\n";
+        arena = nullptr;
+    }
+    if (arena) {
+        outModel.arena = arena;
+        outModel.geometry = arena->Allocate(view.vertices, view.vertexCount, view.indices, view.indexCount);
+        outModel.VAO = arena->VAO();
+        return;
+    }
+    outModel.geometry = GeometryRange();
+    outModel.geometry.vertexCount = (GLuint)view.vertexCount;
+    outModel.geometry.indexCount = (GLuint)view.indexCount;
+
     // Create GL buffers
     glGenVertexArrays(1, &outModel.VAO);
     glGenBuffers(1, &outModel.VBO);
@@ -120,31 +333,24 @@ bool LoadOBJWithMaterials(const std::string& path, MeshGL_Model& outModel, const
 
     glBindVertexArray(outModel.VAO);
     glBindBuffer(GL_ARRAY_BUFFER, outModel.VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(V), vertices.data(), GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, view.vertexCount * ModelVertexLayout::stride, view.vertices, GL_STATIC_DRAW);
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, outModel.EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, view.indexCount * sizeof(unsigned int), view.indices, GL_STATIC_DRAW);
 
-    // Setup attribs: pos(0), normal(1), uv(2)
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(V), (void*)offsetof(V, px));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(V), (void*)offsetof(V, nx));
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(V), (void*)offsetof(V, u));
+    // pos(0), normal(1), uv(2)
+    ModelVertexLayout::Apply();
 
     glBindVertexArray(0);
+}
 
-    outModel.indexCount = indices.size();
-    outModel.submeshes = std::move(submeshes);
-
+void LoadMeshMaterials(const std::vector<MaterialSource>& materials, MeshGL_Model& outModel, bool loadTextures) {
     // Build material list & load textures
     outModel.materials.resize(materials.size());
     for (size_t i = 0; i < materials.size(); ++i) {
         outModel.materials[i].name = materials[i].name;
-        std::string diff = materials[i].diffuse_texname;
-        if (!diff.empty()) {
-            std::string full = folder + diff;
+        const std::string& full = materials[i].diffusePath;
+        if (loadTextures && !full.empty()) {
             bool hasAlpha = false;
             outModel.materials[i].diffuseTex = LoadTexture2D(full, hasAlpha);
             outModel.materials[i].usesAlpha = hasAlpha;
@@ -158,6 +364,59 @@ bool LoadOBJWithMaterials(const std::string& path, MeshGL_Model& outModel, const
     if (outModel.materials.empty()) {
         outModel.materials.push_back(MaterialGL{ "default", 0, false });
     }
+}
+
+void UploadMesh(const MeshData& data, MeshGL_Model& outModel, GeometryArena* arena) {
+    UploadMeshBuffers(ViewOf(data), outModel, arena);
+    outModel.submeshes = data.submeshes;
+    outModel.lods = data.lods;
+    outModel.meshlets = data.meshlets;
+    LoadMeshMaterials(data.materials, outModel);
+}
+
+bool PrepareOBJ(const std::string& path, PreparedMesh& out, const std::string& workingFolderFallback) {
+    std::string cachePath = MeshCachePath(path);
+    {
+        // cache hit: the mapped vertex/index ranges go straight to the GL
+        MeshCacheView view;
+        if (OpenMeshCache(cachePath, path, out.file, view)) {
+            out.mesh = view.mesh;
+            out.submeshes = std::move(view.submeshes);
+            out.lods = std::move(view.lods);
+            out.meshlets = std::move(view.meshlets);
+            out.materials = std::move(view.materials);
+            return true;
+        }
+    }
+
+    MeshData& data = out.data;
+    if (!ImportOBJ(path, data, workingFolderFallback)) return false;
+    OptimizeMesh(data);
+    BuildMeshLods(data);
+    QuantizeMesh(data);
+    SourceInfo source;
+    if (StatSource(path, source, true)) WriteMeshCache(cachePath, data, source);
+    out.mesh = ViewOf(data);
+    out.submeshes = data.submeshes;
+    out.lods = data.lods;
+    out.meshlets = data.meshlets;
+    out.materials = data.materials;
+    return true;
+}
+
+void UploadPreparedMesh(PreparedMesh& prepared, MeshGL_Model& outModel, GeometryArena* arena, bool loadTextures) {
+    UploadMeshBuffers(prepared.mesh, outModel, arena);
+    outModel.submeshes = std::move(prepared.submeshes);
+    outModel.lods = std::move(prepared.lods);
+    outModel.meshlets = std::move(prepared.meshlets);
+    LoadMeshMaterials(prepared.materials, outModel, loadTextures);
+}
 
+bool LoadOBJWithMaterials(const std::string& path, MeshGL_Model& outModel, const std::string& workingFolderFallback,
+    GeometryArena* arena)
+{
+    PreparedMesh prepared;
+    if (!PrepareOBJ(path, prepared, workingFolderFallback)) return false;
+    UploadPreparedMesh(prepared, outModel, arena);
     return true;
 }
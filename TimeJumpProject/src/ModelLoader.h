@@ -2,17 +2,32 @@
 
 // ModelLoader.h
 #include <glad/glad.h>
+#include <algorithm>
 #include <string>
 #include <vector>
 #include <glm/glm.hpp>
+#include "VertexLayout.h"
+#include "GeometryArena.h"
+#include "MappedFile.h"
+#include "Meshlet.h"
 
 // Simple submesh / material containers for GL
 struct SubMeshRange {
     int materialId = -1;      // index into material list
     size_t indexOffset = 0;   // offset in indices (not bytes)
     size_t indexCount = 0;    // number of indices (triangles*3)
+    int baseVertex = 0;       // added to every index (GLB primitives sharing one vertex stream)
 };
 
+// One simplified level of a mesh: the same submeshes/materials as full detail,
+// with their own ranges in the shared index buffer (see BuildMeshLods)
+struct MeshLod {
+    float error = 0.0f;                        // object-space deviation from full detail
+    std::vector<SubMeshRange> submeshes;
+};
+
+const int kMaxMeshLods = 4;                    // including full detail
+
 struct MaterialGL {
     std::string name;
     GLuint diffuseTex = 0;
@@ -21,15 +36,144 @@ struct MaterialGL {
 
 struct MeshGL_Model {
     GLuint VAO = 0;
-    GLuint VBO = 0;
+    GLuint VBO = 0;                            // 0 when the mesh lives in an arena
     GLuint EBO = 0;
-    size_t indexCount = 0;                     // total indices
+    GeometryArena* arena = nullptr;            // shared buffers, or null for its own
+    GeometryRange geometry;                    // where the mesh sits in VBO/EBO or the arena
+    size_t indexCount = 0;                     // total indices, all LODs
+    size_t vertexCount = 0;                    // unique vertices in the VBO
+    glm::vec3 boundsMin{ 0.0f };               // object-space AABB of all vertices
+    glm::vec3 boundsMax{ 0.0f };
+    VertexDequant dequant;                     // set with SetDequantUniforms before drawing
     std::vector<SubMeshRange> submeshes;       // ranges by material / shape
+    std::vector<MeshLod> lods;                 // coarser levels 1.., in the same VBO/EBO
+    MeshletData meshlets;                      // full detail in clusters, for MeshletCuller (empty from the loaders)
     std::vector<MaterialGL> materials;         // materials
 };
 
+// submesh ranges of level 'lod' (0 = full detail)
+inline const std::vector<SubMeshRange>& LodSubmeshes(const MeshGL_Model& mesh, int lod) {
+    return lod <= 0 || mesh.lods.empty() ? mesh.submeshes : mesh.lods[std::min<size_t>(lod, mesh.lods.size()) - 1].submeshes;
+}
+
+// Coarsest level whose error stays within maxError (object-space units, i.e. what
+// one pixel covers at the instance's distance, divided by its scale).
+inline int SelectMeshLod(const MeshGL_Model& mesh, float maxError) {
+    int lod = 0;
+    while (lod < (int)mesh.lods.size() && mesh.lods[lod].error <= maxError) ++lod;
+    return lod;
+}
+
+// GPU vertex of imported models, 16 bytes: positions as half floats normalized to
+// the mesh bounds, snorm 10-10-10-2 normals, unorm16 UVs normalized to the UV bounds
+typedef VertexLayout<
+    Attrib<0, AttribHalf4>,
+    Attrib<1, AttribSnorm1010102>,
+    Attrib<2, AttribUnorm16x2>> ModelVertexLayout;
+
+// CPU-side mesh as imported, before any GL objects exist
+struct ModelVertex { float px, py, pz; float nx, ny, nz; float u, v; };
+
+struct MaterialSource {
+    std::string name;
+    std::string diffusePath;                   // full path, empty if none
+};
+
+struct MeshData {
+    std::vector<ModelVertex> vertices;
+    std::vector<unsigned int> indices;         // full detail, then every LOD
+    std::vector<SubMeshRange> submeshes;
+    std::vector<MeshLod> lods;                 // filled by BuildMeshLods
+    MeshletData meshlets;                      // filled by ClusterMesh
+    std::vector<MaterialSource> materials;
+
+    // filled by QuantizeMesh
+    std::vector<unsigned char> packedVertices; // ModelVertexLayout
+    VertexDequant dequant;
+    glm::vec3 boundsMin{ 0.0f };
+    glm::vec3 boundsMax{ 0.0f };
+};
+
+// GPU-ready geometry, possibly pointing into a mapped mesh cache
+struct MeshView {
+    const unsigned char* vertices = nullptr;   // ModelVertexLayout::stride bytes each
+    size_t vertexCount = 0;
+    const unsigned int* indices = nullptr;
+    size_t indexCount = 0;
+    glm::vec3 boundsMin{ 0.0f };
+    glm::vec3 boundsMax{ 0.0f };
+    VertexDequant dequant;
+};
+
+// parses an OBJ (+ MTL) into outData on worker threads (see ObjParser.h);
+// identical corners share one vertex
+bool ImportOBJ(const std::string& objPath, MeshData& outData, const std::string& workingFolderFallback = "");
+// single-threaded tinyobj import, the reference ImportOBJ must match
+bool ImportOBJSerial(const std::string& objPath, MeshData& outData, const std::string& workingFolderFallback = "");
+
+// Reorders each submesh's triangles for the post-transform cache, then its clusters
+// against overdraw, then renumbers vertices in fetch order (see MeshOptimizer.h).
+// Submesh ranges keep their offsets and counts.
+void OptimizeMesh(MeshData& data);
+
+// Quadric-error LOD chain (see MeshSimplifier.h): each level halves the triangle
+// count of full detail again, simplified per submesh so material ranges and
+// attribute seams survive. Levels build in parallel, are cache-optimized and appended
+// to data.indices; vertices are shared with full detail. The chain stops early once
+// a level no longer shrinks or would deviate by more than a few percent of the mesh.
+// Call after OptimizeMesh.
+void BuildMeshLods(MeshData& data);
+
+// full-detail triangle count from which ClusterMesh builds meshlets; below it,
+// drawing the whole mesh costs less than culling it
+const size_t kMeshletMinTriangles = 16384;
+
+// Splits every full-detail submesh into meshlets (see Meshlet.h) and rewrites its
+// range in meshlet order, so clusters also stay local when drawn whole. Meshes
+// under kMeshletMinTriangles are left alone. Call after OptimizeMesh. The loaders
+// skip it: loaded models are drawn instanced (TreeInstancer), which culls per
+// instance, so only a caller drawing one model through MeshletCuller needs it.
+void ClusterMesh(MeshData& data);
+
+// computes bounds and packs data.vertices into data.packedVertices
+void QuantizeMesh(MeshData& data);
+MeshView ViewOf(const MeshData& data);
+
+// creates VAO/VBO/EBO from packed geometry (or copies it into 'arena', whose VAO
+// the mesh then uses) and copies bounds / dequant
+void UploadMeshBuffers(const MeshView& view, MeshGL_Model& outMesh, GeometryArena* arena = nullptr);
+// loads the diffuse textures into outMesh.materials (names only, no textures, when
+// loadTextures is false)
+void LoadMeshMaterials(const std::vector<MaterialSource>& materials, MeshGL_Model& outMesh, bool loadTextures = true);
+// UploadMeshBuffers + submeshes, LODs, meshlets + LoadMeshMaterials (data must be quantized)
+void UploadMesh(const MeshData& data, MeshGL_Model& outMesh, GeometryArena* arena = nullptr);
+
+// A mesh between PrepareOBJ (any thread) and UploadPreparedMesh (GL thread);
+// 'mesh' points into the mapped cache in 'file' or into 'data'
+struct PreparedMesh {
+    MappedFile file;
+    MeshData data;
+    MeshView mesh;
+    std::vector<SubMeshRange> submeshes;
+    std::vector<MeshLod> lods;
+    MeshletData meshlets;
+    std::vector<MaterialSource> materials;
+};
 
-bool LoadOBJWithMaterials(const std::string& objPath, MeshGL_Model& outMesh, const std::string& workingFolderFallback = "");
+// Maps "<objPath>.meshbin" when it matches the OBJ (see MeshCache.h); otherwise
+// ImportOBJ + OptimizeMesh + BuildMeshLods + QuantizeMesh, then writes
+// that cache. No GL calls.
+bool PrepareOBJ(const std::string& objPath, PreparedMesh& out, const std::string& workingFolderFallback = "");
+// UploadMeshBuffers + submeshes, LODs, meshlets + LoadMeshMaterials
+void UploadPreparedMesh(PreparedMesh& prepared, MeshGL_Model& outMesh, GeometryArena* arena = nullptr,
+    bool loadTextures = true);
+// PrepareOBJ + UploadPreparedMesh. With an arena (ModelVertexLayout) the geometry goes there.
+bool LoadOBJWithMaterials(const std::string& objPath, MeshGL_Model& outMesh, const std::string& workingFolderFallback = "",
+    GeometryArena* arena = nullptr);
 
 
-GLuint LoadTexture2D(const std::string& path, bool& outHasAlpha);
+// OBJ UVs start at the bottom, so images are flipped on load by default; glTF's
+// start at the top and load unflipped
+GLuint LoadTexture2D(const std::string& path, bool& outHasAlpha, bool flipVertically = true);
+// same for an encoded image (PNG, JPEG, ...) already in memory
+GLuint LoadTexture2DFromMemory(const unsigned char* data, size_t size, bool& outHasAlpha, bool flipVertically = true);
@@ -0,0 +1,357 @@
+// ObjParser.cpp
+#include "ObjParser.h"
+#include "MappedFile.h"
+#include "Parallel.h"
+#include "tiny_obj_loader.h"
+
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+// Corner indices as parsed: absolute 0-based indices are stored as is, relative
+// (negative) ones as chunk-local position - kRelative, since the chunk's base is
+// only known after the prefix sum; kMissing for an absent texcoord/normal.
+static const int32_t kMissing = INT32_MIN;
+static const int32_t kRelative = 1 << 30;
+static const uint32_t kEmptySlot = 0xFFFFFFFFu;
+
+struct ObjCorner {
+    int32_t v, t, n;
+    bool operator==(const ObjCorner& o) const { return v == o.v && t == o.t && n == o.n; }
+};
+
+struct ObjMaterialSwitch {
+    size_t triangle;        // chunk-local triangle the material applies from
+    std::string name;
+};
+
+struct ObjChunk {
+    std::vector<float> positions, normals, texcoords;
+    std::vector<ObjCorner> corners;           // 3 per triangle
+    std::vector<ObjMaterialSwitch> switches;
+    std::vector<std::string> mtllibs;         // argument string of each mtllib line
+};
+
+static bool IsBlank(char c) { return c == ' ' || c == '\t'; }
+
+static std::string FolderOf(const std::string& path) {
+    std::filesystem::path p(path);
+    if (p.has_parent_path()) return p.parent_path().string() + "/";
+    return "./";
+}
+
+// one whitespace-separated number; missing or malformed reads as 'fallback' (tinyobj)
+static const char* ParseFloat(const char* p, const char* end, float& out, float fallback) {
+    while (p < end && IsBlank(*p)) ++p;
+    const char* tokenEnd = p;
+    while (tokenEnd < end && !IsBlank(*tokenEnd)) ++tokenEnd;
+    const char* s = (p < tokenEnd && *p == '+') ? p + 1 : p;
+    double value = fallback;
+    if (std::from_chars(s, tokenEnd, value).ec != std::errc()) value = fallback;
+    out = (float)value;
+    return tokenEnd;
+}
+
+// atoi + tinyobj's fixIndex, advancing to the next '/' or blank
+static int32_t ParseIndex(const char*& p, const char* end, size_t count) {
+    const char* s = (p < end && *p == '+') ? p + 1 : p;
+    int value = 0;
+    std::from_chars(s, end, value);
+    while (p < end && *p != '/' && !IsBlank(*p)) ++p;
+    if (value > 0) return value - 1;
+    if (value == 0) return 0;
+    return (int32_t)count + value - kRelative;
+}
+
+static int32_t ResolveIndex(int32_t i, size_t base) {
+    if (i >= 0) return i;
+    if (i == kMissing) return -1;
+    return i + kRelative + (int32_t)base;
+}
+
+static void ParseChunk(const char* p, const char* end, ObjChunk& c) {
+    std::vector<ObjCorner> face;
+    while (p < end) {
+        const char* lineEnd = (const char*)std::memchr(p, '\n', (size_t)(end - p));
+        if (!lineEnd) lineEnd = end;
+        const char* q = p;
+        const char* e = lineEnd;
+        p = lineEnd < end ? lineEnd + 1 : end;
+        if (e > q && e[-1] == '\r') --e;
+        while (q < e && IsBlank(*q)) ++q;
+        if (q >= e || *q == '#') continue;
+        size_t len = (size_t)(e - q);
+
+        if (q[0] == 'v' && len > 1 && IsBlank(q[1])) {
+            float x, y, z;
+            q = ParseFloat(q + 2, e, x, 0.0f);
+            q = ParseFloat(q, e, y, 0.0f);
+            ParseFloat(q, e, z, 0.0f);
+            c.positions.insert(c.positions.end(), { x, y, z });
+        }
+        else if (q[0] == 'v' && len > 2 && q[1] == 'n' && IsBlank(q[2])) {
+            float x, y, z;
+            q = ParseFloat(q + 3, e, x, 0.0f);
+            q = ParseFloat(q, e, y, 0.0f);
+            ParseFloat(q, e, z, 0.0f);
+            c.normals.insert(c.normals.end(), { x, y, z });
+        }
+        else if (q[0] == 'v' && len > 2 && q[1] == 't' && IsBlank(q[2])) {
+            float u, v;
+            q = ParseFloat(q + 3, e, u, 0.0f);
+            ParseFloat(q, e, v, 0.0f);
+            c.texcoords.insert(c.texcoords.end(), { u, v });
+        }
+        else if (q[0] == 'f' && len > 1 && IsBlank(q[1])) {
+            size_t vCount = c.positions.size() / 3, nCount = c.normals.size() / 3, tCount = c.texcoords.size() / 2;
+            face.clear();
+            q += 2;
+            for (;;) {
+                while (q < e && IsBlank(*q)) ++q;
+                if (q >= e) break;
+                ObjCorner k{ kMissing, kMissing, kMissing };
+                k.v = ParseIndex(q, e, vCount);
+                if (q < e && *q == '/') {
+                    ++q;
+                    if (q < e && *q == '/') {           // i//k
+                        ++q;
+                        k.n = ParseIndex(q, e, nCount);
+                    }
+                    else {                              // i/j or i/j/k
+                        k.t = ParseIndex(q, e, tCount);
+                        if (q < e && *q == '/') {
+                            ++q;
+                            k.n = ParseIndex(q, e, nCount);
+                        }
+                    }
+                }
+                face.push_back(k);
+            }
+            // triangle fan, as tinyobj triangulates
+            for (size_t k = 2; k < face.size(); ++k)
+                c.corners.insert(c.corners.end(), { face[0], face[k - 1], face[k] });
+        }
+        else if (len > 6 && std::memcmp(q, "usemtl", 6) == 0 && IsBlank(q[6])) {
+            const char* s = q + 7;
+            while (s < e && IsBlank(*s)) ++s;
+            const char* nameEnd = s;
+            while (nameEnd < e && !IsBlank(*nameEnd)) ++nameEnd;
+            c.switches.push_back(ObjMaterialSwitch{ c.corners.size() / 3, std::string(s, nameEnd) });
+        }
+        else if (len > 6 && std::memcmp(q, "mtllib", 6) == 0 && IsBlank(q[6])) {
+            c.mtllibs.emplace_back(q + 7, e);
+        }
+    }
+}
+
+bool ParseOBJParallel(const std::string& path, MeshData& outData,
+    const std::string& workingFolderFallback, ObjParseStats* stats)
+{
+    auto t0 = std::chrono::high_resolution_clock::now();
+    MappedFile file;
+    if (!file.Open(path)) return false;
+    std::string folder = FolderOf(path);
+    if (folder.empty() && !workingFolderFallback.empty()) folder = workingFolderFallback;
+
+    // chunk boundaries snapped to the start of the next line
+    const char* text = (const char*)file.Data();
+    const size_t size = file.Size();
+    const size_t kMinChunkBytes = 1 << 20;
+    size_t chunkCount = std::max<size_t>(1, std::min<size_t>(size / kMinChunkBytes, WorkerThreadCount() * 4));
+    std::vector<size_t> bounds(chunkCount + 1, size);
+    bounds[0] = 0;
+    for (size_t c = 1; c < chunkCount; ++c) {
+        size_t at = std::max(bounds[c - 1], size / chunkCount * c);
+        const char* nl = at < size ? (const char*)std::memchr(text + at, '\n', size - at) : nullptr;
+        bounds[c] = nl ? (size_t)(nl - text) + 1 : size;
+    }
+
+    std::vector<ObjChunk> chunks(chunkCount);
+    ParallelFor(chunkCount, [&](size_t c) { ParseChunk(text + bounds[c], text + bounds[c + 1], chunks[c]); });
+    auto t1 = std::chrono::high_resolution_clock::now();
+
+    // prefix sums: where each chunk's attributes and triangles land
+    std::vector<size_t> posBase(chunkCount + 1, 0), nrmBase(chunkCount + 1, 0), uvBase(chunkCount + 1, 0), triBase(chunkCount + 1, 0);
+    for (size_t c = 0; c < chunkCount; ++c) {
+        posBase[c + 1] = posBase[c] + chunks[c].positions.size() / 3;
+        nrmBase[c + 1] = nrmBase[c] + chunks[c].normals.size() / 3;
+        uvBase[c + 1] = uvBase[c] + chunks[c].texcoords.size() / 2;
+        triBase[c + 1] = triBase[c] + chunks[c].corners.size() / 3;
+    }
+    std::vector<float> positions(posBase[chunkCount] * 3), normals(nrmBase[chunkCount] * 3), texcoords(uvBase[chunkCount] * 2);
+    std::vector<ObjCorner> corners(triBase[chunkCount] * 3);
+    ParallelFor(chunkCount, [&](size_t c) {
+        const ObjChunk& ch = chunks[c];
+        std::copy(ch.positions.begin(), ch.positions.end(), positions.begin() + posBase[c] * 3);
+        std::copy(ch.normals.begin(), ch.normals.end(), normals.begin() + nrmBase[c] * 3);
+        std::copy(ch.texcoords.begin(), ch.texcoords.end(), texcoords.begin() + uvBase[c] * 2);
+        ObjCorner* dst = corners.data() + triBase[c] * 3;
+        for (const ObjCorner& k : ch.corners) {
+            *dst++ = ObjCorner{ ResolveIndex(k.v, posBase[c]), ResolveIndex(k.t, uvBase[c]), ResolveIndex(k.n, nrmBase[c]) };
+        }
+    });
+
+    // materials (tinyobj's MTL reader), then submeshes from the usemtl switches
+    std::vector<tinyobj::material_t> materials;
+    std::map<std::string, int> materialMap;
+    std::string err;
+    // through MappedFile, so .mtl files come out of the asset pack too
+    auto readMtl = [&](const std::string& name) {
+        MappedFile mtl;
+        if (!mtl.Open(folder + name, true)) {
+            err += "WARN: Material file [ " + folder + name + " ] not found.\n";
+            return false;
+        }
+        std::istringstream stream(std::string((const char*)mtl.Data(), mtl.Size()));
+        std::string warning;
+        tinyobj::LoadMtl(&materialMap, &materials, &stream, &warning);
+        err += warning;
+        return true;
+    };
+    for (const ObjChunk& ch : chunks) {
+        for (const std::string& line : ch.mtllibs) {
+            bool found = false;
+            size_t start = 0;
+            while (!found && start <= line.size()) {
+                size_t space = line.find(' ', start);
+                if (space == std::string::npos) space = line.size();
+                std::string name = line.substr(start, space - start);
+                if (!name.empty()) found = readMtl(name);
+                start = space + 1;
+            }
+            if (!found) err += "WARN: Failed to load material file(s). Use default material.\n";
+        }
+    }
+    if (!err.empty()) std::cerr << "ParseOBJParallel: " << err << "\n";
+
+    std::vector<SubMeshRange>& submeshes = outData.submeshes;
+    submeshes.clear();
+    auto addRun = [&](size_t firstTri, size_t endTri, int materialId) {
+        if (endTri <= firstTri) return;
+        if (!submeshes.empty() && submeshes.back().materialId == materialId) {
+            submeshes.back().indexCount += (endTri - firstTri) * 3;
+            return;
+        }
+        SubMeshRange r;
+        r.materialId = materialId;
+        r.indexOffset = firstTri * 3;
+        r.indexCount = (endTri - firstTri) * 3;
+        submeshes.push_back(r);
+    };
+    size_t runStart = 0;
+    int material = -1;
+    for (size_t c = 0; c < chunkCount; ++c) {
+        for (const ObjMaterialSwitch& sw : chunks[c].switches) {
+            size_t tri = triBase[c] + sw.triangle;
+            addRun(runStart, tri, material);
+            runStart = tri;
+            auto it = materialMap.find(sw.name);
+            material = it != materialMap.end() ? it->second : -1;
+        }
+    }
+    addRun(runStart, triBase[chunkCount], material);
+    chunks.clear();
+
+    // Vertex dedup. Each worker owns the corners whose hash falls in its bucket and
+    // scans the whole corner list in order, so every corner learns the first corner
+    // with the same key exactly as a sequential pass would.
+    const size_t cornerCount = corners.size();
+    std::vector<uint64_t> hashes(cornerCount);
+    const size_t kBlock = 1 << 16;
+    ParallelFor((cornerCount + kBlock - 1) / kBlock, [&](size_t b) {
+        size_t end = std::min(cornerCount, (b + 1) * kBlock);
+        for (size_t i = b * kBlock; i < end; ++i) {
+            uint64_t h = (uint64_t)(uint32_t)corners[i].v * 0x9E3779B97F4A7C15ull;
+            h ^= ((uint64_t)(uint32_t)corners[i].t + (h << 6) + (h >> 2)) * 0xBF58476D1CE4E5B9ull;
+            h ^= ((uint64_t)(uint32_t)corners[i].n + (h << 6) + (h >> 2)) * 0x94D049BB133111EBull;
+            hashes[i] = h ^ (h >> 31);
+        }
+    });
+    const unsigned owners = WorkerThreadCount();
+    std::vector<uint32_t> firstCorner(cornerCount);
+    ParallelFor(owners, [&](size_t o) {
+        size_t owned = 0;
+        for (uint64_t h : hashes) owned += (uint32_t)h % owners == o;
+        size_t capacity = 16;
+        while (capacity < owned * 2) capacity *= 2;
+        std::vector<uint32_t> table(capacity, kEmptySlot);
+        for (size_t i = 0; i < cornerCount; ++i) {
+            if ((uint32_t)hashes[i] % owners != o) continue;
+            size_t slot = (size_t)(hashes[i] >> 32) & (capacity - 1);
+            for (;;) {
+                uint32_t e = table[slot];
+                if (e == kEmptySlot) {
+                    table[slot] = (uint32_t)i;
+                    firstCorner[i] = (uint32_t)i;
+                    break;
+                }
+                if (corners[e] == corners[i]) {
+                    firstCorner[i] = e;
+                    break;
+                }
+                slot = (slot + 1) & (capacity - 1);
+            }
+        }
+    });
+    hashes.clear();
+    hashes.shrink_to_fit();
+
+    std::vector<unsigned int>& indices = outData.indices;
+    indices.resize(cornerCount);
+    std::vector<uint32_t> vertexCorner;
+    vertexCorner.reserve(cornerCount / 4 + 16);
+    for (size_t i = 0; i < cornerCount; ++i) {
+        if (firstCorner[i] == i) {
+            indices[i] = (unsigned int)vertexCorner.size();
+            vertexCorner.push_back((uint32_t)i);
+        }
+        else {
+            indices[i] = indices[firstCorner[i]];
+        }
+    }
+
+    std::vector<ModelVertex>& vertices = outData.vertices;
+    vertices.assign(vertexCorner.size(), ModelVertex{});
+    const size_t posCount = positions.size() / 3, nrmCount = normals.size() / 3, uvCount = texcoords.size() / 2;
+    ParallelFor((vertices.size() + kBlock - 1) / kBlock, [&](size_t b) {
+        size_t end = std::min(vertices.size(), (b + 1) * kBlock);
+        for (size_t i = b * kBlock; i < end; ++i) {
+            const ObjCorner& k = corners[vertexCorner[i]];
+            ModelVertex& vert = vertices[i];
+            if (k.v >= 0 && (size_t)k.v < posCount) {
+                vert.px = positions[3 * k.v + 0];
+                vert.py = positions[3 * k.v + 1];
+                vert.pz = positions[3 * k.v + 2];
+            }
+            if (k.n >= 0 && (size_t)k.n < nrmCount) {
+                vert.nx = normals[3 * k.n + 0];
+                vert.ny = normals[3 * k.n + 1];
+                vert.nz = normals[3 * k.n + 2];
+            }
+            if (k.t >= 0 && (size_t)k.t < uvCount) {
+                vert.u = texcoords[2 * k.t + 0];
+                vert.v = texcoords[2 * k.t + 1];
+            }
+        }
+    });
+
+    outData.materials.resize(materials.size());
+    for (size_t i = 0; i < materials.size(); ++i) {
+        outData.materials[i].name = materials[i].name;
+        outData.materials[i].diffusePath = materials[i].diffuse_texname.empty() ? "" : folder + materials[i].diffuse_texname;
+    }
+
+    auto t2 = std::chrono::high_resolution_clock::now();
+    if (stats) {
+        stats->bytes = size;
+        stats->chunks = chunkCount;
+        stats->parseMs = std::chrono::duration<double, std::milli>(t1 - t0).count();
+        stats->mergeMs = std::chrono::duration<double, std::milli>(t2 - t1).count();
+    }
+    return true;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+// ObjParser.h - multithreaded OBJ parser producing the same MeshData as tinyobj
+#include <string>
+#include "ModelLoader.h"
+
+struct ObjParseStats {
+    size_t bytes = 0;
+    size_t chunks = 0;
+    double parseMs = 0.0;   // parallel text parsing
+    double mergeMs = 0.0;   // prefix sums, index fix-up, vertex dedup
+};
+
+// Maps the file, splits it at line boundaries into chunks parsed on worker threads
+// (floats via std::from_chars), then merges the chunks with prefix sums over their
+// v/vn/vt/triangle counts. Handles v, vn, vt, f (fan-triangulated, negative
+// indices), usemtl and mtllib; everything else is skipped like tinyobj does.
+// Identical corners share one vertex, numbered in first-use order, so the result
+// matches ImportOBJSerial. Deviations from tinyobj: usemtl is resolved against all
+// mtllibs of the file (tinyobj only sees the ones above it) and out-of-range
+// indices read as zero instead of out of bounds.
+bool ParseOBJParallel(const std::string& objPath, MeshData& outData,
+    const std::string& workingFolderFallback = "", ObjParseStats* stats = nullptr);
@@ -0,0 +1,128 @@
+#pragma once
+
+// Parallel.h - tiny fork/join helper for CPU-side batch work (scattering, sims...)
+// on a pool of worker threads started once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+inline unsigned WorkerThreadCount() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n == 0 ? 4u : n;
+}
+
+// one ParallelFor call, on its caller's stack until every claimed item is done
+struct ParallelJob {
+    void (*call)(void* fn, size_t i) = nullptr;
+    void* fn = nullptr;
+    size_t count = 0;
+    std::atomic<size_t> next{ 0 };
+    unsigned helpersLeft = 0;       // pool threads that may still join; under the pool mutex
+    unsigned active = 0;            // pool threads working on it; under the pool mutex
+
+    void Work() {
+        for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) call(fn, i);
+    }
+};
+
+// WorkerThreadCount() - 1 threads (the caller of ParallelFor works too). Callers never
+// wait for an item nobody has started: they run whatever is left themselves, so calls
+// from several threads at once, or from inside an item, cannot deadlock.
+class WorkerPool {
+public:
+    static WorkerPool& Instance() {
+        static WorkerPool pool;
+        return pool;
+    }
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    size_t ThreadCount() const { return threads.size(); }
+
+    void Run(ParallelJob& job) {
+        unsigned helpers = job.helpersLeft; // pool threads may change it once queued
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(&job);
+        }
+        if (helpers == 1) wake.notify_one();
+        else wake.notify_all();
+
+        job.Work();
+
+        std::unique_lock<std::mutex> lock(mutex);
+        auto it = std::find(queue.begin(), queue.end(), &job);
+        if (it != queue.end()) queue.erase(it);
+        done.wait(lock, [&] { return job.active == 0; });
+    }
+
+private:
+    WorkerPool() {
+        unsigned n = WorkerThreadCount();
+        for (unsigned t = 1; t < n; ++t) threads.emplace_back([this] { Loop(); });
+    }
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& t : threads) t.join();
+    }
+
+    void Loop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            wake.wait(lock, [&] { return stopping || !queue.empty(); });
+            if (stopping) return;
+            ParallelJob* job = queue.front();
+            if (job->helpersLeft == 0 || job->next.load() >= job->count) {
+                queue.pop_front(); // nothing left to help with; its caller finishes it
+                continue;
+            }
+            --job->helpersLeft;
+            ++job->active;
+            lock.unlock();
+            job->Work();
+            lock.lock();
+            if (--job->active == 0) done.notify_all();
+        }
+    }
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake;   // work queued, or stopping
+    std::condition_variable done;   // a job's last helper left
+    std::deque<ParallelJob*> queue;
+    bool stopping = false;
+};
+
+// Calls fn(i) for every i in [0, count) spread over the worker pool, at most
+// maxThreads at once (0: all of them) counting the calling thread.
+// Items are claimed dynamically, so fn must not depend on execution order;
+// write results into per-item slots to keep the output deterministic.
+template <typename Fn>
+void ParallelFor(size_t count, Fn&& fn, unsigned maxThreads = 0) {
+    if (count == 0) return;
+    WorkerPool& pool = WorkerPool::Instance();
+    size_t threads = std::min<size_t>(pool.ThreadCount() + 1, count);
+    if (maxThreads) threads = std::min<size_t>(threads, maxThreads);
+    if (threads <= 1) {
+        for (size_t i = 0; i < count; ++i) fn(i);
+        return;
+    }
+
+    using F = std::remove_reference_t<Fn>;
+    ParallelJob job;
+    job.call = [](void* f, size_t i) { (*(F*)f)(i); };
+    job.fn = (void*)&fn;
+    job.count = count;
+    job.helpersLeft = (unsigned)threads - 1;
+    pool.Run(job);
+}
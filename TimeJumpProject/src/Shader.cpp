@@ -1,22 +1,62 @@
 #include <glad/glad.h>
 #include "Shader.h"
-#include <fstream>
-#include <sstream>
+#include "MappedFile.h"
+#include "SourceFile.h"
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 
+// whether a uniform of GL type "type" takes a value of "kind"
+static bool Accepts(UniformKind kind, GLenum type) {
+    switch (kind) {
+    case UniformKind::Bool:  return type == GL_BOOL || type == GL_INT;
+    case UniformKind::Float: return type == GL_FLOAT;
+    case UniformKind::Vec2:  return type == GL_FLOAT_VEC2;
+    case UniformKind::Vec3:  return type == GL_FLOAT_VEC3;
+    case UniformKind::Vec4:  return type == GL_FLOAT_VEC4;
+    case UniformKind::Mat4:  return type == GL_FLOAT_MAT4;
+    case UniformKind::Int:
+        switch (type) {
+        // glUniform1i sets int and bool scalars and samplers; not these
+        case GL_FLOAT: case GL_FLOAT_VEC2: case GL_FLOAT_VEC3: case GL_FLOAT_VEC4:
+        case GL_FLOAT_MAT2: case GL_FLOAT_MAT3: case GL_FLOAT_MAT4:
+        case GL_FLOAT_MAT2x3: case GL_FLOAT_MAT2x4: case GL_FLOAT_MAT3x2:
+        case GL_FLOAT_MAT3x4: case GL_FLOAT_MAT4x2: case GL_FLOAT_MAT4x3:
+        case GL_INT_VEC2: case GL_INT_VEC3: case GL_INT_VEC4:
+        case GL_BOOL_VEC2: case GL_BOOL_VEC3: case GL_BOOL_VEC4:
+        case GL_UNSIGNED_INT: case GL_UNSIGNED_INT_VEC2: case GL_UNSIGNED_INT_VEC3: case GL_UNSIGNED_INT_VEC4:
+            return false;
+        default:
+            return true;
+        }
+    }
+    return false;
+}
+
+static const char* KindName(UniformKind kind) {
+    switch (kind) {
+    case UniformKind::Bool:  return "bool";
+    case UniformKind::Int:   return "int";
+    case UniformKind::Float: return "float";
+    case UniformKind::Vec2:  return "vec2";
+    case UniformKind::Vec3:  return "vec3";
+    case UniformKind::Vec4:  return "vec4";
+    case UniformKind::Mat4:  return "mat4";
+    }
+    return "?";
+}
+
 Shader::~Shader() {
     if (ID) glDeleteProgram(ID);
 }
 
 std::string Shader::ReadFile(const std::string& path) {
-    std::ifstream file(path);
-    if (!file.is_open()) {
+    MappedFile file;
+    if (!file.Open(path, true)) {
         std::cerr << "Shader: failed to open " << path << "\n";
         return {};
     }
-    std::stringstream ss;
-    ss << file.rdbuf();
-    return ss.str();
+    return std::string((const char*)file.Data(), file.Size());
 }
 
 unsigned int Shader::CompileShader(unsigned int type, const std::string& source) {
@@ -36,6 +76,8 @@ unsigned int Shader::CompileShader(unsigned int type, const std::string& source)
 }
 
 bool Shader::LoadFromFiles(const std::string& vertexPath, const std::string& fragmentPath) {
+    uniforms.clear();
+    byHash.clear();
     std::string vsrc = ReadFile(vertexPath);
     std::string fsrc = ReadFile(fragmentPath);
     if (vsrc.empty() || fsrc.empty()) return false;
@@ -58,25 +100,129 @@ bool Shader::LoadFromFiles(const std::string& vertexPath, const std::string& fra
 
     glDeleteShader(vert);
     glDeleteShader(frag);
+    if (success) ReflectUniforms();
     return success;
 }
 
+void Shader::ReflectUniforms() {
+    GLint count = 0, maxLength = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    std::vector<char> name(std::max(maxLength, 1));
+    for (GLint i = 0; i < count; ++i) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(ID, (GLuint)i, (GLsizei)name.size(), &length, &size, &type, name.data());
+        std::string n(name.data(), length);
+        // -1 for uniform block members: those are set through their buffer
+        int location = glGetUniformLocation(ID, n.c_str());
+        int index = AddUniform(n, location, type);
+        // arrays are listed as "name[0]"; plain "name" is the same element, so it shares
+        // the slot (and the cached value)
+        if (n.size() > 3 && n.compare(n.size() - 3, 3, "[0]") == 0)
+            IndexName(n.substr(0, n.size() - 3).c_str(), index);
+    }
+}
+
+int Shader::AddUniform(const std::string& name, int location, unsigned int type) const {
+    UniformSlot slot;
+    slot.name = name;
+    slot.location = location;
+    slot.type = type;
+    int index = (int)uniforms.size();
+    uniforms.push_back(std::move(slot));
+    IndexName(name.c_str(), index);
+    return index;
+}
+
+void Shader::IndexName(const char* name, int index) const {
+    std::pair<uint64_t, int> key(Fnv1a(name, std::strlen(name)), index);
+    byHash.insert(std::upper_bound(byHash.begin(), byHash.end(), key), key);
+}
+
+// the slot's own name, or "name" for an array's "name[0]"
+static bool NameMatches(const std::string& slotName, const char* name) {
+    size_t n = std::strlen(name);
+    if (slotName.size() == n) return slotName.compare(name) == 0;
+    return slotName.size() == n + 3 && slotName.compare(0, n, name) == 0 && slotName.compare(n, 3, "[0]") == 0;
+}
+
+int Shader::Find(const char* name) const {
+    const uint64_t hash = Fnv1a(name, std::strlen(name));
+    auto it = std::lower_bound(byHash.begin(), byHash.end(), std::make_pair(hash, -1));
+    for (; it != byHash.end() && it->first == hash; ++it) {
+        if (NameMatches(uniforms[it->second].name, name)) return it->second;
+    }
+    if (!ID) return -1;
+    // not listed by reflection: an array element ("uCascades[2]") or a name the program
+    // lacks; either way the driver is asked only this once
+    return AddUniform(name, glGetUniformLocation(ID, name), 0);
+}
+
+int Shader::Resolve(const char* name, UniformKind kind) const {
+    int index = Find(name);
+    if (index < 0 || uniforms[index].location < 0) return -1;
+    unsigned int type = uniforms[index].type;
+    if (type != 0 && !Accepts(kind, type)) {
+        std::cerr << "Shader: uniform " << name << " is not a " << KindName(kind) << "\n";
+        return -1;
+    }
+    return index;
+}
+
+bool Shader::Changed(int index, const void* value, size_t size) const {
+    if (index < 0 || index >= (int)uniforms.size()) return false;
+    UniformSlot& u = uniforms[index];
+    if (u.location < 0) return false;
+    if (u.known && std::memcmp(u.value, value, size) == 0) return false;
+    std::memcpy(u.value, value, size);
+    u.known = true;
+    return true;
+}
+
 void Shader::Use() const {
     glUseProgram(ID);
 }
 
-void Shader::SetBool(const std::string& name, bool value) const {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+void Shader::Set(UniformHandle<bool> u, bool value) const {
+    int v = value;
+    if (Changed(u.index, &v, sizeof(v))) glUniform1i(uniforms[u.index].location, v);
+}
+void Shader::Set(UniformHandle<int> u, int value) const {
+    if (Changed(u.index, &value, sizeof(value))) glUniform1i(uniforms[u.index].location, value);
+}
+void Shader::Set(UniformHandle<float> u, float value) const {
+    if (Changed(u.index, &value, sizeof(value))) glUniform1f(uniforms[u.index].location, value);
+}
+void Shader::Set(UniformHandle<glm::vec2> u, const glm::vec2& value) const {
+    if (Changed(u.index, &value, sizeof(value))) glUniform2fv(uniforms[u.index].location, 1, &value[0]);
+}
+void Shader::Set(UniformHandle<glm::vec3> u, const glm::vec3& value) const {
+    if (Changed(u.index, &value, sizeof(value))) glUniform3fv(uniforms[u.index].location, 1, &value[0]);
+}
+void Shader::Set(UniformHandle<glm::vec4> u, const glm::vec4& value) const {
+    if (Changed(u.index, &value, sizeof(value))) glUniform4fv(uniforms[u.index].location, 1, &value[0]);
+}
+void Shader::Set(UniformHandle<glm::mat4> u, const glm::mat4& value) const {
+    if (Changed(u.index, &value, sizeof(value))) glUniformMatrix4fv(uniforms[u.index].location, 1, GL_FALSE, &value[0][0]);
+}
+
+void Shader::SetBool(const char* name, bool value) const {
+    Set(UniformHandle<bool>{ Find(name) }, value);
+}
+void Shader::SetInt(const char* name, int value) const {
+    Set(UniformHandle<int>{ Find(name) }, value);
 }
-void Shader::SetInt(const std::string& name, int value) const {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+void Shader::SetFloat(const char* name, float value) const {
+    Set(UniformHandle<float>{ Find(name) }, value);
 }
-void Shader::SetFloat(const std::string& name, float value) const {
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+void Shader::SetVec2(const char* name, const glm::vec2& value) const {
+    Set(UniformHandle<glm::vec2>{ Find(name) }, value);
 }
-void Shader::SetVec3(const std::string& name, const glm::vec3& value) const {
-    glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+void Shader::SetVec3(const char* name, const glm::vec3& value) const {
+    Set(UniformHandle<glm::vec3>{ Find(name) }, value);
 }
-void Shader::SetMat4(const std::string& name, const glm::mat4& mat) const {
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+void Shader::SetMat4(const char* name, const glm::mat4& mat) const {
+    Set(UniformHandle<glm::mat4>{ Find(name) }, mat);
 }
@@ -1,6 +1,28 @@
 #pragma once
 #include <glm/glm.hpp>
+#include <cstdint>
 #include <string>
+#include <utility>
+#include <vector>
+
+enum class UniformKind { Bool, Int, Float, Vec2, Vec3, Vec4, Mat4 };
+
+template<typename T> struct UniformKindOf;
+template<> struct UniformKindOf<bool> { static constexpr UniformKind value = UniformKind::Bool; };
+template<> struct UniformKindOf<int> { static constexpr UniformKind value = UniformKind::Int; };
+template<> struct UniformKindOf<float> { static constexpr UniformKind value = UniformKind::Float; };
+template<> struct UniformKindOf<glm::vec2> { static constexpr UniformKind value = UniformKind::Vec2; };
+template<> struct UniformKindOf<glm::vec3> { static constexpr UniformKind value = UniformKind::Vec3; };
+template<> struct UniformKindOf<glm::vec4> { static constexpr UniformKind value = UniformKind::Vec4; };
+template<> struct UniformKindOf<glm::mat4> { static constexpr UniformKind value = UniformKind::Mat4; };
+
+// A uniform looked up once (Shader::Uniform) and set through Shader::Set from then on.
+// Empty when the program lacks it; valid until the shader is loaded again.
+template<typename T>
+struct UniformHandle {
+    int index = -1;     // into the shader's uniform table
+    explicit operator bool() const { return index >= 0; }
+};
 
 class Shader {
 public:
@@ -8,17 +30,58 @@ public:
     Shader() = default;
     ~Shader();
 
+    // compiles and links, then reads the program's active uniforms into a table, so
+    // setting one never asks the driver where it is
     bool LoadFromFiles(const std::string& vertexPath, const std::string& fragmentPath);
     void Use() const;
 
-    // uniform helpers
-    void SetBool(const std::string& name, bool value) const;
-    void SetInt(const std::string& name, int value) const;
-    void SetFloat(const std::string& name, float value) const;
-    void SetVec3(const std::string& name, const glm::vec3& value) const;
-    void SetMat4(const std::string& name, const glm::mat4& mat) const;
+    // The uniform "name" ("uView", "spot.color"), or an empty handle when the program
+    // has none (not declared, or optimised out) or it is not a T. Int handles also
+    // take samplers and bools.
+    template<typename T>
+    UniformHandle<T> Uniform(const char* name) const { return { Resolve(name, UniformKindOf<T>::value) }; }
+
+    // The program must be in use, as for glUniform. A value the uniform already holds
+    // is not sent again; empty handles are ignored.
+    void Set(UniformHandle<bool> u, bool value) const;
+    void Set(UniformHandle<int> u, int value) const;
+    void Set(UniformHandle<float> u, float value) const;
+    void Set(UniformHandle<glm::vec2> u, const glm::vec2& value) const;
+    void Set(UniformHandle<glm::vec3> u, const glm::vec3& value) const;
+    void Set(UniformHandle<glm::vec4> u, const glm::vec4& value) const;
+    void Set(UniformHandle<glm::mat4> u, const glm::mat4& value) const;
+
+    // by name: a lookup in the table (no allocation), then as Set
+    void SetBool(const char* name, bool value) const;
+    void SetInt(const char* name, int value) const;
+    void SetFloat(const char* name, float value) const;
+    void SetVec2(const char* name, const glm::vec2& value) const;
+    void SetVec3(const char* name, const glm::vec3& value) const;
+    void SetMat4(const char* name, const glm::mat4& mat) const;
 
 private:
+    struct UniformSlot {
+        std::string name;
+        int location;           // -1: not settable (absent, or in a uniform block)
+        unsigned int type;      // GL type; 0 when found by name only (array elements)
+        bool known = false;     // value holds what the program has
+        alignas(16) unsigned char value[sizeof(glm::mat4)];
+    };
+
     std::string ReadFile(const std::string& path);
     unsigned int CompileShader(unsigned int type, const std::string& source);
+    void ReflectUniforms();
+    int AddUniform(const std::string& name, int location, unsigned int type) const;
+    void IndexName(const char* name, int index) const;
+    // table index for name; names reflection did not list are asked of the driver once
+    int Find(const char* name) const;
+    int Resolve(const char* name, UniformKind kind) const;
+    // records value; false when the uniform already holds it or cannot be set
+    bool Changed(int index, const void* value, size_t size) const;
+
+    // handles index uniforms, which only grows; byHash is (name hash, index) sorted, for
+    // lookups, one entry per name a slot answers to. Mutable: unlisted names are added
+    // as they are asked for, values cached.
+    mutable std::vector<UniformSlot> uniforms;
+    mutable std::vector<std::pair<uint64_t, int>> byHash;
 };
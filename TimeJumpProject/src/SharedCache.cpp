@@ -0,0 +1,110 @@
+// SharedCache.cpp
+#include "SharedCache.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+static std::string cacheFolder;                 // empty: off; set before loading starts
+static std::atomic<uint64_t> cacheBytes{ 0 };   // this process's view: what it found plus what it wrote
+
+static std::string EntryPath(uint64_t key) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx", (unsigned long long)key);
+    return (std::filesystem::path(cacheFolder) / name).string();
+}
+
+bool EnableSharedCache(const std::string& folder) {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    fs::path dir = folder;
+    if (dir.empty()) {
+        fs::path base = fs::is_directory("/dev/shm", ec) ? fs::path("/dev/shm") : fs::temp_directory_path(ec);
+        if (ec) {
+            std::cerr << "SharedCache: no temp folder: " << ec.message() << "\n";
+            return false;
+        }
+        dir = base / ("timejump-cache-v" + std::to_string(kSharedCacheVersion));
+    }
+    fs::create_directories(dir, ec);
+    if (!fs::is_directory(dir, ec)) {
+        std::cerr << "SharedCache: cannot create " << dir.string() << "\n";
+        return false;
+    }
+
+    // size what is there; half-written entries an hour old were left by a crash
+    const auto stale = fs::file_time_type::clock::now() - std::chrono::hours(1);
+    uint64_t bytes = 0;
+    for (const fs::directory_entry& e : fs::directory_iterator(dir, ec)) {
+        std::error_code fec;
+        if (!e.is_regular_file(fec)) continue;
+        if (e.path().extension() == ".tmp" && e.last_write_time(fec) < stale) {
+            fs::remove(e.path(), fec);
+            continue;
+        }
+        uint64_t n = e.file_size(fec);
+        if (!fec) bytes += n;
+    }
+    cacheBytes = bytes;
+    cacheFolder = dir.string();
+    return true;
+}
+
+bool SharedCacheEnabled() {
+    return !cacheFolder.empty();
+}
+
+const std::string& SharedCacheFolder() {
+    return cacheFolder;
+}
+
+uint64_t SharedKey(uint64_t key, uint64_t v) {
+    return Fnv1aMix(key, v);
+}
+
+uint64_t SharedKey(uint64_t key, const void* data, size_t size) {
+    return Fnv1a(data, size, key);
+}
+
+bool OpenSharedEntry(uint64_t key, MappedFile& file) {
+    if (cacheFolder.empty()) return false;
+    std::string path = EntryPath(key);
+    std::error_code ec;
+    if (!std::filesystem::exists(path, ec)) return false;
+    return file.Open(path, true);
+}
+
+bool WriteSharedEntry(uint64_t key, const std::vector<SharedPart>& parts) {
+    namespace fs = std::filesystem;
+    if (cacheFolder.empty()) return false;
+    uint64_t total = 0;
+    for (const SharedPart& p : parts) total += p.size;
+    if (cacheBytes + total > kSharedCacheMaxBytes) return false;
+
+    // a name of its own per writer: two processes storing the same key never share a temp file
+    std::random_device rd;
+    std::string path = EntryPath(key);
+    std::string tmpPath = path + "." + std::to_string(((uint64_t)rd() << 32) | rd()) + ".tmp";
+    std::ofstream f(tmpPath, std::ios::binary | std::ios::trunc);
+    for (const SharedPart& p : parts) {
+        if (p.size) f.write((const char*)p.data, (std::streamsize)p.size);
+    }
+    f.close();
+    std::error_code ec;
+    if (!f) {
+        std::cerr << "SharedCache: cannot write " << tmpPath << "\n";
+        fs::remove(tmpPath, ec);
+        return false;
+    }
+    fs::rename(tmpPath, path, ec);
+    if (ec) {
+        fs::remove(tmpPath, ec);
+        return false;
+    }
+    cacheBytes += total;
+    return true;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+// SharedCache.h - decoded asset data shared by every instance running on the host: one
+// file per asset hash in a shared-memory folder (/dev/shm on Linux, the temp folder
+// elsewhere). The first process to decode an asset writes its entry; the others map it
+// read-only, so the OS keeps one copy of those pages for all of them. Off until enabled.
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+#include "SourceFile.h"
+
+const uint32_t kSharedCacheVersion = 1;                 // part of the folder name
+const uint64_t kSharedCacheMaxBytes = 2048ull << 20;    // no new entries past this
+const size_t kSharedCacheMinBytes = 64 * 1024;          // smaller data is cheaper to redo
+
+struct SharedPart {
+    const void* data;
+    size_t size;
+};
+
+// folder empty: the default location; false (cache stays off) if it cannot be made
+bool EnableSharedCache(const std::string& folder = "");
+bool SharedCacheEnabled();
+const std::string& SharedCacheFolder();
+
+// mixes v into a running key (FNV-1a over its bytes); start from kSharedKeySeed
+const uint64_t kSharedKeySeed = kFnv1aSeed;
+uint64_t SharedKey(uint64_t key, uint64_t v);
+uint64_t SharedKey(uint64_t key, const void* data, size_t size);
+
+// maps the entry stored under key; false if there is none or the cache is off
+bool OpenSharedEntry(uint64_t key, MappedFile& file);
+// stores the parts back to back as key's entry. Entries appear whole (written aside,
+// then renamed), and processes racing on one key write the same bytes, so any thread
+// of any process may call this; false when off, full or the write fails.
+bool WriteSharedEntry(uint64_t key, const std::vector<SharedPart>& parts);
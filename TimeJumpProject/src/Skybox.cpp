@@ -1,11 +1,11 @@
 #include "Skybox.h"
-#include <stb_image.h>
+#include "TextureManager.h"
 #include <iostream>
 
 Skybox::~Skybox() {
     if (VAO) glDeleteVertexArrays(1, &VAO);
     if (VBO) glDeleteBuffers(1, &VBO);
-    if (cubemapTex) glDeleteTextures(1, &cubemapTex);
+    TextureManager::Instance().Release(cubemapTex);
 }
 
 bool Skybox::BuildCube() {
@@ -70,51 +70,50 @@ bool Skybox::Load(const std::vector<std::string>& faces) {
         return false;
     }
 
-    if (!BuildCube()) return false;
-
-    glGenTextures(1, &cubemapTex);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTex);
-    std::cerr << cubemapTex;
-    int w, h, n;
-    stbi_set_flip_vertically_on_load(false);
-    for (unsigned int i = 0; i < faces.size(); ++i) {
-        unsigned char* data = stbi_load(faces[i].c_str(), &w, &h, &n, 0);
-        if (data) {
-            GLenum format = (n == 3) ? GL_RGB : GL_RGBA;
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, format, w, h, 0, format, GL_UNSIGNED_BYTE, data);
-            stbi_image_free(data);
-        }
-        else {
-            std::cerr << "Failed to load cubemap face: " << faces[i] << "\n";
-            stbi_image_free(data);
-            return false;
-        }
-    }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
-    return true;
+    GLuint tex = TextureManager::Instance().LoadCubemap(faces, CubemapOptions());
+    if (!tex) return false;
+    bool ok = SetCubemap(tex);
+    TextureManager::Instance().Release(tex); // SetCubemap holds its own reference
+    return ok;
 }
 
-void Skybox::Draw(unsigned int shaderID, GLuint overrideCubemap) {
-    glDepthFunc(GL_LEQUAL);
-    glUseProgram(shaderID);
+TextureOptions Skybox::CubemapOptions() {
+    TextureOptions options;
+    options.flipVertically = false;
+    options.mipmaps = false;
+    options.wrap = GL_CLAMP_TO_EDGE;
+    return options;
+}
 
-    // set expected sampler uniforms explicitly (defensive)
-    GLint locSky = glGetUniformLocation(shaderID, "skybox");
-    if (locSky >= 0) glUniform1i(locSky, 0);   // samplerCube bound to unit 0
+bool Skybox::SetCubemap(GLuint tex) {
+    if (VAO == 0 && !BuildCube()) return false;
+    TextureManager::Instance().Acquire(tex);
+    TextureManager::Instance().Release(cubemapTex);
+    cubemapTex = tex;
+    return true;
+}
 
-    GLint locStars = glGetUniformLocation(shaderID, "uStars");
-    if (locStars >= 0) glUniform1i(locStars, 1); // sampler2D bound to unit 1
+void Skybox::Draw(const Shader& shader, GLuint overrideCubemap) {
+    glDepthFunc(GL_LEQUAL);
+    shader.Use();
+
+    // set expected sampler uniforms explicitly (defensive); the shader skips them once
+    // they hold these units
+    if (samplerShader != &shader || samplerProgram != shader.ID) {
+        samplerShader = &shader;
+        samplerProgram = shader.ID;
+        uSkybox = shader.Uniform<int>("skybox");
+        uStars = shader.Uniform<int>("uStars");
+    }
+    shader.Set(uSkybox, 0);    // samplerCube bound to unit 0
+    shader.Set(uStars, 1);     // sampler2D bound to unit 1
 
     GLuint toBind = (overrideCubemap != 0) ? overrideCubemap : cubemapTex;
 
     // bind cubemap to unit 0
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_CUBE_MAP, toBind);
+    TextureManager::Instance().Touch(toBind);
 
 
 
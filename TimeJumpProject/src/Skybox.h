@@ -2,6 +2,8 @@
 #include <string>
 #include <vector>
 #include <glad/glad.h>
+#include "TextureManager.h"
+#include "Shader.h"
 
 class Skybox {
 public:
@@ -9,10 +11,19 @@ public:
     ~Skybox();
     // faces: order -> right, left, top, bottom, front, back
     bool Load(const std::vector<std::string>& faces);
-    void Draw(unsigned int shaderID, GLuint overrideCubemap = 0); 
+    // takes a reference to a cubemap loaded elsewhere (TextureManager) and drops the
+    // one to the previous; builds the cube on first use
+    bool SetCubemap(GLuint tex);
+    // how Load loads the faces, for loading them elsewhere
+    static TextureOptions CubemapOptions();
+    void Draw(const Shader& shader, GLuint overrideCubemap = 0);
     GLuint getCubemapID() const { return cubemapTex; }
 private:
     unsigned int cubemapTex = 0;
     unsigned int VAO = 0, VBO = 0;
+    // sampler uniforms, resolved for the shader (and program) Draw last saw
+    const Shader* samplerShader = nullptr;
+    unsigned int samplerProgram = 0;
+    UniformHandle<int> uSkybox, uStars;
     bool BuildCube();
 };
@@ -0,0 +1,83 @@
+// SourceFile.cpp
+#include "SourceFile.h"
+#include "AssetPack.h"
+#include "MappedFile.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <vector>
+
+bool StatSource(const std::string& path, SourceInfo& out, bool withHash) {
+    namespace fs = std::filesystem;
+    if (const AssetPackEntry* e = AssetPack::Lookup(path)) {
+        // packed: what the loose file said when it was packed
+        out.mtime = e->sourceMTime;
+        out.size = e->size;
+    }
+    else {
+        std::error_code ec;
+        auto time = fs::last_write_time(path, ec);
+        if (ec) return false;
+        out.mtime = (uint64_t)time.time_since_epoch().count();
+        out.size = (uint64_t)fs::file_size(path, ec);
+        if (ec) return false;
+    }
+    out.hash = 0;
+    if (withHash) {
+        MappedFile file;
+        if (!file.Open(path)) return false;
+        out.hash = Fnv1a(file.Data(), file.Size());
+    }
+    return true;
+}
+
+bool WriteCacheFile(const std::string& path, const std::function<bool(std::ostream&)>& write, const char* who) {
+    namespace fs = std::filesystem;
+    // write to a temp name and rename, so a crash never leaves a torn cache; a name of
+    // its own per writer, since two loads (or instances) may build the same cache at once
+    std::random_device rd;
+    std::string tmpPath = path + "." + std::to_string(((uint64_t)rd() << 32) | rd()) + ".tmp";
+    {
+        std::ofstream f(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!f) {
+            std::cerr << who << ": cannot write " << tmpPath << "\n";
+            return false;
+        }
+        if (!write(f) || !f.flush()) {
+            std::cerr << who << ": write failed for " << tmpPath << "\n";
+            f.close();
+            std::error_code ec;
+            fs::remove(tmpPath, ec);
+            return false;
+        }
+    }
+    std::error_code ec;
+    fs::rename(tmpPath, path, ec);
+    if (ec) {
+        std::string why = ec.message();
+        fs::remove(tmpPath, ec);
+        // the other writer's cache is in place (and open, where that blocks replacing it)
+        if (fs::exists(path, ec)) return true;
+        std::cerr << who << ": cannot replace " << path << ": " << why << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool RestampCacheFile(const std::string& path, MappedFile& file, size_t offset, uint64_t mtime, const char* who) {
+    std::vector<unsigned char> bytes(file.Data(), file.Data() + file.Size());
+    file.Close();
+    {
+        std::fstream f(path, std::ios::binary | std::ios::in | std::ios::out);
+        if (f && f.seekp((std::streamoff)offset) && f.write((const char*)&mtime, sizeof(mtime)) && f.flush())
+            return file.Open(path, true);
+    }
+    std::memcpy(bytes.data() + offset, &mtime, sizeof(mtime));
+    WriteCacheFile(path, [&](std::ostream& f) {
+        return (bool)f.write((const char*)bytes.data(), (std::streamsize)bytes.size());
+    }, who); // on failure the verified cache is used as is and hashed again next start
+    return file.Open(path, true);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+// SourceFile.h - identity of the source file a derived cache (mesh, texture) was
+// built from, looked up in the mounted AssetPack first, and writing such caches
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+
+class MappedFile;
+
+// FNV-1a 64, behind the content hashes, cache keys and name tables; pass h to continue
+const uint64_t kFnv1aSeed = 0xcbf29ce484222325ull;
+
+inline uint64_t Fnv1a(const void* data, size_t size, uint64_t h = kFnv1aSeed) {
+    const unsigned char* p = (const unsigned char*)data;
+    for (size_t i = 0; i < size; ++i) {
+        h ^= p[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+// mixes v's 8 bytes in, low byte first, so the result does not depend on the host
+inline uint64_t Fnv1aMix(uint64_t h, uint64_t v) {
+    for (int b = 0; b < 8; ++b) {
+        h ^= (v >> (b * 8)) & 0xFF;
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+// The mtime/size pair is the fast check; the content hash (FNV-1a 64) is only
+// computed when they differ, so a touched but unchanged source keeps its cache.
+struct SourceInfo {
+    uint64_t mtime = 0;
+    uint64_t size = 0;
+    uint64_t hash = 0;
+};
+
+bool StatSource(const std::string& path, SourceInfo& out, bool withHash);
+
+// Writes a derived cache whole or not at all: write() fills a temp file of this writer's
+// own, which then replaces path. Writers racing on one cache build the same bytes, so
+// losing the rename to another one still counts as success. who prefixes errors.
+bool WriteCacheFile(const std::string& path, const std::function<bool(std::ostream&)>& write, const char* who);
+// Same bytes, new mtime: stores mtime at offset in the cache mapped by file, so the next
+// start skips the hash. In place if the file is writable, else as a patched copy through
+// WriteCacheFile; if both fail the cache stays as it is. file is mapped again after;
+// false only when that fails.
+bool RestampCacheFile(const std::string& path, MappedFile& file, size_t offset, uint64_t mtime, const char* who);
@@ -1,7 +1,9 @@
 #include "Terrain.h"
-#include <stb_image.h>
+#include "TextureManager.h"
+#include "ImageKernels.h"
 #include <iostream>
 #include <cmath>
+#include <algorithm>
 
 
 Terrain::Terrain() {}
@@ -9,7 +11,14 @@ Terrain::~Terrain() {
     if (VAO) glDeleteVertexArrays(1, &VAO);
     if (VBO) glDeleteBuffers(1, &VBO);
     if (EBO) glDeleteBuffers(1, &EBO);
-    if (textureID) glDeleteTextures(1, &textureID);
+    TextureManager::Instance().Release(textureID);
+    TextureManager::Instance().Release(heightTex);
+}
+
+void Terrain::SetTexture(GLuint tex) {
+    TextureManager::Instance().Acquire(tex);
+    TextureManager::Instance().Release(textureID);
+    textureID = tex;
 }
 
 bool Terrain::Load(const std::string& heightmapPath,
@@ -17,22 +26,42 @@ bool Terrain::Load(const std::string& heightmapPath,
     float heightScale,
     float size)
 {
+    if (!LoadHeightmap(heightmapPath, heightScale, size) || !Upload()) return false;
+
+    // --- load albedo texture ---
+    TextureOptions albedoOptions;
+    albedoOptions.flipVertically = false;
+    GLuint albedo = TextureManager::Instance().Load(texturePath, albedoOptions);
+    if (!albedo) {
+        std::cerr << "Terrain: failed to load texture: " << texturePath << "\n";
+        return false;
+    }
+    TextureManager::Instance().Release(textureID);
+    textureID = albedo;
+    return true;
+}
+
+bool Terrain::LoadHeightmap(const std::string& heightmapPath, float heightScale, float size) {
     // --- load heightmap (grayscale) ---
-    int comp = 0;
-    stbi_set_flip_vertically_on_load(false);
-    unsigned char* data = stbi_load(heightmapPath.c_str(), &width, &height, &comp, 1); // force 1 channel
-    if (!data) {
+    // decoded like a texture, so instances on one host share it through the SharedCache
+    TextureOptions options;
+    options.flipVertically = false;
+    options.channels = 1; // force 1 channel
+    options.compress = false;
+    PreparedTexture image;
+    if (!TextureManager::Prepare({ heightmapPath }, options, image)) {
         std::cerr << "Terrain: failed to load heightmap: " << heightmapPath << "\n";
         return false;
     }
+    const unsigned char* data = image.pixels[0];
+    width = image.width;
+    height = image.height;
 
     // store normalized height values for GetHeightAt()
     hmWidth = width;
     hmHeight = height;
     hmData.resize((size_t)hmWidth * (size_t)hmHeight);
-    for (int i = 0; i < hmWidth * hmHeight; ++i) {
-        hmData[i] = (float)data[i] / 255.0f;
-    }
+    U8ToFloat(data, hmData.data(), hmData.size(), 1.0f / 255.0f);
 
     // save scale/size (used by GetHeightAt())
     worldScaleY = heightScale;
@@ -40,49 +69,41 @@ bool Terrain::Load(const std::string& heightmapPath,
     worldSizeZ = size;
 
     // Build mesh from image (your existing helper)
-    if (!BuildFromImage(data, width, height, 1, heightScale, size)) {
-        stbi_image_free(data);
-        return false;
-    }
-    stbi_image_free(data);
-
-    // --- load albedo texture ---
-    int tw = 0, th = 0, tc = 0;
-    unsigned char* tdata = stbi_load(texturePath.c_str(), &tw, &th, &tc, 0);
-    if (!tdata) {
-        std::cerr << "Terrain: failed to load texture: " << texturePath << "\n";
-        return false;
+    if (!BuildFromImage(data, width, height, 1, heightScale, size)) return false;
+
+    // quantized to 16 bytes per vertex: unorm16 positions over the terrain bounds
+    // (half floats would step ~10 cm at the edges of a 400 m terrain), snorm normals,
+    // unorm16 UVs over their tiled range
+    glm::vec3 pMin(positions.empty() ? glm::vec3(0.0f) : positions[0]), pMax = pMin;
+    for (const glm::vec3& p : positions) { pMin = glm::min(pMin, p); pMax = glm::max(pMax, p); }
+    glm::vec2 uvMin(uvs.empty() ? glm::vec2(0.0f) : uvs[0]), uvMax = uvMin;
+    for (const glm::vec2& t : uvs) { uvMin = glm::min(uvMin, t); uvMax = glm::max(uvMax, t); }
+    dequant.posOffset = pMin;
+    dequant.posScale = glm::max(pMax - pMin, glm::vec3(1e-6f));
+    dequant.uvOffset = uvMin;
+    dequant.uvScale = glm::max(uvMax - uvMin, glm::vec2(1e-6f));
+
+    packedVertices.resize(positions.size() * TerrainVertexLayout::stride);
+    for (size_t i = 0; i < positions.size(); ++i) {
+        unsigned char* v = &packedVertices[i * TerrainVertexLayout::stride];
+        TerrainVertexLayout::Put<0>(v, (positions[i] - dequant.posOffset) / dequant.posScale);
+        TerrainVertexLayout::Put<1>(v, normals[i]);
+        TerrainVertexLayout::Put<2>(v, (uvs[i] - dequant.uvOffset) / dequant.uvScale);
     }
+    return true;
+}
 
-    // Set pixel unpack alignment for safety (in case row stride not multiple of 4)
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-
-    GLenum extFormat = (tc == 3 ? GL_RGB : GL_RGBA);
-    GLenum internalFormat = (tc == 3 ? GL_RGB8 : GL_RGBA8);
-
-    if (textureID == 0) glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_2D, textureID);
-    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, tw, th, 0, extFormat, GL_UNSIGNED_BYTE, tdata);
-    glGenerateMipmap(GL_TEXTURE_2D);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    stbi_image_free(tdata);
-
-    // restore default alignment
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+bool Terrain::Upload() {
+    if (packedVertices.empty()) return false;
 
-    // --- create VAO/VBO/EBO from positions/normals/uvs/indices ---
-    struct Vertex { glm::vec3 p; glm::vec3 n; glm::vec2 uv; };
-    std::vector<Vertex> verts;
-    verts.reserve(positions.size());
-    for (size_t i = 0; i < positions.size(); ++i) {
-        verts.push_back({ positions[i], normals[i], uvs[i] });
-    }
+    // same heights on the GPU so shaders can place things on the surface
+    TextureOptions heightOptions;
+    heightOptions.mipmaps = false;
+    heightOptions.wrap = GL_CLAMP_TO_EDGE;
+    TextureManager::Instance().Release(heightTex);
+    heightTex = TextureManager::Instance().Create(GL_R32F, hmWidth, hmHeight, GL_RED, GL_FLOAT, hmData.data(), heightOptions);
 
+    // --- create VAO/VBO/EBO from the packed vertices and indices ---
     // Delete old buffers if they exist (optional, safe)
     if (VAO == 0) glGenVertexArrays(1, &VAO);
     if (VBO == 0) glGenBuffers(1, &VBO);
@@ -91,26 +112,22 @@ bool Terrain::Load(const std::string& heightmapPath,
     glBindVertexArray(VAO);
 
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, verts.size() * sizeof(Vertex), verts.data(), GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, packedVertices.size(), packedVertices.data(), GL_STATIC_DRAW);
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
 
     // layout: pos(0), normal(1), uv(2)
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, p));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, n));
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, uv));
+    TerrainVertexLayout::Apply();
 
     glBindVertexArray(0);
+    std::vector<unsigned char>().swap(packedVertices);
 
     return true;
 }
 
 
-bool Terrain::BuildFromImage(unsigned char* data, int w, int h, int channels,
+bool Terrain::BuildFromImage(const unsigned char* data, int w, int h, int channels,
     float heightScale, float size)
 {
     if (!data || w <= 1 || h <= 1) return false;
@@ -165,6 +182,7 @@ void Terrain::Draw() {
     if (textureID) {
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, textureID);
+        TextureManager::Instance().Touch(textureID);
     }
     glBindVertexArray(VAO);
     glDrawElements(GL_TRIANGLES, (GLsizei)indices.size(), GL_UNSIGNED_INT, 0);
@@ -212,3 +230,53 @@ float Terrain::GetHeightAt(float worldX, float worldZ) const {
     return h * worldScaleY;
 }
 
+
+glm::vec3 Terrain::GetNormalAt(float worldX, float worldZ) const {
+    if (hmWidth <= 1 || hmHeight <= 1) return glm::vec3(NAN);
+
+    // one heightmap texel in world units
+    float dx = worldSizeX / (float)(hmWidth - 1);
+    float dz = worldSizeZ / (float)(hmHeight - 1);
+    float halfX = worldSizeX * 0.5f;
+    float halfZ = worldSizeZ * 0.5f;
+
+    // clamp the taps so samples on the border still get a normal
+    float xl = std::max(worldX - dx, -halfX), xr = std::min(worldX + dx, halfX);
+    float zb = std::max(worldZ - dz, -halfZ), zf = std::min(worldZ + dz, halfZ);
+
+    float hl = GetHeightAt(xl, worldZ), hr = GetHeightAt(xr, worldZ);
+    float hb = GetHeightAt(worldX, zb), hf = GetHeightAt(worldX, zf);
+    if (!std::isfinite(hl) || !std::isfinite(hr) || !std::isfinite(hb) || !std::isfinite(hf))
+        return glm::vec3(NAN);
+
+    glm::vec3 n((hl - hr) / (xr - xl), 1.0f, (hb - hf) / (zf - zb));
+    return glm::normalize(n);
+}
+
+void Terrain::GetHeightRange(float x0, float z0, float x1, float z1, float& outMin, float& outMax) const {
+    outMin = outMax = 0.0f;
+    if (hmWidth <= 1 || hmHeight <= 1 || hmData.empty()) return;
+
+    auto toCol = [&](float x) {
+        float u = (x + worldSizeX * 0.5f) / worldSizeX;
+        return std::min(std::max((int)std::floor(u * (hmWidth - 1)), 0), hmWidth - 1);
+    };
+    auto toRow = [&](float z) {
+        float v = (z + worldSizeZ * 0.5f) / worldSizeZ;
+        return std::min(std::max((int)std::floor(v * (hmHeight - 1)), 0), hmHeight - 1);
+    };
+    // widen by one texel so bilinear samples at the border are covered
+    int c0 = std::max(toCol(std::min(x0, x1)), 0), c1 = std::min(toCol(std::max(x0, x1)) + 1, hmWidth - 1);
+    int r0 = std::max(toRow(std::min(z0, z1)), 0), r1 = std::min(toRow(std::max(z0, z1)) + 1, hmHeight - 1);
+
+    float lo = hmData[(size_t)r0 * hmWidth + c0], hi = lo;
+    for (int r = r0; r <= r1; ++r) {
+        for (int c = c0; c <= c1; ++c) {
+            float h = hmData[(size_t)r * hmWidth + c];
+            lo = std::min(lo, h);
+            hi = std::max(hi, h);
+        }
+    }
+    outMin = lo * worldScaleY;
+    outMax = hi * worldScaleY;
+}
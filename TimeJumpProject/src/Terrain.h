@@ -4,6 +4,13 @@
 #include <glm/glm.hpp>
 #include <string>
 #include <vector>
+#include "VertexLayout.h"
+
+// 16 bytes per vertex, see Terrain::LoadHeightmap
+typedef VertexLayout<
+    Attrib<0, AttribUnorm16x4>,
+    Attrib<1, AttribSnorm1010102>,
+    Attrib<2, AttribUnorm16x2>> TerrainVertexLayout;
 
 class Terrain {
 public:
@@ -14,27 +21,50 @@ public:
     // and an albedo texture for the terrain.
     bool Load(const std::string& heightmapPath, const std::string& texturePath,
         float heightScale = 20.0f, float size = 100.0f);
+    // Load without the albedo, in two halves for loading off the GL thread:
+    // LoadHeightmap decodes the heightmap and builds the mesh and the heights
+    // GetHeightAt reads (no GL, any thread); Upload creates the height texture and
+    // vertex buffers on the GL thread. The terrain then draws with whatever SetTexture gave it.
+    bool LoadHeightmap(const std::string& heightmapPath, float heightScale = 20.0f, float size = 100.0f);
+    bool Upload();
 
     void Draw(); // binds texture and draws mesh
     float GetHeightAt(float worldX, float worldZ) const;
+    // surface normal from central differences of the heightmap (NAN outside)
+    glm::vec3 GetNormalAt(float worldX, float worldZ) const;
+    float GetSizeX() const { return worldSizeX; }
+    float GetSizeZ() const { return worldSizeZ; }
+    float GetHeightScale() const { return worldScaleY; }
+    // min/max world Y over a world-space rectangle (clamped to the terrain)
+    void GetHeightRange(float x0, float z0, float x1, float z1, float& outMin, float& outMax) const;
+    // normalized heights as an R32F texture, for GPU-side placement (grass etc.)
+    GLuint GetHeightTexture() const { return heightTex; }
+    int GetHeightMapWidth() const { return hmWidth; }
+    int GetHeightMapHeight() const { return hmHeight; }
     // optional transform
     glm::mat4 model = glm::mat4(1.0f);
 
-    void SetTexture(GLuint tex) { textureID = tex; }
+    // takes a reference to tex (TextureManager) and drops the one to the previous texture
+    void SetTexture(GLuint tex);
     GLuint GetTexture() const { return textureID; }
+    // uniforms the terrain shader needs to decode the quantized vertices
+    const VertexDequant& GetDequant() const { return dequant; }
 
 private:
-    bool BuildFromImage(unsigned char* data, int w, int h, int channels,
+    bool BuildFromImage(const unsigned char* data, int w, int h, int channels,
         float heightScale, float size);
     void ComputeNormals();
 
     unsigned int VAO = 0, VBO = 0, EBO = 0;
     unsigned int textureID = 0;
+    unsigned int heightTex = 0;
     int width = 0, height = 0;
     std::vector<glm::vec3> positions;
     std::vector<glm::vec3> normals;
     std::vector<glm::vec2> uvs;
     std::vector<unsigned int> indices;
+    std::vector<unsigned char> packedVertices; // TerrainVertexLayout, between LoadHeightmap and Upload
+    VertexDequant dequant;
         int hmWidth = 0;
     int hmHeight = 0;
     std::vector<float> hmData; // row-major: hmData[row*hmWidth + col]
@@ -1,7 +1,7 @@
 // TextRenderer.cpp
 #include "TextRenderer.h"
 #include <glad/glad.h>
-#include <stb_image.h>
+#include "TextureManager.h"
 #include <glm/gtc/matrix_transform.hpp>
 #include <vector>
 #include <iostream>
@@ -38,7 +38,7 @@ TextRenderer::TextRenderer() {}
 TextRenderer::~TextRenderer() {
     if (VBO) glDeleteBuffers(1, &VBO);
     if (VAO) glDeleteVertexArrays(1, &VAO);
-    if (fontTex) glDeleteTextures(1, &fontTex);
+    TextureManager::Instance().Release(fontTex);
     if (shaderID) glDeleteProgram(shaderID);
 }
 
@@ -71,6 +71,14 @@ bool TextRenderer::Init(int screenW, int screenH) {
     scrW = screenW; scrH = screenH;
     shaderID = CompileShader(textVS, textFS);
     if (!shaderID) return false;
+    // the program is ours alone: find the uniforms once, point the sampler at unit 0 for good
+    locOrtho = glGetUniformLocation(shaderID, "uOrtho");
+    locTextColor = glGetUniformLocation(shaderID, "uTextColor");
+    GLint previous = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &previous);
+    glUseProgram(shaderID);
+    glUniform1i(glGetUniformLocation(shaderID, "uFont"), 0);
+    glUseProgram((GLuint)previous);
 
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
@@ -90,19 +98,18 @@ bool TextRenderer::Init(int screenW, int screenH) {
 
 bool TextRenderer::LoadFont(const std::string& atlasPath, int c, int r) {
     cols = c; rows = r;
-    int w, h, n;
-    stbi_set_flip_vertically_on_load(false);
-    unsigned char* data = stbi_load(atlasPath.c_str(), &w, &h, &n, 4);
-    if (!data) {
+    TextureOptions options;
+    options.flipVertically = false;
+    options.mipmaps = false;
+    options.channels = 4;
+    options.compress = false; // block artefacts show on glyph edges
+    GLuint tex = TextureManager::Instance().Load(atlasPath, options);
+    if (!tex) {
         std::cerr << "TextRenderer: failed to load atlas: " << atlasPath << "\n";
         return false;
     }
-    glGenTextures(1, &fontTex);
-    glBindTexture(GL_TEXTURE_2D, fontTex);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    stbi_image_free(data);
+    TextureManager::Instance().Release(fontTex);
+    fontTex = tex;
     return true;
 }
 
@@ -156,17 +163,20 @@ void TextRenderer::RenderText(const std::string& text, float x, float y, float s
     glDisable(GL_DEPTH_TEST);
 
     glUseProgram(shaderID);
-    glm::mat4 ortho = glm::ortho(0.0f, (float)scrW, (float)scrH, 0.0f);
-    int loc = glGetUniformLocation(shaderID, "uOrtho");
-    glUniformMatrix4fv(loc, 1, GL_FALSE, &ortho[0][0]);
-
-    int locc = glGetUniformLocation(shaderID, "uTextColor");
-    glUniform3f(locc, color.r, color.g, color.b);
+    // the program keeps its uniforms between draws: send only what changed
+    if (orthoW != scrW || orthoH != scrH) {
+        glm::mat4 ortho = glm::ortho(0.0f, (float)scrW, (float)scrH, 0.0f);
+        glUniformMatrix4fv(locOrtho, 1, GL_FALSE, &ortho[0][0]);
+        orthoW = scrW; orthoH = scrH;
+    }
+    if (!colorSent || sentColor != color) {
+        glUniform3f(locTextColor, color.r, color.g, color.b);
+        sentColor = color;
+        colorSent = true;
+    }
 
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, fontTex);
-    int locf = glGetUniformLocation(shaderID, "uFont");
-    glUniform1i(locf, 0);
 
     glBindVertexArray(VAO);
     glDrawArrays(GL_TRIANGLES, 0, (GLsizei)(verts.size() / 4));
@@ -26,6 +26,11 @@ private:
     unsigned int VAO = 0, VBO = 0;
     unsigned int fontTex = 0;
     unsigned int shaderID = 0;
+    int locOrtho = -1, locTextColor = -1;
+    // what the program's uniforms hold, so RenderText skips resending it
+    int orthoW = -1, orthoH = -1;
+    glm::vec3 sentColor = glm::vec3(0.0f);
+    bool colorSent = false;
     int scrW = 800, scrH = 600;
     int cols = 16, rows = 16;
     bool inited = false;
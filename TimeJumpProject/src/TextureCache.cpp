@@ -0,0 +1,296 @@
+// TextureCache.cpp
+#include "TextureCache.h"
+#include "ImageKernels.h"
+#include "SourceFile.h"
+
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+
+// bump whenever the encoders, the mip filter or the stamp below change
+static const uint32_t kTextureCacheVersion = 2;
+static const char kTextureCacheMagic[4] = { 'T', 'J', 'T', 'X' };
+
+#pragma pack(push, 1)
+// ours, in the header's reserved words (other tools leave them alone)
+struct TextureCacheStamp {
+    char magic[4];
+    uint32_t version;
+    uint32_t channels;
+    uint64_t sourceMTime; // combined over cubemap faces
+    uint64_t sourceSize;
+    uint64_t sourceHash;
+};
+
+struct DdsPixelFormat {
+    uint32_t size, flags, fourCC, rgbBitCount, rMask, gMask, bMask, aMask;
+};
+
+struct DdsHeader {
+    uint32_t size, flags, height, width, pitchOrLinearSize, depth, mipMapCount;
+    TextureCacheStamp stamp;
+    uint32_t reserved1[2];    // rest of the 11 reserved words
+    DdsPixelFormat pixelFormat;
+    uint32_t caps, caps2, caps3, caps4, reserved2;
+};
+
+struct DdsHeaderDx10 {
+    uint32_t dxgiFormat, resourceDimension, miscFlag, arraySize, miscFlags2;
+};
+
+struct DdsFile {
+    char magic[4];
+    DdsHeader header;
+    DdsHeaderDx10 dx10;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(DdsHeader) == 124, "DDS header layout");
+
+static const uint32_t kDdsFlags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000; // caps, size, pixel format, mips, linear size
+static const uint32_t kDdpfFourCC = 0x4;
+static const uint32_t kDdsCapsComplex = 0x8, kDdsCapsTexture = 0x1000, kDdsCapsMipmap = 0x400000;
+static const uint32_t kDdsCaps2Cubemap = 0xFE00;  // cubemap + all six faces
+static const uint32_t kDx10Texture2D = 3, kDx10MiscCube = 0x4;
+
+static uint32_t FourCC(const char* s) {
+    return (uint32_t)s[0] | ((uint32_t)s[1] << 8) | ((uint32_t)s[2] << 16) | ((uint32_t)s[3] << 24);
+}
+
+static uint32_t DxgiFormat(BlockFormat format) {
+    switch (format) {
+    case BlockFormat::BC1: return 71;
+    case BlockFormat::BC3: return 77;
+    case BlockFormat::BC4: return 80;
+    case BlockFormat::BC5: return 83;
+    case BlockFormat::BC7: return 98;
+    default: return 0;
+    }
+}
+
+static BlockFormat FromDxgi(uint32_t dxgi) {
+    switch (dxgi) {
+    case 71: return BlockFormat::BC1;
+    case 77: return BlockFormat::BC3;
+    case 80: return BlockFormat::BC4;
+    case 83: return BlockFormat::BC5;
+    case 98: return BlockFormat::BC7;
+    default: return BlockFormat::None;
+    }
+}
+
+static int MipCount(int w, int h) {
+    int levels = 1;
+    while ((std::max(w, h) >> levels) > 0) ++levels;
+    return levels;
+}
+
+// one identity for all sources; a single source keeps its own values. False with
+// 'missing' set when a source is gone.
+static bool StatSources(const std::vector<std::string>& sources, SourceInfo& out, bool withHash, bool& missing) {
+    missing = false;
+    if (sources.size() == 1) {
+        missing = !StatSource(sources[0], out, withHash);
+        return !missing;
+    }
+    out = SourceInfo();
+    uint64_t mtime = kFnv1aSeed, hash = kFnv1aSeed;
+    for (const std::string& s : sources) {
+        SourceInfo one;
+        if (!StatSource(s, one, withHash)) {
+            missing = true;
+            return false;
+        }
+        mtime = Fnv1aMix(mtime, one.mtime);
+        hash = Fnv1aMix(hash, one.hash);
+        out.size += one.size;
+    }
+    out.mtime = mtime;
+    out.hash = withHash ? hash : 0;
+    return true;
+}
+
+std::string TextureCachePath(const std::string& sourcePath, bool flipped, bool cubemap) {
+    return sourcePath + (cubemap ? ".cube" : "") + (flipped ? ".flip" : "") + ".dds";
+}
+
+BlockFormat ChooseBlockFormat(int channels, bool allowBC7) {
+    switch (channels) {
+    case 1: return BlockFormat::BC4;
+    case 2: return BlockFormat::BC5;
+    case 3: return BlockFormat::BC1;
+    case 4: return allowBC7 ? BlockFormat::BC7 : BlockFormat::BC3;
+    default: return BlockFormat::None;
+    }
+}
+
+const unsigned char* CompressedImage::Level(int face, int level) const {
+    size_t offset = 0;
+    for (int f = 0; f <= face; ++f)
+        for (int l = 0; l < levels && (f < face || l < level); ++l) offset += LevelSize(l);
+    return data + offset;
+}
+
+size_t CompressedImage::LevelSize(int level) const {
+    return CompressedLevelSize(format, std::max(1, width >> level), std::max(1, height >> level));
+}
+
+bool BuildTextureCache(const std::vector<std::string>& sources, bool flipVertically, bool allowBC7,
+    const std::string& cachePath)
+{
+    if (sources.size() != 1 && sources.size() != 6) return false;
+    SourceInfo source;
+    bool missing = false;
+    if (!StatSources(sources, source, true, missing)) return false;
+
+    stbi_set_flip_vertically_on_load_thread(flipVertically);
+    std::vector<unsigned char*> images;
+    int w = 0, h = 0, channels = 0;
+    bool ok = true;
+    for (const std::string& s : sources) {
+        int iw = 0, ih = 0, comp = 0;
+        MappedFile file;
+        unsigned char* pixels = file.Open(s, true) ?
+            stbi_load_from_memory(file.Data(), (int)file.Size(), &iw, &ih, &comp, 0) : nullptr;
+        if (!pixels) {
+            std::cerr << "BuildTextureCache: failed to load " << s << "\n";
+            ok = false;
+            break;
+        }
+        images.push_back(pixels);
+        if (images.size() == 1) {
+            w = iw;
+            h = ih;
+            channels = comp;
+        }
+        else if (iw != w || ih != h || comp != channels) {
+            std::cerr << "BuildTextureCache: " << s << " does not match " << sources[0] << "\n";
+            ok = false;
+            break;
+        }
+    }
+
+    CompressedImage img;
+    img.format = ChooseBlockFormat(channels, allowBC7);
+    img.width = w;
+    img.height = h;
+    img.levels = MipCount(w, h);
+    img.faces = (int)sources.size();
+    std::vector<unsigned char> blocks;
+    if (ok) {
+        size_t faceSize = 0;
+        for (int l = 0; l < img.levels; ++l) faceSize += img.LevelSize(l);
+        blocks.resize(faceSize * img.faces);
+        img.data = blocks.data();
+        std::vector<unsigned char> level, next;
+        for (int f = 0; f < img.faces; ++f) {
+            const unsigned char* pixels = images[f];
+            for (int l = 0; l < img.levels; ++l) {
+                int lw = std::max(1, w >> l), lh = std::max(1, h >> l);
+                CompressImage(img.format, pixels, lw, lh, channels, blocks.data() + (img.Level(f, l) - img.data));
+                if (l + 1 == img.levels) break;
+                // colour (3-4 channels) filters in linear light; 1-2 channel images are data
+                DownsampleImage(pixels, lw, lh, channels, MipFilter::Kaiser, channels >= 3, next);
+                level.swap(next);
+                pixels = level.data();
+            }
+        }
+    }
+    for (unsigned char* p : images) stbi_image_free(p);
+    if (!ok) return false;
+
+    DdsFile d{};
+    std::memcpy(d.magic, "DDS ", 4);
+    DdsHeader& hd = d.header;
+    hd.size = sizeof(DdsHeader);
+    hd.flags = kDdsFlags;
+    hd.height = (uint32_t)h;
+    hd.width = (uint32_t)w;
+    hd.pitchOrLinearSize = (uint32_t)img.LevelSize(0);
+    hd.mipMapCount = (uint32_t)img.levels;
+    std::memcpy(hd.stamp.magic, kTextureCacheMagic, sizeof(hd.stamp.magic));
+    hd.stamp.version = kTextureCacheVersion;
+    hd.stamp.channels = (uint32_t)channels;
+    hd.stamp.sourceMTime = source.mtime;
+    hd.stamp.sourceSize = source.size;
+    hd.stamp.sourceHash = source.hash;
+    hd.pixelFormat.size = sizeof(DdsPixelFormat);
+    hd.pixelFormat.flags = kDdpfFourCC;
+    hd.pixelFormat.fourCC = FourCC("DX10");
+    hd.caps = kDdsCapsTexture | (img.levels > 1 ? kDdsCapsComplex | kDdsCapsMipmap : 0) | (img.faces == 6 ? kDdsCapsComplex : 0);
+    hd.caps2 = img.faces == 6 ? kDdsCaps2Cubemap : 0;
+    d.dx10.dxgiFormat = DxgiFormat(img.format);
+    d.dx10.resourceDimension = kDx10Texture2D;
+    d.dx10.miscFlag = img.faces == 6 ? kDx10MiscCube : 0;
+    d.dx10.arraySize = 1;
+
+    // two loads of one image (different options) may build it at once: WriteCacheFile
+    // gives each its own temp file
+    return WriteCacheFile(cachePath, [&](std::ostream& f) {
+        f.write((const char*)&d, sizeof(d));
+        f.write((const char*)blocks.data(), (std::streamsize)blocks.size());
+        return (bool)f;
+    }, "BuildTextureCache");
+}
+
+// header checks that do not need the sources
+static const DdsFile* ValidHeader(const MappedFile& file, CompressedImage& out) {
+    if (file.Size() < sizeof(DdsFile)) return nullptr;
+    const DdsFile* d = (const DdsFile*)file.Data();
+    const DdsHeader& h = d->header;
+    if (std::memcmp(d->magic, "DDS ", 4) != 0 || h.size != sizeof(DdsHeader)) return nullptr;
+    if (std::memcmp(h.stamp.magic, kTextureCacheMagic, sizeof(h.stamp.magic)) != 0 || h.stamp.version != kTextureCacheVersion)
+        return nullptr;
+    if (h.pixelFormat.fourCC != FourCC("DX10") || d->dx10.arraySize != 1) return nullptr;
+    out.format = FromDxgi(d->dx10.dxgiFormat);
+    out.width = (int)h.width;
+    out.height = (int)h.height;
+    out.levels = (int)std::max(1u, h.mipMapCount);
+    out.faces = (d->dx10.miscFlag & kDx10MiscCube) ? 6 : 1;
+    out.channels = (int)h.stamp.channels;
+    out.sourceHash = h.stamp.sourceHash;
+    out.data = file.Data() + sizeof(DdsFile);
+    if (out.format == BlockFormat::None || out.width <= 0 || out.height <= 0 || out.levels > MipCount(out.width, out.height))
+        return nullptr;
+    size_t faceSize = 0;
+    for (int l = 0; l < out.levels; ++l) faceSize += out.LevelSize(l);
+    if (sizeof(DdsFile) + faceSize * out.faces != file.Size()) return nullptr;
+    return d;
+}
+
+bool OpenTextureCache(const std::string& cachePath, const std::vector<std::string>& sources, MappedFile& file,
+    CompressedImage& out)
+{
+    if (!file.Open(cachePath, true)) return false;
+    const DdsFile* d = ValidHeader(file, out);
+    if (!d || (size_t)out.faces != sources.size()) {
+        file.Close();
+        return false;
+    }
+
+    SourceInfo source;
+    bool missing = false;
+    if (!StatSources(sources, source, false, missing)) {
+        // shipped without the originals: the cache is the texture
+        if (!missing) file.Close();
+        return missing;
+    }
+    const TextureCacheStamp& stamp = d->header.stamp;
+    if (source.mtime != stamp.sourceMTime || source.size != stamp.sourceSize) {
+        // touched: only the content decides
+        if (source.size != stamp.sourceSize || !StatSources(sources, source, true, missing) || source.hash != stamp.sourceHash) {
+            file.Close();
+            return false;
+        }
+        // same bytes, new mtime: patch the stamp so the next start skips the hash
+        const size_t at = offsetof(DdsFile, header) + offsetof(DdsHeader, stamp) + offsetof(TextureCacheStamp, sourceMTime);
+        if (!RestampCacheFile(cachePath, file, at, source.mtime, "OpenTextureCache") || !ValidHeader(file, out)) {
+            file.Close();
+            return false;
+        }
+    }
+    return true;
+}
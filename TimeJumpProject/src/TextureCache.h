@@ -0,0 +1,41 @@
+#pragma once
+
+// TextureCache.h - block-compressed, fully mipmapped copies of source images (DDS), built on first load
+#include <string>
+#include <vector>
+#include "BlockCompression.h"
+#include "MappedFile.h"
+
+// "<image>" -> "<image>.dds"; ".flip.dds" when stored flipped for bottom-origin UVs,
+// ".cube.dds" (next to the +X face) for the six faces of a cubemap
+std::string TextureCachePath(const std::string& sourcePath, bool flipped, bool cubemap);
+
+// Picks the format from the source's channels: 1 -> BC4, 2 -> BC5, 3 -> BC1,
+// 4 -> BC7 (BC3 without allowBC7).
+BlockFormat ChooseBlockFormat(int channels, bool allowBC7);
+
+// Decodes the source(s) (one image, or six equally sized cubemap faces), flips them
+// if asked, builds the full mip chain and writes it compressed. The file records the
+// sources' mtime/size and content hash so OpenTextureCache can tell when it is stale.
+bool BuildTextureCache(const std::vector<std::string>& sources, bool flipVertically, bool allowBC7,
+    const std::string& cachePath);
+
+// points into the mapping held by the MappedFile passed to OpenTextureCache
+struct CompressedImage {
+    BlockFormat format = BlockFormat::None;
+    int width = 0, height = 0;
+    int levels = 0;
+    int faces = 1;               // 6 for cubemaps
+    int channels = 0;            // of the source
+    uint64_t sourceHash = 0;     // content of the source(s)
+    const unsigned char* data = nullptr; // face by face, each level after level (DDS order)
+
+    const unsigned char* Level(int face, int level) const;
+    size_t LevelSize(int level) const;
+};
+
+// Maps cachePath and validates it against the sources (mtime/size, then content
+// hash). Missing sources are accepted, so converted textures can ship without the
+// originals. False when the cache is missing, stale or malformed.
+bool OpenTextureCache(const std::string& cachePath, const std::vector<std::string>& sources, MappedFile& file,
+    CompressedImage& out);
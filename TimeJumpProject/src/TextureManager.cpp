@@ -0,0 +1,560 @@
+// TextureManager.cpp
+#include "TextureManager.h"
+#include "ImageKernels.h"
+#include "MappedFile.h"
+#include "SharedCache.h"
+#include "SourceFile.h"
+#include "TextureCache.h"
+
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+// null on contexts before 4.2 (see TextureManager::LoadTextureStorage)
+static PFNGLTEXSTORAGE2DPROC texStorage2D = nullptr;
+static bool s3tcSupported = false, bptcSupported = false;
+
+static std::string OptionsKey(const TextureOptions& o) {
+    return "|" + std::to_string(o.flipVertically) + std::to_string(o.mipmaps) + std::to_string(o.channels) +
+        std::to_string(o.compress) + ":" + std::to_string(o.wrap);
+}
+
+static int LevelCount(int w, int h, bool mipmaps) {
+    int levels = 1;
+    if (mipmaps) while ((std::max(w, h) >> levels) > 0) ++levels;
+    return levels;
+}
+
+static size_t BytesPerTexel(GLenum internalFormat) {
+    switch (internalFormat) {
+    case GL_R8: return 1;
+    case GL_RG8: case GL_R16F: return 2;
+    case GL_RGB8: return 3;
+    case GL_RGBA8: case GL_R32F: case GL_RG16F: return 4;
+    case GL_RGBA16F: return 8;
+    case GL_RGBA32F: return 16;
+    default: return 4;
+    }
+}
+
+static size_t LevelBytes(GLenum internalFormat, int w, int h, int levels, int faces) {
+    size_t bytes = 0;
+    for (int l = 0; l < levels; ++l)
+        bytes += (size_t)std::max(1, w >> l) * std::max(1, h >> l) * BytesPerTexel(internalFormat);
+    return bytes * faces;
+}
+
+// Immutable storage for every level of the bound texture. Without glTexStorage2D the
+// levels are specified one by one, which gives a complete texture all the same.
+static void AllocateStorage(GLenum target, GLenum internalFormat, int w, int h, int levels, GLenum format, GLenum type) {
+    if (texStorage2D) {
+        texStorage2D(target, levels, internalFormat, w, h);
+        return;
+    }
+    int faces = target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+    GLenum first = target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X : target;
+    for (int l = 0; l < levels; ++l)
+        for (int f = 0; f < faces; ++f)
+            glTexImage2D(first + f, l, internalFormat, std::max(1, w >> l), std::max(1, h >> l), 0, format, type, nullptr);
+    glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, levels - 1);
+}
+
+static void SetSampling(GLenum target, const TextureOptions& o) {
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, o.mipmaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, o.wrap);
+    glTexParameteri(target, GL_TEXTURE_WRAP_T, o.wrap);
+    if (target == GL_TEXTURE_CUBE_MAP) glTexParameteri(target, GL_TEXTURE_WRAP_R, o.wrap);
+}
+
+static bool FormatSupported(BlockFormat format) {
+    switch (format) {
+    case BlockFormat::BC1: case BlockFormat::BC3: return s3tcSupported;
+    case BlockFormat::BC4: case BlockFormat::BC5: return true; // RGTC is core since 3.0
+    case BlockFormat::BC7: return bptcSupported;
+    default: return false;
+    }
+}
+
+// Levels of the cache from firstLevel down, as stored (no decode, no glGenerateMipmap),
+// each specified on its own so TextureStreamer can add the larger ones and
+// TextureManager can free them again; the base level starts at firstLevel.
+static GLuint UploadCompressed(const CompressedImage& img, int levels, int firstLevel, const TextureOptions& options,
+    TextureInfo& info)
+{
+    const GLenum target = img.faces == 6 ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
+    const GLenum first = img.faces == 6 ? GL_TEXTURE_CUBE_MAP_POSITIVE_X : GL_TEXTURE_2D;
+    const GLenum format = BlockGLFormat(img.format);
+    info.width = img.width;
+    info.height = img.height;
+    info.channels = img.channels;
+    info.levels = levels;
+    info.baseLevel = firstLevel;
+    info.hasAlpha = img.channels == 4;
+    info.internalFormat = format;
+    info.bytes = 0;
+    for (int l = firstLevel; l < levels; ++l) info.bytes += img.LevelSize(l) * img.faces;
+
+    GLuint tex = 0;
+    glGenTextures(1, &tex);
+    glBindTexture(target, tex);
+    for (int f = 0; f < img.faces; ++f) {
+        for (int l = firstLevel; l < levels; ++l) {
+            int w = std::max(1, img.width >> l), h = std::max(1, img.height >> l);
+            glCompressedTexImage2D(first + f, l, format, w, h, 0, (GLsizei)img.LevelSize(l), img.Level(f, l));
+        }
+    }
+    glTexParameteri(target, GL_TEXTURE_BASE_LEVEL, firstLevel);
+    glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    SetSampling(target, options);
+    return tex;
+}
+
+static GLenum SizedFormat(int channels) {
+    return channels == 1 ? GL_R8 : channels == 2 ? GL_RG8 : channels == 3 ? GL_RGB8 : GL_RGBA8;
+}
+
+static GLenum PixelFormat(int channels) {
+    return channels == 1 ? GL_RED : channels == 2 ? GL_RG : channels == 3 ? GL_RGB : GL_RGBA;
+}
+
+TextureManager& TextureManager::Instance() {
+    static TextureManager manager;
+    return manager;
+}
+
+bool TextureManager::LoadTextureStorage(GLADloadproc load) {
+    texStorage2D = nullptr;
+    if (GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 2))
+        texStorage2D = (PFNGLTEXSTORAGE2DPROC)load("glTexStorage2D");
+
+    s3tcSupported = false;
+    bptcSupported = GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 2);
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i) {
+        const char* ext = (const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+        if (!ext) continue;
+        if (std::strcmp(ext, "GL_EXT_texture_compression_s3tc") == 0) s3tcSupported = true;
+        else if (std::strcmp(ext, "GL_ARB_texture_compression_bptc") == 0) bptcSupported = true;
+    }
+    return texStorage2D != nullptr;
+}
+
+PreparedTexture::~PreparedTexture() {
+    if (shared) return;
+    for (const unsigned char* p : pixels) if (p) stbi_image_free((void*)p);
+}
+
+std::string TextureManager::PathKey(const std::vector<std::string>& paths, const TextureOptions& options) {
+    std::string key = "p";
+    for (const std::string& p : paths) {
+        std::error_code ec;
+        std::filesystem::path canonical = std::filesystem::weakly_canonical(p, ec);
+        key += (ec ? p : canonical.generic_string()) + (paths.size() > 1 ? ";" : "");
+    }
+    return key + OptionsKey(options);
+}
+
+// Decodes one image into out.pixels[face]; the faces of a cubemap must match the first
+static bool DecodeFace(const unsigned char* data, size_t size, const std::string& name, int face, PreparedTexture& out) {
+    // per thread: loads run on worker threads side by side
+    stbi_set_flip_vertically_on_load_thread(out.options.flipVertically);
+    int w = 0, h = 0, comp = 0;
+    out.pixels[face] = stbi_load_from_memory(data, (int)size, &w, &h, &comp, out.options.channels);
+    if (!out.pixels[face]) {
+        std::cerr << "TextureManager: failed to decode " << name << ": " << stbi_failure_reason() << "\n";
+        return false;
+    }
+    int channels = out.options.channels ? out.options.channels : comp;
+    if (face == 0) {
+        out.width = w;
+        out.height = h;
+        out.channels = channels;
+    }
+    else if (w != out.width || h != out.height || channels != out.channels) {
+        std::cerr << "TextureManager: cubemap face " << name << " does not match " << out.name << "\n";
+        return false;
+    }
+    return true;
+}
+
+// Decoded images in the SharedCache: this header, then the faces' pixels back to back
+const char kSharedImageMagic[8] = { 'T', 'J', 'I', 'M', 'A', 'G', 'E', 0 };
+const uint32_t kSharedImageVersion = 1;
+
+struct SharedImageHeader {
+    char magic[8];
+    uint32_t version;
+    int32_t width, height, channels, faces;
+    uint32_t reserved;
+};
+
+// key: the bytes of every source (their hashes), and the options decoding depends on
+static uint64_t SharedImageKey(const std::vector<uint64_t>& sourceHashes, const TextureOptions& options) {
+    uint64_t key = SharedKey(kSharedKeySeed, kSharedImageMagic, sizeof(kSharedImageMagic));
+    for (uint64_t h : sourceHashes) key = SharedKey(key, h);
+    return SharedKey(SharedKey(key, options.flipVertically), (uint64_t)options.channels);
+}
+
+static bool OpenSharedImage(uint64_t key, PreparedTexture& out) {
+    auto file = std::make_shared<MappedFile>();
+    if (!OpenSharedEntry(key, *file) || file->Size() < sizeof(SharedImageHeader)) return false;
+    SharedImageHeader h;
+    std::memcpy(&h, file->Data(), sizeof(h));
+    if (std::memcmp(h.magic, kSharedImageMagic, sizeof(h.magic)) != 0 || h.version != kSharedImageVersion ||
+        h.faces != out.faces || h.width <= 0 || h.height <= 0 || h.channels < 1 || h.channels > 4) return false;
+    const size_t faceBytes = (size_t)h.width * h.height * h.channels;
+    if (file->Size() != sizeof(h) + faceBytes * h.faces) return false;
+    out.width = h.width;
+    out.height = h.height;
+    out.channels = h.channels;
+    for (int f = 0; f < out.faces; ++f) out.pixels[f] = file->Data() + sizeof(h) + f * faceBytes;
+    out.shared = std::move(file);
+    return true;
+}
+
+// stores what DecodeFace produced for the next process that asks for the same image
+static void StoreSharedImage(uint64_t key, const PreparedTexture& out) {
+    const size_t faceBytes = (size_t)out.width * out.height * out.channels;
+    if (faceBytes * out.faces < kSharedCacheMinBytes) return;
+    SharedImageHeader h{};
+    std::memcpy(h.magic, kSharedImageMagic, sizeof(h.magic));
+    h.version = kSharedImageVersion;
+    h.width = out.width;
+    h.height = out.height;
+    h.channels = out.channels;
+    h.faces = out.faces;
+    std::vector<SharedPart> parts{ { &h, sizeof(h) } };
+    for (int f = 0; f < out.faces; ++f) parts.push_back({ out.pixels[f], faceBytes });
+    WriteSharedEntry(key, parts);
+}
+
+// Opens the compressed cache of the source(s), building it when missing or stale.
+// False when the context cannot sample the cache's format or the cache cannot be
+// built; the caller then decodes the source as usual.
+static bool PrepareCompressed(const std::vector<std::string>& sources, PreparedTexture& out) {
+    if (!s3tcSupported) return false;
+    const bool cubemap = sources.size() == 6;
+    std::string cachePath = TextureCachePath(sources[0], out.options.flipVertically, cubemap);
+    auto file = std::make_shared<MappedFile>();
+    CompressedImage img;
+    if (!OpenTextureCache(cachePath, sources, *file, img)) {
+        std::cout << "TextureManager: compressing " << sources[0] << (cubemap ? " (cubemap)" : "") << "\n";
+        if (!BuildTextureCache(sources, out.options.flipVertically, bptcSupported, cachePath) ||
+            !OpenTextureCache(cachePath, sources, *file, img)) return false;
+    }
+    if (!FormatSupported(img.format)) return false;
+    // hashes the same bytes as the decoded path's content key, so both share
+    if (!cubemap) out.contentKey = "c" + std::to_string(img.sourceHash) + OptionsKey(out.options);
+    out.cache = std::move(file);
+    out.compressed = img;
+    return true;
+}
+
+// Every level of the decoded face(s), generated from the base level
+static GLuint UploadDecoded(const PreparedTexture& p, TextureInfo& info) {
+    const GLenum target = p.faces == 6 ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
+    const GLenum first = p.faces == 6 ? GL_TEXTURE_CUBE_MAP_POSITIVE_X : GL_TEXTURE_2D;
+    // RGB goes up as RGBA: drivers keep RGB8 at 4 bytes a texel anyway, and widening
+    // it here (ImageKernels) spares them their own per-texel conversion
+    const int channels = p.channels == 3 ? 4 : p.channels;
+    info.width = p.width;
+    info.height = p.height;
+    info.channels = channels;
+    info.levels = LevelCount(p.width, p.height, p.options.mipmaps);
+    info.hasAlpha = p.channels == 4;
+    info.internalFormat = SizedFormat(channels);
+    info.bytes = LevelBytes(info.internalFormat, p.width, p.height, info.levels, p.faces);
+
+    GLuint tex = 0;
+    glGenTextures(1, &tex);
+    glBindTexture(target, tex);
+    AllocateStorage(target, info.internalFormat, p.width, p.height, info.levels, PixelFormat(channels), GL_UNSIGNED_BYTE);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    std::vector<unsigned char> rgba;
+    for (int f = 0; f < p.faces; ++f) {
+        const unsigned char* pixels = p.pixels[f];
+        if (p.channels == 3) {
+            rgba.resize((size_t)p.width * p.height * 4);
+            ExpandRgbToRgba(pixels, rgba.data(), (size_t)p.width * p.height);
+            pixels = rgba.data();
+        }
+        glTexSubImage2D(first + f, 0, 0, 0, p.width, p.height, PixelFormat(channels), GL_UNSIGNED_BYTE, pixels);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    if (p.options.mipmaps) glGenerateMipmap(target);
+    SetSampling(target, p.options);
+    return tex;
+}
+
+GLuint TextureManager::Share(const std::string& key, TextureInfo* info) {
+    auto it = byPath.find(key);
+    if (it == byPath.end()) {
+        it = byContent.find(key);
+        if (it == byContent.end()) return 0;
+    }
+    Entry& e = entries[it->second];
+    ++e.refs;
+    if (info) *info = e.info;
+    return it->second;
+}
+
+GLuint TextureManager::Adopt(GLuint tex, const TextureInfo& info, std::vector<std::string> keys, TextureInfo* outInfo) {
+    Entry& e = entries[tex];
+    e.info = info;
+    e.refs = 1;
+    e.keys = std::move(keys);
+    e.lastUsed = frame; // loaded to be drawn: stream it in even before the first Touch
+    for (const std::string& k : e.keys) (k[0] == 'p' ? byPath : byContent)[k] = tex;
+    residentBytes += info.bytes;
+    if (outInfo) *outInfo = info;
+    return tex;
+}
+
+bool TextureManager::Prepare(const std::vector<std::string>& paths, const TextureOptions& options, PreparedTexture& out) {
+    if (paths.size() != 1 && paths.size() != 6) {
+        std::cerr << "TextureManager: a cubemap needs 6 faces, got " << paths.size() << "\n";
+        return false;
+    }
+    if (paths[0].empty()) return false;
+    out.options = options;
+    out.name = paths[0];
+    out.faces = (int)paths.size();
+    out.pathKey = PathKey(paths, options);
+    if (options.compress && options.channels == 0 && PrepareCompressed(paths, out)) return true;
+
+    // with the SharedCache on, each image is decoded by one process on the host
+    const bool share = SharedCacheEnabled();
+    std::vector<MappedFile> files(out.faces);
+    std::vector<uint64_t> hashes;
+    for (int f = 0; f < out.faces; ++f) {
+        if (!files[f].Open(paths[f])) return false;
+        if (out.faces == 1 || share) hashes.push_back(Fnv1a(files[f].Data(), files[f].Size()));
+    }
+    // same bytes under another name (copied textures, shared material images)
+    if (out.faces == 1) out.contentKey = "c" + std::to_string(hashes[0]) + OptionsKey(options);
+    const uint64_t key = share ? SharedImageKey(hashes, options) : 0;
+    if (share && OpenSharedImage(key, out)) return true;
+
+    for (int f = 0; f < out.faces; ++f) {
+        if (!DecodeFace(files[f].Data(), files[f].Size(), paths[f], f, out)) return false;
+    }
+    if (share) StoreSharedImage(key, out);
+    return true;
+}
+
+bool TextureManager::PrepareFromMemory(const unsigned char* data, size_t size, const TextureOptions& options,
+    PreparedTexture& out)
+{
+    if (!data || size == 0) return false;
+    out.options = options;
+    out.name = "embedded image";
+    const uint64_t hash = Fnv1a(data, size);
+    out.contentKey = "c" + std::to_string(hash) + OptionsKey(options);
+    const bool share = SharedCacheEnabled();
+    const uint64_t key = share ? SharedImageKey({ hash }, options) : 0;
+    if (share && OpenSharedImage(key, out)) return true;
+    if (!DecodeFace(data, size, out.name, 0, out)) return false;
+    if (share) StoreSharedImage(key, out);
+    return true;
+}
+
+GLuint TextureManager::Find(const std::vector<std::string>& paths, const TextureOptions& options, TextureInfo* info) {
+    if (paths.empty()) return 0;
+    return Share(PathKey(paths, options), info);
+}
+
+GLuint TextureManager::Finish(PreparedTexture& p, TextureInfo* info) {
+    // loaded meanwhile under this name, or these bytes under another
+    if (!p.pathKey.empty()) {
+        if (GLuint tex = Share(p.pathKey, info)) return tex;
+    }
+    if (!p.contentKey.empty()) {
+        if (GLuint tex = Share(p.contentKey, info)) {
+            if (!p.pathKey.empty()) {
+                entries[tex].keys.push_back(p.pathKey);
+                byPath[p.pathKey] = tex;
+            }
+            return tex;
+        }
+    }
+    std::vector<std::string> keys;
+    if (!p.pathKey.empty()) keys.push_back(p.pathKey);
+    if (!p.contentKey.empty()) keys.push_back(p.contentKey);
+    TextureInfo uploaded;
+    if (!p.cache) {
+        if (!p.pixels[0]) return 0;
+        return Adopt(UploadDecoded(p, uploaded), uploaded, std::move(keys), info);
+    }
+
+    // streamed: the levels above kStreamResidentSize arrive later (even without
+    // mipmaps, which then only sample the base level)
+    const CompressedImage& img = p.compressed;
+    int levels = p.options.mipmaps || p.options.stream ? img.levels : 1, minLevel = 0;
+    while (minLevel + 1 < levels &&
+        std::max(img.width >> minLevel, img.height >> minLevel) > kStreamResidentSize) ++minLevel;
+    GLuint tex = UploadCompressed(img, levels, p.options.stream ? minLevel : 0, p.options, uploaded);
+    Adopt(tex, uploaded, std::move(keys), info);
+    // the rest is BeginFrame's: it streams the missing levels in as the budget allows
+    Entry& e = entries[tex];
+    e.file = p.cache;
+    e.img = img;
+    e.minLevel = minLevel;
+    return tex;
+}
+
+GLuint TextureManager::Load(const std::string& path, const TextureOptions& options, TextureInfo* info) {
+    if (path.empty()) return 0;
+    if (GLuint tex = Find({ path }, options, info)) return tex;
+    PreparedTexture prepared;
+    if (!Prepare({ path }, options, prepared)) return 0;
+    return Finish(prepared, info);
+}
+
+GLuint TextureManager::LoadFromMemory(const unsigned char* data, size_t size, const TextureOptions& options, TextureInfo* info) {
+    PreparedTexture prepared;
+    if (!PrepareFromMemory(data, size, options, prepared)) return 0;
+    return Finish(prepared, info);
+}
+
+GLuint TextureManager::LoadCubemap(const std::vector<std::string>& faces, const TextureOptions& options, TextureInfo* info) {
+    if (faces.size() != 6) {
+        std::cerr << "TextureManager: a cubemap needs 6 faces, got " << faces.size() << "\n";
+        return 0;
+    }
+    if (GLuint tex = Find(faces, options, info)) return tex;
+    PreparedTexture prepared;
+    if (!Prepare(faces, options, prepared)) return 0;
+    return Finish(prepared, info);
+}
+
+GLuint TextureManager::Create(GLenum internalFormat, int width, int height, GLenum format, GLenum type,
+    const void* pixels, const TextureOptions& options)
+{
+    if (width <= 0 || height <= 0) return 0;
+    TextureInfo info;
+    info.width = width;
+    info.height = height;
+    info.channels = format == GL_RED ? 1 : format == GL_RG ? 2 : format == GL_RGB ? 3 : 4;
+    info.levels = LevelCount(width, height, options.mipmaps);
+    info.hasAlpha = format == GL_RGBA;
+    info.internalFormat = internalFormat;
+    info.bytes = LevelBytes(internalFormat, width, height, info.levels, 1);
+
+    GLuint tex = 0;
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    AllocateStorage(GL_TEXTURE_2D, internalFormat, width, height, info.levels, format, type);
+    if (pixels) {
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, format, type, pixels);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        if (options.mipmaps) glGenerateMipmap(GL_TEXTURE_2D);
+    }
+    SetSampling(GL_TEXTURE_2D, options);
+    return Adopt(tex, info, {}, nullptr);
+}
+
+void TextureManager::Acquire(GLuint tex) {
+    auto it = entries.find(tex);
+    if (it != entries.end()) ++it->second.refs;
+}
+
+void TextureManager::Release(GLuint tex) {
+    auto it = entries.find(tex);
+    if (it == entries.end() || --it->second.refs > 0) return;
+    streamer.Cancel(tex);
+    for (const std::string& k : it->second.keys) (k[0] == 'p' ? byPath : byContent).erase(k);
+    residentBytes -= it->second.info.bytes;
+    glDeleteTextures(1, &tex);
+    entries.erase(it);
+}
+
+void TextureManager::Clear() {
+    streamer.Clear();
+    for (auto& e : entries) glDeleteTextures(1, &e.first);
+    entries.clear();
+    byPath.clear();
+    byContent.clear();
+    residentBytes = 0;
+}
+
+void TextureManager::Touch(GLuint tex) {
+    auto it = entries.find(tex);
+    if (it != entries.end()) it->second.lastUsed = frame;
+}
+
+// Frees tex's largest resident level; the next one is sampled from the next draw
+void TextureManager::DropLevel(GLuint tex, Entry& e) {
+    const int level = e.info.baseLevel;
+    const GLenum target = e.img.faces == 6 ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
+    const GLenum first = e.img.faces == 6 ? GL_TEXTURE_CUBE_MAP_POSITIVE_X : GL_TEXTURE_2D;
+    glBindTexture(target, tex);
+    glTexParameteri(target, GL_TEXTURE_BASE_LEVEL, level + 1);
+    for (int f = 0; f < e.img.faces; ++f)
+        glCompressedTexImage2D(first + f, level, e.info.internalFormat, 0, 0, 0, 0, nullptr);
+    size_t bytes = e.img.LevelSize(level) * e.img.faces;
+    e.info.baseLevel = level + 1;
+    e.info.bytes -= bytes;
+    residentBytes -= bytes;
+}
+
+void TextureManager::LevelStreamed(GLuint tex, int level) {
+    auto it = entries.find(tex);
+    if (it == entries.end()) return;
+    Entry& e = it->second;
+    size_t bytes = e.img.LevelSize(level) * e.img.faces;
+    e.info.baseLevel = level;
+    e.info.bytes += bytes;
+    residentBytes += bytes;
+}
+
+size_t TextureManager::BeginFrame(size_t streamBytes) {
+    ++frame;
+    // least recently drawn first
+    std::vector<std::pair<unsigned, GLuint>> lru;
+    for (const auto& e : entries)
+        if (e.second.file) lru.push_back({ e.second.lastUsed, e.first });
+    std::sort(lru.begin(), lru.end());
+
+    // over budget: stop what is streaming in, then give back the largest levels
+    size_t committed = residentBytes + streamer.PendingBytes();
+    for (size_t i = 0; budget && committed > budget && i < lru.size(); ++i) {
+        GLuint tex = lru[i].second;
+        Entry& e = entries[tex];
+        if (streamer.Streaming(tex)) {
+            streamer.Cancel(tex);
+            committed = residentBytes + streamer.PendingBytes();
+        }
+        while (committed > budget && e.info.baseLevel < e.minLevel) {
+            committed -= e.img.LevelSize(e.info.baseLevel) * e.img.faces;
+            DropLevel(tex, e);
+        }
+    }
+
+    // the most recently drawn get their missing levels back, as many as fit
+    for (size_t i = lru.size(); i-- > 0;) {
+        GLuint tex = lru[i].second;
+        Entry& e = entries[tex];
+        if (frame - e.lastUsed > kResidencyRecentFrames) break;
+        if (e.info.baseLevel == 0 || streamer.Streaming(tex)) continue;
+        int level = e.info.baseLevel;
+        while (level > 0) {
+            size_t bytes = e.img.LevelSize(level - 1) * e.img.faces;
+            if (budget && committed + bytes > budget) break;
+            committed += bytes;
+            --level;
+        }
+        streamer.Add(tex, e.file, e.img, e.info.baseLevel, level);
+    }
+    return streamer.Update(streamBytes);
+}
+
+const TextureInfo* TextureManager::Info(GLuint tex) const {
+    auto it = entries.find(tex);
+    return it == entries.end() ? nullptr : &it->second.info;
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+// TextureManager.h - owner of every texture decoded from an image: shared by path and
+// by content, reference counted, kept within a VRAM budget
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <memory>
+#include <vector>
+#include "TextureStreamer.h"
+
+// How an image becomes a texture. Part of the sharing key: the same file asked for
+// with different options is a different texture.
+struct TextureOptions {
+    bool flipVertically = true;   // UVs with the origin at the bottom (OBJ); false for glTF, cubemaps, fonts
+    bool mipmaps = true;          // full chain + trilinear, else the base level + linear
+    int channels = 0;             // force 1-4 channels; 0 keeps the file's
+    GLenum wrap = GL_REPEAT;
+    // BCn with pre-built mips from a DDS cache next to the file (TextureCache.h),
+    // built on first load; Load and LoadCubemap without forced channels only
+    bool compress = true;
+    // compressed only: start with the mips up to kStreamResidentSize and let
+    // BeginFrame() upload the larger ones over the next frames
+    bool stream = true;
+};
+
+// largest mip (width or height) a streamed texture is created with, and the
+// smallest a compressed texture is ever cut down to
+const int kStreamResidentSize = 64;
+// default upload budget of TextureManager::BeginFrame, per frame
+const size_t kStreamBytesPerFrame = 4u << 20;
+// default TextureManager budget
+const size_t kTextureBudgetBytes = 256u << 20;
+// a texture bound within this many frames gets its dropped mips back when they fit
+const unsigned kResidencyRecentFrames = 8;
+
+// The CPU half of a load: filled by TextureManager::Prepare on any thread, turned
+// into a texture by TextureManager::Finish on the GL thread
+struct PreparedTexture {
+    PreparedTexture() = default;
+    ~PreparedTexture();
+    PreparedTexture(const PreparedTexture&) = delete;
+    PreparedTexture& operator=(const PreparedTexture&) = delete;
+
+    TextureOptions options;
+    std::string name;                   // first path, for messages
+    std::string pathKey, contentKey;    // sharing keys, either may be empty
+    int faces = 1;
+    // from the compressed cache
+    std::shared_ptr<MappedFile> cache;
+    CompressedImage compressed;
+    // else decoded by stb_image, one image per face, or mapped from the SharedCache
+    int width = 0, height = 0, channels = 0;
+    const unsigned char* pixels[6] = {};
+    std::shared_ptr<MappedFile> shared;  // holds the pixels when they are mapped
+};
+
+struct TextureInfo {
+    int width = 0, height = 0;
+    int channels = 0;             // as uploaded
+    int levels = 1;
+    int baseLevel = 0;            // largest level resident (compressed: grows and shrinks)
+    bool hasAlpha = false;        // four channels
+    GLenum internalFormat = 0;
+    size_t bytes = 0;             // resident levels (and faces), as allocated
+};
+
+// Load* return the existing texture (one more reference) when the same path, or
+// an image with the same bytes, was already loaded with the same options; every
+// successful Load*/Create is paired with a Release. GL thread only, except Prepare*.
+//
+// Residency: textures from the compressed cache are specified level by level, so
+// their largest mips can be freed and brought back under the same name. Each frame
+// BeginFrame weighs the resident bytes plus those on their way in against the
+// budget; when over, the least recently Touch()ed textures lose their largest
+// levels first (never below kStreamResidentSize), and textures drawn lately
+// stream theirs back while they fit. Decoded and Created textures count toward the
+// usage but are never cut down.
+class TextureManager {
+public:
+    static TextureManager& Instance();
+
+    // glad.c is generated for GL 3.3, so glTexStorage2D (4.2) is fetched here; call
+    // once after gladLoadGLLoader. Without it every level is specified up front with
+    // glTexImage2D instead, which allocates the same. Also records which BCn formats
+    // the context takes (S3TC for BC1/BC3, BPTC for BC7); without S3TC nothing is
+    // compressed. Returns whether glTexStorage2D was found.
+    static bool LoadTextureStorage(GLADloadproc load);
+
+    // PNG/JPEG/... through stb_image; 0 (with a message on std::cerr) on failure
+    GLuint Load(const std::string& path, const TextureOptions& options = TextureOptions(), TextureInfo* info = nullptr);
+    GLuint LoadFromMemory(const unsigned char* data, size_t size, const TextureOptions& options = TextureOptions(),
+        TextureInfo* info = nullptr);
+    // faces in GL order (+X, -X, +Y, -Y, +Z, -Z), all the same size
+    GLuint LoadCubemap(const std::vector<std::string>& faces, const TextureOptions& options, TextureInfo* info = nullptr);
+    // Load* in two halves, for loading off the GL thread. Prepare decodes the image
+    // (one path, or six cubemap faces) or opens its compressed cache, building it when
+    // needed; it touches nothing shared, so any thread may call it. Finish returns the
+    // texture loaded meanwhile under the same path or bytes, else uploads the result.
+    static bool Prepare(const std::vector<std::string>& paths, const TextureOptions& options, PreparedTexture& out);
+    static bool PrepareFromMemory(const unsigned char* data, size_t size, const TextureOptions& options,
+        PreparedTexture& out);
+    GLuint Finish(PreparedTexture& prepared, TextureInfo* info = nullptr);
+    // the texture already loaded from paths with options (one more reference), else 0
+    GLuint Find(const std::vector<std::string>& paths, const TextureOptions& options, TextureInfo* info = nullptr);
+    // the name Find looks paths up under
+    static std::string PathKey(const std::vector<std::string>& paths, const TextureOptions& options);
+    // texture from raw pixels, never shared (e.g. generated data)
+    GLuint Create(GLenum internalFormat, int width, int height, GLenum format, GLenum type, const void* pixels,
+        const TextureOptions& options);
+
+    void Acquire(GLuint tex);
+    // deletes the texture with its last reference; names it does not own are ignored
+    void Release(GLuint tex);
+    // deletes every texture; call before the context goes away
+    void Clear();
+
+    // once per frame, before drawing: applies the budget, then uploads up to
+    // streamBytes of mips, never waiting on the GPU; returns the bytes sent
+    size_t BeginFrame(size_t streamBytes = kStreamBytesPerFrame);
+    // marks tex as drawn this frame; call where it is bound
+    void Touch(GLuint tex);
+    // 0 = unlimited; a lower budget takes effect at the next BeginFrame
+    void SetBudget(size_t bytes) { budget = bytes; }
+    size_t Budget() const { return budget; }
+
+    const TextureInfo* Info(GLuint tex) const;
+    size_t ResidentBytes() const { return residentBytes; }
+    size_t StreamingBytes() const { return streamer.PendingBytes(); }
+    size_t TextureCount() const { return entries.size(); }
+
+private:
+    struct Entry {
+        TextureInfo info;
+        int refs = 0;
+        std::vector<std::string> keys; // byPath / byContent entries naming it
+        unsigned lastUsed = 0;         // frame of the last Touch
+        // compressed only: the cache the dropped levels come back from
+        std::shared_ptr<MappedFile> file;
+        CompressedImage img;
+        int minLevel = 0;              // largest level it may be cut down to
+    };
+
+    GLuint Share(const std::string& key, TextureInfo* info);
+    GLuint Adopt(GLuint tex, const TextureInfo& info, std::vector<std::string> keys, TextureInfo* outInfo);
+    void DropLevel(GLuint tex, Entry& e);
+    void LevelStreamed(GLuint tex, int level);
+
+    std::unordered_map<GLuint, Entry> entries;
+    std::unordered_map<std::string, GLuint> byPath;    // canonical path + options
+    std::unordered_map<std::string, GLuint> byContent; // content hash + options
+    size_t residentBytes = 0;
+    size_t budget = kTextureBudgetBytes;
+    unsigned frame = 0;
+    TextureStreamer streamer{ [this](GLuint tex, int level) { LevelStreamed(tex, level); } };
+};
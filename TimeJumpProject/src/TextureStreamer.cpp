@@ -0,0 +1,132 @@
+// TextureStreamer.cpp
+#include "TextureStreamer.h"
+
+#include <algorithm>
+#include <cstring>
+
+static size_t LevelPixels(const CompressedImage& img, int level) {
+    return (size_t)std::max(1, img.width >> level) * std::max(1, img.height >> level);
+}
+
+// Specifies (width, height > 0) or frees (0 x 0) one level on every face of the
+// bound texture; no PBO may be bound
+static void SpecifyLevel(const CompressedImage& img, int level, bool allocate) {
+    const GLenum first = img.faces == 6 ? GL_TEXTURE_CUBE_MAP_POSITIVE_X : GL_TEXTURE_2D;
+    const int w = allocate ? std::max(1, img.width >> level) : 0, h = allocate ? std::max(1, img.height >> level) : 0;
+    for (int f = 0; f < img.faces; ++f)
+        glCompressedTexImage2D(first + f, level, BlockGLFormat(img.format), w, h, 0,
+            allocate ? (GLsizei)img.LevelSize(level) : 0, nullptr);
+}
+
+void TextureStreamer::Add(GLuint tex, std::shared_ptr<MappedFile> file, const CompressedImage& img, int residentLevel,
+    int lastLevel)
+{
+    if (tex == 0 || residentLevel <= std::max(0, lastLevel)) return;
+    Job job;
+    job.tex = tex;
+    job.file = std::move(file);
+    job.img = img;
+    job.level = residentLevel - 1;
+    job.lastLevel = std::max(0, lastLevel);
+    jobs.push_back(std::move(job));
+}
+
+void TextureStreamer::Cancel(GLuint tex) {
+    for (const Job& j : jobs) {
+        if (j.tex != tex || !j.allocated) continue;
+        glBindTexture(j.img.faces == 6 ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D, tex);
+        SpecifyLevel(j.img, j.level, false);
+    }
+    jobs.erase(std::remove_if(jobs.begin(), jobs.end(), [&](const Job& j) { return j.tex == tex; }), jobs.end());
+}
+
+bool TextureStreamer::Streaming(GLuint tex) const {
+    return std::any_of(jobs.begin(), jobs.end(), [&](const Job& j) { return j.tex == tex; });
+}
+
+size_t TextureStreamer::PendingBytes() const {
+    size_t bytes = 0;
+    for (const Job& j : jobs)
+        for (int l = j.lastLevel; l <= j.level; ++l) bytes += j.img.LevelSize(l) * j.img.faces;
+    return bytes;
+}
+
+size_t TextureStreamer::Update(size_t budgetBytes) {
+    size_t sent = 0;
+    bool bound = false;
+    while (!jobs.empty() && sent < budgetBytes) {
+        Slot& slot = slots[nextSlot];
+        if (slot.fence) {
+            if (glClientWaitSync(slot.fence, 0, 0) == GL_TIMEOUT_EXPIRED) break; // still being read: next frame
+            glDeleteSync(slot.fence);
+            slot.fence = nullptr;
+        }
+
+        // the smallest pending level first, so every texture sharpens at the same pace
+        auto it = std::min_element(jobs.begin(), jobs.end(), [](const Job& a, const Job& b) {
+            return LevelPixels(a.img, a.level) < LevelPixels(b.img, b.level);
+        });
+        Job& job = *it;
+        const CompressedImage& img = job.img;
+        const int w = std::max(1, img.width >> job.level), h = std::max(1, img.height >> job.level);
+        const int blocksY = (h + 3) / 4;
+        const size_t rowBytes = (size_t)((w + 3) / 4) * BlockBytes(img.format);
+        size_t room = std::min(kStreamSlotBytes, budgetBytes - sent);
+        if (room < rowBytes && sent > 0) break;
+        int rows = std::min(blocksY - job.blockRow, (int)std::max<size_t>(1, room / rowBytes));
+        size_t bytes = (size_t)rows * rowBytes;
+
+        const GLenum target = img.faces == 6 ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
+        const GLenum face = img.faces == 6 ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + job.face : GL_TEXTURE_2D;
+        glBindTexture(target, job.tex);
+        if (!job.allocated) {
+            // levels below the base are not sampled, so the empty one is never seen
+            if (bound) glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            SpecifyLevel(img, job.level, true);
+            job.allocated = true;
+        }
+
+        if (slot.pbo == 0) glGenBuffers(1, &slot.pbo);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+        bound = true;
+        if (slot.size < bytes) {
+            slot.size = std::max(bytes, kStreamSlotBytes);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)slot.size, nullptr, GL_STREAM_DRAW);
+        }
+        void* dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (!dst) break;
+        std::memcpy(dst, img.Level(job.face, job.level) + (size_t)job.blockRow * rowBytes, bytes);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        const int y = job.blockRow * 4;
+        glCompressedTexSubImage2D(face, job.level, 0, y, w, std::min(rows * 4, h - y), BlockGLFormat(img.format),
+            (GLsizei)bytes, nullptr);
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        nextSlot = (nextSlot + 1) % kStreamSlots;
+        sent += bytes;
+
+        job.blockRow += rows;
+        if (job.blockRow < blocksY) continue;
+        job.blockRow = 0;
+        if (++job.face < img.faces) continue;
+        job.face = 0;
+        // commands run in order: draws issued after this sample the new level
+        glTexParameteri(target, GL_TEXTURE_BASE_LEVEL, job.level);
+        if (onLevel) onLevel(job.tex, job.level);
+        job.allocated = false;
+        if (--job.level < job.lastLevel) jobs.erase(it);
+    }
+    // client-memory uploads elsewhere must not read from a PBO
+    if (bound) glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return sent;
+}
+
+void TextureStreamer::Clear() {
+    jobs.clear();
+    for (Slot& s : slots) {
+        if (s.fence) glDeleteSync(s.fence);
+        if (s.pbo) glDeleteBuffers(1, &s.pbo);
+        s = Slot();
+    }
+    nextSlot = 0;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+// TextureStreamer.h - uploads the large mips of cache-backed textures in small chunks per frame through a PBO ring
+#include <glad/glad.h>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "TextureCache.h"
+
+// slots in the PBO ring, and the size of each (larger block rows grow their slot)
+const int kStreamSlots = 4;
+const size_t kStreamSlotBytes = 1u << 20;
+
+// A texture is added with its small mips already uploaded (mutable, one
+// glCompressedTexImage2D per level) and GL_TEXTURE_BASE_LEVEL on the largest of them.
+// Update specifies the next level with no data, then copies it, a band of block rows
+// at a time, into a free PBO slot and issues glCompressedTexSubImage2D from it; once
+// a level has all its faces, the base level drops to it and the texture sharpens.
+// Smaller levels go first across all textures. A slot is reused only after the fence
+// behind its last upload signals, so Update never waits on the GPU. GL thread only.
+class TextureStreamer {
+public:
+    // onLevel runs once a level is complete and sampled (the texture's new base level)
+    explicit TextureStreamer(std::function<void(GLuint tex, int level)> onLevel = nullptr) : onLevel(std::move(onLevel)) {}
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    // levels lastLevel..residentLevel-1 are streamed from img, which points into file
+    void Add(GLuint tex, std::shared_ptr<MappedFile> file, const CompressedImage& img, int residentLevel, int lastLevel = 0);
+    // drops tex's remaining levels and frees a half-uploaded one (call before deleting it)
+    void Cancel(GLuint tex);
+    // uploads about budgetBytes (at least one block row when anything is pending);
+    // returns the bytes sent
+    size_t Update(size_t budgetBytes);
+    // deletes the PBOs and fences; call while the context is alive
+    void Clear();
+
+    bool Idle() const { return jobs.empty(); }
+    bool Streaming(GLuint tex) const;
+    // not yet sampled: the levels still to come, including the one in flight
+    size_t PendingBytes() const;
+
+private:
+    struct Job {
+        GLuint tex = 0;
+        std::shared_ptr<MappedFile> file; // keeps img's data mapped
+        CompressedImage img;
+        int level = 0;      // being uploaded; the ones above it are resident
+        int lastLevel = 0;  // done after this one
+        int face = 0;
+        int blockRow = 0;
+        bool allocated = false; // level specified on every face
+    };
+    struct Slot {
+        GLuint pbo = 0;
+        size_t size = 0;
+        GLsync fence = nullptr;
+    };
+
+    std::function<void(GLuint, int)> onLevel;
+    std::vector<Job> jobs;
+    Slot slots[kStreamSlots];
+    int nextSlot = 0;
+};
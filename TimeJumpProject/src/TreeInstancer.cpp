@@ -2,32 +2,128 @@
 #include <random>
 #include <glm/gtc/matrix_transform.hpp>
 #include <iostream>
+#include <cmath>
+#include <algorithm>
+#include <chrono>
 
 #include "Terrain.h" 
+#include "Parallel.h"
+#include "Frustum.h"
+#include "Shader.h"
+#include "TextureManager.h"
 
-TreeInstancer::TreeInstancer() : instanceVBO(0) {}
+// spare slots per live instance reserved in every cell for AddInstance
+static const float kCellSlack = 0.25f;
+// dirty slots closer than this are uploaded as one range (8 * 64 bytes beats another call)
+static const uint32_t kMaxUploadGap = 8;
+// overflow size that starts a background compaction (at least, or 1/8 of the live count)
+static const uint32_t kCompactMinOverflow = 256;
+
+// world-space radius of one instance (uniform scale assumed)
+static float InstanceRadius(float meshRadius, const glm::mat4& m) {
+    return meshRadius * glm::length(glm::vec3(m[0]));
+}
+
+// Grid + slot tables for a set of live instances. Runs on the compaction thread,
+// so it only touches its arguments.
+static TreeLayout BuildLayout(const std::vector<TreeHandle>& handles, const std::vector<glm::mat4>& mats,
+    const std::vector<glm::vec4>& growth, size_t handleCount, float meshRadius, float cellSize)
+{
+    std::vector<glm::vec3> positions(mats.size());
+    std::vector<float> radii(mats.size());
+    for (size_t i = 0; i < mats.size(); ++i) {
+        positions[i] = glm::vec3(mats[i][3]);
+        radii[i] = InstanceRadius(meshRadius, mats[i]);
+    }
+
+    TreeLayout layout;
+    std::vector<uint32_t> order;
+    layout.grid.Build(positions, radii, cellSize, order, kCellSlack);
+
+    layout.mats.assign(order.size(), glm::mat4(0.0f));
+    layout.growth.assign(order.size(), kDefaultGrowth);
+    layout.slotHandle.assign(order.size(), kInvalidTree);
+    layout.handleSlot.assign(handleCount, VegetationGrid::kNoInstance);
+    for (size_t slot = 0; slot < order.size(); ++slot) {
+        if (order[slot] == VegetationGrid::kNoInstance) continue;
+        TreeHandle h = handles[order[slot]];
+        layout.mats[slot] = mats[order[slot]];
+        layout.growth[slot] = growth[order[slot]];
+        layout.slotHandle[slot] = h;
+        layout.handleSlot[h] = (uint32_t)slot;
+    }
+    return layout;
+}
+
+TreeInstancer::TreeInstancer() {}
 TreeInstancer::~TreeInstancer() {
-    if (instanceVBO) {
-        glDeleteBuffers(1, &instanceVBO);
-        instanceVBO = 0;
+    WaitForSort();
+    for (int b = 0; b < 2; ++b) {
+        if (sortedVBO[b][0]) glDeleteBuffers(2, sortedVBO[b]);
+    }
+    for (TreeSpecies& sp : species) {
+        WaitForCompaction(sp);
+        if (sp.instanceVBO) {
+            glDeleteBuffers(1, &sp.instanceVBO);
+            sp.instanceVBO = 0;
+        }
+        if (sp.growthVBO) {
+            glDeleteBuffers(1, &sp.growthVBO);
+            sp.growthVBO = 0;
+        }
     }
 }
 
-void TreeInstancer::GenerateInstances(int count,
+int TreeInstancer::AddSpecies(const MeshGL_Model& mesh, int era) {
+    WaitForSort(); // the job holds a reference into 'species'
+    TreeSpecies sp;
+    sp.mesh = &mesh;
+    sp.era = era;
+    // object-space bounding radius around the root, scaled per instance
+    sp.meshRadius = std::max(glm::length(mesh.boundsMin), glm::length(mesh.boundsMax));
+    species.push_back(std::move(sp));
+    return (int)species.size() - 1;
+}
+
+size_t TreeInstancer::TotalInstanceCount() const {
+    size_t n = 0;
+    for (const TreeSpecies& sp : species) n += sp.grid.LiveCount();
+    return n;
+}
+
+void TreeInstancer::Clear(int s) {
+    TreeSpecies& sp = species[s];
+    WaitForSort();
+    WaitForCompaction(sp);
+    sp.mats.clear();
+    sp.growth.clear();
+    sp.grid.Clear();
+    sp.slotHandle.clear();
+    sp.handleSlot.clear();
+    sp.freeHandles.clear();
+    sp.dirtySlots.clear();
+}
+
+void TreeInstancer::GenerateInstances(int s, int count,
     float minX, float maxX,
     float minZ, float maxZ,
     const Terrain& terrain,
-    float minScale, float maxScale)
+    float minScale, float maxScale,
+    uint32_t seed)
 {
-    mats.clear();
-    std::random_device rd;
-    std::mt19937 rng(rd());
+    Clear(s);
+    if (count <= 0) return;
+    std::vector<glm::mat4> mats;
+    mats.reserve(count);
+    std::mt19937 rng(seed);
     std::uniform_real_distribution<float> distX(minX, maxX);
     std::uniform_real_distribution<float> distZ(minZ, maxZ);
     std::uniform_real_distribution<float> distScale(minScale, maxScale);
     std::uniform_real_distribution<float> distRot(0.0f, glm::two_pi<float>());
 
-    for (int i = 0; i < count; ++i) {
+    // retry rejected (off-terrain) samples, bounded so bad bounds cannot spin forever
+    const int maxAttempts = count * 8;
+    for (int attempt = 0; attempt < maxAttempts && (int)mats.size() < count; ++attempt) {
         float x = distX(rng);
         float z = distZ(rng);
         float y = terrain.GetHeightAt(x, z);
@@ -37,37 +133,545 @@ void TreeInstancer::GenerateInstances(int count,
         M = glm::translate(M, glm::vec3(x, y, z));
         float rot = distRot(rng);
         M = glm::rotate(M, rot, glm::vec3(0, 1, 0));
-        float s = distScale(rng);
-        M = glm::scale(M, glm::vec3(s));
+        float sc = distScale(rng);
+        M = glm::scale(M, glm::vec3(sc));
         mats.push_back(M);
     }
+    if ((int)mats.size() < count) {
+        std::cerr << "TreeInstancer: placed " << mats.size() << " of " << count
+            << " trees (bounds mostly off the terrain)\n";
+    }
+
+    std::vector<TreeHandle> handles(mats.size());
+    for (size_t i = 0; i < handles.size(); ++i) handles[i] = (TreeHandle)i;
+    ResetLayout(species[s], handles, mats, std::vector<glm::vec4>(mats.size(), kDefaultGrowth), mats.size());
 }
 
-void TreeInstancer::UploadInstancesToGPU(const MeshGL_Model& mesh) {
-    if (instanceVBO == 0) glGenBuffers(1, &instanceVBO);
-    glBindVertexArray(mesh.VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
-    glBufferData(GL_ARRAY_BUFFER, mats.size() * sizeof(glm::mat4), mats.data(), GL_STATIC_DRAW);
+ScatterStats TreeInstancer::ScatterInstances(int s, const Terrain& terrain, const ScatterRules& rules) {
+    ScatterStats stats;
+    std::vector<ScatterInstance> scattered = ScatterVegetation(terrain, rules, &stats);
 
+    Clear(s);
+    std::vector<glm::mat4> mats(scattered.size());
+    std::vector<TreeHandle> handles(scattered.size());
+    const size_t chunk = 16384;
+    ParallelFor((scattered.size() + chunk - 1) / chunk, [&](size_t c) {
+        size_t end = std::min(scattered.size(), (c + 1) * chunk);
+        for (size_t i = c * chunk; i < end; ++i) {
+            mats[i] = InstanceMatrix(scattered[i]);
+            handles[i] = (TreeHandle)i;
+        }
+    });
+    ResetLayout(species[s], handles, mats, std::vector<glm::vec4>(mats.size(), kDefaultGrowth), mats.size());
+    return stats;
+}
 
-    std::size_t vec4Size = sizeof(glm::vec4);
-    for (int i = 0; i < 4; i++) {
+void TreeInstancer::UploadInstancesToGPU(int s) {
+    TreeSpecies& sp = species[s];
+    if (!sp.mesh || sp.mesh->VAO == 0) return;
+    if (sp.instanceVBO == 0) glGenBuffers(1, &sp.instanceVBO);
+    if (sp.growthVBO == 0) glGenBuffers(1, &sp.growthVBO);
+    glBindVertexArray(sp.mesh->VAO);
+    UploadDirty(sp, true);
+
+    for (int i = 0; i < 5; i++) {
         glEnableVertexAttribArray(3 + i);
-        glVertexAttribPointer(3 + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(i * vec4Size));
         glVertexAttribDivisor(3 + i, 1);
     }
+    BindInstanceRange(sp, 0);
 
     glBindVertexArray(0);
 }
 
-void TreeInstancer::DrawInstanced(const MeshGL_Model& mesh, int instanceCount)
+size_t TreeInstancer::UploadDirty(TreeSpecies& sp, bool all) {
+    const size_t n = sp.mats.size();
+    const size_t stride = sizeof(glm::mat4) + sizeof(glm::vec4);
+    size_t bytes = 0;
+
+    if (n > sp.gpuSlots || all || sp.uploadAll) {
+        // grow with headroom so a trickle of adds does not reallocate every frame;
+        // re-specifying the store also orphans the old one instead of stalling on it
+        if (n > sp.gpuSlots) sp.gpuSlots = std::max<size_t>(n + n / 2, 64);
+        glBindBuffer(GL_ARRAY_BUFFER, sp.instanceVBO);
+        glBufferData(GL_ARRAY_BUFFER, sp.gpuSlots * sizeof(glm::mat4), nullptr, GL_DYNAMIC_DRAW);
+        if (n > 0) glBufferSubData(GL_ARRAY_BUFFER, 0, n * sizeof(glm::mat4), sp.mats.data());
+        glBindBuffer(GL_ARRAY_BUFFER, sp.growthVBO);
+        glBufferData(GL_ARRAY_BUFFER, sp.gpuSlots * sizeof(glm::vec4), nullptr, GL_DYNAMIC_DRAW);
+        if (n > 0) glBufferSubData(GL_ARRAY_BUFFER, 0, n * sizeof(glm::vec4), sp.growth.data());
+        bytes = n * stride;
+    }
+    else if (!sp.dirtySlots.empty()) {
+        std::vector<uint32_t>& d = sp.dirtySlots;
+        std::sort(d.begin(), d.end());
+        d.erase(std::unique(d.begin(), d.end()), d.end());
+
+        // coalesce nearby slots; the clean ones in between are rewritten unchanged
+        size_t i = 0;
+        while (i < d.size() && d[i] < n) {
+            uint32_t first = d[i], last = d[i];
+            while (++i < d.size() && d[i] < n && d[i] - last <= kMaxUploadGap) last = d[i];
+            size_t count = (size_t)last - first + 1;
+            glBindBuffer(GL_ARRAY_BUFFER, sp.instanceVBO);
+            glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(glm::mat4), count * sizeof(glm::mat4), &sp.mats[first]);
+            glBindBuffer(GL_ARRAY_BUFFER, sp.growthVBO);
+            glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(glm::vec4), count * sizeof(glm::vec4), &sp.growth[first]);
+            bytes += count * stride;
+        }
+    }
+    sp.dirtySlots.clear();
+    sp.uploadAll = false;
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return bytes;
+}
+
+void TreeInstancer::BindInstanceRange(const TreeSpecies& sp, size_t first) {
+    BindInstanceBuffers(sp.instanceVBO, sp.growthVBO, first);
+}
+
+void TreeInstancer::BindInstanceBuffers(GLuint matVBO, GLuint growthVBO, size_t first) {
+    // GL 3.3 has no base-instance draws, so offset the instanced attributes instead.
+    // Always rebinding the species' own VBO also lets two species share one mesh VAO.
+    std::size_t vec4Size = sizeof(glm::vec4);
+    std::size_t base = first * sizeof(glm::mat4);
+    glBindBuffer(GL_ARRAY_BUFFER, matVBO);
+    for (int i = 0; i < 4; i++) {
+        glVertexAttribPointer(3 + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(base + i * vec4Size));
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, growthVBO);
+    glVertexAttribPointer(7, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)(first * vec4Size));
+}
+
+void TreeInstancer::BuildSpatialIndex(int s, float cellSize) {
+    TreeSpecies& sp = species[s];
+    WaitForCompaction(sp);
+    sp.cellSize = cellSize;
+
+    std::vector<TreeHandle> handles;
+    std::vector<glm::mat4> mats;
+    std::vector<glm::vec4> growth;
+    SnapshotLive(sp, handles, mats, growth);
+    ResetLayout(sp, handles, mats, growth, sp.handleSlot.size());
+}
+
+void TreeInstancer::SnapshotLive(const TreeSpecies& sp, std::vector<TreeHandle>& handles,
+    std::vector<glm::mat4>& mats, std::vector<glm::vec4>& growth)
 {
-    if (instanceCount <= 0) return;
-    if (mesh.VAO == 0 || mesh.indexCount == 0) return;
+    handles.reserve(sp.grid.LiveCount());
+    mats.reserve(sp.grid.LiveCount());
+    growth.reserve(sp.grid.LiveCount());
+    for (size_t slot = 0; slot < sp.slotHandle.size(); ++slot) {
+        if (sp.slotHandle[slot] == kInvalidTree) continue;
+        handles.push_back(sp.slotHandle[slot]);
+        mats.push_back(sp.mats[slot]);
+        growth.push_back(sp.growth[slot]);
+    }
+}
+
+void TreeInstancer::ResetLayout(TreeSpecies& sp, const std::vector<TreeHandle>& handles,
+    const std::vector<glm::mat4>& mats, const std::vector<glm::vec4>& growth, size_t handleCount)
+{
+    WaitForCompaction(sp);
+    TreeLayout layout = BuildLayout(handles, mats, growth, handleCount, sp.meshRadius, sp.cellSize);
+    ApplyCompaction(sp, layout);
+}
+
+void TreeInstancer::WaitForCompaction(TreeSpecies& sp) {
+    if (sp.compaction) sp.compaction->wait();
+    sp.compaction.reset();
+    sp.editLog.clear();
+}
+
+void TreeInstancer::ApplyCompaction(TreeSpecies& sp, TreeLayout& layout) {
+    WaitForSort();
+    sp.grid = std::move(layout.grid);
+    sp.mats = std::move(layout.mats);
+    sp.growth = std::move(layout.growth);
+    sp.slotHandle = std::move(layout.slotHandle);
+    // handles created after the snapshot are placed again by their logged Add
+    size_t handleCount = std::max(layout.handleSlot.size(), sp.handleSlot.size());
+    sp.handleSlot = std::move(layout.handleSlot);
+    sp.handleSlot.resize(handleCount, VegetationGrid::kNoInstance);
+
+    for (const TreeEdit& e : sp.editLog) ApplyEdit(sp, e);
+    sp.editLog.clear();
+    // slots all moved: the next FlushUpdates sends the whole buffer
+    sp.dirtySlots.clear();
+    sp.uploadAll = true;
+}
+
+void TreeInstancer::RequestCompaction(int s) {
+    TreeSpecies& sp = species[s];
+    if (sp.compaction) return;
+
+    // edits made until the result lands go to editLog
+    std::vector<TreeHandle> handles;
+    std::vector<glm::mat4> mats;
+    std::vector<glm::vec4> growth;
+    SnapshotLive(sp, handles, mats, growth);
+    size_t handleCount = sp.handleSlot.size();
+    float meshRadius = sp.meshRadius, cellSize = sp.cellSize;
+    sp.compaction = std::make_shared<std::future<TreeLayout>>(std::async(std::launch::async,
+        [handles = std::move(handles), mats = std::move(mats), growth = std::move(growth), handleCount, meshRadius, cellSize]() {
+            return BuildLayout(handles, mats, growth, handleCount, meshRadius, cellSize);
+        }));
+}
+
+void TreeInstancer::PlaceHandle(TreeSpecies& sp, TreeHandle h, const glm::mat4& m, const glm::vec4& growth) {
+    uint32_t slot = sp.grid.AllocateSlot(glm::vec3(m[3]), InstanceRadius(sp.meshRadius, m));
+    if (slot >= sp.mats.size()) {
+        sp.mats.resize((size_t)slot + 1, glm::mat4(0.0f));
+        sp.growth.resize((size_t)slot + 1, kDefaultGrowth);
+        sp.slotHandle.resize((size_t)slot + 1, kInvalidTree);
+    }
+    sp.mats[slot] = m;
+    sp.growth[slot] = growth;
+    sp.slotHandle[slot] = h;
+    sp.handleSlot[h] = slot;
+    sp.dirtySlots.push_back(slot);
+}
 
-    glBindVertexArray(mesh.VAO);
+void TreeInstancer::ReleaseSlot(TreeSpecies& sp, uint32_t slot) {
+    uint32_t moved = sp.grid.FreeSlot(slot);
+    if (moved != slot) {
+        // the cell's last instance filled the hole; mirror that in the matrices
+        sp.mats[slot] = sp.mats[moved];
+        sp.growth[slot] = sp.growth[moved];
+        TreeHandle h = sp.slotHandle[moved];
+        sp.slotHandle[slot] = h;
+        sp.handleSlot[h] = slot;
+        sp.dirtySlots.push_back(slot);
+    }
+    sp.slotHandle[moved] = kInvalidTree;
+}
+
+void TreeInstancer::ApplyEdit(TreeSpecies& sp, const TreeEdit& e) {
+    WaitForSort();
+    uint32_t slot = e.handle < sp.handleSlot.size() ? sp.handleSlot[e.handle] : VegetationGrid::kNoInstance;
+    switch (e.kind) {
+    case TreeEdit::Add:
+        if (e.handle >= sp.handleSlot.size()) sp.handleSlot.resize((size_t)e.handle + 1, VegetationGrid::kNoInstance);
+        PlaceHandle(sp, e.handle, e.mat, e.growth);
+        break;
+    case TreeEdit::Remove:
+        if (slot == VegetationGrid::kNoInstance) break;
+        ReleaseSlot(sp, slot);
+        sp.handleSlot[e.handle] = VegetationGrid::kNoInstance;
+        break;
+    case TreeEdit::Update:
+        if (slot == VegetationGrid::kNoInstance) break;
+        if (sp.grid.MoveSlot(slot, glm::vec3(e.mat[3]), InstanceRadius(sp.meshRadius, e.mat))) {
+            sp.mats[slot] = e.mat;
+            sp.dirtySlots.push_back(slot);
+        }
+        else {
+            // crossed into another cell
+            glm::vec4 g = sp.growth[slot];
+            ReleaseSlot(sp, slot);
+            PlaceHandle(sp, e.handle, e.mat, g);
+        }
+        break;
+    case TreeEdit::Grow:
+        if (slot == VegetationGrid::kNoInstance) break;
+        sp.growth[slot] = e.growth;
+        if (!sp.uploadAll) sp.dirtySlots.push_back(slot);
+        break;
+    }
+}
+
+TreeHandle TreeInstancer::AddInstance(int s, const glm::mat4& m, const glm::vec4& growth) {
+    TreeSpecies& sp = species[s];
+    TreeHandle h;
+    if (!sp.freeHandles.empty()) {
+        h = sp.freeHandles.back();
+        sp.freeHandles.pop_back();
+    }
+    else {
+        h = (TreeHandle)sp.handleSlot.size();
+        sp.handleSlot.push_back(VegetationGrid::kNoInstance);
+    }
+    TreeEdit e{ TreeEdit::Add, h, m, growth };
+    ApplyEdit(sp, e);
+    if (sp.compaction) sp.editLog.push_back(e);
+    return h;
+}
+
+bool TreeInstancer::RemoveInstance(int s, TreeHandle h) {
+    TreeSpecies& sp = species[s];
+    if (h >= sp.handleSlot.size() || sp.handleSlot[h] == VegetationGrid::kNoInstance) return false;
+    TreeEdit e{ TreeEdit::Remove, h, glm::mat4(0.0f), kDefaultGrowth };
+    ApplyEdit(sp, e);
+    if (sp.compaction) sp.editLog.push_back(e);
+    sp.freeHandles.push_back(h);
+    return true;
+}
+
+bool TreeInstancer::UpdateInstance(int s, TreeHandle h, const glm::mat4& m) {
+    TreeSpecies& sp = species[s];
+    if (h >= sp.handleSlot.size() || sp.handleSlot[h] == VegetationGrid::kNoInstance) return false;
+    TreeEdit e{ TreeEdit::Update, h, m, kDefaultGrowth };
+    ApplyEdit(sp, e);
+    if (sp.compaction) sp.editLog.push_back(e);
+    return true;
+}
+
+bool TreeInstancer::GetInstance(int s, TreeHandle h, glm::mat4& out) const {
+    const TreeSpecies& sp = species[s];
+    if (h >= sp.handleSlot.size() || sp.handleSlot[h] == VegetationGrid::kNoInstance) return false;
+    out = sp.mats[sp.handleSlot[h]];
+    return true;
+}
+
+bool TreeInstancer::SetGrowth(int s, TreeHandle h, const glm::vec4& growth) {
+    TreeSpecies& sp = species[s];
+    if (h >= sp.handleSlot.size() || sp.handleSlot[h] == VegetationGrid::kNoInstance) return false;
+    TreeEdit e{ TreeEdit::Grow, h, glm::mat4(0.0f), growth };
+    ApplyEdit(sp, e);
+    if (sp.compaction) sp.editLog.push_back(e);
+    return true;
+}
+
+void TreeInstancer::SetGrowth(int s, const std::vector<TreeHandle>& handles, const std::vector<glm::vec4>& values) {
+    TreeSpecies& sp = species[s];
+    // touching a large share of the forest: one full upload beats sorting a huge dirty list
+    if (handles.size() > sp.grid.LiveCount() / 4) {
+        sp.uploadAll = true;
+        sp.dirtySlots.clear();
+    }
+    for (size_t i = 0; i < handles.size() && i < values.size(); ++i) SetGrowth(s, handles[i], values[i]);
+}
+
+TreeHandle TreeInstancer::HandleAtSlot(int s, uint32_t slot) const {
+    const TreeSpecies& sp = species[s];
+    return slot < sp.slotHandle.size() ? sp.slotHandle[slot] : kInvalidTree;
+}
+
+size_t TreeInstancer::FlushUpdates() {
+    size_t bytes = 0;
+    for (TreeSpecies& sp : species) {
+        if (sp.compaction &&
+            sp.compaction->wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            TreeLayout layout = sp.compaction->get();
+            sp.compaction.reset();
+            ApplyCompaction(sp, layout); // marks the species for a full upload
+        }
+        else if (!sp.compaction) {
+            // the overflow range is drawn unculled; re-sort it into cells once it matters
+            uint32_t limit = std::max(kCompactMinOverflow, sp.grid.LiveCount() / 8);
+            if (sp.grid.Overflow().count > limit) RequestCompaction((int)(&sp - species.data()));
+        }
 
-    glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)mesh.indexCount, GL_UNSIGNED_INT, 0, instanceCount);
+        if (sp.instanceVBO == 0) { sp.dirtySlots.clear(); continue; }
+        if (sp.uploadAll || !sp.dirtySlots.empty() || sp.mats.size() > sp.gpuSlots) bytes += UploadDirty(sp, false);
+    }
+    return bytes;
+}
+
+void TreeInstancer::SetEra(float era) {
+    for (TreeSpecies& sp : species) {
+        sp.fade = glm::clamp(1.0f - std::fabs(era - (float)sp.era), 0.0f, 1.0f);
+    }
+}
 
+void TreeInstancer::DrawSubmeshes(const MeshGL_Model& mesh, GLsizei instanceCount, int lod) {
+    const GeometryRange& g = mesh.geometry;
+    if (mesh.submeshes.empty()) {
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, (GLsizei)mesh.indexCount, GL_UNSIGNED_INT,
+            (void*)((size_t)g.firstIndex * sizeof(unsigned int)), instanceCount, g.baseVertex);
+        return;
+    }
+    glActiveTexture(GL_TEXTURE0);
+    for (const SubMeshRange& sm : LodSubmeshes(mesh, lod)) {
+        if (sm.materialId >= 0 && sm.materialId < (int)mesh.materials.size()) {
+            glBindTexture(GL_TEXTURE_2D, mesh.materials[sm.materialId].diffuseTex);
+            TextureManager::Instance().Touch(mesh.materials[sm.materialId].diffuseTex);
+        }
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, (GLsizei)sm.indexCount, GL_UNSIGNED_INT,
+            (void*)((g.firstIndex + sm.indexOffset) * sizeof(unsigned int)), instanceCount, g.baseVertex + sm.baseVertex);
+    }
+}
+
+void TreeInstancer::DrawCulled(const glm::mat4& view, const glm::mat4& proj, const Shader& shader) {
+    Frustum frustum = Frustum::FromMatrix(proj * view);
+    glm::vec3 eye(glm::inverse(view)[3]);
+    // pixels covered by one unit at distance one
+    float pixelsPerUnit = proj[1][1] * 0.5f * lodViewportHeight;
+    for (size_t& n : lodInstances) n = 0;
+    GLuint boundVAO = 0; // species sharing a geometry arena share its VAO
+
+    for (TreeSpecies& sp : species) {
+        if (sp.fade <= 0.0f || sp.blended || sp.grid.Empty() || sp.instanceVBO == 0) continue;
+        if (!sp.mesh || sp.mesh->VAO == 0 || sp.mesh->indexCount == 0) continue;
+        const MeshGL_Model& mesh = *sp.mesh;
+
+        // visible cells, bucketed by LOD, one range each; the free slack after a cell keeps
+        // it apart from the next, so ranges only merge where a cell has no slack left
+        for (std::vector<glm::uvec2>& ranges : lodRanges) ranges.clear();
+        auto add = [&](const VegetationCell& c) {
+            // slots added since the last FlushUpdates may not exist on the GPU yet
+            if (c.count == 0 || c.first >= sp.gpuSlots || !frustum.IntersectsAABB(c.boundsMin, c.boundsMax)) return;
+            uint32_t count = (uint32_t)std::min<size_t>(c.count, sp.gpuSlots - c.first);
+            int lod = 0;
+            if (!mesh.lods.empty() && sp.meshRadius > 0.0f) {
+                float dist = glm::length(glm::clamp(eye, c.boundsMin, c.boundsMax) - eye);
+                float scale = std::max(c.maxRadius / sp.meshRadius, 1e-6f);
+                lod = SelectMeshLod(mesh, lodPixels * dist / (pixelsPerUnit * scale));
+            }
+            std::vector<glm::uvec2>& ranges = lodRanges[lod];
+            if (!ranges.empty() && ranges.back().x + ranges.back().y == c.first)
+                ranges.back().y += count;
+            else
+                ranges.push_back(glm::uvec2(c.first, count));
+            lodInstances[lod] += count;
+        };
+        for (const VegetationCell& c : sp.grid.Cells()) add(c);
+        add(sp.grid.Overflow());
+
+        size_t rangeCount = 0;
+        for (const std::vector<glm::uvec2>& ranges : lodRanges) rangeCount += ranges.size();
+        if (rangeCount == 0) continue;
+
+        shader.SetFloat("uFade", sp.fade);
+        shader.SetBool("uFadeInvert", (sp.era & 1) != 0);
+        SetDequantUniforms(shader, mesh.dequant);
+        if (boundVAO != mesh.VAO) {
+            glBindVertexArray(mesh.VAO);
+            boundVAO = mesh.VAO;
+        }
+        BindInstanceRange(sp, 0);
+
+        // One submission per submesh (i.e. per texture): every visible range at every
+        // LOD becomes one indirect command whose baseInstance is the range's first slot
+        const SubMeshRange whole{ -1, 0, mesh.indexCount };
+        size_t submeshCount = std::max<size_t>(mesh.submeshes.size(), 1);
+        glActiveTexture(GL_TEXTURE0);
+        for (size_t s = 0; s < submeshCount; ++s) {
+            drawList.Clear();
+            for (int lod = 0; lod < kMaxMeshLods; ++lod) {
+                const std::vector<SubMeshRange>& subs = LodSubmeshes(mesh, lod);
+                const SubMeshRange& sm = subs.empty() ? whole : subs[s];
+                if (sm.indexCount == 0) continue;
+                for (const glm::uvec2& r : lodRanges[lod]) {
+                    drawList.Add(DrawElementsIndirectCommand{ (GLuint)sm.indexCount, r.y,
+                        mesh.geometry.firstIndex + (GLuint)sm.indexOffset, mesh.geometry.baseVertex + sm.baseVertex, r.x });
+                }
+            }
+            int materialId = mesh.submeshes.empty() ? -1 : mesh.submeshes[s].materialId;
+            if (materialId >= 0 && materialId < (int)mesh.materials.size()) {
+                glBindTexture(GL_TEXTURE_2D, mesh.materials[materialId].diffuseTex);
+                TextureManager::Instance().Touch(mesh.materials[materialId].diffuseTex);
+            }
+            drawList.Submit([&](GLuint first) { BindInstanceRange(sp, first); });
+        }
+        BindInstanceRange(sp, 0);
+    }
+    if (boundVAO) glBindVertexArray(0);
+}
+
+void TreeInstancer::WaitForSort() {
+    if (sortJob.valid()) sortJob.wait(); // keep the result, DrawSortedBlended uploads it
+}
+
+void TreeInstancer::DrawSortedBlended(int s, const glm::mat4& view, const glm::mat4& proj, const Shader& shader) {
+    TreeSpecies& sp = species[s];
+
+    // 1) last frame's sort is done by now (it had a whole frame): upload it to the back pair
+    auto collect = [&]() {
+        if (!sortJob.valid()) return;
+        lastSortMs = sortJob.get();
+        int back = 1 - sortFront;
+        if (sortedVBO[back][0] == 0) glGenBuffers(2, sortedVBO[back]);
+        size_t n = sortedMats.size();
+        if (n > sortedCapacity[back]) {
+            sortedCapacity[back] = std::max<size_t>(n + n / 2, 256);
+            glBindBuffer(GL_ARRAY_BUFFER, sortedVBO[back][0]);
+            glBufferData(GL_ARRAY_BUFFER, sortedCapacity[back] * sizeof(glm::mat4), nullptr, GL_STREAM_DRAW);
+            glBindBuffer(GL_ARRAY_BUFFER, sortedVBO[back][1]);
+            glBufferData(GL_ARRAY_BUFFER, sortedCapacity[back] * sizeof(glm::vec4), nullptr, GL_STREAM_DRAW);
+        }
+        if (n > 0) {
+            glBindBuffer(GL_ARRAY_BUFFER, sortedVBO[back][0]);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, n * sizeof(glm::mat4), sortedMats.data());
+            glBindBuffer(GL_ARRAY_BUFFER, sortedVBO[back][1]);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, n * sizeof(glm::vec4), sortedGrowth.data());
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        sortedCount[back] = (GLsizei)n;
+        sortedSpecies[back] = sortSpecies;
+        sortFront = back;
+    };
+    collect();
+
+    // 2) start sorting this frame's visible instances
+    if (!sp.grid.Empty() && sp.fade > 0.0f) {
+        sp.grid.VisibleRanges(Frustum::FromMatrix(proj * view), visibleRanges);
+        sortSlots.clear();
+        for (const glm::uvec2& r : visibleRanges)
+            for (uint32_t slot = r.x; slot < r.x + r.y; ++slot) sortSlots.push_back(slot);
+
+        glm::mat4 invView = glm::inverse(view);
+        glm::vec3 eye(invView[3]);
+        glm::vec3 forward = -glm::normalize(glm::vec3(invView[2]));
+        sortSpecies = s;
+        sortJob = std::async(std::launch::async, [this, s, eye, forward]() {
+            auto t0 = std::chrono::high_resolution_clock::now();
+            const TreeSpecies& src = species[s];
+            SortBackToFront(sortSlots.size(), [&](size_t i) { return glm::vec3(src.mats[sortSlots[i]][3]); },
+                eye, forward, sortScratch, sortOrder);
+
+            sortedMats.resize(sortOrder.size());
+            sortedGrowth.resize(sortOrder.size());
+            const size_t chunk = 16384;
+            ParallelFor((sortOrder.size() + chunk - 1) / chunk, [&](size_t c) {
+                size_t end = std::min(sortOrder.size(), (c + 1) * chunk);
+                for (size_t i = c * chunk; i < end; ++i) {
+                    uint32_t slot = sortSlots[sortOrder[i]];
+                    sortedMats[i] = src.mats[slot];
+                    sortedGrowth[i] = src.growth[slot];
+                }
+            });
+            return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+        });
+        // nothing sorted yet (first frame, or the species changed): wait for this one
+        if (sortedSpecies[sortFront] != s) collect();
+    }
+
+    // 3) draw the front buffer
+    if (sortedSpecies[sortFront] != s || sortedCount[sortFront] == 0 || sp.fade <= 0.0f) return;
+    if (!sp.mesh || sp.mesh->VAO == 0 || sp.mesh->indexCount == 0) return;
+    shader.SetFloat("uFade", sp.fade);
+    shader.SetBool("uFadeInvert", (sp.era & 1) != 0);
+    SetDequantUniforms(shader, sp.mesh->dequant);
+    glBindVertexArray(sp.mesh->VAO);
+    BindInstanceBuffers(sortedVBO[sortFront][0], sortedVBO[sortFront][1], 0);
+    DrawSubmeshes(*sp.mesh, sortedCount[sortFront]);
+    BindInstanceRange(sp, 0);
+    glBindVertexArray(0);
+}
+
+void TreeInstancer::DrawInstanced(int s, const Shader& shader)
+{
+    TreeSpecies& sp = species[s];
+    if (sp.grid.Empty() || sp.instanceVBO == 0) return;
+    if (!sp.mesh || sp.mesh->VAO == 0 || sp.mesh->indexCount == 0) return;
+
+    // every live range; free slots between cells are skipped
+    visibleRanges.clear();
+    auto add = [&](const VegetationCell& c) {
+        if (c.count == 0 || c.first >= sp.gpuSlots) return;
+        if (!visibleRanges.empty() && visibleRanges.back().x + visibleRanges.back().y == c.first)
+            visibleRanges.back().y += c.count;
+        else
+            visibleRanges.push_back(glm::uvec2(c.first, c.count));
+    };
+    for (const VegetationCell& c : sp.grid.Cells()) add(c);
+    add(sp.grid.Overflow());
+
+    SetDequantUniforms(shader, sp.mesh->dequant);
+    glBindVertexArray(sp.mesh->VAO);
+    for (const glm::uvec2& r : visibleRanges) {
+        BindInstanceRange(sp, r.x);
+        DrawSubmeshes(*sp.mesh, (GLsizei)std::min<size_t>(r.y, sp.gpuSlots - r.x));
+    }
+    BindInstanceRange(sp, 0);
     glBindVertexArray(0);
 }
@@ -3,35 +3,203 @@
 // Make sure GL loader provides GLuint etc (glad recommended)
 #include <glad/glad.h>
 
+#include <future>
+#include <memory>
 #include <vector>
 #include <glm/glm.hpp>
 #include "ModelLoader.h"
+#include "VegetationScatter.h"
+#include "VegetationGrid.h"
+#include "DepthSort.h"
 
 
 class Terrain;
+class Shader;
+
+// Stable id for one tree. Slots in the instance buffer move (removals keep cells
+// packed, compaction re-sorts), handles never do.
+typedef uint32_t TreeHandle;
+const TreeHandle kInvalidTree = 0xFFFFFFFFu;
+
+// Per-instance growth attribute (location 7): scale from/to, age from/to in years.
+// tree_inst.vert scales the mesh by mix(from, to, uGrowthBlend), so a simulated
+// jump animates on the GPU without touching the matrices.
+const glm::vec4 kDefaultGrowth(1.0f, 1.0f, 0.0f, 0.0f);
+
+// result of a background re-sort, swapped in by FlushUpdates
+struct TreeLayout {
+    VegetationGrid grid;
+    std::vector<glm::mat4> mats;        // by slot
+    std::vector<glm::vec4> growth;      // by slot
+    std::vector<TreeHandle> slotHandle; // by slot
+    std::vector<uint32_t> handleSlot;   // by handle
+};
+
+// edit recorded while a compaction runs, replayed on its result
+struct TreeEdit {
+    enum Kind { Add, Remove, Update, Grow } kind;
+    TreeHandle handle;
+    glm::mat4 mat;
+    glm::vec4 growth;
+};
+
+// One species = one model + its own instance batch. Species are tagged with the
+// era they belong to; all of them stay resident and the era blend only decides
+// which batches draw (and how faded), so a time jump never touches GPU memory.
+struct TreeSpecies {
+    const MeshGL_Model* mesh = nullptr; // not owned, must outlive the instancer
+    int era = 0;
+    float meshRadius = 0.0f;            // object-space radius around the root
+    float cellSize = 32.0f;
+    std::vector<glm::mat4> mats;        // by slot; only live grid slots are drawn
+    std::vector<glm::vec4> growth;      // by slot, see kDefaultGrowth
+    GLuint instanceVBO = 0;
+    GLuint growthVBO = 0;
+    size_t gpuSlots = 0;                // capacity of both buffers in instances
+    VegetationGrid grid;
+    float fade = 1.0f;                  // 0 = hidden, 1 = fully drawn
+    bool blended = false;               // drawn by DrawSortedBlended instead of DrawCulled
+
+    // handle <-> slot indirection, free-list of handles
+    std::vector<TreeHandle> slotHandle;
+    std::vector<uint32_t> handleSlot;
+    std::vector<TreeHandle> freeHandles;
+    std::vector<uint32_t> dirtySlots;   // uploaded, coalesced, by FlushUpdates
+    bool uploadAll = false;             // bulk edits: skip the dirty list
+
+    std::shared_ptr<std::future<TreeLayout>> compaction; // in-flight re-sort (or null)
+    std::vector<TreeEdit> editLog;
+};
 
 class TreeInstancer {
 public:
     TreeInstancer();
     ~TreeInstancer();
 
+    // registers a species and returns its index
+    int AddSpecies(const MeshGL_Model& mesh, int era = 0);
+    int SpeciesCount() const { return (int)species.size(); }
+    const TreeSpecies& GetSpecies(int s) const { return species[s]; }
 
-    void GenerateInstances(int count,
+    // uniform random placement; fixed seed, rejected samples are retried so
+    // the requested count is reached whenever the bounds overlap the terrain
+    void GenerateInstances(int s, int count,
         float minX, float maxX,
         float minZ, float maxZ,
         const Terrain& terrain,
-        float minScale = 0.8f, float maxScale = 1.4f);
+        float minScale = 0.8f, float maxScale = 1.4f,
+        uint32_t seed = 1337);
+
+    // Poisson-disk placement with terrain rules (see VegetationScatter.h)
+    ScatterStats ScatterInstances(int s, const Terrain& terrain, const ScatterRules& rules);
 
-    // uploads mats[] to GPU (creates instanceVBO if needed)
-    void UploadInstancesToGPU(const MeshGL_Model& mesh);
+    // Sorts the species' matrices into grid cells so each cell is one contiguous
+    // range of its instance buffer, with spare slots for dynamic adds. Generate/
+    // ScatterInstances already do this; call it to change the cell size.
+    // Instance i of the last generate/scatter gets handle i.
+    void BuildSpatialIndex(int s, float cellSize = 32.0f);
 
-    // instanceCount = number of instances generated
-    void DrawInstanced(const MeshGL_Model& mesh, int instanceCount);
+    // Dynamic edits. They only touch CPU data and queue dirty slots; nothing is
+    // uploaded until FlushUpdates. Instances that do not fit their cell spill into
+    // an overflow range, which triggers a background re-sort.
+    TreeHandle AddInstance(int s, const glm::mat4& m, const glm::vec4& growth = kDefaultGrowth);
+    bool RemoveInstance(int s, TreeHandle h);
+    bool UpdateInstance(int s, TreeHandle h, const glm::mat4& m);
+    bool GetInstance(int s, TreeHandle h, glm::mat4& out) const;
+    bool SetGrowth(int s, TreeHandle h, const glm::vec4& growth);
+    // bulk version for whole-forest updates; values[i] belongs to handles[i]
+    void SetGrowth(int s, const std::vector<TreeHandle>& handles, const std::vector<glm::vec4>& values);
+    // one past the highest handle ever issued (handles below it may be free)
+    size_t HandleCount(int s) const { return species[s].handleSlot.size(); }
+    // grid queries (GetSpecies(s).grid) return slots; map them back to handles
+    TreeHandle HandleAtSlot(int s, uint32_t slot) const;
 
-    // optional: clear CPU-side mats
-    void Clear() { mats.clear(); }
+    // Once per frame: swaps in finished compactions and uploads dirty slots as
+    // coalesced glBufferSubData ranges. Returns the bytes uploaded.
+    size_t FlushUpdates();
+    // starts a background re-sort of one species (no-op if one is running)
+    void RequestCompaction(int s);
+
+    // uploads the species' matrices to GPU (creates its instanceVBO if needed)
+    void UploadInstancesToGPU(int s);
+
+    // Continuous era position (0 = present, 1 = first jump, ...). Species within one
+    // era of it get a fade weight, everything else is skipped. Cheap: no GL calls.
+    void SetEra(float era);
+
+    // draws every instance of one species, ignoring culling and fade
+    // (shader: the bound program, for the mesh's dequantization uniforms)
+    void DrawInstanced(int s, const Shader& shader);
+
+    // draws all non-hidden, non-blended species; frustum-culls grid cells and issues
+    // one instanced draw per run of visible cells. Each cell draws the coarsest mesh
+    // LOD whose error projects below the pixel tolerance at the cell's nearest point
+    // (see SetLodTolerance). On GL 4.3 all runs of one submesh go out as a single
+    // multi-draw-indirect (GeometryArena.h). Sets "uFade" and "uFadeInvert" on the bound shader.
+    void DrawCulled(const glm::mat4& view, const glm::mat4& proj, const Shader& shader);
+    // viewport height in pixels and the LOD error allowed on screen, in pixels
+    void SetLodTolerance(float viewportHeight, float pixels = 1.0f) { lodViewportHeight = viewportHeight; lodPixels = pixels; }
+    // instances drawn per LOD by the last DrawCulled
+    size_t LodInstanceCount(int lod) const { return lodInstances[lod]; }
+
+    // Alpha-blended foliage: draws one species' visible instances back to front, at
+    // full detail, from a sorted copy of its instance data. The sort for this frame
+    // (radix sort on quantized view depth, on worker threads) overlaps rendering and
+    // is drawn next frame, while this frame draws the previous result from the other
+    // buffer pair.
+    void SetBlended(int s, bool blended) { species[s].blended = blended; }
+    void DrawSortedBlended(int s, const glm::mat4& view, const glm::mat4& proj, const Shader& shader);
+    double LastSortMilliseconds() const { return lastSortMs; }
+
+    void Clear(int s);
+    size_t InstanceCount(int s) const { return species[s].grid.LiveCount(); }
+    size_t TotalInstanceCount() const;
 
 private:
-    std::vector<glm::mat4> mats;
-    GLuint instanceVBO = 0;   // declared here (fixes 'undeclared identifier' errors)
+    // synchronous re-sort; handles[i] is the handle of mats[i] / growth[i]
+    void ResetLayout(TreeSpecies& sp, const std::vector<TreeHandle>& handles,
+        const std::vector<glm::mat4>& mats, const std::vector<glm::vec4>& growth, size_t handleCount);
+    static void SnapshotLive(const TreeSpecies& sp, std::vector<TreeHandle>& handles,
+        std::vector<glm::mat4>& mats, std::vector<glm::vec4>& growth);
+    // blocks on an in-flight compaction and drops its result
+    void WaitForCompaction(TreeSpecies& sp);
+    void ApplyCompaction(TreeSpecies& sp, TreeLayout& layout);
+    // slot bookkeeping shared by live edits and the compaction replay
+    void ApplyEdit(TreeSpecies& sp, const TreeEdit& e);
+    void PlaceHandle(TreeSpecies& sp, TreeHandle h, const glm::mat4& m, const glm::vec4& growth);
+    void ReleaseSlot(TreeSpecies& sp, uint32_t slot);
+    // dirty slots only, or everything (also when the buffer has to grow)
+    size_t UploadDirty(TreeSpecies& sp, bool all);
+
+    // sort job reads species data, so every mutation waits for it first
+    void WaitForSort();
+
+    // points attributes 3..7 of the bound VAO at instance slot 'first' of a species
+    void BindInstanceRange(const TreeSpecies& sp, size_t first);
+    void BindInstanceBuffers(GLuint matVBO, GLuint growthVBO, size_t first);
+    // one instanced draw per submesh of one LOD, binding each material's diffuse texture
+    void DrawSubmeshes(const MeshGL_Model& mesh, GLsizei instanceCount, int lod = 0);
+
+    std::vector<TreeSpecies> species;
+    std::vector<glm::uvec2> visibleRanges; // scratch, reused every frame
+    std::vector<glm::uvec2> lodRanges[kMaxMeshLods]; // DrawCulled scratch, by LOD
+    size_t lodInstances[kMaxMeshLods] = {};
+    IndirectDrawList drawList;             // DrawCulled, one submesh at a time
+    float lodViewportHeight = 1080.0f;
+    float lodPixels = 1.0f;
+
+    // back-to-front sort (DrawSortedBlended), double-buffered
+    std::future<double> sortJob;           // returns the sort time in ms
+    int sortSpecies = -1;                  // species the in-flight job sorts
+    std::vector<uint32_t> sortSlots;       // job input: visible slots
+    std::vector<uint32_t> sortOrder;
+    DepthSortScratch sortScratch;
+    std::vector<glm::mat4> sortedMats;     // job output, uploaded next frame
+    std::vector<glm::vec4> sortedGrowth;
+    GLuint sortedVBO[2][2] = { { 0, 0 }, { 0, 0 } }; // [buffer][matrices, growth]
+    size_t sortedCapacity[2] = { 0, 0 };
+    GLsizei sortedCount[2] = { 0, 0 };
+    int sortedSpecies[2] = { -1, -1 };
+    int sortFront = 0;
+    double lastSortMs = 0.0;
 };
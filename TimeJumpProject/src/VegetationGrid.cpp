@@ -0,0 +1,198 @@
+// VegetationGrid.cpp
+#include "VegetationGrid.h"
+#include "Frustum.h"
+
+#include <algorithm>
+#include <cmath>
+
+void VegetationGrid::Clear() {
+    cells.clear();
+    slotPositions.clear();
+    overflow = VegetationCell();
+    liveCount = 0;
+    cellsX = cellsZ = 0;
+}
+
+void VegetationGrid::Grow(VegetationCell& c, const glm::vec3& pos, float r) {
+    glm::vec3 lo = pos - glm::vec3(r, 0.0f, r);
+    glm::vec3 hi = pos + glm::vec3(r, 2.0f * r, r); // trees grow up from their root
+    if (c.count == 0) { c.boundsMin = lo; c.boundsMax = hi; c.maxRadius = r; }
+    else { c.boundsMin = glm::min(c.boundsMin, lo); c.boundsMax = glm::max(c.boundsMax, hi); c.maxRadius = std::max(c.maxRadius, r); }
+}
+
+void VegetationGrid::Build(const std::vector<glm::vec3>& positions, const std::vector<float>& radii,
+    float size, std::vector<uint32_t>& outOrder, float slack)
+{
+    Clear();
+    outOrder.clear();
+    cellSize = size > 0.0f ? size : 1.0f;
+    if (positions.empty() || size <= 0.0f) return;
+
+    glm::vec2 mn(positions[0].x, positions[0].z), mx = mn;
+    for (const glm::vec3& p : positions) {
+        mn = glm::min(mn, glm::vec2(p.x, p.z));
+        mx = glm::max(mx, glm::vec2(p.x, p.z));
+    }
+    originX = mn.x;
+    originZ = mn.y;
+    cellsX = (int)std::floor((mx.x - mn.x) / size) + 1;
+    cellsZ = (int)std::floor((mx.y - mn.y) / size) + 1;
+    cells.assign((size_t)cellsX * cellsZ, VegetationCell());
+
+    // counting sort: histogram, prefix sum (over capacities), scatter (stable inside each cell)
+    std::vector<uint32_t> cellOf(positions.size());
+    for (size_t i = 0; i < positions.size(); ++i) {
+        cellOf[i] = (uint32_t)CellIndexAt(positions[i].x, positions[i].z);
+        cells[cellOf[i]].count++;
+    }
+    uint32_t running = 0;
+    for (VegetationCell& c : cells) {
+        c.capacity = c.count;
+        if (slack > 0.0f) c.capacity += (uint32_t)std::ceil((float)c.count * slack) + 1;
+        c.first = running;
+        running += c.capacity;
+        c.count = 0;
+    }
+    overflow.first = running;
+
+    outOrder.assign(running, kNoInstance);
+    slotPositions.assign(running, glm::vec3(0.0f));
+    for (size_t i = 0; i < positions.size(); ++i) {
+        VegetationCell& c = cells[cellOf[i]];
+        Grow(c, positions[i], i < radii.size() ? radii[i] : 0.0f);
+        uint32_t slot = c.first + c.count++;
+        outOrder[slot] = (uint32_t)i;
+        slotPositions[slot] = positions[i];
+    }
+    liveCount = (uint32_t)positions.size();
+}
+
+VegetationCell& VegetationGrid::CellOfSlot(uint32_t slot) {
+    if (slot >= overflow.first) return overflow;
+    // last cell whose range starts at or before slot (zero-capacity cells sort before their neighbour)
+    auto it = std::upper_bound(cells.begin(), cells.end(), slot,
+        [](uint32_t s, const VegetationCell& c) { return s < c.first; });
+    return *(it - 1);
+}
+
+uint32_t VegetationGrid::AllocateSlot(const glm::vec3& pos, float radius) {
+    int ci = CellIndexAt(pos.x, pos.z);
+    VegetationCell& c = (ci >= 0 && cells[ci].count < cells[ci].capacity) ? cells[ci] : overflow;
+    Grow(c, pos, radius);
+    uint32_t slot = c.first + c.count++;
+    if (slot >= slotPositions.size()) slotPositions.resize((size_t)slot + 1);
+    slotPositions[slot] = pos;
+    ++liveCount;
+    return slot;
+}
+
+uint32_t VegetationGrid::FreeSlot(uint32_t slot) {
+    VegetationCell& c = CellOfSlot(slot);
+    if (c.count == 0 || slot >= c.first + c.count) return slot; // already free
+    // keep live slots packed so the cell stays one draw range; bounds stay conservative
+    uint32_t last = c.first + c.count - 1;
+    slotPositions[slot] = slotPositions[last];
+    c.count--;
+    --liveCount;
+    return last;
+}
+
+bool VegetationGrid::MoveSlot(uint32_t slot, const glm::vec3& pos, float radius) {
+    VegetationCell& c = CellOfSlot(slot);
+    if (&c != &overflow) {
+        int ci = CellIndexAt(pos.x, pos.z);
+        if (ci < 0 || &cells[ci] != &c) return false;
+    }
+    Grow(c, pos, radius);
+    slotPositions[slot] = pos;
+    return true;
+}
+
+int VegetationGrid::CellIndexAt(float x, float z) const {
+    if (cellsX == 0) return -1;
+    int cx = (int)std::floor((x - originX) / cellSize);
+    int cz = (int)std::floor((z - originZ) / cellSize);
+    if (cx < 0 || cz < 0 || cx >= cellsX || cz >= cellsZ) return -1;
+    return cz * cellsX + cx;
+}
+
+void VegetationGrid::QueryRadius(const glm::vec3& center, float radius, std::vector<uint32_t>& outSlots) const {
+    outSlots.clear();
+    if (radius < 0.0f) return;
+    float r2 = radius * radius;
+    auto scan = [&](const VegetationCell& c) {
+        for (uint32_t s = c.first; s < c.first + c.count; ++s) {
+            float dx = slotPositions[s].x - center.x, dz = slotPositions[s].z - center.z;
+            if (dx * dx + dz * dz <= r2) outSlots.push_back(s);
+        }
+    };
+    scan(overflow);
+    if (cells.empty()) return;
+
+    int cx0 = std::max(0, (int)std::floor((center.x - radius - originX) / cellSize));
+    int cz0 = std::max(0, (int)std::floor((center.z - radius - originZ) / cellSize));
+    int cx1 = std::min(cellsX - 1, (int)std::floor((center.x + radius - originX) / cellSize));
+    int cz1 = std::min(cellsZ - 1, (int)std::floor((center.z + radius - originZ) / cellSize));
+
+    for (int cz = cz0; cz <= cz1; ++cz)
+        for (int cx = cx0; cx <= cx1; ++cx) scan(cells[(size_t)cz * cellsX + cx]);
+}
+
+int VegetationGrid::Nearest(const glm::vec3& p, float maxRadius) const {
+    int best = -1;
+    float bestD2 = maxRadius < std::sqrt(std::numeric_limits<float>::max())
+        ? maxRadius * maxRadius : std::numeric_limits<float>::max();
+    auto scan = [&](const VegetationCell& c) {
+        for (uint32_t s = c.first; s < c.first + c.count; ++s) {
+            float dx = slotPositions[s].x - p.x, dz = slotPositions[s].z - p.z;
+            float d2 = dx * dx + dz * dz;
+            if (d2 <= bestD2) { bestD2 = d2; best = (int)s; }
+        }
+    };
+    scan(overflow);
+    if (cells.empty()) return best;
+
+    int pcx = std::min(std::max((int)std::floor((p.x - originX) / cellSize), 0), cellsX - 1);
+    int pcz = std::min(std::max((int)std::floor((p.z - originZ) / cellSize), 0), cellsZ - 1);
+    int maxRing = std::max(cellsX, cellsZ);
+
+    // grow square rings of cells until the ring is farther than the best hit
+    for (int ring = 0; ring <= maxRing; ++ring) {
+        if (ring > 0) {
+            // closest possible distance from p to any cell in this ring
+            float gap = (float)(ring - 1) * cellSize;
+            if (gap * gap > bestD2) break;
+        }
+        for (int cz = pcz - ring; cz <= pcz + ring; ++cz) {
+            if (cz < 0 || cz >= cellsZ) continue;
+            bool edgeRow = (cz == pcz - ring || cz == pcz + ring);
+            for (int cx = pcx - ring; cx <= pcx + ring; cx += (edgeRow || ring == 0) ? 1 : 2 * ring) {
+                if (cx < 0 || cx >= cellsX) continue;
+                scan(cells[(size_t)cz * cellsX + cx]);
+            }
+        }
+    }
+    return best;
+}
+
+void VegetationGrid::CullCells(const Frustum& frustum, std::vector<uint32_t>& outCells) const {
+    outCells.clear();
+    for (size_t i = 0; i < cells.size(); ++i) {
+        const VegetationCell& c = cells[i];
+        if (c.count > 0 && frustum.IntersectsAABB(c.boundsMin, c.boundsMax)) outCells.push_back((uint32_t)i);
+    }
+}
+
+void VegetationGrid::VisibleRanges(const Frustum& frustum, std::vector<glm::uvec2>& outRanges) const {
+    outRanges.clear();
+    auto add = [&](const VegetationCell& c) {
+        if (c.count == 0 || !frustum.IntersectsAABB(c.boundsMin, c.boundsMax)) return;
+        // full cells are contiguous in slot order, so neighbours along a row merge into one draw
+        if (!outRanges.empty() && outRanges.back().x + outRanges.back().y == c.first)
+            outRanges.back().y += c.count;
+        else
+            outRanges.push_back(glm::uvec2(c.first, c.count));
+    };
+    for (const VegetationCell& c : cells) add(c);
+    add(overflow);
+}
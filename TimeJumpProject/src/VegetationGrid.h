@@ -0,0 +1,77 @@
+#pragma once
+
+// VegetationGrid.h - uniform XZ grid over vegetation instances
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include <glm/glm.hpp>
+
+struct Frustum;
+
+struct VegetationCell {
+    uint32_t first = 0;           // first instance slot (in the instance buffer)
+    uint32_t count = 0;           // live instances, packed at [first, first + count)
+    uint32_t capacity = 0;        // reserved slots; [first + count, first + capacity) are free
+    glm::vec3 boundsMin{ 0.0f };  // AABB over instances, including their radius
+    glm::vec3 boundsMax{ 0.0f };
+    float maxRadius = 0.0f;       // largest instance radius, for LOD selection
+};
+
+class VegetationGrid {
+public:
+    static constexpr uint32_t kNoInstance = 0xFFFFFFFFu;
+
+    // Buckets instances into square cells with a counting sort. Cells are laid out
+    // row-major and every cell owns one contiguous slot range, with 'slack' extra
+    // free slots per live instance for later AllocateSlot calls. outOrder[slot] is the
+    // incoming index that lands in that slot (kNoInstance for free slots); callers
+    // reorder their per-instance data (matrices etc.) with it. Queries return slots.
+    void Build(const std::vector<glm::vec3>& positions, const std::vector<float>& radii,
+        float cellSize, std::vector<uint32_t>& outOrder, float slack = 0.0f);
+    void Clear();
+
+    // Dynamic edits. Instances whose cell is full (or that fall outside the grid)
+    // go to an overflow range after all cells. It is culled as one box around all
+    // of them, so it rarely drops out; rebuild once it grows. Slots only move inside
+    // the grid, never across cells.
+    uint32_t AllocateSlot(const glm::vec3& pos, float radius);
+    // Frees a slot by moving the cell's last live instance into it. Returns the
+    // slot that was moved (== slot when nothing moved); the caller mirrors the move.
+    uint32_t FreeSlot(uint32_t slot);
+    // Moves a live slot. Returns false if pos belongs to another cell; the caller
+    // then frees and reallocates.
+    bool MoveSlot(uint32_t slot, const glm::vec3& pos, float radius);
+
+    // slots whose XZ distance to center is <= radius
+    void QueryRadius(const glm::vec3& center, float radius, std::vector<uint32_t>& outSlots) const;
+    // closest slot in XZ, or -1 if nothing lies within maxRadius
+    int Nearest(const glm::vec3& p, float maxRadius = std::numeric_limits<float>::max()) const;
+
+    // indices of non-empty cells touching the frustum
+    void CullCells(const Frustum& frustum, std::vector<uint32_t>& outCells) const;
+    // visible live slots as [first, count) ranges, ready for instanced draws
+    void VisibleRanges(const Frustum& frustum, std::vector<glm::uvec2>& outRanges) const;
+
+    int CellIndexAt(float x, float z) const; // -1 outside the grid
+    const std::vector<VegetationCell>& Cells() const { return cells; }
+    const VegetationCell& Overflow() const { return overflow; }
+    uint32_t SlotCount() const { return overflow.first + overflow.count; } // highest used slot + 1
+    uint32_t LiveCount() const { return liveCount; }
+    int CellsX() const { return cellsX; }
+    int CellsZ() const { return cellsZ; }
+    float CellSize() const { return cellSize; }
+    glm::vec2 Origin() const { return glm::vec2(originX, originZ); }
+    bool Empty() const { return liveCount == 0; }
+
+private:
+    VegetationCell& CellOfSlot(uint32_t slot);
+    static void Grow(VegetationCell& c, const glm::vec3& pos, float radius);
+
+    std::vector<VegetationCell> cells;
+    VegetationCell overflow;              // starts right after the last cell's capacity
+    std::vector<glm::vec3> slotPositions; // positions in slot order, for queries
+    uint32_t liveCount = 0;
+    float originX = 0.0f, originZ = 0.0f;
+    float cellSize = 1.0f;
+    int cellsX = 0, cellsZ = 0;
+};
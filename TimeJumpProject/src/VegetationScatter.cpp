@@ -0,0 +1,287 @@
+// VegetationScatter.cpp
+#include "VegetationScatter.h"
+#include "ImageKernels.h"
+#include "MappedFile.h"
+#include "Parallel.h"
+#include "Terrain.h"
+
+#include "stb_image.h"
+
+#include <glm/gtc/constants.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+namespace {
+
+// splitmix64: tiny, fast and identical on every compiler (unlike std:: distributions)
+struct ScatterRng {
+    uint64_t state;
+    explicit ScatterRng(uint64_t s) : state(s) {}
+    uint64_t Next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+    float Next01() { return (float)(Next() >> 40) * (1.0f / 16777216.0f); }
+    float Range(float a, float b) { return a + (b - a) * Next01(); }
+};
+
+uint64_t TileSeed(uint32_t seed, int tx, int tz, uint32_t stream) {
+    uint64_t h = ((uint64_t)seed << 32) ^ ((uint64_t)(uint32_t)tx * 0x9E3779B1u) ^ ((uint64_t)(uint32_t)tz << 16) ^ stream;
+    return ScatterRng(h).Next();
+}
+
+// Background acceleration grid for Bridson's algorithm. Cell size r/sqrt(2)
+// guarantees at most one sample per cell.
+struct PoissonGrid {
+    float minX = 0, minZ = 0, cell = 1, radius = 1;
+    int w = 0, h = 0;
+    std::vector<glm::vec2> pts;
+    std::vector<uint8_t> used;
+
+    int CellX(float x) const { return std::min(std::max((int)((x - minX) / cell), 0), w - 1); }
+    int CellZ(float z) const { return std::min(std::max((int)((z - minZ) / cell), 0), h - 1); }
+
+    bool Free(const glm::vec2& p) const {
+        int cx = CellX(p.x), cz = CellZ(p.y);
+        if (used[(size_t)cz * w + cx]) return false; // cell diagonal == r, an occupied own cell always conflicts
+        float r2 = radius * radius;
+        for (int z = std::max(cz - 2, 0); z <= std::min(cz + 2, h - 1); ++z) {
+            for (int x = std::max(cx - 2, 0); x <= std::min(cx + 2, w - 1); ++x) {
+                if ((x - cx == 2 || cx - x == 2) && (z - cz == 2 || cz - z == 2)) continue; // corners are > r away
+                size_t i = (size_t)z * w + x;
+                if (!used[i]) continue;
+                glm::vec2 d = pts[i] - p;
+                if (glm::dot(d, d) < r2) return false;
+            }
+        }
+        return true;
+    }
+
+    void Insert(const glm::vec2& p) {
+        size_t i = (size_t)CellZ(p.y) * w + CellX(p.x);
+        pts[i] = p;
+        used[i] = 1;
+    }
+};
+
+struct TileBounds {
+    float x0, x1, z0, z1;   // world rectangle used to throw darts
+    int cx0, cx1, cz0, cz1; // owned grid cells [c0, c1)
+};
+
+// Bridson sampling restricted to one tile. Reads neighbour cells written by
+// earlier phases, writes only cells inside its own tile.
+void SampleTile(PoissonGrid& grid, const TileBounds& b, ScatterRng& rng, int k,
+    std::vector<glm::vec2>& out)
+{
+    std::vector<glm::vec2> active;
+    const float ring = grid.radius * 1.0001f;
+    const float stepCos = std::cos(glm::two_pi<float>() / (float)k);
+    const float stepSin = std::sin(glm::two_pi<float>() / (float)k);
+
+    // ownership is decided on cell indices so rounding never lets a tile write a neighbour's cell
+    auto inside = [&](const glm::vec2& p) {
+        if (p.x < b.x0 || p.x >= b.x1 || p.y < b.z0 || p.y >= b.z1) return false;
+        int cx = grid.CellX(p.x), cz = grid.CellZ(p.y);
+        return cx >= b.cx0 && cx < b.cx1 && cz >= b.cz0 && cz < b.cz1;
+    };
+    auto accept = [&](const glm::vec2& p) {
+        grid.Insert(p);
+        out.push_back(p);
+        active.push_back(p);
+    };
+
+    // random darts seed new fronts until the tile looks saturated
+    const int maxMisses = 32;
+    int misses = 0;
+    while (misses < maxMisses) {
+        glm::vec2 dart(rng.Range(b.x0, b.x1), rng.Range(b.z0, b.z1));
+        if (!inside(dart) || !grid.Free(dart)) { ++misses; continue; }
+        misses = 0;
+        accept(dart);
+
+        while (!active.empty()) {
+            size_t ai = (size_t)(rng.Next() % active.size());
+            glm::vec2 base = active[ai];
+            bool found = false;
+            // candidates walk around a ring just outside r (Roberts' variant of Bridson):
+            // tighter packing and far fewer rejected tries than random annulus samples
+            float a0 = rng.Next01() * glm::two_pi<float>();
+            glm::vec2 dir(std::cos(a0), std::sin(a0));
+            for (int i = 0; i < k; ++i) {
+                glm::vec2 c = base + dir * ring;
+                if (inside(c) && grid.Free(c)) { accept(c); found = true; break; }
+                dir = glm::vec2(dir.x * stepCos - dir.y * stepSin, dir.x * stepSin + dir.y * stepCos);
+            }
+            if (!found) {
+                active[ai] = active.back();
+                active.pop_back();
+            }
+        }
+    }
+}
+
+} // namespace
+
+bool DensityMask::Load(const std::string& path) {
+    int comp = 0;
+    MappedFile file;
+    stbi_set_flip_vertically_on_load_thread(false);
+    unsigned char* data = file.Open(path, true) ?
+        stbi_load_from_memory(file.Data(), (int)file.Size(), &width, &height, &comp, 1) : nullptr;
+    if (!data) {
+        std::cerr << "DensityMask: failed to load " << path << "\n";
+        width = height = 0;
+        values.clear();
+        return false;
+    }
+    values.resize((size_t)width * (size_t)height);
+    U8ToFloat(data, values.data(), values.size(), 1.0f / 255.0f);
+    stbi_image_free(data);
+    return true;
+}
+
+float DensityMask::Sample(float u, float v) const {
+    if (values.empty()) return 1.0f;
+    float fx = glm::clamp(u, 0.0f, 1.0f) * (width - 1);
+    float fz = glm::clamp(v, 0.0f, 1.0f) * (height - 1);
+    int x0 = (int)fx, z0 = (int)fz;
+    int x1 = std::min(x0 + 1, width - 1), z1 = std::min(z0 + 1, height - 1);
+    float sx = fx - (float)x0, sz = fz - (float)z0;
+    float a = values[(size_t)z0 * width + x0] * (1.0f - sx) + values[(size_t)z0 * width + x1] * sx;
+    float c = values[(size_t)z1 * width + x0] * (1.0f - sx) + values[(size_t)z1 * width + x1] * sx;
+    return a * (1.0f - sz) + c * sz;
+}
+
+std::vector<ScatterInstance> ScatterVegetation(const Terrain& terrain, const ScatterRules& rules,
+    ScatterStats* outStats)
+{
+    auto t0 = std::chrono::high_resolution_clock::now();
+    std::vector<ScatterInstance> result;
+
+    float extentX = rules.maxX - rules.minX;
+    float extentZ = rules.maxZ - rules.minZ;
+    if (rules.minSpacing <= 0.0f || extentX <= 0.0f || extentZ <= 0.0f) {
+        std::cerr << "ScatterVegetation: invalid bounds or spacing\n";
+        return result;
+    }
+
+    PoissonGrid grid;
+    grid.radius = rules.minSpacing;
+    grid.cell = rules.minSpacing / std::sqrt(2.0f);
+    grid.minX = rules.minX;
+    grid.minZ = rules.minZ;
+    grid.w = std::max(1, (int)std::ceil(extentX / grid.cell));
+    grid.h = std::max(1, (int)std::ceil(extentZ / grid.cell));
+    grid.pts.resize((size_t)grid.w * grid.h);
+    grid.used.assign((size_t)grid.w * grid.h, 0);
+
+    // tiles must be at least 4 cells wide: a tile reads +-2 cells around itself,
+    // so same-phase tiles (one tile apart) never touch the same cells
+    int tileCells = std::max(4, (int)std::lround(rules.tileSize / grid.cell));
+    int tilesX = (grid.w + tileCells - 1) / tileCells;
+    int tilesZ = (grid.h + tileCells - 1) / tileCells;
+    size_t tileCount = (size_t)tilesX * tilesZ;
+
+    auto boundsOf = [&](int tx, int tz) {
+        TileBounds b;
+        b.x0 = rules.minX + (float)(tx * tileCells) * grid.cell;
+        b.z0 = rules.minZ + (float)(tz * tileCells) * grid.cell;
+        b.x1 = std::min(rules.minX + (float)((tx + 1) * tileCells) * grid.cell, rules.maxX);
+        b.z1 = std::min(rules.minZ + (float)((tz + 1) * tileCells) * grid.cell, rules.maxZ);
+        b.cx0 = tx * tileCells; b.cx1 = std::min((tx + 1) * tileCells, grid.w);
+        b.cz0 = tz * tileCells; b.cz1 = std::min((tz + 1) * tileCells, grid.h);
+        return b;
+    };
+
+    // --- blue-noise pass: 4 phases of a 2x2 tile checkerboard ---
+    std::vector<std::vector<glm::vec2>> tileSamples(tileCount);
+    for (int phase = 0; phase < 4; ++phase) {
+        std::vector<size_t> phaseTiles;
+        for (int tz = phase >> 1; tz < tilesZ; tz += 2)
+            for (int tx = phase & 1; tx < tilesX; tx += 2)
+                phaseTiles.push_back((size_t)tz * tilesX + tx);
+
+        ParallelFor(phaseTiles.size(), [&](size_t i) {
+            size_t t = phaseTiles[i];
+            int tx = (int)(t % tilesX), tz = (int)(t / tilesX);
+            ScatterRng rng(TileSeed(rules.seed, tx, tz, 0));
+            SampleTile(grid, boundsOf(tx, tz), rng, std::max(1, rules.candidatesPerPoint), tileSamples[t]);
+        });
+    }
+
+    // --- rule pass: terrain height/slope/density, then per-instance variation ---
+    float minSlopeCos = std::cos(glm::radians(glm::clamp(rules.maxSlopeDeg, 0.0f, 90.0f)));
+    std::vector<std::vector<ScatterInstance>> tileOut(tileCount);
+    std::vector<ScatterStats> tileStats(tileCount);
+
+    ParallelFor(tileCount, [&](size_t t) {
+        int tx = (int)(t % tilesX), tz = (int)(t / tilesX);
+        ScatterRng rng(TileSeed(rules.seed, tx, tz, 1));
+        ScatterStats& st = tileStats[t];
+        std::vector<ScatterInstance>& out = tileOut[t];
+        out.reserve(tileSamples[t].size());
+
+        for (const glm::vec2& p : tileSamples[t]) {
+            ++st.candidates;
+            float y = terrain.GetHeightAt(p.x, p.y);
+            if (!std::isfinite(y)) { ++st.rejectedBounds; continue; }
+            if (y < rules.minHeight || y > rules.maxHeight) { ++st.rejectedHeight; continue; }
+
+            glm::vec3 n = terrain.GetNormalAt(p.x, p.y);
+            if (!std::isfinite(n.y) || n.y < minSlopeCos) { ++st.rejectedSlope; continue; }
+
+            if (rules.density && !rules.density->Empty()) {
+                float u = (p.x - rules.minX) / extentX;
+                float v = (p.y - rules.minZ) / extentZ;
+                if (rng.Next01() >= rules.density->Sample(u, v)) { ++st.rejectedDensity; continue; }
+            }
+
+            ScatterInstance inst;
+            inst.position = glm::vec3(p.x, y, p.y);
+            inst.rotation = rng.Next01() * glm::two_pi<float>();
+            inst.scale = rng.Range(rules.minScale, rules.maxScale);
+            out.push_back(inst);
+        }
+    });
+
+    // --- merge tiles in index order via prefix sums ---
+    std::vector<size_t> offsets(tileCount + 1, 0);
+    for (size_t t = 0; t < tileCount; ++t) offsets[t + 1] = offsets[t] + tileOut[t].size();
+    result.resize(offsets[tileCount]);
+    ParallelFor(tileCount, [&](size_t t) {
+        std::copy(tileOut[t].begin(), tileOut[t].end(), result.begin() + offsets[t]);
+    });
+    if (rules.maxCount > 0 && result.size() > rules.maxCount) result.resize(rules.maxCount);
+
+    if (outStats) {
+        ScatterStats total;
+        for (const ScatterStats& st : tileStats) {
+            total.candidates += st.candidates;
+            total.rejectedBounds += st.rejectedBounds;
+            total.rejectedSlope += st.rejectedSlope;
+            total.rejectedHeight += st.rejectedHeight;
+            total.rejectedDensity += st.rejectedDensity;
+        }
+        total.milliseconds = std::chrono::duration<double, std::milli>(
+            std::chrono::high_resolution_clock::now() - t0).count();
+        *outStats = total;
+    }
+    return result;
+}
+
+glm::mat4 InstanceMatrix(const ScatterInstance& inst) {
+    // written out directly instead of chaining translate/rotate/scale
+    float c = std::cos(inst.rotation) * inst.scale;
+    float s = std::sin(inst.rotation) * inst.scale;
+    glm::mat4 M(1.0f);
+    M[0] = glm::vec4(c, 0.0f, -s, 0.0f);
+    M[1] = glm::vec4(0.0f, inst.scale, 0.0f, 0.0f);
+    M[2] = glm::vec4(s, 0.0f, c, 0.0f);
+    M[3] = glm::vec4(inst.position, 1.0f);
+    return M;
+}
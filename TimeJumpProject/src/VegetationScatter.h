@@ -0,0 +1,60 @@
+#pragma once
+
+// VegetationScatter.h - deterministic Poisson-disk scattering over the terrain
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+class Terrain;
+
+// Optional greyscale mask stretched over the scatter bounds (0 = empty, 1 = full density)
+struct DensityMask {
+    int width = 0, height = 0;
+    std::vector<float> values; // row-major: values[row*width + col]
+
+    bool Load(const std::string& path);
+    float Sample(float u, float v) const; // bilinear, u/v in [0..1]
+    bool Empty() const { return values.empty(); }
+};
+
+struct ScatterRules {
+    uint32_t seed = 1337;          // same seed + rules -> same output, bit for bit
+    float minX = -90.0f, maxX = 90.0f;
+    float minZ = -90.0f, maxZ = 90.0f;
+
+    float minSpacing = 6.0f;       // Poisson-disk radius (world units)
+    float tileSize = 32.0f;        // parallel work unit, clamped to >= 4 grid cells
+    int candidatesPerPoint = 12;   // Bridson k
+
+    // terrain rules, applied after the blue-noise pass
+    float minHeight = -1e30f, maxHeight = 1e30f; // world Y
+    float maxSlopeDeg = 35.0f;
+    const DensityMask* density = nullptr;
+
+    float minScale = 0.8f, maxScale = 1.4f;
+    size_t maxCount = 0;           // 0 = unlimited; otherwise truncated in tile order
+};
+
+struct ScatterInstance {
+    glm::vec3 position;
+    float rotation;                // radians around +Y
+    float scale;
+};
+
+struct ScatterStats {
+    size_t candidates = 0;         // blue-noise points before rules
+    size_t rejectedBounds = 0;     // outside the terrain heightmap
+    size_t rejectedSlope = 0;
+    size_t rejectedHeight = 0;
+    size_t rejectedDensity = 0;
+    double milliseconds = 0.0;
+};
+
+// Generates instances tile by tile on worker threads. Output order and values only
+// depend on the rules (never on thread timing), so identical seeds reproduce layouts.
+std::vector<ScatterInstance> ScatterVegetation(const Terrain& terrain, const ScatterRules& rules,
+    ScatterStats* outStats = nullptr);
+
+// translate * rotateY * uniform scale, as used by the instance buffers
+glm::mat4 InstanceMatrix(const ScatterInstance& inst);
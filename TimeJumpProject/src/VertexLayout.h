@@ -0,0 +1,135 @@
+#pragma once
+
+// VertexLayout.h - compile-time vertex layouts: packed attribute formats, offsets,
+// stride and the glVertexAttribPointer setup generated from one type list
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include <utility>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+// ---- attribute formats: GL description + encoder from the float value ----
+
+template <int N>
+struct AttribFloat {
+    static constexpr GLint components = N;
+    static constexpr GLenum glType = GL_FLOAT;
+    static constexpr GLboolean normalized = GL_FALSE;
+    static constexpr size_t bytes = N * sizeof(float);
+    static void Encode(const glm::vec<N, float>& v, unsigned char* dst) { std::memcpy(dst, &v[0], bytes); }
+};
+
+// xyz as half floats plus w = 1, padded to 8 bytes to keep attributes 4-byte aligned
+struct AttribHalf4 {
+    static constexpr GLint components = 4;
+    static constexpr GLenum glType = GL_HALF_FLOAT;
+    static constexpr GLboolean normalized = GL_FALSE;
+    static constexpr size_t bytes = 8;
+    static void Encode(const glm::vec3& v, unsigned char* dst) {
+        uint64_t packed = glm::packHalf4x16(glm::vec4(v, 1.0f));
+        std::memcpy(dst, &packed, bytes);
+    }
+};
+
+// xyz in [0, 1] as 16-bit unorm plus w = 1
+struct AttribUnorm16x4 {
+    static constexpr GLint components = 4;
+    static constexpr GLenum glType = GL_UNSIGNED_SHORT;
+    static constexpr GLboolean normalized = GL_TRUE;
+    static constexpr size_t bytes = 8;
+    static void Encode(const glm::vec3& v, unsigned char* dst) {
+        uint64_t packed = glm::packUnorm4x16(glm::vec4(v, 1.0f));
+        std::memcpy(dst, &packed, bytes);
+    }
+};
+
+// uv in [0, 1] as 16-bit unorm
+struct AttribUnorm16x2 {
+    static constexpr GLint components = 2;
+    static constexpr GLenum glType = GL_UNSIGNED_SHORT;
+    static constexpr GLboolean normalized = GL_TRUE;
+    static constexpr size_t bytes = 4;
+    static void Encode(const glm::vec2& v, unsigned char* dst) {
+        uint32_t packed = glm::packUnorm2x16(v);
+        std::memcpy(dst, &packed, bytes);
+    }
+};
+
+// unit vector as snorm 10-10-10 (w = 0); ~0.1 degree error, plenty for normals
+struct AttribSnorm1010102 {
+    static constexpr GLint components = 4;
+    static constexpr GLenum glType = GL_INT_2_10_10_10_REV;
+    static constexpr GLboolean normalized = GL_TRUE;
+    static constexpr size_t bytes = 4;
+    static void Encode(const glm::vec3& v, unsigned char* dst) {
+        uint32_t packed = glm::packSnorm3x10_1x2(glm::vec4(v, 0.0f));
+        std::memcpy(dst, &packed, bytes);
+    }
+};
+
+// ---- layouts ----
+
+template <GLuint Location, typename Format>
+struct Attrib {
+    static constexpr GLuint location = Location;
+    using Fmt = Format;
+};
+
+// VertexLayout<Attrib<0, AttribHalf4>, Attrib<1, AttribSnorm1010102>, ...>: attributes
+// are packed in list order with no padding.
+template <typename... Attribs>
+struct VertexLayout {
+    static constexpr size_t count = sizeof...(Attribs);
+    static constexpr size_t sizes[count] = { Attribs::Fmt::bytes... };
+
+    static constexpr size_t Offset(size_t i) {
+        size_t offset = 0;
+        for (size_t k = 0; k < i; ++k) offset += sizes[k];
+        return offset;
+    }
+    static constexpr size_t stride = Offset(count);
+
+    template <size_t I>
+    using At = std::tuple_element_t<I, std::tuple<Attribs...>>;
+
+    // enables every attribute of the bound VAO and points it at the bound
+    // GL_ARRAY_BUFFER, starting 'baseOffset' bytes in
+    static void Apply(size_t baseOffset = 0) { ApplyAll(baseOffset, std::index_sequence_for<Attribs...>{}); }
+
+    // encodes attribute I of the vertex starting at 'vertex'
+    template <size_t I, typename T>
+    static void Put(unsigned char* vertex, const T& value) { At<I>::Fmt::Encode(value, vertex + Offset(I)); }
+
+private:
+    template <size_t... I>
+    static void ApplyAll(size_t baseOffset, std::index_sequence<I...>) {
+        (ApplyOne<At<I>>(baseOffset + Offset(I)), ...);
+    }
+    template <typename A>
+    static void ApplyOne(size_t offset) {
+        glEnableVertexAttribArray(A::location);
+        glVertexAttribPointer(A::location, A::Fmt::components, A::Fmt::glType, A::Fmt::normalized,
+            (GLsizei)stride, (void*)offset);
+    }
+};
+
+// How a shader turns quantized attributes back into object space:
+// value = stored * scale + offset (see uPosScale etc. in tree_inst.vert / terrain.vert).
+struct VertexDequant {
+    glm::vec3 posScale{ 1.0f };
+    glm::vec3 posOffset{ 0.0f };
+    glm::vec2 uvScale{ 1.0f };
+    glm::vec2 uvOffset{ 0.0f };
+};
+
+template <typename ShaderT>
+void SetDequantUniforms(const ShaderT& shader, const VertexDequant& d) {
+    shader.SetVec3("uPosScale", d.posScale);
+    shader.SetVec3("uPosOffset", d.posOffset);
+    shader.SetVec2("uUvScale", d.uvScale);
+    shader.SetVec2("uUvOffset", d.uvOffset);
+}
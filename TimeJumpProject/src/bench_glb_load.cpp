@@ -0,0 +1,174 @@
+// bench_glb_load.cpp
+// Load time of the same geometry as OBJ and as GLB: ImportOBJ alone, the full OBJ
+// pipeline (import, OptimizeMesh, BuildMeshLods, QuantizeMesh), and
+// ImportGLB on a file whose buffer views upload as-is (direct) and on one whose
+// scaled node forces the decode path, and the full GLB pipeline the demo runs (decode
+// plus ProcessGLB, and with its mesh cache). The GLBs are written from the imported OBJ, one primitive per submesh. Without an argument the synthetic OBJ of bench_obj_parse is used.
+//
+// Not part of the Visual Studio project; built by the Makefile's tools target:
+//   make bench_glb_load      (or: make tools)
+//   ./bench_glb_load [model.obj]      (or: ./bench_glb_load "" <grid size>)
+
+#include "GltfLoader.h"
+#include "ModelLoader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+static std::string WriteSyntheticObj(int n) {
+    std::string path = (std::filesystem::temp_directory_path() / "bench_glb_load.obj").string();
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return "";
+    std::fprintf(f, "# synthetic %dx%d height field\n", n, n);
+    for (int z = 0; z <= n; ++z) {
+        for (int x = 0; x <= n; ++x) {
+            float h = std::sin(x * 0.05f) * std::cos(z * 0.07f) * 4.0f;
+            std::fprintf(f, "v %.6f %.6f %.6f\n", x * 0.1f, h, z * 0.1f);
+            std::fprintf(f, "vt %.6f %.6f\n", (float)x / n, (float)z / n);
+            std::fprintf(f, "vn %.6f %.6f %.6f\n", -std::cos(x * 0.05f) * 0.2f, 1.0f, std::sin(z * 0.07f) * 0.2f);
+        }
+    }
+    for (int z = 0; z < n; ++z) {
+        if (z == 0 || z == n / 2) std::fprintf(f, "usemtl %s\n", z == 0 ? "bark" : "leaves");
+        for (int x = 0; x < n; ++x) {
+            int a = z * (n + 1) + x + 1, b = a + n + 1;
+            std::fprintf(f, "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, b, b, b, b + 1, b + 1, b + 1, a + 1, a + 1, a + 1);
+        }
+    }
+    std::fclose(f);
+    return path;
+}
+
+static void Append(std::vector<unsigned char>& bin, const void* data, size_t bytes) {
+    const unsigned char* p = (const unsigned char*)data;
+    bin.insert(bin.end(), p, p + bytes);
+}
+
+// POSITION, NORMAL and TEXCOORD_0 as three float views, indices as one uint view
+static bool WriteGlb(const MeshData& mesh, const std::string& path, float nodeScale) {
+    std::vector<float> positions, normals, uvs;
+    glm::vec3 mn(1e30f), mx(-1e30f);
+    for (const ModelVertex& v : mesh.vertices) {
+        positions.insert(positions.end(), { v.px, v.py, v.pz });
+        normals.insert(normals.end(), { v.nx, v.ny, v.nz });
+        uvs.insert(uvs.end(), { v.u, 1.0f - v.v }); // glTF UVs start at the top
+        mn = glm::min(mn, glm::vec3(v.px, v.py, v.pz));
+        mx = glm::max(mx, glm::vec3(v.px, v.py, v.pz));
+    }
+    std::vector<unsigned char> bin;
+    Append(bin, positions.data(), positions.size() * 4);
+    Append(bin, normals.data(), normals.size() * 4);
+    Append(bin, uvs.data(), uvs.size() * 4);
+    size_t indexOffset = bin.size();
+    Append(bin, mesh.indices.data(), mesh.indices.size() * 4);
+    size_t vc = mesh.vertices.size();
+
+    std::string json = "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[0]}],\"nodes\":[{\"mesh\":0";
+    if (nodeScale != 1.0f) json += ",\"scale\":[" + std::to_string(nodeScale) + "," + std::to_string(nodeScale) + "," + std::to_string(nodeScale) + "]";
+    json += "}],\"buffers\":[{\"byteLength\":" + std::to_string(bin.size()) + "}],\"bufferViews\":[";
+    json += "{\"buffer\":0,\"byteOffset\":0,\"byteLength\":" + std::to_string(vc * 12) + "},";
+    json += "{\"buffer\":0,\"byteOffset\":" + std::to_string(vc * 12) + ",\"byteLength\":" + std::to_string(vc * 12) + "},";
+    json += "{\"buffer\":0,\"byteOffset\":" + std::to_string(vc * 24) + ",\"byteLength\":" + std::to_string(vc * 8) + "},";
+    json += "{\"buffer\":0,\"byteOffset\":" + std::to_string(indexOffset) + ",\"byteLength\":" + std::to_string(mesh.indices.size() * 4) + "}],";
+    json += "\"accessors\":[";
+    char bounds[256];
+    std::snprintf(bounds, sizeof(bounds), "\"min\":[%g,%g,%g],\"max\":[%g,%g,%g]", mn.x, mn.y, mn.z, mx.x, mx.y, mx.z);
+    json += "{\"bufferView\":0,\"componentType\":5126,\"count\":" + std::to_string(vc) + ",\"type\":\"VEC3\"," + bounds + "},";
+    json += "{\"bufferView\":1,\"componentType\":5126,\"count\":" + std::to_string(vc) + ",\"type\":\"VEC3\"},";
+    json += "{\"bufferView\":2,\"componentType\":5126,\"count\":" + std::to_string(vc) + ",\"type\":\"VEC2\"}";
+    for (const SubMeshRange& s : mesh.submeshes) {
+        json += ",{\"bufferView\":3,\"byteOffset\":" + std::to_string(s.indexOffset * 4) +
+            ",\"componentType\":5125,\"count\":" + std::to_string(s.indexCount) + ",\"type\":\"SCALAR\"}";
+    }
+    json += "],\"meshes\":[{\"primitives\":[";
+    for (size_t i = 0; i < mesh.submeshes.size(); ++i) {
+        if (i) json += ",";
+        json += "{\"attributes\":{\"POSITION\":0,\"NORMAL\":1,\"TEXCOORD_0\":2},\"indices\":" + std::to_string(3 + i) + "}";
+    }
+    json += "]}]}";
+    while (json.size() % 4) json += ' ';
+    while (bin.size() % 4) bin.push_back(0);
+
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return false;
+    uint32_t header[3] = { 0x46546C67, 2, (uint32_t)(12 + 8 + json.size() + 8 + bin.size()) };
+    uint32_t jsonChunk[2] = { (uint32_t)json.size(), 0x4E4F534A };
+    uint32_t binChunk[2] = { (uint32_t)bin.size(), 0x004E4942 };
+    std::fwrite(header, sizeof(header), 1, f);
+    std::fwrite(jsonChunk, sizeof(jsonChunk), 1, f);
+    std::fwrite(json.data(), 1, json.size(), f);
+    std::fwrite(binChunk, sizeof(binChunk), 1, f);
+    std::fwrite(bin.data(), 1, bin.size(), f);
+    std::fclose(f);
+    return true;
+}
+
+template <typename Fn>
+static double MedianMs(int runs, Fn&& fn) {
+    std::vector<double> ms;
+    for (int r = 0; r < runs; ++r) {
+        auto t0 = std::chrono::high_resolution_clock::now();
+        fn();
+        auto t1 = std::chrono::high_resolution_clock::now();
+        ms.push_back(std::chrono::duration<double, std::milli>(t1 - t0).count());
+    }
+    std::sort(ms.begin(), ms.end());
+    return ms[ms.size() / 2];
+}
+
+int main(int argc, char** argv) {
+    std::string path = argc > 1 ? argv[1] : "";
+    if (path.empty()) path = WriteSyntheticObj(argc > 2 ? std::atoi(argv[2]) : 1000);
+    const int runs = 3;
+
+    MeshData obj;
+    if (!ImportOBJ(path, obj)) return 1;
+    std::string directPath = (std::filesystem::temp_directory_path() / "bench_glb_direct.glb").string();
+    std::string decodePath = (std::filesystem::temp_directory_path() / "bench_glb_decode.glb").string();
+    if (!WriteGlb(obj, directPath, 1.0f) || !WriteGlb(obj, decodePath, 2.0f)) return 1;
+
+    double importMs = MedianMs(runs, [&] { MeshData m; ImportOBJ(path, m); });
+    double pipelineMs = MedianMs(runs, [&] {
+        MeshData m;
+        ImportOBJ(path, m);
+        OptimizeMesh(m);
+        BuildMeshLods(m);
+        QuantizeMesh(m);
+    });
+    GlbAsset direct, decoded;
+    double directMs = MedianMs(runs, [&] { MappedFile f; ImportGLB(directPath, f, direct, true); });
+    double decodeMs = MedianMs(runs, [&] { MappedFile f; ImportGLB(decodePath, f, decoded, true); });
+    // what the demo does: decoded, then the same passes as the OBJ, which the mesh cache
+    // saves from the second run on
+    auto glbPipeline = [&] {
+        MappedFile f;
+        GlbAsset a;
+        ImportGLB(directPath, f, a);
+        ProcessGLB(a);
+    };
+    double coldMs = MedianMs(runs, [&] {
+        std::filesystem::remove(MeshCachePath(directPath));
+        glbPipeline();
+    });
+    double cachedMs = MedianMs(runs, glbPipeline);
+
+    std::printf("%s: %zu vertices, %zu triangles, %zu submeshes\n", path.c_str(),
+        obj.vertices.size(), obj.indices.size() / 3, obj.submeshes.size());
+    std::printf("OBJ import:          %8.1f ms\n", importMs);
+    std::printf("OBJ full pipeline:   %8.1f ms\n", pipelineMs);
+    std::printf("GLB direct:          %8.2f ms  (%s, %.1f MB to upload, %zu triangles)\n", directMs,
+        direct.direct ? "zero-copy" : "DECODED", direct.gpuSize / (1024.0 * 1024.0), direct.indexCount / 3);
+    std::printf("GLB decode:          %8.1f ms  (%s, %zu triangles)\n", decodeMs,
+        decoded.direct ? "DIRECT" : "decoded", decoded.indexCount / 3);
+    std::printf("GLB full pipeline:   %8.1f ms  (mesh cache: %.2f ms)\n", coldMs, cachedMs);
+    bool ok = direct.direct && !decoded.direct && direct.indexCount == obj.indices.size() &&
+        decoded.indexCount == obj.indices.size();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,118 @@
+// bench_mesh_optimize.cpp
+// Measures what OptimizeMesh (ModelLoader.h / MeshOptimizer.h) buys on an imported
+// model: ACMR (vertex shader runs per triangle, 16-entry FIFO and 32-entry) and
+// vertex fetch overfetch, per stage, plus the time each stage takes. Defaults to
+// resources/models/Tree1.obj; falls back to a shuffled synthetic sphere when the
+// model is missing so the numbers stay reproducible.
+//
+// Not part of the Visual Studio project; built by the Makefile's tools target:
+//   make bench_mesh_optimize      (or: make tools)
+//   ./bench_mesh_optimize [model.obj]
+
+#include "ModelLoader.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// UV sphere with two material bands, triangles and vertices shuffled like a badly
+// exported OBJ
+static MeshData SyntheticMesh() {
+    const int rings = 200, segments = 400;
+    MeshData m;
+    for (int r = 0; r <= rings; ++r) {
+        for (int s = 0; s <= segments; ++s) {
+            float th = 3.14159265f * r / rings, ph = 6.2831853f * s / segments;
+            float x = std::sin(th) * std::cos(ph), y = std::cos(th), z = std::sin(th) * std::sin(ph);
+            m.vertices.push_back(ModelVertex{ x, y, z, x, y, z, (float)s / segments, (float)r / rings });
+        }
+    }
+    std::mt19937 rng(7);
+    for (int band = 0; band < 2; ++band) {
+        std::vector<unsigned int> tris;
+        for (int r = band * rings / 2; r < (band + 1) * rings / 2; ++r) {
+            for (int s = 0; s < segments; ++s) {
+                unsigned int a = r * (segments + 1) + s, b = a + segments + 1;
+                tris.insert(tris.end(), { a, b, a + 1, a + 1, b, b + 1 });
+            }
+        }
+        std::vector<size_t> order(tris.size() / 3);
+        for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+        std::shuffle(order.begin(), order.end(), rng);
+        SubMeshRange range;
+        range.materialId = band;
+        range.indexOffset = m.indices.size();
+        range.indexCount = tris.size();
+        for (size_t t : order) m.indices.insert(m.indices.end(), &tris[t * 3], &tris[t * 3] + 3);
+        m.submeshes.push_back(range);
+    }
+    // vertex order of an importer that numbers in file order, not in use order
+    std::vector<unsigned int> perm(m.vertices.size());
+    for (size_t i = 0; i < perm.size(); ++i) perm[i] = (unsigned int)i;
+    std::shuffle(perm.begin(), perm.end(), rng);
+    std::vector<ModelVertex> shuffled(m.vertices.size());
+    for (size_t i = 0; i < perm.size(); ++i) shuffled[perm[i]] = m.vertices[i];
+    for (unsigned int& i : m.indices) i = perm[i];
+    m.vertices.swap(shuffled);
+    return m;
+}
+
+static void Report(const char* stage, const MeshData& m, double ms) {
+    float acmr16 = 0.0f, acmr32 = 0.0f;
+    size_t tris = 0;
+    for (const SubMeshRange& r : m.submeshes) {
+        const unsigned int* idx = m.indices.data() + r.indexOffset;
+        size_t t = r.indexCount / 3;
+        acmr16 += AnalyzeVertexCache(idx, r.indexCount, m.vertices.size(), 16) * t;
+        acmr32 += AnalyzeVertexCache(idx, r.indexCount, m.vertices.size(), 32) * t;
+        tris += t;
+    }
+    float fetch = AnalyzeVertexFetch(m.indices.data(), m.indices.size(), m.vertices.size(), sizeof(ModelVertex));
+    std::printf("%-14s ACMR16 %.3f  ACMR32 %.3f  overfetch %.2f  %8.2f ms\n",
+        stage, acmr16 / tris, acmr32 / tris, fetch, ms);
+}
+
+int main(int argc, char** argv) {
+    std::string path = argc > 1 ? argv[1] : "../resources/models/Tree1.obj";
+    MeshData mesh;
+    if (!ImportOBJ(path, mesh)) {
+        std::printf("%s not found, using a synthetic sphere\n", path.c_str());
+        mesh = SyntheticMesh();
+    }
+    std::printf("vertices: %zu, triangles: %zu, submeshes: %zu\n",
+        mesh.vertices.size(), mesh.indices.size() / 3, mesh.submeshes.size());
+    Report("imported", mesh, 0.0);
+
+    // stages one by one, so each one's effect shows
+    auto t0 = std::chrono::high_resolution_clock::now();
+    std::vector<std::vector<unsigned int>> clusters(mesh.submeshes.size());
+    for (size_t i = 0; i < mesh.submeshes.size(); ++i) {
+        const SubMeshRange& r = mesh.submeshes[i];
+        OptimizeVertexCache(mesh.indices.data() + r.indexOffset, r.indexCount, mesh.vertices.size(), 16, &clusters[i]);
+    }
+    auto t1 = std::chrono::high_resolution_clock::now();
+    Report("vertex cache", mesh, std::chrono::duration<double, std::milli>(t1 - t0).count());
+
+    size_t clusterCount = 0;
+    t0 = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < mesh.submeshes.size(); ++i) {
+        const SubMeshRange& r = mesh.submeshes[i];
+        OptimizeOverdraw(mesh.indices.data() + r.indexOffset, r.indexCount, &mesh.vertices[0].px, sizeof(ModelVertex), clusters[i]);
+        clusterCount += clusters[i].size();
+    }
+    t1 = std::chrono::high_resolution_clock::now();
+    Report("overdraw", mesh, std::chrono::duration<double, std::milli>(t1 - t0).count());
+    std::printf("               (%zu clusters)\n", clusterCount);
+
+    t0 = std::chrono::high_resolution_clock::now();
+    size_t used = OptimizeVertexFetch(mesh.vertices.data(), mesh.vertices.size(), sizeof(ModelVertex),
+        mesh.indices.data(), mesh.indices.size());
+    mesh.vertices.resize(used);
+    t1 = std::chrono::high_resolution_clock::now();
+    Report("vertex fetch", mesh, std::chrono::duration<double, std::milli>(t1 - t0).count());
+    return 0;
+}
@@ -0,0 +1,129 @@
+// bench_meshlet_cull.cpp
+// Meshlet clustering and culling (Meshlet.h) on a dense closed model: build time
+// and fill (vertices / triangles per meshlet), then for cameras around and close to
+// the model the share of meshlets and triangles MeshletCuller::Cull keeps, split
+// into frustum and back-face rejects, and the time one Cull takes. Every back-face
+// reject is checked triangle by triangle, so a cone that is too tight fails the run.
+// Defaults to a bumpy synthetic sphere (a stand-in for a scanned prop).
+//
+// Not part of the Visual Studio project; built by the Makefile's tools target:
+//   make bench_meshlet_cull      (or: make tools)
+//   ./bench_meshlet_cull [model.obj]
+
+#include "ModelLoader.h"
+#include "Meshlet.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include <glm/gtc/matrix_transform.hpp>
+
+// ~1M triangles, displaced so normals vary inside every meshlet
+static MeshData SyntheticMesh() {
+    const int rings = 500, segments = 1000;
+    MeshData m;
+    for (int r = 0; r <= rings; ++r) {
+        for (int s = 0; s <= segments; ++s) {
+            float th = 3.14159265f * r / rings, ph = 6.2831853f * s / segments;
+            glm::vec3 n(std::sin(th) * std::cos(ph), std::cos(th), std::sin(th) * std::sin(ph));
+            glm::vec3 p = n * (1.0f + 0.01f * std::sin(40.0f * th) * std::sin(30.0f * ph));
+            m.vertices.push_back(ModelVertex{ p.x, p.y, p.z, n.x, n.y, n.z, (float)s / segments, (float)r / rings });
+        }
+    }
+    SubMeshRange range;
+    range.materialId = 0;
+    for (int r = 0; r < rings; ++r) {
+        for (int s = 0; s < segments; ++s) {
+            unsigned int a = r * (segments + 1) + s, b = a + segments + 1;
+            m.indices.insert(m.indices.end(), { a, a + 1, b, a + 1, b + 1, b }); // counter-clockwise from outside
+        }
+    }
+    range.indexCount = m.indices.size();
+    m.submeshes.push_back(range);
+    return m;
+}
+
+// back-face rejects whose triangles are not all back-facing
+static size_t WrongRejects(const MeshData& m, const glm::vec3& eye) {
+    size_t wrong = 0;
+    const MeshletData& d = m.meshlets;
+    for (const Meshlet& ml : d.meshlets) {
+        if (!MeshletBackfacing(ml, eye)) continue;
+        for (uint32_t t = 0; t < ml.triangleCount; ++t) {
+            glm::vec3 p[3];
+            for (int k = 0; k < 3; ++k) {
+                const ModelVertex& v = m.vertices[d.vertices[ml.vertexOffset + d.triangles[ml.triangleOffset + t * 3 + k]]];
+                p[k] = glm::vec3(v.px, v.py, v.pz);
+            }
+            glm::vec3 n = glm::cross(p[1] - p[0], p[2] - p[0]);
+            if (glm::dot(p[0] - eye, n) < 0.0f) {
+                ++wrong;
+                break;
+            }
+        }
+    }
+    return wrong;
+}
+
+int main(int argc, char** argv) {
+    MeshData m;
+    if (argc > 1) {
+        if (!ImportOBJ(argv[1], m)) return 1;
+    }
+    else {
+        m = SyntheticMesh();
+    }
+    OptimizeMesh(m);
+    auto t0 = std::chrono::high_resolution_clock::now();
+    ClusterMesh(m);
+    double buildMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+    const MeshletData& d = m.meshlets;
+    if (d.Empty()) {
+        std::printf("%zu triangles: below kMeshletMinTriangles, no meshlets\n", m.indices.size() / 3);
+        return 0;
+    }
+    size_t triangles = 0;
+    for (const SubMeshRange& r : m.submeshes) triangles += r.indexCount / 3;
+    std::printf("%zu triangles -> %zu meshlets in %.1f ms (%.1f vertices, %.1f triangles each)\n",
+        triangles, d.meshlets.size(), buildMs, (double)d.vertices.size() / d.meshlets.size(),
+        (double)triangles / d.meshlets.size());
+
+    MeshGL_Model model;
+    model.meshlets = d;
+    model.submeshes = m.submeshes;
+    glm::vec3 lo(1e30f), hi(-1e30f);
+    for (const ModelVertex& v : m.vertices) {
+        lo = glm::min(lo, glm::vec3(v.px, v.py, v.pz));
+        hi = glm::max(hi, glm::vec3(v.px, v.py, v.pz));
+    }
+    glm::vec3 centre = (lo + hi) * 0.5f;
+    float size = glm::length(hi - lo) * 0.5f;
+    glm::mat4 proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.01f * size, 100.0f * size);
+
+    MeshletCuller culler;
+    size_t wrong = 0;
+    std::printf("%-26s %8s %8s %8s %9s %9s\n", "camera", "kept", "tris", "frustum", "backface", "cull");
+    const float distances[2] = { 3.0f, 0.8f }; // from the bounds centre, in half-diagonals
+    for (float dist : distances) {
+        for (int a = 0; a < 4; ++a) {
+            float ang = a * 1.5707963f + 0.3f;
+            glm::vec3 eye = centre + size * dist * glm::vec3(std::cos(ang), 0.4f, std::sin(ang));
+            glm::mat4 view = glm::lookAt(eye, centre, glm::vec3(0.0f, 1.0f, 0.0f));
+            const int runs = 20;
+            size_t kept = 0;
+            auto c0 = std::chrono::high_resolution_clock::now();
+            for (int r = 0; r < runs; ++r) kept = culler.Cull(model, glm::mat4(1.0f), view, proj);
+            double us = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - c0).count() / runs;
+            wrong += WrongRejects(m, eye);
+            char label[64];
+            std::snprintf(label, sizeof(label), "%.1fx size, %3d deg", dist, (int)(ang * 57.29578f));
+            std::printf("%-26s %7.1f%% %7.1f%% %8zu %9zu %7.0f us\n", label,
+                100.0 * kept / d.meshlets.size(), 100.0 * culler.VisibleTriangles() / triangles,
+                culler.CulledFrustum(), culler.CulledBackface(), us);
+        }
+    }
+    std::printf("back-face rejects with a front-facing triangle: %zu\n", wrong);
+    return wrong == 0 ? 0 : 1;
+}
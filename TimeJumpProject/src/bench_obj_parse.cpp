@@ -0,0 +1,101 @@
+// bench_obj_parse.cpp
+// OBJ import throughput: tinyobj (ImportOBJSerial) against the parallel parser
+// (ImportOBJ / ObjParser.h), in MB/s, and a check that both produce identical
+// vertices, indices and submeshes. Without an argument it writes a synthetic
+// scan-like OBJ (quads, v/vt/vn, two materials, a block of negative indices)
+// to the temp directory first.
+//
+// Not part of the Visual Studio project; built by the Makefile's tools target:
+//   make bench_obj_parse      (or: make tools)
+//   ./bench_obj_parse [model.obj]      (or: ./bench_obj_parse "" <grid size>)
+
+#include "ModelLoader.h"
+#include "ObjParser.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+static std::string WriteSyntheticObj(int n) {
+    std::string path = (std::filesystem::temp_directory_path() / "bench_obj_parse.obj").string();
+    std::string mtlPath = (std::filesystem::temp_directory_path() / "bench_obj_parse.mtl").string();
+    if (FILE* mtl = std::fopen(mtlPath.c_str(), "wb")) {
+        std::fprintf(mtl, "newmtl bark\nKd 0.4 0.3 0.2\nnewmtl leaves\nKd 0.2 0.6 0.2\n");
+        std::fclose(mtl);
+    }
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return "";
+    std::fprintf(f, "# synthetic %dx%d height field\nmtllib bench_obj_parse.mtl\n", n, n);
+    for (int z = 0; z <= n; ++z) {
+        for (int x = 0; x <= n; ++x) {
+            float h = std::sin(x * 0.05f) * std::cos(z * 0.07f) * 4.0f;
+            std::fprintf(f, "v %.6f %.6f %.6f\n", x * 0.1f, h, z * 0.1f);
+            std::fprintf(f, "vt %.6f %.6f\n", (float)x / n, (float)z / n);
+            std::fprintf(f, "vn %.6f %.6f %.6f\n", -std::cos(x * 0.05f) * 0.2f, 1.0f, std::sin(z * 0.07f) * 0.2f);
+        }
+    }
+    for (int z = 0; z < n; ++z) {
+        if (z == 0 || z == n / 2) std::fprintf(f, "usemtl %s\n", z == 0 ? "bark" : "leaves");
+        for (int x = 0; x < n; ++x) {
+            int a = z * (n + 1) + x + 1, b = a + n + 1;
+            std::fprintf(f, "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, b, b, b, b + 1, b + 1, b + 1, a + 1, a + 1, a + 1);
+        }
+    }
+    // a detached patch addressed with relative indices, as some exporters write
+    std::fprintf(f, "o patch\nv 0 10 0\nv 1 10 0\nv 1 10 1\nv 0 10 1\nvn 0 1 0\nf -4//-1 -3//-1 -2//-1 -1//-1\n");
+    std::fclose(f);
+    return path;
+}
+
+static bool SameMesh(const MeshData& a, const MeshData& b) {
+    if (a.vertices.size() != b.vertices.size() || a.indices != b.indices) return false;
+    if (std::memcmp(a.vertices.data(), b.vertices.data(), a.vertices.size() * sizeof(ModelVertex)) != 0) return false;
+    if (a.submeshes.size() != b.submeshes.size() || a.materials.size() != b.materials.size()) return false;
+    for (size_t i = 0; i < a.submeshes.size(); ++i) {
+        if (a.submeshes[i].materialId != b.submeshes[i].materialId ||
+            a.submeshes[i].indexOffset != b.submeshes[i].indexOffset ||
+            a.submeshes[i].indexCount != b.submeshes[i].indexCount) return false;
+    }
+    return true;
+}
+
+template <typename Fn>
+static double MedianMs(int runs, Fn&& fn) {
+    std::vector<double> ms;
+    for (int r = 0; r < runs; ++r) {
+        auto t0 = std::chrono::high_resolution_clock::now();
+        fn();
+        auto t1 = std::chrono::high_resolution_clock::now();
+        ms.push_back(std::chrono::duration<double, std::milli>(t1 - t0).count());
+    }
+    std::sort(ms.begin(), ms.end());
+    return ms[ms.size() / 2];
+}
+
+int main(int argc, char** argv) {
+    std::string path = argc > 1 ? argv[1] : "";
+    if (path.empty()) path = WriteSyntheticObj(argc > 2 ? std::atoi(argv[2]) : 1000);
+    double mb = (double)std::filesystem::file_size(path) / (1024.0 * 1024.0);
+    const int runs = 3;
+
+    MeshData serial, parallel;
+    ObjParseStats stats;
+    double serialMs = MedianMs(runs, [&] { ImportOBJSerial(path, serial); });
+    double parallelMs = MedianMs(runs, [&] { ParseOBJParallel(path, parallel, "", &stats); });
+
+    std::printf("%s: %.1f MB, %zu vertices, %zu triangles, %zu submeshes\n", path.c_str(), mb,
+        parallel.vertices.size(), parallel.indices.size() / 3, parallel.submeshes.size());
+    std::printf("tinyobj:  %8.1f ms  %7.1f MB/s\n", serialMs, mb / (serialMs / 1000.0));
+    std::printf("parallel: %8.1f ms  %7.1f MB/s  (%zu chunks, %u threads; parse %.1f ms, merge %.1f ms)\n",
+        parallelMs, mb / (parallelMs / 1000.0), stats.chunks, WorkerThreadCount(), stats.parseMs, stats.mergeMs);
+    bool same = SameMesh(serial, parallel);
+    std::printf("identical output: %s\n", same ? "yes" : "NO");
+    return same ? 0 : 1;
+}
@@ -0,0 +1,98 @@
+// bench_texture_compress.cpp
+// Texture load cost with and without the block-compressed cache (TextureCache.h): for
+// each image, stb_image decode time and the uncompressed footprint with mips (what
+// TextureManager uploads without a cache), the one-off BuildTextureCache time, and
+// the time OpenTextureCache takes to map and validate the cache, with its size.
+// Defaults to the tree textures and both skyboxes under ../resources. Caches are
+// written next to the images, as on a first run.
+//
+// Not part of the Visual Studio project; built by the Makefile's tools target:
+//   make bench_texture_compress      (or: make tools)
+//   ./bench_texture_compress [image ...]     (six "a;b;c;d;e;f" paths make a cubemap)
+
+#include "TextureCache.h"
+
+#include "stb_image.h"
+
+#include <chrono>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static double Ms(std::chrono::high_resolution_clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+}
+
+static std::vector<std::string> Split(const std::string& s) {
+    std::vector<std::string> out;
+    std::stringstream ss(s);
+    for (std::string part; std::getline(ss, part, ';');) out.push_back(part);
+    return out;
+}
+
+static std::string Faces(const std::string& folder) {
+    std::string s;
+    for (const char* f : { "right", "left", "top", "bottom", "front", "back" }) s += (s.empty() ? "" : ";") + folder + f + ".png";
+    return s;
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> inputs;
+    for (int i = 1; i < argc; ++i) inputs.push_back(argv[i]);
+    if (inputs.empty()) {
+        inputs = { "../resources/models/BarkDecidious0143_5_S.jpg", "../resources/models/BarkDecidious0194_7_S.jpg",
+            "../resources/models/Leaves0120_35_S.png", "../resources/models/Leaves0142_4_S.png",
+            "../resources/models/Leaves0156_1_S.png",
+            Faces("../resources/skybox/"), Faces("../resources/skybox_dry/") };
+    }
+
+    std::printf("%-44s %6s %10s %10s %10s %10s %10s\n", "image", "format", "decode", "raw+mips", "build", "open", "cache");
+    double rawTotal = 0.0, cacheTotal = 0.0, decodeTotal = 0.0, openTotal = 0.0;
+    for (const std::string& input : inputs) {
+        std::vector<std::string> sources = Split(input);
+        if (sources.size() != 1 && sources.size() != 6) continue;
+
+        auto t0 = std::chrono::high_resolution_clock::now();
+        size_t raw = 0;
+        bool ok = true;
+        for (const std::string& s : sources) {
+            int w = 0, h = 0, comp = 0;
+            unsigned char* pixels = stbi_load(s.c_str(), &w, &h, &comp, 0);
+            if (!pixels) {
+                ok = false;
+                break;
+            }
+            raw += (size_t)w * h * (comp == 3 ? 4 : comp) * 4 / 3; // drivers pad RGB8 to 4 bytes
+            stbi_image_free(pixels);
+        }
+        double decodeMs = Ms(t0);
+        if (!ok) {
+            std::printf("%-44s cannot load\n", sources[0].c_str());
+            continue;
+        }
+
+        std::string cachePath = TextureCachePath(sources[0], sources.size() == 1, sources.size() == 6);
+        t0 = std::chrono::high_resolution_clock::now();
+        if (!BuildTextureCache(sources, sources.size() == 1, true, cachePath)) return 1;
+        double buildMs = Ms(t0);
+
+        MappedFile file;
+        CompressedImage img;
+        t0 = std::chrono::high_resolution_clock::now();
+        if (!OpenTextureCache(cachePath, sources, file, img)) return 1;
+        double openMs = Ms(t0);
+
+        static const char* kNames[] = { "-", "BC1", "BC3", "BC4", "BC5", "BC7" };
+        std::string name = sources[0].substr(sources[0].find_last_of("/\\") + 1) + (sources.size() == 6 ? " (cube)" : "");
+        std::printf("%-44s %6s %7.1f ms %7.1f MB %7.0f ms %7.2f ms %7.1f MB\n", name.c_str(), kNames[(int)img.format],
+            decodeMs, raw / 1048576.0, buildMs, openMs, file.Size() / 1048576.0);
+        rawTotal += raw;
+        cacheTotal += (double)file.Size();
+        decodeTotal += decodeMs;
+        openTotal += openMs;
+    }
+    std::printf("total: decode %.0f ms -> open %.1f ms, %.1f MB -> %.1f MB (%.1fx smaller)\n", decodeTotal, openTotal,
+        rawTotal / 1048576.0, cacheTotal / 1048576.0, cacheTotal > 0.0 ? rawTotal / cacheTotal : 0.0);
+    return 0;
+}
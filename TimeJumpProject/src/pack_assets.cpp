@@ -0,0 +1,71 @@
+// pack_assets.cpp
+// Packs every file under resources/ into resources.pack (AssetPack.h) next to it; the
+// demo mounts the pack at startup and falls back to the loose files for anything it
+// lacks. Run the demo once first so the texture and mesh caches (.dds, .meshbin)
+// exist: packed along, they load without the originals being decoded or parsed again.
+//
+// Not part of the Visual Studio project; built by the Makefile's tools target:
+//   make pack_assets      (or: make tools)
+//   ./pack_assets [folder holding resources/] [--store]     (--store: no LZ4)
+
+#include "AssetPack.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv) {
+    namespace fs = std::filesystem;
+    std::string folder = ".";
+    bool compress = true;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--store") == 0) compress = false;
+        else folder = argv[i];
+    }
+
+    fs::path resources = fs::path(folder) / "resources";
+    if (!fs::is_directory(resources)) {
+        std::printf("no resources/ in %s\n", folder.c_str());
+        return 1;
+    }
+    std::vector<std::string> paths;
+    uint64_t looseBytes = 0;
+    for (const fs::directory_entry& e : fs::recursive_directory_iterator(resources)) {
+        if (!e.is_regular_file() || e.path().extension() == ".tmp") continue; // caches being written
+        paths.push_back(fs::relative(e.path(), folder).generic_string());
+        looseBytes += e.file_size();
+    }
+    std::sort(paths.begin(), paths.end());
+
+    std::string out = (fs::path(folder) / kAssetPackName).string();
+    auto t0 = std::chrono::high_resolution_clock::now();
+    if (!WriteAssetPack(folder, paths, out, compress)) return 1;
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+    std::printf("%s: %zu files, %.1f MB -> %.1f MB in %.0f ms\n", out.c_str(), paths.size(), looseBytes / 1048576.0,
+        fs::file_size(out) / 1048576.0, ms);
+
+    // read everything back through the pack and compare with the loose files
+    AssetPack pack;
+    if (!pack.Open(out)) return 1;
+    std::vector<unsigned char> bytes;
+    double readMs = 0.0;
+    for (const std::string& p : paths) {
+        t0 = std::chrono::high_resolution_clock::now();
+        const AssetPackEntry* e = pack.Find(p);
+        bytes.resize(e ? (size_t)e->size : 0);
+        bool ok = e && pack.Decompress(*e, bytes.data());
+        readMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+        MappedFile loose;
+        if (!ok || !loose.Open((fs::path(folder) / p).string()) || loose.Size() != bytes.size() ||
+            (loose.Size() && std::memcmp(loose.Data(), bytes.data(), bytes.size()) != 0)) {
+            std::printf("%s: does not read back\n", p.c_str());
+            return 1;
+        }
+    }
+    std::printf("read back and verified, %.0f ms\n", readMs);
+    return 0;
+}